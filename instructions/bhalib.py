@@ -29,7 +29,16 @@ import shutil
 use_output()
 shutil.copy(os.path.join(LOCATION, "libs", "1st", "yk__lib.h"), os.path.join(TEMP, "yk__lib.h"))
 shutil.copy(os.path.join(LOCATION, "libs", "1st", "yk__sort.h"), os.path.join(TEMP, "yk__sort.h"))
+shutil.copy(os.path.join(LOCATION, "libs", "1st", "yk__sdsrope.h"), os.path.join(TEMP, "yk__sdsrope.h"))
+# Concurrent hash map needs yk__thread.h, so it is not part of yk__lib.h
+shutil.copy(os.path.join(LOCATION, "libs", "1st", "yk__chashmap.h"), os.path.join(LOCATION, "output", "yk__chashmap.h"))
+# Parallel sort needs yk__thread.h too
+shutil.copy(os.path.join(LOCATION, "libs", "1st", "yk__psort.h"), os.path.join(LOCATION, "output", "yk__psort.h"))
 shutil.copy(os.path.join(LOCATION, "output", "yk__stb_ds.h"), os.path.join(TEMP, "yk__stb_ds.h"))
+# This patch applies to yk__sds
+# Adds growth policies and bulk appends so large buffers are not reallocated over and over
+patch("yk__sds.patch")
+copy_file("yk__sds.h", "yk__sds_patched.h", is_temp=True)
 # This patch applies to yk__stb_ds
 # This allow to use the strdup method of stb_ds with sds by delegating to features of sds :) cool ha!
 patch("yk__stb_ds.patch")
@@ -0,0 +1,293 @@
+/**
+Sharded concurrent hash map on top of yk__stb_ds and yk__thread as a single file header by Bhathiya Perera
+
+MIT License
+Copyright (c) 2022 Bhathiya Perera
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+// ======================================================================= //
+//                               Notes                                     //
+// ======================================================================= //
+
+Keys are spread over a power of two number of shards by their hash, each
+shard is a plain yk__stb_ds hashmap guarded by its own reader-writer lock.
+Readers of a shard run in parallel, a writer waits for them to leave and
+keeps new readers out until it is done. Threads only contend when they use
+the same shard, so use a few times more shards than threads.
+
+Entries are the key followed by the value, both are copied in and out with
+memcpy. String maps take yk__sds keys and keep their own copy of each key.
+Keys and values are always passed by address, for string maps the key is
+the address of an yk__sds.
+
+Include yk__lib.h and yk__thread.h before this file, and define
+YK__CHASHMAP_IMPLEMENTATION in one file to get the implementation.
+*/
+#ifndef YK__CHASHMAP
+#define YK__CHASHMAP
+#include <stddef.h>
+#ifndef YK__CHASHMAP_SHARDS
+#define YK__CHASHMAP_SHARDS 64
+#endif
+#define YK__CHASHMAP_CACHE_LINE_SIZE 64
+/**
+ * One shard, padded to a cache line so locks of neighbours do not share one
+ * (the shard array is allocated aligned to a cache line)
+ */
+typedef struct yk__chashmap_shard {
+  yk__thread_atomic_int_t state;// reader count and writer bits
+  void *map;                    // yk__stb_ds hashmap of the entries
+  char pad[YK__CHASHMAP_CACHE_LINE_SIZE - sizeof(yk__thread_atomic_int_t) -
+           sizeof(void *)];
+} yk__chashmap_shard;
+/**
+ * Concurrent hash map, initialize with yk__chashmap_init() or
+ * yk__chashmap_init_str()
+ */
+typedef struct yk__chashmap {
+  yk__chashmap_shard *shards;// cache line aligned inside shard_memory
+  void *shard_memory;
+  size_t shard_count;        // power of two
+  size_t keysize;            // sizeof(yk__sds) for string keys
+  size_t valuesize;
+  size_t valueoffset;// offset of the value in an entry, the key is first
+  size_t elemsize;   // size of an entry
+  int mode;          // YK__STBDS_HM_BINARY or YK__STBDS_HM_STRING
+} yk__chashmap;
+/**
+ * Initialize a map with keys of keysize bytes compared with memcmp
+ * @param m map
+ * @param shards number of shards, rounded up to a power of two,
+ *               0 for YK__CHASHMAP_SHARDS
+ * @param keysize size of a key
+ * @param valuesize size of a value
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__chashmap_init(yk__chashmap *m, size_t shards, size_t keysize,
+                      size_t valuesize);
+/**
+ * Initialize a map with yk__sds keys, keys are copied when inserted
+ * @param m map
+ * @param shards number of shards, see yk__chashmap_init()
+ * @param valuesize size of a value
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__chashmap_init_str(yk__chashmap *m, size_t shards, size_t valuesize);
+/**
+ * Free all entries and shards, no other thread may use the map
+ * @param m map
+ */
+void yk__chashmap_free(yk__chashmap *m);
+/**
+ * Insert a key and value or update the value of an existing key
+ * @param m map
+ * @param key address of key
+ * @param value address of value
+ */
+void yk__chashmap_put(yk__chashmap *m, const void *key, const void *value);
+/**
+ * Copy the value of a key
+ * @param m map
+ * @param key address of key
+ * @param value where to copy the value, not touched if key is missing
+ * @return 1 if key was found, 0 otherwise
+ */
+int yk__chashmap_get(yk__chashmap *m, const void *key, void *value);
+/**
+ * Delete a key
+ * @param m map
+ * @param key address of key
+ * @return 1 if key was deleted, 0 if it was not present
+ */
+int yk__chashmap_del(yk__chashmap *m, const void *key);
+/**
+ * Get number of entries, only exact when no other thread is writing
+ * @param m map
+ */
+size_t yk__chashmap_len(yk__chashmap *m);
+#define yk__chmput(m, k, v) yk__chashmap_put((m), &(k), &(v))
+#define yk__chmget(m, k, v) yk__chashmap_get((m), &(k), &(v))
+#define yk__chmdel(m, k) yk__chashmap_del((m), &(k))
+#define yk__chmlen(m) yk__chashmap_len(m)
+#ifdef YK__CHASHMAP_IMPLEMENTATION
+#include <stdlib.h>// malloc
+#include <string.h>// memcpy
+#define YK__CHASHMAP_WRITER (1 << 30) // a writer holds the lock
+#define YK__CHASHMAP_WAITING (1 << 29)// a writer waits for the readers
+#define YK__CHASHMAP_SPINS 64
+// stb_ds hashmaps point after their default entry
+#define yk__chashmap_raw(m, map) ((char *) (map) - (m)->elemsize)
+static void yk__chashmap_spin(int *spins) {
+  if (++*spins == YK__CHASHMAP_SPINS) {
+    *spins = 0;
+    yk__thread_yield();
+  }
+}
+static void yk__chashmap_read_lock(yk__chashmap_shard *s) {
+  int spins = 0;
+  // uncontended readers only pay for one atomic add, waiting writers go first
+  // so a stream of readers can not starve them
+  while (yk__thread_atomic_int_inc(&s->state) >= YK__CHASHMAP_WAITING) {
+    yk__thread_atomic_int_dec(&s->state);
+    while (yk__thread_atomic_int_load(&s->state) >= YK__CHASHMAP_WAITING)
+      yk__chashmap_spin(&spins);
+  }
+}
+static void yk__chashmap_read_unlock(yk__chashmap_shard *s) {
+  yk__thread_atomic_int_dec(&s->state);
+}
+static void yk__chashmap_write_lock(yk__chashmap_shard *s) {
+  int spins = 0;
+  for (;;) {
+    int state = yk__thread_atomic_int_load(&s->state);
+    if ((state & ~YK__CHASHMAP_WAITING) == 0) {
+      if (yk__thread_atomic_int_compare_and_swap(
+              &s->state, state, YK__CHASHMAP_WRITER) == state)
+        return;
+    } else if (!(state & YK__CHASHMAP_WAITING)) {
+      // keep new readers out while the current ones finish
+      yk__thread_atomic_int_compare_and_swap(&s->state, state,
+                                             state | YK__CHASHMAP_WAITING);
+    }
+    yk__chashmap_spin(&spins);
+  }
+}
+static void yk__chashmap_write_unlock(yk__chashmap_shard *s) {
+  yk__thread_atomic_int_sub(&s->state, YK__CHASHMAP_WRITER);
+}
+static int yk__chashmap_init_mode(yk__chashmap *m, size_t shards,
+                                  size_t keysize, size_t valuesize, int mode) {
+  size_t i, align = sizeof(void *);
+  if (shards == 0) shards = YK__CHASHMAP_SHARDS;
+  m->shard_count = 1;
+  while (m->shard_count < shards) m->shard_count *= 2;
+  m->keysize = keysize;
+  m->valuesize = valuesize;
+  m->valueoffset = (keysize + align - 1) / align * align;
+  m->elemsize = (m->valueoffset + valuesize + align - 1) / align * align;
+  m->mode = mode;
+  // malloc only aligns to 16 bytes, over-allocate and align the shards
+  m->shard_memory = malloc(m->shard_count * sizeof(yk__chashmap_shard) +
+                           YK__CHASHMAP_CACHE_LINE_SIZE - 1);
+  if (m->shard_memory == NULL) return -1;
+  m->shards = (yk__chashmap_shard *) (((size_t) m->shard_memory +
+                                       YK__CHASHMAP_CACHE_LINE_SIZE - 1) &
+                                      ~(size_t) (YK__CHASHMAP_CACHE_LINE_SIZE -
+                                                 1));
+  memset(m->shards, 0, m->shard_count * sizeof(yk__chashmap_shard));
+  // hash indexes are created here, later resizes reuse their seed and do not
+  // touch the global seed of yk__stb_ds from many threads
+  for (i = 0; i < m->shard_count; i++) {
+    m->shards[i].map = yk__stbds_shmode_func(
+        m->elemsize,
+        mode == YK__STBDS_HM_STRING ? YK__STBDS_SH_STRDUP : YK__STBDS_SH_NONE);
+  }
+  return 0;
+}
+int yk__chashmap_init(yk__chashmap *m, size_t shards, size_t keysize,
+                      size_t valuesize) {
+  return yk__chashmap_init_mode(m, shards, keysize, valuesize,
+                                YK__STBDS_HM_BINARY);
+}
+int yk__chashmap_init_str(yk__chashmap *m, size_t shards, size_t valuesize) {
+  return yk__chashmap_init_mode(m, shards, sizeof(yk__sds), valuesize,
+                                YK__STBDS_HM_STRING);
+}
+void yk__chashmap_free(yk__chashmap *m) {
+  size_t i;
+  for (i = 0; i < m->shard_count; i++) {
+    yk__stbds_hmfree_func(yk__chashmap_raw(m, m->shards[i].map), m->elemsize);
+  }
+  free(m->shard_memory);
+  memset(m, 0, sizeof(yk__chashmap));
+}
+/**
+ * Pick the shard of a key and the key pointer yk__stb_ds wants for it
+ */
+static yk__chashmap_shard *yk__chashmap_shard_of(yk__chashmap *m,
+                                                 const void *key,
+                                                 void **stbds_key) {
+  size_t hash;
+  if (m->mode == YK__STBDS_HM_STRING) {
+    *stbds_key = *(yk__sds const *) key;
+    hash = yk__sdshashlen(*stbds_key, yk__sdslen(*stbds_key), 0);
+  } else {
+    *stbds_key = (void *) key;
+    hash = yk__stbds_hash_bytes(*stbds_key, m->keysize, 0);
+  }
+  // low bits pick the slot inside the shard, use the high ones here
+  hash ^= hash >> 16;
+  return &m->shards[(hash >> 8) & (m->shard_count - 1)];
+}
+void yk__chashmap_put(yk__chashmap *m, const void *key, const void *value) {
+  void *stbds_key;
+  yk__chashmap_shard *s = yk__chashmap_shard_of(m, key, &stbds_key);
+  char *entry;
+  yk__chashmap_write_lock(s);
+  s->map = yk__stbds_hmput_key(s->map, m->elemsize, stbds_key, m->keysize,
+                               m->mode);
+  entry = (char *) s->map +
+          m->elemsize * yk__stbds_temp(yk__chashmap_raw(m, s->map));
+  if (m->mode == YK__STBDS_HM_STRING) {
+    *(char **) entry = yk__stbds_temp_key(yk__chashmap_raw(m, s->map));
+  } else {
+    memcpy(entry, key, m->keysize);
+  }
+  memcpy(entry + m->valueoffset, value, m->valuesize);
+  yk__chashmap_write_unlock(s);
+}
+int yk__chashmap_get(yk__chashmap *m, const void *key, void *value) {
+  void *stbds_key;
+  yk__chashmap_shard *s = yk__chashmap_shard_of(m, key, &stbds_key);
+  ptrdiff_t i;
+  yk__chashmap_read_lock(s);
+  // the _ts lookup does not write to the map, so readers can share it
+  yk__stbds_hmget_key_ts(s->map, m->elemsize, stbds_key, m->keysize, &i,
+                         m->mode);
+  if (i >= 0) {
+    memcpy(value, (char *) s->map + m->elemsize * i + m->valueoffset,
+           m->valuesize);
+  }
+  yk__chashmap_read_unlock(s);
+  return i >= 0;
+}
+int yk__chashmap_del(yk__chashmap *m, const void *key) {
+  void *stbds_key;
+  yk__chashmap_shard *s = yk__chashmap_shard_of(m, key, &stbds_key);
+  int deleted;
+  yk__chashmap_write_lock(s);
+  s->map = yk__stbds_hmdel_key(s->map, m->elemsize, stbds_key, m->keysize, 0,
+                               m->mode);
+  deleted = (int) yk__stbds_temp(yk__chashmap_raw(m, s->map));
+  yk__chashmap_write_unlock(s);
+  return deleted;
+}
+size_t yk__chashmap_len(yk__chashmap *m) {
+  size_t i, len = 0;
+  for (i = 0; i < m->shard_count; i++) {
+    yk__chashmap_shard *s = &m->shards[i];
+    yk__chashmap_read_lock(s);
+    len += yk__stbds_header(yk__chashmap_raw(m, s->map))->length - 1;
+    yk__chashmap_read_unlock(s);
+  }
+  return len;
+}
+#endif
+#endif
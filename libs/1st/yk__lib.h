@@ -1,4 +1,5 @@
-#include "yk__sds.h"
+#include "yk__sds_patched.h"
+#include "yk__sdsrope.h"
 #include "yk__stb_ds_patched.h"
 #include "yk__bhalib.h"
 #include "yk__sort.h"
@@ -0,0 +1,414 @@
+/**
+Chunked string builder (rope) on top of yk__sds as a single file header by Bhathiya Perera
+
+MIT License
+Copyright (c) 2022 Bhathiya Perera
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+// ======================================================================= //
+//                               Notes                                     //
+// ======================================================================= //
+
+A rope is a deque of yk__sds chunks. Small appends are copied into the free
+space of the last chunk (chunks are YK__SDSROPE_CHUNK_SIZE bytes), large
+pieces become chunks of their own. Small prepends and inserts go into the
+free space of the chunk they touch, moving at most a chunk worth of bytes. Nothing is ever moved once written, so
+building a large text costs a single copy per byte, plus one more when the
+rope is flattened (or none at all if it is written with writev).
+*/
+#ifndef YK__SDSROPE
+#define YK__SDSROPE
+#include <stddef.h>
+#ifndef YK__SDSROPE_CHUNK_SIZE
+#define YK__SDSROPE_CHUNK_SIZE 4096
+#endif
+/**
+ * Rope of yk__sds chunks, initialize with yk__sdsrope_init()
+ */
+typedef struct yk__sdsrope {
+  yk__sds *chunks;// storage for the chunk deque
+  size_t head;    // index of the first chunk in storage
+  size_t count;   // number of chunks in use
+  size_t capacity;// number of slots in storage
+  size_t length;  // total number of bytes
+} yk__sdsrope;
+/**
+ * Initialize an empty rope
+ * @param r rope
+ */
+void yk__sdsrope_init(yk__sdsrope *r);
+/**
+ * Free all chunks of the rope, rope can be reused after init
+ * @param r rope
+ */
+void yk__sdsrope_free(yk__sdsrope *r);
+/**
+ * Append bytes to end of rope (amortized O(1))
+ * @param r rope
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_append(yk__sdsrope *r, const void *data, size_t len);
+/**
+ * Append a copy of an yk__sds string to end of rope
+ * @param r rope
+ * @param s string
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_append_sds(yk__sdsrope *r, const yk__sds s);
+/**
+ * Append an yk__sds string as a chunk without copying it
+ * Rope takes ownership of s, do not free or modify it afterwards
+ * @param r rope
+ * @param s string
+ * @return 0 if successful, -1 if out of memory (s is not taken)
+ */
+int yk__sdsrope_adopt(yk__sdsrope *r, yk__sds s);
+/**
+ * Add bytes to the beginning of rope, small pieces are copied into the free
+ * space of the first chunk (O(YK__SDSROPE_CHUNK_SIZE))
+ * @param r rope
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_prepend(yk__sdsrope *r, const void *data, size_t len);
+/**
+ * Insert bytes at given byte position, cost is O(number of chunks)
+ * @param r rope
+ * @param pos position (clamped to length of rope)
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_insert(yk__sdsrope *r, size_t pos, const void *data,
+                       size_t len);
+/**
+ * Get total length of rope in bytes
+ */
+size_t yk__sdsrope_len(const yk__sdsrope *r);
+/**
+ * Get number of chunks in rope
+ */
+size_t yk__sdsrope_chunk_count(const yk__sdsrope *r);
+/**
+ * Get a chunk of the rope, it is owned by the rope so only read it
+ * @param r rope
+ * @param i index of the chunk
+ * @return yk__sds chunk
+ */
+yk__sds yk__sdsrope_chunk(const yk__sdsrope *r, size_t i);
+/**
+ * Copy the rope to a single new yk__sds string (allocated only once)
+ * @param r rope
+ * @return new yk__sds string or NULL if out of memory
+ */
+yk__sds yk__sdsrope_flatten(const yk__sdsrope *r);
+/**
+ * Write the rope to a file descriptor (uses writev where available)
+ * @param r rope
+ * @param fd file descriptor
+ * @return 0 if successful, -1 if write failed
+ */
+int yk__sdsrope_write(const yk__sdsrope *r, int fd);
+#ifdef YK__SDSROPE_IMPLEMENTATION
+#include <errno.h>
+#include <stdlib.h>// malloc
+#include <string.h>// memcpy
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifndef YK__SDSROPE_IOV_MAX
+#define YK__SDSROPE_IOV_MAX 64
+#endif
+#define yk__sdsrope_at(r, i) ((r)->chunks[(r)->head + (i)])
+void yk__sdsrope_init(yk__sdsrope *r) { memset(r, 0, sizeof(yk__sdsrope)); }
+void yk__sdsrope_free(yk__sdsrope *r) {
+  size_t i;
+  for (i = 0; i < r->count; i++) { yk__sdsfree(yk__sdsrope_at(r, i)); }
+  free(r->chunks);
+  memset(r, 0, sizeof(yk__sdsrope));
+}
+/**
+ * Make sure there are at least front free slots before the first chunk and
+ * back free slots after the last chunk
+ * @return 0 if successful, -1 if out of memory
+ */
+static int yk__sdsrope_reserve(yk__sdsrope *r, size_t front, size_t back) {
+  size_t cap, head;
+  yk__sds *chunks;
+  if (r->head >= front && r->capacity - r->head - r->count >= back) return 0;
+  cap = r->capacity * 2;
+  if (cap < 8) cap = 8;
+  while (cap < r->count + front + back) cap *= 2;
+  chunks = malloc(cap * sizeof(yk__sds));
+  if (chunks == NULL) return -1;
+  // appending is the common case, only keep slack in front if asked for it
+  head = 0;
+  if (front > 0) head = front + (cap - r->count - front - back) / 2;
+  if (r->count > 0) {
+    memcpy(chunks + head, r->chunks + r->head, r->count * sizeof(yk__sds));
+  }
+  free(r->chunks);
+  r->chunks = chunks;
+  r->head = head;
+  r->capacity = cap;
+  return 0;
+}
+/**
+ * Create a new chunk holding given data
+ * small chunks get YK__SDSROPE_CHUNK_SIZE capacity so later appends fit in
+ */
+static yk__sds yk__sdsrope_new_chunk(const void *data, size_t len) {
+  yk__sds chunk;
+  if (len >= YK__SDSROPE_CHUNK_SIZE) return yk__sdsnewlen(data, len);
+  chunk = yk__sdssetgrowth(yk__sdsempty(), YK__SDS_GROW_EXACT);
+  if (chunk == NULL) return NULL;
+  chunk = yk__sdsMakeRoomFor(chunk, YK__SDSROPE_CHUNK_SIZE);
+  if (chunk == NULL) return NULL;
+  return yk__sdscatlen(chunk, data, len);
+}
+/**
+ * Check that len bytes can go into the free space of a chunk that is small
+ * enough to move its bytes around
+ */
+#define yk__sdsrope_fits(chunk, len)                                           \
+  (yk__sdslen(chunk) <= YK__SDSROPE_CHUNK_SIZE && yk__sdsavail(chunk) >= (len))
+/**
+ * Copy data into the free space of chunk at offset, moving the bytes after
+ * offset up (the caller checks that it fits)
+ */
+static void yk__sdsrope_fill(yk__sds chunk, size_t offset, const void *data,
+                             size_t len) {
+  memmove(chunk + offset + len, chunk + offset, yk__sdslen(chunk) - offset);
+  memcpy(chunk + offset, data, len);
+  yk__sdsIncrLen(chunk, (ssize_t) len);
+}
+/**
+ * Insert already created chunks at chunk index i
+ * @return 0 if successful, -1 if out of memory
+ */
+static int yk__sdsrope_insert_chunks(yk__sdsrope *r, size_t i, yk__sds *items,
+                                     size_t n) {
+  if (i == 0 && r->count > 0) {
+    if (yk__sdsrope_reserve(r, n, 0) != 0) return -1;
+    r->head -= n;
+  } else {
+    if (yk__sdsrope_reserve(r, 0, n) != 0) return -1;
+    memmove(&yk__sdsrope_at(r, i + n), &yk__sdsrope_at(r, i),
+            (r->count - i) * sizeof(yk__sds));
+  }
+  memcpy(&yk__sdsrope_at(r, i), items, n * sizeof(yk__sds));
+  r->count += n;
+  return 0;
+}
+int yk__sdsrope_append(yk__sdsrope *r, const void *data, size_t len) {
+  const char *p = (const char *) data;
+  yk__sds chunk;
+  if (len == 0) return 0;
+  if (r->count > 0) {
+    // fill the free space of the last chunk first
+    yk__sds last = yk__sdsrope_at(r, r->count - 1);
+    size_t fill = yk__sdsavail(last);
+    if (fill > len) fill = len;
+    if (fill > 0) {
+      memcpy(last + yk__sdslen(last), p, fill);
+      yk__sdsIncrLen(last, (ssize_t) fill);
+      r->length += fill;
+      p += fill;
+      len -= fill;
+      if (len == 0) return 0;
+    }
+  }
+  chunk = yk__sdsrope_new_chunk(p, len);
+  if (chunk == NULL) return -1;
+  if (yk__sdsrope_insert_chunks(r, r->count, &chunk, 1) != 0) {
+    yk__sdsfree(chunk);
+    return -1;
+  }
+  r->length += len;
+  return 0;
+}
+int yk__sdsrope_append_sds(yk__sdsrope *r, const yk__sds s) {
+  return yk__sdsrope_append(r, s, yk__sdslen(s));
+}
+int yk__sdsrope_adopt(yk__sdsrope *r, yk__sds s) {
+  if (yk__sdsrope_insert_chunks(r, r->count, &s, 1) != 0) return -1;
+  r->length += yk__sdslen(s);
+  return 0;
+}
+int yk__sdsrope_prepend(yk__sdsrope *r, const void *data, size_t len) {
+  yk__sds chunk;
+  if (len == 0) return 0;
+  if (r->count > 0 && yk__sdsrope_fits(yk__sdsrope_at(r, 0), len)) {
+    yk__sdsrope_fill(yk__sdsrope_at(r, 0), 0, data, len);
+    r->length += len;
+    return 0;
+  }
+  chunk = yk__sdsrope_new_chunk(data, len);
+  if (chunk == NULL) return -1;
+  if (yk__sdsrope_insert_chunks(r, 0, &chunk, 1) != 0) {
+    yk__sdsfree(chunk);
+    return -1;
+  }
+  r->length += len;
+  return 0;
+}
+int yk__sdsrope_insert(yk__sdsrope *r, size_t pos, const void *data,
+                       size_t len) {
+  size_t i, offset, chunk_len = 0;
+  yk__sds chunk, parts[2];
+  if (len == 0) return 0;
+  if (pos >= r->length) return yk__sdsrope_append(r, data, len);
+  if (pos == 0) return yk__sdsrope_prepend(r, data, len);
+  // find chunk i that contains byte at pos
+  offset = pos;
+  for (i = 0; i < r->count; i++) {
+    chunk_len = yk__sdslen(yk__sdsrope_at(r, i));
+    if (offset < chunk_len) break;
+    offset -= chunk_len;
+  }
+  if (offset == 0) {
+    // insert between chunk i - 1 and chunk i, at the end of the first one or
+    // the start of the second one if it fits
+    chunk = yk__sdsrope_at(r, i - 1);
+    if (yk__sdsavail(chunk) >= len) {
+      yk__sdsrope_fill(chunk, yk__sdslen(chunk), data, len);
+      r->length += len;
+      return 0;
+    }
+    chunk = yk__sdsrope_at(r, i);
+    if (yk__sdsrope_fits(chunk, len)) {
+      yk__sdsrope_fill(chunk, 0, data, len);
+      r->length += len;
+      return 0;
+    }
+    chunk = yk__sdsrope_new_chunk(data, len);
+    if (chunk == NULL) return -1;
+    if (yk__sdsrope_insert_chunks(r, i, &chunk, 1) != 0) {
+      yk__sdsfree(chunk);
+      return -1;
+    }
+    r->length += len;
+    return 0;
+  }
+  chunk = yk__sdsrope_at(r, i);
+  if (yk__sdsrope_fits(chunk, len)) {
+    // chunks are small, just make a gap in place
+    yk__sdsrope_fill(chunk, offset, data, len);
+    r->length += len;
+    return 0;
+  }
+  // split chunk i at offset and put data in between
+  parts[0] = yk__sdsrope_new_chunk(data, len);
+  if (parts[0] == NULL) return -1;
+  parts[1] = yk__sdsnewlen(chunk + offset, chunk_len - offset);
+  if (parts[1] == NULL || yk__sdsrope_insert_chunks(r, i + 1, parts, 2) != 0) {
+    yk__sdsfree(parts[0]);
+    yk__sdsfree(parts[1]);
+    return -1;
+  }
+  yk__sdsIncrLen(chunk, -(ssize_t) (chunk_len - offset));
+  r->length += len;
+  return 0;
+}
+size_t yk__sdsrope_len(const yk__sdsrope *r) { return r->length; }
+size_t yk__sdsrope_chunk_count(const yk__sdsrope *r) { return r->count; }
+yk__sds yk__sdsrope_chunk(const yk__sdsrope *r, size_t i) {
+  return yk__sdsrope_at(r, i);
+}
+yk__sds yk__sdsrope_flatten(const yk__sdsrope *r) {
+  size_t i;
+  char *p;
+  yk__sds s = yk__sdsnewlen(YK__SDS_NOINIT, r->length);
+  if (s == NULL) return NULL;
+  p = s;
+  for (i = 0; i < r->count; i++) {
+    yk__sds chunk = yk__sdsrope_at(r, i);
+    memcpy(p, chunk, yk__sdslen(chunk));
+    p += yk__sdslen(chunk);
+  }
+  return s;
+}
+int yk__sdsrope_write(const yk__sdsrope *r, int fd) {
+#if defined(_WIN32)
+  size_t i;
+  for (i = 0; i < r->count; i++) {
+    const char *p = yk__sdsrope_at(r, i);
+    size_t left = yk__sdslen(yk__sdsrope_at(r, i));
+    while (left > 0) {
+      unsigned int n = left > 0x40000000 ? 0x40000000 : (unsigned int) left;
+      int written = _write(fd, p, n);
+      if (written <= 0) return -1;// 0 would never finish
+      p += written;
+      left -= (size_t) written;
+    }
+  }
+  return 0;
+#else
+  struct iovec iov[YK__SDSROPE_IOV_MAX];
+  size_t i = 0, skip = 0;// skip bytes of chunk i that are already written
+  while (i < r->count) {
+    int n = 0;
+    size_t j = i;
+    ssize_t written;
+    while (j < r->count && n < YK__SDSROPE_IOV_MAX) {
+      yk__sds chunk = yk__sdsrope_at(r, j);
+      size_t offset = (j == i) ? skip : 0;
+      if (yk__sdslen(chunk) > offset) {
+        iov[n].iov_base = chunk + offset;
+        iov[n].iov_len = yk__sdslen(chunk) - offset;
+        n++;
+      }
+      j++;
+    }
+    if (n == 0) break;
+    written = writev(fd, iov, n);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    // advance over fully and partially written chunks
+    while (i < r->count && written > 0) {
+      size_t left = yk__sdslen(yk__sdsrope_at(r, i)) - skip;
+      if ((size_t) written < left) {
+        skip += (size_t) written;
+        written = 0;
+      } else {
+        written -= (ssize_t) left;
+        skip = 0;
+        i++;
+      }
+    }
+    // skip empty chunks
+    while (i < r->count && yk__sdslen(yk__sdsrope_at(r, i)) == skip) {
+      skip = 0;
+      i++;
+    }
+  }
+  return 0;
+#endif
+}
+#endif
+#endif
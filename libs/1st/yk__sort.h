@@ -41,6 +41,20 @@ MIT License
 Copyright (c) 2020 ismdeep
 
 
+## Reference - pattern defeating quick sort
+https://github.com/orlp/pdqsort
+
+zlib License
+Copyright (c) 2021 Orson Peters
+
+
+## Reference - timsort run detection, merge rules and galloping
+https://github.com/python/cpython/blob/main/Objects/listsort.txt
+
+Python Software Foundation License
+Copyright (c) 2001 Python Software Foundation
+
+
 ## Reference - memswap
 https://gist.github.com/JadenGeller/3ab6fbc3f75690103ea6
 Unknown license, asked in above link
@@ -48,6 +62,8 @@ Unknown license, asked in above link
 #ifndef YK__SORT
 #define YK__SORT
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>// memcpy
 /**
  * Comparison function, returns 0 if equal > 0 for larger and < 0 for smaller
  */
@@ -58,27 +74,585 @@ typedef int (*yk__compare_function)(const void *, const void *);
  * @param item_size single item size
  * @param elements number of elements
  * @param cmp_func compare function
- * @return 0 if successful, -1 if partial
+ * @return 0 if successful, -1 if the temporary element could not be allocated
  */
 int yk__quicksort(void *arr, size_t item_size, size_t elements,
                   yk__compare_function cmp_func);
 /**
  * Perform a quick sort for given array (no malloc)
+ * Pattern defeating quick sort, O(n log n) worst case (falls back to heap
+ * sort), linear for sorted, reversed and all equal input, not stable.
  * @param arr array
  * @param item_size single item size
  * @param elements number of elements
  * @param cmp_func compare function
  * @param single_elem_buffer buffer for a single temporary element (item_size can be held)
- * @return 0 if successful, -1 if partial
+ * @return 0, the array is always fully sorted
  */
 int yk__quicksort_ex(void *arr, size_t item_size, size_t elements,
                      yk__compare_function cmp_func, void *single_elem_buffer);
+#define YK__SORT_INSERTION_THRESHOLD 24
+#define YK__SORT_NINTHER_THRESHOLD 128
+#define YK__SORT_PARTIAL_INSERTION_LIMIT 8
+#define YK__SORT_STACK_SIZE 64
+/**
+ * less for YK__DEFINE_SORT on integers and floats, the float version orders
+ * NaNs after every number so they do not break the sort
+ */
+#define YK__SORT_NUMBER_LESS(a, b) ((a) < (b))
+#define YK__SORT_FLOAT_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+/**
+ * Define a sort specialized for arrays of T, same algorithm as
+ * yk__quicksort_ex with the comparison and element moves inlined
+ * (scope is the linkage of the sort function, helpers are static inline)
+ */
+#define YK__SORT_DEFINE_TYPED(name, T, less, scope)                            \
+  static inline void name##_swap(T *arr, size_t a, size_t b) {                 \
+    T tmp = arr[a];                                                            \
+    arr[a] = arr[b];                                                           \
+    arr[b] = tmp;                                                              \
+  }                                                                            \
+  static inline int name##_insertion(T *arr, size_t begin, size_t end,         \
+                                     size_t limit) {                           \
+    size_t i, j, moved = 0;                                                    \
+    for (i = begin + 1; i < end; i++) {                                        \
+      T tmp;                                                                   \
+      if (!less(arr[i], arr[i - 1])) continue;                                 \
+      tmp = arr[i];                                                            \
+      j = i;                                                                   \
+      do {                                                                     \
+        arr[j] = arr[j - 1];                                                   \
+        j--;                                                                   \
+      } while (j > begin && less(tmp, arr[j - 1]));                            \
+      arr[j] = tmp;                                                            \
+      moved += i - j;                                                          \
+      if (moved > limit && i + 1 < end) return 0;                              \
+    }                                                                          \
+    return 1;                                                                  \
+  }                                                                            \
+  static inline void name##_sort3(T *arr, size_t a, size_t b, size_t c) {      \
+    if (less(arr[b], arr[a])) name##_swap(arr, a, b);                          \
+    if (less(arr[c], arr[b])) name##_swap(arr, b, c);                          \
+    if (less(arr[b], arr[a])) name##_swap(arr, a, b);                          \
+  }                                                                            \
+  static inline void name##_sift_down(T *arr, size_t root, size_t n) {         \
+    for (;;) {                                                                 \
+      size_t child = 2 * root + 1;                                             \
+      if (child >= n) return;                                                  \
+      if (child + 1 < n && less(arr[child], arr[child + 1])) child++;          \
+      if (!less(arr[root], arr[child])) return;                                \
+      name##_swap(arr, root, child);                                           \
+      root = child;                                                            \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_sift_up(T *arr, size_t pos) {                      \
+    while (pos > 0 && less(arr[(pos - 1) / 2], arr[pos])) {                    \
+      name##_swap(arr, (pos - 1) / 2, pos);                                    \
+      pos = (pos - 1) / 2;                                                     \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_sort_heap(T *arr, size_t n) {                      \
+    size_t i;                                                                  \
+    for (i = n; i > 1; i--) {                                                  \
+      name##_swap(arr, 0, i - 1);                                              \
+      name##_sift_down(arr, 0, i - 1);                                         \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_heapsort(T *arr, size_t n) {                       \
+    size_t i;                                                                  \
+    for (i = n / 2; i > 0; i--) name##_sift_down(arr, i - 1, n);               \
+    name##_sort_heap(arr, n);                                                  \
+  }                                                                            \
+  static inline size_t name##_partition_right(T *arr, size_t begin,            \
+                                              size_t end,                      \
+                                              int *already_partitioned) {      \
+    T pivot = arr[begin];                                                      \
+    size_t first = begin, last = end;                                          \
+    while (++first < end && less(arr[first], pivot)) {}                        \
+    if (first - 1 == begin) {                                                  \
+      while (first < last) {                                                   \
+        last--;                                                                \
+        if (less(arr[last], pivot)) break;                                     \
+      }                                                                        \
+    } else {                                                                   \
+      while (--last > begin && !less(arr[last], pivot)) {}                     \
+    }                                                                          \
+    *already_partitioned = first >= last;                                      \
+    while (first < last) {                                                     \
+      name##_swap(arr, first, last);                                           \
+      while (++first < end && less(arr[first], pivot)) {}                      \
+      while (--last > begin && !less(arr[last], pivot)) {}                     \
+    }                                                                          \
+    arr[begin] = arr[first - 1];                                               \
+    arr[first - 1] = pivot;                                                    \
+    return first - 1;                                                          \
+  }                                                                            \
+  static inline size_t name##_partition_left(T *arr, size_t begin,             \
+                                             size_t end) {                     \
+    T pivot = arr[begin];                                                      \
+    size_t first = begin, last = end;                                          \
+    while (--last > begin && less(pivot, arr[last])) {}                        \
+    if (last + 1 == end) {                                                     \
+      while (first < last) {                                                   \
+        first++;                                                               \
+        if (less(pivot, arr[first])) break;                                    \
+      }                                                                        \
+    } else {                                                                   \
+      while (++first < end && !less(pivot, arr[first])) {}                     \
+    }                                                                          \
+    while (first < last) {                                                     \
+      name##_swap(arr, first, last);                                           \
+      while (--last > begin && less(pivot, arr[last])) {}                      \
+      while (++first < end && !less(pivot, arr[first])) {}                     \
+    }                                                                          \
+    arr[begin] = arr[last];                                                    \
+    arr[last] = pivot;                                                         \
+    return last;                                                               \
+  }                                                                            \
+  static inline void name##_break_patterns(T *arr, size_t begin, size_t end) { \
+    size_t size = end - begin, q = size / 4;                                   \
+    if (size < YK__SORT_INSERTION_THRESHOLD) return;                           \
+    name##_swap(arr, begin, begin + q);                                        \
+    name##_swap(arr, end - 1, end - q);                                        \
+    if (size > YK__SORT_NINTHER_THRESHOLD) {                                   \
+      name##_swap(arr, begin + 1, begin + (q + 1));                            \
+      name##_swap(arr, begin + 2, begin + (q + 2));                            \
+      name##_swap(arr, end - 2, end - (q + 1));                                \
+      name##_swap(arr, end - 3, end - (q + 2));                                \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_choose_pivot(T *arr, size_t begin, size_t end) {   \
+    size_t size = end - begin, s2 = size / 2;                                  \
+    if (size > YK__SORT_NINTHER_THRESHOLD) {                                   \
+      name##_sort3(arr, begin, begin + s2, end - 1);                           \
+      name##_sort3(arr, begin + 1, begin + s2 - 1, end - 2);                   \
+      name##_sort3(arr, begin + 2, begin + s2 + 1, end - 3);                   \
+      name##_sort3(arr, begin + s2 - 1, begin + s2, begin + s2 + 1);           \
+      name##_swap(arr, begin, begin + s2);                                     \
+    } else {                                                                   \
+      name##_sort3(arr, begin + s2, begin, end - 1);                           \
+    }                                                                          \
+  }                                                                            \
+  scope void name(T *arr, size_t elements) {                                   \
+    struct {                                                                   \
+      size_t begin, end;                                                       \
+      int bad_allowed, leftmost;                                               \
+    } stack[YK__SORT_STACK_SIZE];                                              \
+    int top = 0, bad_allowed = 0, leftmost, already_partitioned;               \
+    size_t begin, end, size, pivot_pos, l_size, r_size;                        \
+    for (size = elements; size > 1; size >>= 1) bad_allowed++;                 \
+    stack[0].begin = 0;                                                        \
+    stack[0].end = elements;                                                   \
+    stack[0].bad_allowed = bad_allowed;                                        \
+    stack[0].leftmost = 1;                                                     \
+    while (top >= 0) {                                                         \
+      begin = stack[top].begin;                                                \
+      end = stack[top].end;                                                    \
+      bad_allowed = stack[top].bad_allowed;                                    \
+      leftmost = stack[top--].leftmost;                                        \
+      for (;;) {                                                               \
+        size = end - begin;                                                    \
+        if (size < YK__SORT_INSERTION_THRESHOLD) {                             \
+          name##_insertion(arr, begin, end, (size_t) -1);                      \
+          break;                                                               \
+        }                                                                      \
+        name##_choose_pivot(arr, begin, end);                                  \
+        if (!leftmost && !less(arr[begin - 1], arr[begin])) {                  \
+          begin = name##_partition_left(arr, begin, end) + 1;                  \
+          continue;                                                            \
+        }                                                                      \
+        pivot_pos =                                                            \
+            name##_partition_right(arr, begin, end, &already_partitioned);     \
+        l_size = pivot_pos - begin;                                            \
+        r_size = end - (pivot_pos + 1);                                        \
+        if (l_size < size / 8 || r_size < size / 8) {                          \
+          if (--bad_allowed == 0) {                                            \
+            name##_heapsort(arr + begin, size);                                \
+            break;                                                             \
+          }                                                                    \
+          name##_break_patterns(arr, begin, pivot_pos);                        \
+          name##_break_patterns(arr, pivot_pos + 1, end);                      \
+        } else if (already_partitioned &&                                      \
+                   name##_insertion(arr, begin, pivot_pos,                     \
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT) &&       \
+                   name##_insertion(arr, pivot_pos + 1, end,                   \
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT)) {       \
+          break;                                                               \
+        }                                                                      \
+        top++;                                                                 \
+        if (l_size < r_size) {                                                 \
+          stack[top].begin = pivot_pos + 1;                                    \
+          stack[top].end = end;                                                \
+          stack[top].leftmost = 0;                                             \
+          end = pivot_pos;                                                     \
+        } else {                                                               \
+          stack[top].begin = begin;                                            \
+          stack[top].end = pivot_pos;                                          \
+          stack[top].leftmost = leftmost;                                      \
+          begin = pivot_pos + 1;                                               \
+          leftmost = 0;                                                        \
+        }                                                                      \
+        stack[top].bad_allowed = bad_allowed;                                  \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope void name##_nth_element(T *arr, size_t elements, size_t nth) {         \
+    int bad_allowed = 0, leftmost = 1, already_partitioned;                    \
+    size_t begin = 0, end = elements, size, pivot_pos;                         \
+    if (nth >= elements) return;                                               \
+    for (size = elements; size > 1; size >>= 1) bad_allowed++;                 \
+    for (;;) {                                                                 \
+      size = end - begin;                                                      \
+      if (size < YK__SORT_INSERTION_THRESHOLD) {                               \
+        name##_insertion(arr, begin, end, (size_t) -1);                        \
+        return;                                                                \
+      }                                                                        \
+      name##_choose_pivot(arr, begin, end);                                    \
+      if (!leftmost && !less(arr[begin - 1], arr[begin])) {                    \
+        begin = name##_partition_left(arr, begin, end) + 1;                    \
+        if (nth < begin) return;                                               \
+        continue;                                                              \
+      }                                                                        \
+      pivot_pos =                                                              \
+          name##_partition_right(arr, begin, end, &already_partitioned);       \
+      if (pivot_pos - begin < size / 8 || end - pivot_pos - 1 < size / 8) {    \
+        if (--bad_allowed == 0) {                                              \
+          name##_heapsort(arr + begin, size);                                  \
+          return;                                                              \
+        }                                                                      \
+        name##_break_patterns(arr, begin, pivot_pos);                          \
+        name##_break_patterns(arr, pivot_pos + 1, end);                        \
+      }                                                                        \
+      if (nth == pivot_pos) return;                                            \
+      if (nth < pivot_pos) {                                                   \
+        end = pivot_pos;                                                       \
+      } else {                                                                 \
+        begin = pivot_pos + 1;                                                 \
+        leftmost = 0;                                                          \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope void name##_partial_sort(T *arr, size_t elements, size_t k) {          \
+    if (k >= elements) {                                                       \
+      name(arr, elements);                                                     \
+    } else if (k > 0) {                                                        \
+      name##_nth_element(arr, elements, k - 1);                                \
+      name(arr, k - 1);                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope size_t name##_topk_push(T *heap, size_t count, size_t k, T item) {     \
+    if (count < k) {                                                           \
+      heap[count] = item;                                                      \
+      name##_sift_up(heap, count);                                             \
+      return count + 1;                                                        \
+    }                                                                          \
+    if (k > 0 && less(item, heap[0])) {                                        \
+      heap[0] = item;                                                          \
+      name##_sift_down(heap, 0, k);                                            \
+    }                                                                          \
+    return count;                                                              \
+  }                                                                            \
+  scope void name##_topk_sort(T *heap, size_t count) {                         \
+    name##_sort_heap(heap, count);                                             \
+  }                                                                            \
+/**                                                                            \
+ * Define static inline functions for arrays of T, the same as the generic     \
+ * ones without item_size, cmp_func and buffers:                               \
+ * void name(T *arr, size_t elements)                                          \
+ * void name##_nth_element(T *arr, size_t elements, size_t nth)                \
+ * void name##_partial_sort(T *arr, size_t elements, size_t k)                 \
+ * size_t name##_topk_push(T *heap, size_t count, size_t k, T item)            \
+ *   returns the new count, pass 0 for the first item                          \
+ * void name##_topk_sort(T *heap, size_t count)                                \
+ * @param name name of the sort function, also prefixes its helpers            \
+ * @param T element type                                                       \
+ * @param less less(a, b) is called with two T lvalues and must be true when   \
+ * a sorts before b, a strict weak ordering like < (can be a macro)            \
+ */
+#define YK__DEFINE_SORT(name, T, less)                                         \
+  YK__SORT_DEFINE_TYPED(name, T, less, static inline)
+#define YK__SORT_DECLARE_TYPED(name, T)                                        \
+  void name(T *arr, size_t elements);                                          \
+  void name##_nth_element(T *arr, size_t elements, size_t nth);                \
+  void name##_partial_sort(T *arr, size_t elements, size_t k);                 \
+  size_t name##_topk_push(T *heap, size_t count, size_t k, T item);            \
+  void name##_topk_sort(T *heap, size_t count);
+/**
+ * Sorts for the number types of Yaksha (i8 to i64, u8 to u64, f32 and f64),
+ * yk__sort_i32 and yk__sort_i32_nth_element, _partial_sort, _topk_push and
+ * _topk_sort, see YK__DEFINE_SORT
+ */
+YK__SORT_DECLARE_TYPED(yk__sort_i8, int8_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i16, int16_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i32, int32_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i64, int64_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u8, uint8_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u16, uint16_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u32, uint32_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u64, uint64_t)
+YK__SORT_DECLARE_TYPED(yk__sort_f32, float)
+YK__SORT_DECLARE_TYPED(yk__sort_f64, double)
+/**
+ * Radix sort keys, unsigned integers that sort in the same order as the
+ * values they were made from
+ */
+typedef uint64_t (*yk__radix_key_function)(const void *);
+static inline uint64_t yk__radix_key_i32(int32_t x) {
+  return (uint32_t) x ^ ((uint32_t) 1 << 31);
+}
+static inline uint64_t yk__radix_key_i64(int64_t x) {
+  return (uint64_t) x ^ ((uint64_t) 1 << 63);
+}
+static inline uint64_t yk__radix_key_f32(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits >> 31 ? ~bits : bits | ((uint32_t) 1 << 31);
+}
+static inline uint64_t yk__radix_key_f64(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits >> 63 ? ~bits : bits | ((uint64_t) 1 << 63);
+}
+/**
+ * Perform a LSD radix sort, one pass per key byte, skipping bytes that are
+ * the same for all keys. Stable, floats order -NaN < -inf < -0.0 < 0.0 <
+ * inf < NaN.
+ * @param arr array
+ * @param elements number of elements
+ * @return 0 if successful, -1 if the scratch array could not be allocated
+ */
+int yk__radixsort_u32(uint32_t *arr, size_t elements);
+int yk__radixsort_u64(uint64_t *arr, size_t elements);
+int yk__radixsort_i64(int64_t *arr, size_t elements);
+int yk__radixsort_f64(double *arr, size_t elements);
+/**
+ * Perform a LSD radix sort (no malloc)
+ * @param arr array
+ * @param elements number of elements
+ * @param scratch array of the same type that can hold elements
+ */
+void yk__radixsort_u32_ex(uint32_t *arr, size_t elements, uint32_t *scratch);
+void yk__radixsort_u64_ex(uint64_t *arr, size_t elements, uint64_t *scratch);
+void yk__radixsort_i64_ex(int64_t *arr, size_t elements, int64_t *scratch);
+void yk__radixsort_f64_ex(double *arr, size_t elements, double *scratch);
+/**
+ * Perform a LSD radix sort of any elements by an integer key, for example a
+ * field of a struct read with one of the yk__radix_key_* helpers
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func returns the key of an element, called once per pass
+ * @return 0 if successful, -1 if the scratch array could not be allocated
+ */
+int yk__radixsort_key(void *arr, size_t item_size, size_t elements,
+                      yk__radix_key_function key_func);
+/**
+ * Perform a LSD radix sort by an integer key (no malloc)
+ * @param scratch buffer that can hold elements items
+ */
+void yk__radixsort_key_ex(void *arr, size_t item_size, size_t elements,
+                          yk__radix_key_function key_func, void *scratch);
+/**
+ * Perform a MSD radix sort of yk__sds strings in yk__sdscmp order, one byte
+ * at a time, small buckets are finished with a quick sort
+ * @param arr array
+ * @param elements number of elements
+ * @return 0 if successful, -1 if the scratch arrays could not be allocated
+ */
+int yk__radixsort_sds(yk__sds *arr, size_t elements);
+/**
+ * Perform a stable sort for given array, equal elements keep their order
+ * Merges natural runs like timsort, O(n) for sorted or reversed input and
+ * O(n log n) worst case.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the scratch buffer could not be allocated
+ */
+int yk__stablesort(void *arr, size_t item_size, size_t elements,
+                   yk__compare_function cmp_func);
+/**
+ * Perform a stable sort for given array (no malloc)
+ * Runs that do not fit the scratch buffer are merged in place by rotating
+ * them, which is slower but needs no more memory.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function
+ * @param scratch buffer of scratch_elements elements
+ * @param scratch_elements at least 1, elements / 2 never has to rotate
+ */
+void yk__stablesort_ex(void *arr, size_t item_size, size_t elements,
+                       yk__compare_function cmp_func, void *scratch,
+                       size_t scratch_elements);
+/**
+ * Move the element that would be at nth in the sorted array there, with
+ * no larger element before it and no smaller one after it. Quick select
+ * with the same pivots and partitions as yk__quicksort, O(n) on average.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param nth position to fill, nothing is done if it is >= elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the temporary element could not be allocated
+ */
+int yk__nth_element(void *arr, size_t item_size, size_t elements, size_t nth,
+                    yk__compare_function cmp_func);
+/**
+ * Same as yk__nth_element (no malloc)
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__nth_element_ex(void *arr, size_t item_size, size_t elements,
+                        size_t nth, yk__compare_function cmp_func,
+                        void *single_elem_buffer);
+/**
+ * Sort the k smallest elements into the start of the array, the order of
+ * the others is unspecified. O(n + k log k), selects then sorts k elements.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param k number of elements to sort, the whole array if it is >= elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the temporary element could not be allocated
+ */
+int yk__partial_sort(void *arr, size_t item_size, size_t elements, size_t k,
+                     yk__compare_function cmp_func);
+/**
+ * Same as yk__partial_sort (no malloc)
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__partial_sort_ex(void *arr, size_t item_size, size_t elements,
+                         size_t k, yk__compare_function cmp_func,
+                         void *single_elem_buffer);
+/**
+ * Keeps the k smallest items pushed to it in a max heap, for streams that
+ * do not fit in memory or are not known up front. Use a reversed compare
+ * function to keep the k largest.
+ */
+typedef struct yk__topk {
+  char *items;// buffer of k items, a heap until yk__topk_sort
+  size_t item_size;
+  size_t k;
+  size_t count;
+  yk__compare_function cmp_func;
+} yk__topk;
+/**
+ * Start an empty top k heap
+ * @param topk heap to initialize
+ * @param items buffer that can hold k items
+ * @param item_size single item size
+ * @param k number of items to keep
+ * @param cmp_func compare function
+ */
+void yk__topk_init(yk__topk *topk, void *items, size_t item_size, size_t k,
+                   yk__compare_function cmp_func);
+/**
+ * Offer an item, O(log k) if it is kept and one comparison if not
+ * @param topk heap
+ * @param item item to copy in
+ * @return 1 if the item is one of the k smallest so far, 0 if not
+ */
+int yk__topk_push(yk__topk *topk, const void *item);
+/**
+ * Sort the kept items in place, smallest first, and empty the heap
+ * @param topk heap
+ * @return number of items in topk->items
+ */
+size_t yk__topk_sort(yk__topk *topk);
+/**
+ * Sort indices instead of the elements, perm[i] becomes the index of the
+ * element that belongs at i. Stable, arr is not modified.
+ * Every comparison reads two elements from anywhere in arr, so on records
+ * much larger than their key this is slower than sorting the records: for
+ * 262144 records of 256 bytes argsort + yk__apply_permutation takes 100 ms
+ * against 60 ms for yk__quicksort (620 against 410 ms parsing a string key).
+ * yk__argsort_by_key keeps the keys next to the indices and takes 71 ms
+ * (85 ms), use it or yk__sort_by_key for such records.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function, called with elements of arr
+ * @param perm output, elements indices
+ * @return 0 if successful, -1 if the scratch buffer could not be allocated
+ */
+int yk__argsort(const void *arr, size_t item_size, size_t elements,
+                yk__compare_function cmp_func, size_t *perm);
+/**
+ * Same as yk__argsort (no malloc)
+ * @param scratch buffer of scratch_elements indices, see yk__stablesort_ex
+ * @param scratch_elements at least 1
+ */
+void yk__argsort_ex(const void *arr, size_t item_size, size_t elements,
+                    yk__compare_function cmp_func, size_t *perm,
+                    size_t *scratch, size_t scratch_elements);
+/**
+ * Reorder the array so element i is the one that was at perm[i], following
+ * the cycles of the permutation so every element is copied once (plus one
+ * copy per cycle through the temporary element)
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param perm permutation from yk__argsort, reset to 0, 1, 2, ... on return
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__apply_permutation(void *arr, size_t item_size, size_t elements,
+                           size_t *perm, void *single_elem_buffer);
+/**
+ * Write the sort key of item to key
+ */
+typedef void (*yk__key_extract_function)(const void *item, void *key);
+/**
+ * Perform a stable sort by a key that is extracted once per element instead
+ * of on every comparison (decorate, sort, undecorate). Keys are stably
+ * sorted next to the index of their element and the records moved once
+ * with yk__apply_permutation, which suits records much larger than keys.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func extracts the key of an element
+ * @param key_size size of a key
+ * @param key_cmp_func compare function for two keys
+ * @return 0 if successful, -1 if memory for keys and indices could not be
+ *         allocated, the array is not modified then
+ */
+int yk__sort_by_key(void *arr, size_t item_size, size_t elements,
+                    yk__key_extract_function key_func, size_t key_size,
+                    yk__compare_function key_cmp_func);
+/**
+ * Same as yk__argsort, with keys extracted once per element and sorted next
+ * to their index like yk__sort_by_key, arr is not modified.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func extracts the key of an element
+ * @param key_size size of a key
+ * @param key_cmp_func compare function for two keys
+ * @param perm output, elements indices
+ * @return 0 if successful, -1 if memory for keys and indices could not be
+ *         allocated
+ */
+int yk__argsort_by_key(const void *arr, size_t item_size, size_t elements,
+                       yk__key_extract_function key_func, size_t key_size,
+                       yk__compare_function key_cmp_func, size_t *perm);
 #ifdef YK__SORT_IMPLEMENTATION
 #include <stdlib.h>// malloc
-#include <string.h>// memcpy
-#define YK__SORT_MAX_LEVELS 48
+// swaps move 16 (SSE2) or 32 (AVX) bytes at a time where possible,
+// #define YK__SORT_NO_SIMD to use the portable version
+#if !defined(YK__SORT_NO_SIMD) &&                                              \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define YK__SORT_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define YK__SORT_SIMD_AVX
+#include <immintrin.h>
+#endif
+#endif
+typedef void (*yk__swap_function)(void *, void *, size_t);
 /**
- * Swap memory between a and b of given item_size
+ * Swap memory between a and b of given item_size, in vector and word sized
+ * pieces first and byte by byte for the tail
  * @param a pointer to position a
  * @param b pointer to position b
  * @param item_size single element size
@@ -87,6 +661,29 @@ void yk__memswap(void *a, void *b, size_t item_size) {
   char *a_swap = (char *) a;
   char *b_swap = (char *) b;
   char *a_end = a_swap + item_size;
+#if defined(YK__SORT_SIMD_AVX)
+  for (; a_end - a_swap >= 32; a_swap += 32, b_swap += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) a_swap);
+    __m256i y = _mm256_loadu_si256((const __m256i *) b_swap);
+    _mm256_storeu_si256((__m256i *) a_swap, y);
+    _mm256_storeu_si256((__m256i *) b_swap, x);
+  }
+#endif
+#if defined(YK__SORT_SIMD_SSE2)
+  for (; a_end - a_swap >= 16; a_swap += 16, b_swap += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) a_swap);
+    __m128i y = _mm_loadu_si128((const __m128i *) b_swap);
+    _mm_storeu_si128((__m128i *) a_swap, y);
+    _mm_storeu_si128((__m128i *) b_swap, x);
+  }
+#endif
+  for (; a_end - a_swap >= 8; a_swap += 8, b_swap += 8) {
+    uint64_t x, y;
+    memcpy(&x, a_swap, 8);
+    memcpy(&y, b_swap, 8);
+    memcpy(a_swap, &y, 8);
+    memcpy(b_swap, &x, 8);
+  }
   while (a_swap < a_end) {
     char temp = *a_swap;
     *a_swap = *b_swap;
@@ -116,64 +713,309 @@ void yk__memswap(void *a, void *b, size_t item_size) {
  */
 #define yk__generic_get(arr, pos, item_size)                                   \
   ((void *) (((char *) arr) + ((pos) * (item_size))))
+/**
+ * Swap of a single T sized element, memcpy keeps unaligned access legal and
+ * compiles to plain loads and stores
+ */
+#define YK__SORT_DEFINE_SWAP(bytes, T)                                         \
+  static void yk__memswap_##bytes(void *a, void *b, size_t item_size) {        \
+    T x, y;                                                                    \
+    (void) item_size;                                                          \
+    memcpy(&x, a, sizeof(T));                                                  \
+    memcpy(&y, b, sizeof(T));                                                  \
+    memcpy(a, &y, sizeof(T));                                                  \
+    memcpy(b, &x, sizeof(T));                                                  \
+  }
+YK__SORT_DEFINE_SWAP(1, uint8_t)
+YK__SORT_DEFINE_SWAP(2, uint16_t)
+YK__SORT_DEFINE_SWAP(4, uint32_t)
+YK__SORT_DEFINE_SWAP(8, uint64_t)
+#if defined(YK__SORT_SIMD_SSE2)
+YK__SORT_DEFINE_SWAP(16, __m128i)
+#endif
+#if defined(YK__SORT_SIMD_AVX)
+YK__SORT_DEFINE_SWAP(32, __m256i)
+#endif
+/**
+ * Pick the swap for elements of item_size, done once per sort instead of
+ * looking at the size on every swap
+ * @param item_size single element size
+ * @return swap function
+ */
+static yk__swap_function yk__sort_swapper(size_t item_size) {
+  switch (item_size) {
+    case 1:
+      return yk__memswap_1;
+    case 2:
+      return yk__memswap_2;
+    case 4:
+      return yk__memswap_4;
+    case 8:
+      return yk__memswap_8;
+#if defined(YK__SORT_SIMD_SSE2)
+    case 16:
+      return yk__memswap_16;
+#endif
+#if defined(YK__SORT_SIMD_AVX)
+    case 32:
+      return yk__memswap_32;
+#endif
+    default:
+      return yk__memswap;
+  }
+}
+#define YK__SORT_AT(pos) yk__generic_get(arr, pos, item_size)
+#define YK__SORT_SWAP(pos1, pos2)                                              \
+  swap_func(YK__SORT_AT(pos1), YK__SORT_AT(pos2), item_size)
+#define YK__SORT_LESS(pos1, pos2)                                              \
+  (cmp_func(YK__SORT_AT(pos1), YK__SORT_AT(pos2)) < 0)
+/**
+ * Insertion sort [begin, end), each element is moved into place with a single
+ * memmove
+ * @param limit stop once more than limit elements were moved
+ * @return 1 if the range is sorted, 0 if the limit was hit
+ */
+static int yk__sort_insertion(void *arr, size_t item_size, size_t begin,
+                              size_t end, yk__compare_function cmp_func,
+                              void *tmp, size_t limit) {
+  size_t i, j, moved = 0;
+  for (i = begin + 1; i < end; i++) {
+    if (!YK__SORT_LESS(i, i - 1)) continue;
+    memcpy(tmp, YK__SORT_AT(i), item_size);
+    j = i - 1;
+    while (j > begin && cmp_func(tmp, YK__SORT_AT(j - 1)) < 0) j--;
+    memmove(YK__SORT_AT(j + 1), YK__SORT_AT(j), (i - j) * item_size);
+    memcpy(YK__SORT_AT(j), tmp, item_size);
+    moved += i - j;
+    if (moved > limit && i + 1 < end) return 0;
+  }
+  return 1;
+}
+static void yk__sort2(void *arr, size_t item_size, size_t a, size_t b,
+                      yk__compare_function cmp_func,
+                      yk__swap_function swap_func) {
+  if (YK__SORT_LESS(b, a)) YK__SORT_SWAP(a, b);
+}
+static void yk__sort3(void *arr, size_t item_size, size_t a, size_t b,
+                      size_t c, yk__compare_function cmp_func,
+                      yk__swap_function swap_func) {
+  yk__sort2(arr, item_size, a, b, cmp_func, swap_func);
+  yk__sort2(arr, item_size, b, c, cmp_func, swap_func);
+  yk__sort2(arr, item_size, a, b, cmp_func, swap_func);
+}
+/**
+ * Heap sort elements [begin, end), used when quick sort keeps picking bad
+ * pivots so the sort stays O(n log n)
+ */
+static void yk__sort_sift_down(void *arr, size_t item_size, size_t begin,
+                               size_t root, size_t n,
+                               yk__compare_function cmp_func,
+                               yk__swap_function swap_func) {
+  for (;;) {
+    size_t child = 2 * root + 1;
+    if (child >= n) return;
+    if (child + 1 < n && YK__SORT_LESS(begin + child, begin + child + 1))
+      child++;
+    if (!YK__SORT_LESS(begin + root, begin + child)) return;
+    YK__SORT_SWAP(begin + root, begin + child);
+    root = child;
+  }
+}
+static void yk__sort_sift_up(void *arr, size_t item_size, size_t pos,
+                             yk__compare_function cmp_func,
+                             yk__swap_function swap_func) {
+  while (pos > 0 && YK__SORT_LESS((pos - 1) / 2, pos)) {
+    YK__SORT_SWAP((pos - 1) / 2, pos);
+    pos = (pos - 1) / 2;
+  }
+}
+/**
+ * Sort the max heap [begin, end) by moving its top to the end n - 1 times
+ */
+static void yk__sort_sort_heap(void *arr, size_t item_size, size_t begin,
+                               size_t end, yk__compare_function cmp_func,
+                               yk__swap_function swap_func) {
+  size_t i;
+  for (i = end - begin; i > 1; i--) {
+    YK__SORT_SWAP(begin, begin + i - 1);
+    yk__sort_sift_down(arr, item_size, begin, 0, i - 1, cmp_func, swap_func);
+  }
+}
+static void yk__sort_heapsort(void *arr, size_t item_size, size_t begin,
+                              size_t end, yk__compare_function cmp_func,
+                              yk__swap_function swap_func) {
+  size_t n = end - begin, i;
+  for (i = n / 2; i > 0; i--)
+    yk__sort_sift_down(arr, item_size, begin, i - 1, n, cmp_func, swap_func);
+  yk__sort_sort_heap(arr, item_size, begin, end, cmp_func, swap_func);
+}
+/**
+ * Partition [begin, end) around the pivot at begin, elements equal to the
+ * pivot go to the right. The scans are bounded by the range, so a compare
+ * function that is not a strict weak ordering gives a wrong order instead
+ * of reading outside the array.
+ * @param already_partitioned set to 1 if no elements had to be swapped
+ * @return final position of the pivot
+ */
+static size_t yk__sort_partition_right(void *arr, size_t item_size,
+                                       size_t begin, size_t end,
+                                       yk__compare_function cmp_func,
+                                       yk__swap_function swap_func,
+                                       int *already_partitioned) {
+  size_t first = begin, last = end;
+  while (++first < end && YK__SORT_LESS(first, begin)) {}
+  if (first - 1 == begin) {
+    while (first < last && !YK__SORT_LESS(--last, begin)) {}
+  } else {
+    while (--last > begin && !YK__SORT_LESS(last, begin)) {}
+  }
+  *already_partitioned = first >= last;
+  while (first < last) {
+    YK__SORT_SWAP(first, last);
+    while (++first < end && YK__SORT_LESS(first, begin)) {}
+    while (--last > begin && !YK__SORT_LESS(last, begin)) {}
+  }
+  YK__SORT_SWAP(begin, first - 1);
+  return first - 1;
+}
+/**
+ * Partition [begin, end) around the pivot at begin, elements equal to the
+ * pivot go to the left. Used when the element before begin equals the pivot,
+ * then everything left of the returned position is equal and already sorted.
+ */
+static size_t yk__sort_partition_left(void *arr, size_t item_size,
+                                      size_t begin, size_t end,
+                                      yk__compare_function cmp_func,
+                                      yk__swap_function swap_func) {
+  size_t first = begin, last = end;
+  while (--last > begin && YK__SORT_LESS(begin, last)) {}
+  if (last + 1 == end) {
+    while (first < last && !YK__SORT_LESS(begin, ++first)) {}
+  } else {
+    while (++first < end && !YK__SORT_LESS(begin, first)) {}
+  }
+  while (first < last) {
+    YK__SORT_SWAP(first, last);
+    while (--last > begin && YK__SORT_LESS(begin, last)) {}
+    while (++first < end && !YK__SORT_LESS(begin, first)) {}
+  }
+  YK__SORT_SWAP(begin, last);
+  return last;
+}
+/**
+ * Swap a few elements of [begin, end) around after an unbalanced partition,
+ * so a pattern in the input does not keep producing bad pivots
+ */
+static void yk__sort_break_patterns(void *arr, size_t item_size, size_t begin,
+                                    size_t end, yk__swap_function swap_func) {
+  size_t size = end - begin, q = size / 4;
+  if (size < YK__SORT_INSERTION_THRESHOLD) return;
+  YK__SORT_SWAP(begin, begin + q);
+  YK__SORT_SWAP(end - 1, end - q);
+  if (size > YK__SORT_NINTHER_THRESHOLD) {
+    YK__SORT_SWAP(begin + 1, begin + (q + 1));
+    YK__SORT_SWAP(begin + 2, begin + (q + 2));
+    YK__SORT_SWAP(end - 2, end - (q + 1));
+    YK__SORT_SWAP(end - 3, end - (q + 2));
+  }
+}
+/**
+ * Move the median of 3 (or for large ranges the ninther, a median of 3
+ * medians) to begin, the elements it was picked from are left in order
+ */
+static void yk__sort_choose_pivot(void *arr, size_t item_size, size_t begin,
+                                  size_t end, yk__compare_function cmp_func,
+                                  yk__swap_function swap_func) {
+  size_t size = end - begin, s2 = size / 2;
+  if (size > YK__SORT_NINTHER_THRESHOLD) {
+    yk__sort3(arr, item_size, begin, begin + s2, end - 1, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + 1, begin + s2 - 1, end - 2, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + 2, begin + s2 + 1, end - 3, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + s2 - 1, begin + s2, begin + s2 + 1,
+              cmp_func, swap_func);
+    YK__SORT_SWAP(begin, begin + s2);
+  } else {
+    yk__sort3(arr, item_size, begin + s2, begin, end - 1, cmp_func,
+              swap_func);
+  }
+}
 int yk__quicksort_ex(void *arr, size_t item_size, size_t elements,
                      yk__compare_function cmp_func, void *single_elem_buffer) {
-  size_t beg[YK__SORT_MAX_LEVELS], end[YK__SORT_MAX_LEVELS], L, R;
-  int i = 0;
-  beg[0] = 0;
-  end[0] = elements;
-  // NOTE: You can probably change this to a some MAX_SIZE char[]
-  void *piv = single_elem_buffer;
-  while (i >= 0) {
-    L = beg[i];
-    R = end[i];
-    if (R - L > 1) {
-      size_t M = L + ((R - L) >> 1);
-      // T piv = arr[M];
-      memcpy(piv, yk__generic_get(arr, M, item_size), item_size);
-      // arr[M] = arr[L];
-      memcpy(yk__generic_get(arr, M, item_size),
-             yk__generic_get(arr, L, item_size), item_size);
-      if (i == YK__SORT_MAX_LEVELS - 1) { return -1; }
-      R--;
-      while (L < R) {
-        // while (arr[R] >= piv && L < R)
-        while (cmp_func(yk__generic_get(arr, R, item_size), piv) >= 0 &&
-               L < R) {
-          R--;
-        }
-        if (L < R) { yk__generic_swap(arr, L++, R, item_size); }
-        // while (arr[L] <= piv && L < R)
-        while (cmp_func(yk__generic_get(arr, L, item_size), piv) <= 0 &&
-               L < R) {
-          L++;
-        }
-        if (L < R) { yk__generic_swap(arr, R--, L, item_size); }
+  // pattern defeating quick sort: median of 3 or ninther pivots, insertion
+  // sort for small ranges, and heap sort once too many partitions were bad.
+  // The larger side is pushed so the stack never holds more than log2(n).
+  struct {
+    size_t begin, end;
+    int bad_allowed, leftmost;
+  } stack[YK__SORT_STACK_SIZE];
+  int top = 0, bad_allowed = 0, leftmost, already_partitioned;
+  size_t begin, end, size, pivot_pos, l_size, r_size;
+  yk__swap_function swap_func = yk__sort_swapper(item_size);
+  for (size = elements; size > 1; size >>= 1) bad_allowed++;
+  stack[0].begin = 0;
+  stack[0].end = elements;
+  stack[0].bad_allowed = bad_allowed;
+  stack[0].leftmost = 1;
+  while (top >= 0) {
+    begin = stack[top].begin;
+    end = stack[top].end;
+    bad_allowed = stack[top].bad_allowed;
+    leftmost = stack[top--].leftmost;
+    for (;;) {
+      size = end - begin;
+      if (size < YK__SORT_INSERTION_THRESHOLD) {
+        yk__sort_insertion(arr, item_size, begin, end, cmp_func,
+                           single_elem_buffer, (size_t) -1);
+        break;
       }
-      // arr[L] = piv;
-      memcpy(yk__generic_get(arr, L, item_size), piv, item_size);
-      M = L + 1;
-      // while (L > beg[i] && arr[L - 1] == piv)
-      while (L > beg[i] &&
-             cmp_func(yk__generic_get(arr, L - 1, item_size), piv) == 0) {
-        L--;
+      yk__sort_choose_pivot(arr, item_size, begin, end, cmp_func, swap_func);
+      // many elements equal to the previous pivot, skip them
+      if (!leftmost && !YK__SORT_LESS(begin - 1, begin)) {
+        begin = yk__sort_partition_left(arr, item_size, begin, end, cmp_func,
+                                        swap_func) +
+                1;
+        continue;
       }
-      // while (M < end[i] && arr[M] == piv)
-      while (M < end[i] &&
-             cmp_func(yk__generic_get(arr, M, item_size), piv) == 0) {
-        M++;
+      pivot_pos =
+          yk__sort_partition_right(arr, item_size, begin, end, cmp_func,
+                                   swap_func, &already_partitioned);
+      l_size = pivot_pos - begin;
+      r_size = end - (pivot_pos + 1);
+      if (l_size < size / 8 || r_size < size / 8) {
+        if (--bad_allowed == 0) {
+          yk__sort_heapsort(arr, item_size, begin, end, cmp_func, swap_func);
+          break;
+        }
+        yk__sort_break_patterns(arr, item_size, begin, pivot_pos, swap_func);
+        yk__sort_break_patterns(arr, item_size, pivot_pos + 1, end,
+                                swap_func);
+      } else if (already_partitioned &&
+                 yk__sort_insertion(arr, item_size, begin, pivot_pos, cmp_func,
+                                    single_elem_buffer,
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT) &&
+                 yk__sort_insertion(arr, item_size, pivot_pos + 1, end,
+                                    cmp_func, single_elem_buffer,
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT)) {
+        // input was (nearly) sorted already
+        break;
       }
-      if (L - beg[i] > end[i] - M) {
-        beg[i + 1] = M;
-        end[i + 1] = end[i];
-        end[i++] = L;
+      top++;
+      if (l_size < r_size) {
+        stack[top].begin = pivot_pos + 1;
+        stack[top].end = end;
+        stack[top].leftmost = 0;
+        end = pivot_pos;
       } else {
-        beg[i + 1] = beg[i];
-        end[i + 1] = L;
-        beg[i++] = M;
+        stack[top].begin = begin;
+        stack[top].end = pivot_pos;
+        stack[top].leftmost = leftmost;
+        begin = pivot_pos + 1;
+        leftmost = 0;
       }
-    } else {
-      i--;
+      stack[top].bad_allowed = bad_allowed;
     }
   }
   return 0;
@@ -188,5 +1030,716 @@ int yk__quicksort(void *arr, size_t item_size, size_t elements,
   free(single_elem_buffer);
   return return_value;
 }
+void yk__nth_element_ex(void *arr, size_t item_size, size_t elements,
+                        size_t nth, yk__compare_function cmp_func,
+                        void *single_elem_buffer) {
+  // yk__quicksort_ex that only continues with the side holding nth
+  int bad_allowed = 0, leftmost = 1, already_partitioned;
+  size_t begin = 0, end = elements, size, pivot_pos;
+  yk__swap_function swap_func = yk__sort_swapper(item_size);
+  if (nth >= elements) return;
+  for (size = elements; size > 1; size >>= 1) bad_allowed++;
+  for (;;) {
+    size = end - begin;
+    if (size < YK__SORT_INSERTION_THRESHOLD) {
+      yk__sort_insertion(arr, item_size, begin, end, cmp_func,
+                         single_elem_buffer, (size_t) -1);
+      return;
+    }
+    yk__sort_choose_pivot(arr, item_size, begin, end, cmp_func, swap_func);
+    if (!leftmost && !YK__SORT_LESS(begin - 1, begin)) {
+      // everything before the returned position equals the pivot
+      begin = yk__sort_partition_left(arr, item_size, begin, end, cmp_func,
+                                      swap_func) +
+              1;
+      if (nth < begin) return;
+      continue;
+    }
+    pivot_pos = yk__sort_partition_right(arr, item_size, begin, end, cmp_func,
+                                         swap_func, &already_partitioned);
+    if (pivot_pos - begin < size / 8 || end - pivot_pos - 1 < size / 8) {
+      if (--bad_allowed == 0) {
+        yk__sort_heapsort(arr, item_size, begin, end, cmp_func, swap_func);
+        return;
+      }
+      yk__sort_break_patterns(arr, item_size, begin, pivot_pos, swap_func);
+      yk__sort_break_patterns(arr, item_size, pivot_pos + 1, end, swap_func);
+    }
+    if (nth == pivot_pos) return;
+    if (nth < pivot_pos) {
+      end = pivot_pos;
+    } else {
+      begin = pivot_pos + 1;
+      leftmost = 0;
+    }
+  }
+}
+int yk__nth_element(void *arr, size_t item_size, size_t elements, size_t nth,
+                    yk__compare_function cmp_func) {
+  void *single_elem_buffer = malloc(item_size);
+  if (NULL == single_elem_buffer) return -1;
+  yk__nth_element_ex(arr, item_size, elements, nth, cmp_func,
+                     single_elem_buffer);
+  free(single_elem_buffer);
+  return 0;
+}
+void yk__partial_sort_ex(void *arr, size_t item_size, size_t elements,
+                         size_t k, yk__compare_function cmp_func,
+                         void *single_elem_buffer) {
+  if (k >= elements) {
+    yk__quicksort_ex(arr, item_size, elements, cmp_func, single_elem_buffer);
+  } else if (k > 0) {
+    // arr[k - 1] is the largest of the k, only the ones before it are left
+    yk__nth_element_ex(arr, item_size, elements, k - 1, cmp_func,
+                       single_elem_buffer);
+    yk__quicksort_ex(arr, item_size, k - 1, cmp_func, single_elem_buffer);
+  }
+}
+int yk__partial_sort(void *arr, size_t item_size, size_t elements, size_t k,
+                     yk__compare_function cmp_func) {
+  void *single_elem_buffer = malloc(item_size);
+  if (NULL == single_elem_buffer) return -1;
+  yk__partial_sort_ex(arr, item_size, elements, k, cmp_func,
+                      single_elem_buffer);
+  free(single_elem_buffer);
+  return 0;
+}
+void yk__topk_init(yk__topk *topk, void *items, size_t item_size, size_t k,
+                   yk__compare_function cmp_func) {
+  topk->items = (char *) items;
+  topk->item_size = item_size;
+  topk->k = k;
+  topk->count = 0;
+  topk->cmp_func = cmp_func;
+}
+int yk__topk_push(yk__topk *topk, const void *item) {
+  size_t item_size = topk->item_size;
+  char *arr = topk->items;
+  if (topk->count < topk->k) {
+    memcpy(YK__SORT_AT(topk->count), item, item_size);
+    yk__sort_sift_up(arr, item_size, topk->count++, topk->cmp_func,
+                     yk__sort_swapper(item_size));
+    return 1;
+  }
+  // the top is the largest item kept, anything not smaller is dropped
+  if (topk->k == 0 || topk->cmp_func(item, arr) >= 0) return 0;
+  memcpy(arr, item, item_size);
+  yk__sort_sift_down(arr, item_size, 0, 0, topk->k, topk->cmp_func,
+                     yk__sort_swapper(item_size));
+  return 1;
+}
+size_t yk__topk_sort(yk__topk *topk) {
+  size_t count = topk->count;
+  yk__sort_sort_heap(topk->items, topk->item_size, 0, count, topk->cmp_func,
+                     yk__sort_swapper(topk->item_size));
+  topk->count = 0;
+  return count;
+}
+#define YK__SORT_MIN_GALLOP 7
+#define YK__SORT_MAX_RUNS 128
+/**
+ * State of one stable sort
+ */
+typedef struct yk__stablesort_state {
+  size_t item_size;
+  yk__compare_function cmp_func;
+  yk__swap_function swap_func;
+  char *tmp;           // scratch buffer
+  size_t tmp_elements; // capacity of tmp
+  size_t min_gallop;   // lower when galloping pays off, higher when not
+  const char *items;   // argsort: elements are indices of these, or NULL
+  size_t items_size;
+} yk__stablesort_state;
+/**
+ * Compare two elements, or for an argsort the items they index
+ */
+static inline int yk__stable_cmp(yk__stablesort_state *s, const void *a,
+                                 const void *b) {
+  if (s->items == NULL) return s->cmp_func(a, b);
+  return s->cmp_func(s->items + *(const size_t *) a * s->items_size,
+                     s->items + *(const size_t *) b * s->items_size);
+}
+#define YK__STABLE_AT(base, pos) ((base) + (pos) * s->item_size)
+#define YK__STABLE_LESS(a, b) (yk__stable_cmp(s, a, b) < 0)
+/**
+ * Number of leading elements of base that are smaller than key (upper = 0)
+ * or not larger than key (upper = 1), searching 1, 3, 7, ... elements from
+ * the start and then binary
+ */
+static size_t yk__stable_gallop(yk__stablesort_state *s, const void *key,
+                                char *base, size_t n, int upper) {
+  size_t lo = 0, hi = 1;
+  while (hi <= n) {
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, hi - 1), key);
+    if (c > 0 || (!upper && c == 0)) break;
+    lo = hi;
+    hi = hi * 2 + 1;
+  }
+  if (hi > n) hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, mid), key);
+    if (c < 0 || (upper && c == 0)) lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+/**
+ * Same as yk__stable_gallop, searching from the end of base
+ */
+static size_t yk__stable_gallop_back(yk__stablesort_state *s,
+                                     const void *key, char *base, size_t n,
+                                     int upper) {
+  size_t lo, hi = n, step = 1;
+  while (step <= n) {
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, n - step), key);
+    if (c < 0 || (upper && c == 0)) break;
+    hi = n - step;
+    step = step * 2 + 1;
+  }
+  lo = step > n ? 0 : n - step + 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, mid), key);
+    if (c < 0 || (upper && c == 0)) lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+static void yk__stable_reverse(yk__stablesort_state *s, char *base, size_t n) {
+  char *lo = base, *hi = YK__STABLE_AT(base, n);
+  while (n > 1) {
+    hi -= s->item_size;
+    s->swap_func(lo, hi, s->item_size);
+    lo += s->item_size;
+    n -= 2;
+  }
+}
+/**
+ * Binary insertion sort of base, the first sorted elements are in order
+ */
+static void yk__stable_insertion(yk__stablesort_state *s, char *base,
+                                 size_t sorted, size_t n) {
+  for (; sorted < n; sorted++) {
+    char *item = YK__STABLE_AT(base, sorted);
+    size_t lo = 0, hi = sorted;
+    if (!YK__STABLE_LESS(item, YK__STABLE_AT(base, sorted - 1))) continue;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (YK__STABLE_LESS(item, YK__STABLE_AT(base, mid))) hi = mid;
+      else
+        lo = mid + 1;
+    }
+    memcpy(s->tmp, item, s->item_size);
+    memmove(YK__STABLE_AT(base, lo + 1), YK__STABLE_AT(base, lo),
+            (sorted - lo) * s->item_size);
+    memcpy(YK__STABLE_AT(base, lo), s->tmp, s->item_size);
+  }
+}
+/**
+ * Length of the run at the start of base, a strictly descending run is
+ * reversed (there are no equal elements in it whose order could change)
+ */
+static size_t yk__stable_count_run(yk__stablesort_state *s, char *base,
+                                   size_t n) {
+  size_t end = 1;
+  if (n < 2) return n;
+  if (YK__STABLE_LESS(YK__STABLE_AT(base, 1), base)) {
+    while (end + 1 < n && YK__STABLE_LESS(YK__STABLE_AT(base, end + 1),
+                                          YK__STABLE_AT(base, end)))
+      end++;
+    yk__stable_reverse(s, base, end + 1);
+  } else {
+    while (end + 1 < n && !YK__STABLE_LESS(YK__STABLE_AT(base, end + 1),
+                                           YK__STABLE_AT(base, end)))
+      end++;
+  }
+  return end + 1;
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements), na fits
+ * the scratch buffer, the smallest element of b is smaller than a[0]
+ */
+static void yk__stable_merge_lo(yk__stablesort_state *s, char *a, size_t na,
+                                size_t nb) {
+  size_t size = s->item_size, count_a, count_b;
+  char *pa = s->tmp, *pb = YK__STABLE_AT(a, na), *dest = a;
+  char *a_end = YK__STABLE_AT(s->tmp, na), *b_end = YK__STABLE_AT(pb, nb);
+  memcpy(s->tmp, a, na * size);
+  while (pa < a_end && pb < b_end) {
+    count_a = count_b = 0;
+    // one element at a time until one run keeps winning
+    do {
+      if (YK__STABLE_LESS(pb, pa)) {
+        memcpy(dest, pb, size);
+        pb += size;
+        count_b++;
+        count_a = 0;
+      } else {
+        memcpy(dest, pa, size);
+        pa += size;
+        count_a++;
+        count_b = 0;
+      }
+      dest += size;
+    } while (pa < a_end && pb < b_end &&
+             (count_a | count_b) < s->min_gallop);
+    // then copy whole stretches found by galloping
+    while (pa < a_end && pb < b_end) {
+      count_a = yk__stable_gallop(s, pb, pa, (a_end - pa) / size, 1);
+      memcpy(dest, pa, count_a * size);
+      dest += count_a * size;
+      pa += count_a * size;
+      if (pa == a_end) break;
+      memcpy(dest, pb, size);
+      dest += size;
+      pb += size;
+      if (pb == b_end) break;
+      count_b = yk__stable_gallop(s, pa, pb, (b_end - pb) / size, 0);
+      memmove(dest, pb, count_b * size);
+      dest += count_b * size;
+      pb += count_b * size;
+      if (pb == b_end) break;
+      memcpy(dest, pa, size);
+      dest += size;
+      pa += size;
+      if (s->min_gallop > 1) s->min_gallop--;
+      if (count_a < YK__SORT_MIN_GALLOP && count_b < YK__SORT_MIN_GALLOP) {
+        s->min_gallop += 2;
+        break;
+      }
+    }
+  }
+  // what is left of b is already in place
+  memcpy(dest, pa, a_end - pa);
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements) from the
+ * end, nb fits the scratch buffer, the largest element of a is larger than
+ * the last one of b
+ */
+static void yk__stable_merge_hi(yk__stablesort_state *s, char *a, size_t na,
+                                size_t nb) {
+  size_t size = s->item_size, count_a, count_b;
+  char *b = YK__STABLE_AT(a, na);
+  // one past the last element left in a and b, and where the next one goes
+  char *pa = b, *pb = YK__STABLE_AT(s->tmp, nb), *dest = YK__STABLE_AT(b, nb);
+  memcpy(s->tmp, b, nb * size);
+  while (pa > a && pb > s->tmp) {
+    count_a = count_b = 0;
+    do {
+      dest -= size;
+      if (YK__STABLE_LESS(pb - size, pa - size)) {
+        pa -= size;
+        memcpy(dest, pa, size);
+        count_a++;
+        count_b = 0;
+      } else {
+        pb -= size;
+        memcpy(dest, pb, size);
+        count_b++;
+        count_a = 0;
+      }
+    } while (pa > a && pb > s->tmp && (count_a | count_b) < s->min_gallop);
+    while (pa > a && pb > s->tmp) {
+      size_t left = (pa - a) / size;
+      count_a = left - yk__stable_gallop_back(s, pb - size, a, left, 1);
+      dest -= count_a * size;
+      pa -= count_a * size;
+      memmove(dest, pa, count_a * size);
+      if (pa == a) break;
+      dest -= size;
+      pb -= size;
+      memcpy(dest, pb, size);
+      if (pb == s->tmp) break;
+      left = (pb - s->tmp) / size;
+      count_b = left - yk__stable_gallop_back(s, pa - size, s->tmp, left, 0);
+      dest -= count_b * size;
+      pb -= count_b * size;
+      memcpy(dest, pb, count_b * size);
+      if (pb == s->tmp) break;
+      dest -= size;
+      pa -= size;
+      memcpy(dest, pa, size);
+      if (s->min_gallop > 1) s->min_gallop--;
+      if (count_a < YK__SORT_MIN_GALLOP && count_b < YK__SORT_MIN_GALLOP) {
+        s->min_gallop += 2;
+        break;
+      }
+    }
+  }
+  // what is left of a is already in place
+  memcpy(a, s->tmp, pb - s->tmp);
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements), rotating
+ * pieces of them around while neither fits the scratch buffer
+ */
+static void yk__stable_merge(yk__stablesort_state *s, char *a, size_t na,
+                             size_t nb) {
+  size_t skip;
+  while (na > 0 && nb > 0) {
+    size_t ma, mb;
+    // elements of a that are not larger than b[0] are in place already, so
+    // are elements of b not smaller than the last one of a
+    skip = yk__stable_gallop(s, YK__STABLE_AT(a, na), a, na, 1);
+    a = YK__STABLE_AT(a, skip);
+    na -= skip;
+    if (na == 0) return;
+    nb = yk__stable_gallop_back(s, YK__STABLE_AT(a, na - 1),
+                                YK__STABLE_AT(a, na), nb, 0);
+    if (nb == 0) return;
+    if (na <= nb && na <= s->tmp_elements) {
+      yk__stable_merge_lo(s, a, na, nb);
+      return;
+    }
+    if (nb <= s->tmp_elements) {
+      yk__stable_merge_hi(s, a, na, nb);
+      return;
+    }
+    // a[ma] stays before the elements of b that are not smaller than it
+    if (na >= nb) {
+      ma = na / 2;
+      mb = yk__stable_gallop(s, YK__STABLE_AT(a, ma), YK__STABLE_AT(a, na),
+                             nb, 0);
+    } else {
+      mb = nb / 2;
+      ma = yk__stable_gallop(s, YK__STABLE_AT(a, na + mb), a, na, 1);
+    }
+    // rotate a[ma, na) b[0, mb) into b[0, mb) a[ma, na)
+    yk__stable_reverse(s, YK__STABLE_AT(a, ma), na - ma);
+    yk__stable_reverse(s, YK__STABLE_AT(a, na), mb);
+    yk__stable_reverse(s, YK__STABLE_AT(a, ma), na - ma + mb);
+    // merge the smaller half now and the other one in the next iteration
+    if (ma + mb < (na - ma) + (nb - mb)) {
+      yk__stable_merge(s, a, ma, mb);
+      a = YK__STABLE_AT(a, ma + mb);
+      na -= ma;
+      nb -= mb;
+    } else {
+      yk__stable_merge(s, YK__STABLE_AT(a, ma + mb), na - ma, nb - mb);
+      na = ma;
+      nb = mb;
+    }
+  }
+}
+static void yk__stable_init(yk__stablesort_state *s, size_t item_size,
+                            yk__compare_function cmp_func, void *scratch,
+                            size_t scratch_elements) {
+  s->item_size = item_size;
+  s->cmp_func = cmp_func;
+  s->swap_func = yk__sort_swapper(item_size);
+  s->tmp = (char *) scratch;
+  s->tmp_elements = scratch_elements;
+  s->min_gallop = YK__SORT_MIN_GALLOP;
+  s->items = NULL;
+  s->items_size = 0;
+}
+static void yk__stable_sort(yk__stablesort_state *s, char *base,
+                            size_t elements) {
+  size_t run_start[YK__SORT_MAX_RUNS], run_length[YK__SORT_MAX_RUNS];
+  size_t runs = 0, lo = 0, min_run = elements, r = 0;
+  // runs shorter than min_run are extended with insertion sort, min_run is
+  // picked so elements / min_run is a power of two or just below one
+  while (min_run >= 64) {
+    r |= min_run & 1;
+    min_run >>= 1;
+  }
+  min_run += r;
+  while (lo < elements) {
+    size_t n = yk__stable_count_run(s, YK__STABLE_AT(base, lo),
+                                    elements - lo);
+    if (n < min_run) {
+      size_t forced = elements - lo < min_run ? elements - lo : min_run;
+      yk__stable_insertion(s, YK__STABLE_AT(base, lo), n, forced);
+      n = forced;
+    }
+    run_start[runs] = lo;
+    run_length[runs++] = n;
+    lo += n;
+    // keep run lengths growing faster than fibonacci from the top of the
+    // stack down, so there are at most YK__SORT_MAX_RUNS of them
+    while (runs > 1) {
+      size_t k = runs - 2;
+      if ((k > 0 && run_length[k - 1] <= run_length[k] + run_length[k + 1]) ||
+          (k > 1 && run_length[k - 2] <= run_length[k - 1] + run_length[k])) {
+        if (run_length[k - 1] < run_length[k + 1]) k--;
+      } else if (lo < elements && run_length[k] > run_length[k + 1]) {
+        break;// the last runs are merged once there are no more
+      }
+      yk__stable_merge(s, YK__STABLE_AT(base, run_start[k]), run_length[k],
+                       run_length[k + 1]);
+      run_length[k] += run_length[k + 1];
+      if (k + 2 < runs) {
+        run_start[k + 1] = run_start[k + 2];
+        run_length[k + 1] = run_length[k + 2];
+      }
+      runs--;
+    }
+  }
+}
+void yk__stablesort_ex(void *arr, size_t item_size, size_t elements,
+                       yk__compare_function cmp_func, void *scratch,
+                       size_t scratch_elements) {
+  yk__stablesort_state state;
+  yk__stable_init(&state, item_size, cmp_func, scratch, scratch_elements);
+  yk__stable_sort(&state, (char *) arr, elements);
+}
+int yk__stablesort(void *arr, size_t item_size, size_t elements,
+                   yk__compare_function cmp_func) {
+  size_t scratch_elements = elements / 2 + 1;
+  void *scratch = malloc(scratch_elements * item_size);
+  if (scratch == NULL) return -1;
+  yk__stablesort_ex(arr, item_size, elements, cmp_func, scratch,
+                    scratch_elements);
+  free(scratch);
+  return 0;
+}
+void yk__argsort_ex(const void *arr, size_t item_size, size_t elements,
+                    yk__compare_function cmp_func, size_t *perm,
+                    size_t *scratch, size_t scratch_elements) {
+  yk__stablesort_state state;
+  size_t i;
+  for (i = 0; i < elements; i++) perm[i] = i;
+  yk__stable_init(&state, sizeof(size_t), cmp_func, scratch,
+                  scratch_elements);
+  state.items = (const char *) arr;
+  state.items_size = item_size;
+  yk__stable_sort(&state, (char *) perm, elements);
+}
+int yk__argsort(const void *arr, size_t item_size, size_t elements,
+                yk__compare_function cmp_func, size_t *perm) {
+  size_t scratch_elements = elements / 2 + 1;
+  size_t *scratch = malloc(scratch_elements * sizeof(size_t));
+  if (scratch == NULL) return -1;
+  yk__argsort_ex(arr, item_size, elements, cmp_func, perm, scratch,
+                 scratch_elements);
+  free(scratch);
+  return 0;
+}
+void yk__apply_permutation(void *arr, size_t item_size, size_t elements,
+                           size_t *perm, void *single_elem_buffer) {
+  size_t i, j, k;
+  for (i = 0; i < elements; i++) {
+    if (perm[i] == i) continue;
+    // walk the cycle through i, pulling each element into the hole left by
+    // the previous one, and mark the positions that are done
+    memcpy(single_elem_buffer, YK__SORT_AT(i), item_size);
+    for (j = i; (k = perm[j]) != i; j = k) {
+      memcpy(YK__SORT_AT(j), YK__SORT_AT(k), item_size);
+      perm[j] = j;
+    }
+    memcpy(YK__SORT_AT(j), single_elem_buffer, item_size);
+    perm[j] = j;
+  }
+}
+// each key is followed by the index of its element, so the sort compares
+// and moves small contiguous pairs, key_cmp_func sees the key at the start
+#define YK__SORT_KEY_BYTES(key_size)                                           \
+  (((key_size) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t))
+/**
+ * Stably sort the (key, index) pairs of arr in pairs, using scratch of
+ * elements / 2 + 1 pairs, and write the indices to perm (can be scratch)
+ */
+static void yk__sort_key_pairs(const void *arr, size_t item_size,
+                               size_t elements,
+                               yk__key_extract_function key_func,
+                               size_t key_size,
+                               yk__compare_function key_cmp_func, char *pairs,
+                               char *scratch, size_t *perm) {
+  size_t key_bytes = YK__SORT_KEY_BYTES(key_size);
+  size_t pair_size = key_bytes + sizeof(size_t), i;
+  yk__stablesort_state state;
+  for (i = 0; i < elements; i++) {
+    char *pair = pairs + i * pair_size;
+    key_func(YK__SORT_AT(i), pair);
+    memcpy(pair + key_bytes, &i, sizeof(size_t));
+  }
+  yk__stable_init(&state, pair_size, key_cmp_func, scratch, elements / 2 + 1);
+  yk__stable_sort(&state, pairs, elements);
+  for (i = 0; i < elements; i++)
+    memcpy(&perm[i], pairs + i * pair_size + key_bytes, sizeof(size_t));
+}
+int yk__argsort_by_key(const void *arr, size_t item_size, size_t elements,
+                       yk__key_extract_function key_func, size_t key_size,
+                       yk__compare_function key_cmp_func, size_t *perm) {
+  size_t pair_size = YK__SORT_KEY_BYTES(key_size) + sizeof(size_t);
+  char *pairs = malloc((elements + elements / 2 + 1) * pair_size);
+  if (pairs == NULL) return -1;
+  yk__sort_key_pairs(arr, item_size, elements, key_func, key_size,
+                     key_cmp_func, pairs, pairs + elements * pair_size, perm);
+  free(pairs);
+  return 0;
+}
+int yk__sort_by_key(void *arr, size_t item_size, size_t elements,
+                    yk__key_extract_function key_func, size_t key_size,
+                    yk__compare_function key_cmp_func) {
+  size_t pair_size = YK__SORT_KEY_BYTES(key_size) + sizeof(size_t);
+  size_t scratch_elements = elements / 2 + 1;
+  // pairs, then the sort scratch (reused for the permutation, a pair is at
+  // least two indices) and the temporary record
+  char *pairs = malloc((elements + scratch_elements) * pair_size + item_size);
+  char *scratch;
+  if (pairs == NULL) return -1;
+  scratch = pairs + elements * pair_size;
+  yk__sort_key_pairs(arr, item_size, elements, key_func, key_size,
+                     key_cmp_func, pairs, scratch, (size_t *) scratch);
+  yk__apply_permutation(arr, item_size, elements, (size_t *) scratch,
+                        scratch + scratch_elements * pair_size);
+  free(pairs);
+  return 0;
+}
+#undef YK__SORT_KEY_BYTES
+#undef YK__STABLE_AT
+#undef YK__STABLE_LESS
+YK__SORT_DEFINE_TYPED(yk__sort_i8, int8_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i16, int16_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i32, int32_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i64, int64_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u8, uint8_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u16, uint16_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u32, uint32_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u64, uint64_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_f32, float, YK__SORT_FLOAT_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_f64, double, YK__SORT_FLOAT_LESS, )
+#define YK__SORT_RADIX_KEY(x) (x)
+#define YK__SORT_DEFINE_RADIX(name, T, key_bytes, to_key)                      \
+  void name##_ex(T *arr, size_t elements, T *scratch) {                        \
+    size_t count[key_bytes][256], i, b, offset;                                \
+    T *from = arr, *to = scratch, *t;                                          \
+    memset(count, 0, sizeof(count));                                           \
+    for (i = 0; i < elements; i++) {                                           \
+      uint64_t key = to_key(arr[i]);                                           \
+      for (b = 0; b < key_bytes; b++) count[b][(key >> (8 * b)) & 255]++;      \
+    }                                                                          \
+    for (b = 0; b < key_bytes && elements > 0; b++) {                          \
+      size_t *c = count[b];                                                    \
+      if (c[(to_key(arr[0]) >> (8 * b)) & 255] == elements) continue;          \
+      for (i = 0, offset = 0; i < 256; i++) {                                  \
+        size_t n = c[i];                                                       \
+        c[i] = offset;                                                         \
+        offset += n;                                                           \
+      }                                                                        \
+      for (i = 0; i < elements; i++)                                           \
+        to[c[(to_key(from[i]) >> (8 * b)) & 255]++] = from[i];                 \
+      t = from;                                                                \
+      from = to;                                                               \
+      to = t;                                                                  \
+    }                                                                          \
+    if (from != arr) memcpy(arr, from, elements * sizeof(T));                  \
+  }                                                                            \
+  int name(T *arr, size_t elements) {                                          \
+    T *scratch = (T *) malloc(elements * sizeof(T) + 1);                       \
+    if (scratch == NULL) return -1;                                            \
+    name##_ex(arr, elements, scratch);                                         \
+    free(scratch);                                                             \
+    return 0;                                                                  \
+  }
+YK__SORT_DEFINE_RADIX(yk__radixsort_u32, uint32_t, 4, YK__SORT_RADIX_KEY)
+YK__SORT_DEFINE_RADIX(yk__radixsort_u64, uint64_t, 8, YK__SORT_RADIX_KEY)
+YK__SORT_DEFINE_RADIX(yk__radixsort_i64, int64_t, 8, yk__radix_key_i64)
+YK__SORT_DEFINE_RADIX(yk__radixsort_f64, double, 8, yk__radix_key_f64)
+void yk__radixsort_key_ex(void *arr, size_t item_size, size_t elements,
+                          yk__radix_key_function key_func, void *scratch) {
+  size_t count[8][256], i, b, offset;
+  char *from = (char *) arr, *to = (char *) scratch, *t;
+  uint64_t first;
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < elements; i++) {
+    uint64_t key = key_func(from + i * item_size);
+    for (b = 0; b < 8; b++) count[b][(key >> (8 * b)) & 255]++;
+  }
+  if (elements == 0) return;
+  first = key_func(arr);
+  for (b = 0; b < 8; b++) {
+    size_t *c = count[b];
+    if (c[(first >> (8 * b)) & 255] == elements) continue;
+    for (i = 0, offset = 0; i < 256; i++) {
+      size_t n = c[i];
+      c[i] = offset;
+      offset += n;
+    }
+    for (i = 0; i < elements; i++) {
+      char *item = from + i * item_size;
+      memcpy(to + c[(key_func(item) >> (8 * b)) & 255]++ * item_size, item,
+             item_size);
+    }
+    t = from;
+    from = to;
+    to = t;
+  }
+  if (from != (char *) arr) memcpy(arr, from, elements * item_size);
+}
+int yk__radixsort_key(void *arr, size_t item_size, size_t elements,
+                      yk__radix_key_function key_func) {
+  void *scratch = malloc(elements * item_size + 1);
+  if (scratch == NULL) return -1;
+  yk__radixsort_key_ex(arr, item_size, elements, key_func, scratch);
+  free(scratch);
+  return 0;
+}
+#define YK__SORT_SDS_LESS(a, b) (yk__sdscmp(a, b) < 0)
+#define YK__SORT_SDS_THRESHOLD 64
+YK__SORT_DEFINE_TYPED(yk__sort_sds, yk__sds, YK__SORT_SDS_LESS,
+                      static inline)
+int yk__radixsort_sds(yk__sds *arr, size_t elements) {
+  // buckets still to sort, they never overlap and hold 2 or more strings
+  struct yk__sort_sds_bucket {
+    size_t begin, end, depth;
+  } *stack;
+  size_t count[257], i, top = 0;
+  yk__sds *scratch = (yk__sds *) malloc(elements * sizeof(yk__sds) + 1);
+  uint16_t *digits = (uint16_t *) malloc(elements * sizeof(uint16_t) + 1);
+  stack = (struct yk__sort_sds_bucket *) malloc(
+      (elements / 2 + 1) * sizeof(struct yk__sort_sds_bucket));
+  if (scratch == NULL || digits == NULL || stack == NULL) {
+    free(scratch);
+    free(digits);
+    free(stack);
+    return -1;
+  }
+  stack[0].begin = 0;
+  stack[0].end = elements;
+  stack[0].depth = 0;
+  if (elements > 1) top = 1;
+  while (top > 0) {
+    size_t begin = stack[--top].begin, end = stack[top].end;
+    size_t depth = stack[top].depth, offset;
+    if (end - begin < YK__SORT_SDS_THRESHOLD) {
+      yk__sort_sds(arr + begin, end - begin);
+      continue;
+    }
+    // digit 0 is the end of the string, so shorter strings come first
+    memset(count, 0, sizeof(count));
+    for (i = begin; i < end; i++) {
+      yk__sds s = arr[i];
+      digits[i] = yk__sdslen(s) > depth ? (unsigned char) s[depth] + 1 : 0;
+      count[digits[i]]++;
+    }
+    for (i = 0, offset = begin; i < 257; i++) {
+      size_t n = count[i];
+      count[i] = offset;
+      offset += n;
+    }
+    for (i = begin; i < end; i++) scratch[count[digits[i]]++] = arr[i];
+    memcpy(arr + begin, scratch + begin, (end - begin) * sizeof(yk__sds));
+    // count[i] is now the end of bucket i, strings in bucket 0 are equal
+    for (i = 1; i < 257; i++) {
+      if (count[i] - count[i - 1] < 2) continue;
+      stack[top].begin = count[i - 1];
+      stack[top].end = count[i];
+      stack[top++].depth = depth + 1;
+    }
+  }
+  free(scratch);
+  free(digits);
+  free(stack);
+  return 0;
+}
+#undef YK__SORT_AT
+#undef YK__SORT_SWAP
+#undef YK__SORT_LESS
 #endif
 #endif
\ No newline at end of file
@@ -34,6 +34,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #define ssize_t intmax_t
 #endif
 #define YK__SDS_MAX_PREALLOC (1024 * 1024)
+#ifndef YK__SDS_GROW_FACTOR
+#define YK__SDS_GROW_FACTOR 2
+#endif
+#ifndef YK__SDS_GROW_CHUNK_SIZE
+#define YK__SDS_GROW_CHUNK_SIZE YK__SDS_MAX_PREALLOC
+#endif
 extern const char *YK__SDS_NOINIT;
 #include <sys/types.h>
 #include <stdarg.h>
@@ -69,13 +75,38 @@ struct __attribute__((__packed__)) yk__sdshdr64 {
   unsigned char flags; /* 3 lsb of type, 5 unused bits */
   char buf[];
 };
+/* Variant of yk__sdshdr64 that caches the result of yk__sdshash(). */
+struct __attribute__((__packed__)) yk__sdshdrhashed {
+  size_t hash;         /* valid only if YK__SDS_HASH_VALID flag is set */
+  uint64_t len;        /* used */
+  uint64_t alloc;      /* excluding the header and null terminator */
+  unsigned char flags; /* 3 lsb of type, 2 bits growth, 1 bit hash valid */
+  char buf[];
+};
 #define YK__SDS_TYPE_5 0
 #define YK__SDS_TYPE_8 1
 #define YK__SDS_TYPE_16 2
 #define YK__SDS_TYPE_32 3
 #define YK__SDS_TYPE_64 4
+#define YK__SDS_TYPE_HASHED 5
 #define YK__SDS_TYPE_MASK 7
 #define YK__SDS_TYPE_BITS 3
+/* Growth policies used by yk__sdsMakeRoomFor(). The policy is stored in the
+ * 2 bits following the type bits in the flags byte, type 5 strings have no
+ * free bits there and always use YK__SDS_GROW_DEFAULT.
+ *
+ * YK__SDS_GROW_DEFAULT   - double below YK__SDS_MAX_PREALLOC, then add it.
+ * YK__SDS_GROW_GEOMETRIC - always multiply by YK__SDS_GROW_FACTOR.
+ * YK__SDS_GROW_CHUNK     - round up to a multiple of YK__SDS_GROW_CHUNK_SIZE.
+ * YK__SDS_GROW_EXACT     - allocate only what was asked for. */
+#define YK__SDS_GROW_DEFAULT 0
+#define YK__SDS_GROW_GEOMETRIC 1
+#define YK__SDS_GROW_CHUNK 2
+#define YK__SDS_GROW_EXACT 3
+#define YK__SDS_GROW_MASK (3 << YK__SDS_TYPE_BITS)
+/* Set in the flags byte of YK__SDS_TYPE_HASHED strings once the hash is
+ * cached. Every function that changes the length clears it. */
+#define YK__SDS_HASH_VALID (1 << 5)
 #define YK__SDS_HDR_VAR(T, s)                                                  \
   struct yk__sdshdr##T *sh = (void *) ((s) - (sizeof(struct yk__sdshdr##T)));
 #define YK__SDS_HDR(T, s)                                                      \
@@ -94,6 +125,8 @@ static inline size_t yk__sdslen(const yk__sds s) {
       return YK__SDS_HDR(32, s)->len;
     case YK__SDS_TYPE_64:
       return YK__SDS_HDR(64, s)->len;
+    case YK__SDS_TYPE_HASHED:
+      return YK__SDS_HDR(hashed, s)->len;
   }
   return 0;
 }
@@ -119,6 +152,10 @@ static inline size_t yk__sdsavail(const yk__sds s) {
       YK__SDS_HDR_VAR(64, s);
       return sh->alloc - sh->len;
     }
+    case YK__SDS_TYPE_HASHED: {
+      YK__SDS_HDR_VAR(hashed, s);
+      return sh->alloc - sh->len;
+    }
   }
   return 0;
 }
@@ -141,6 +178,10 @@ static inline void yk__sdssetlen(yk__sds s, size_t newlen) {
     case YK__SDS_TYPE_64:
       YK__SDS_HDR(64, s)->len = newlen;
       break;
+    case YK__SDS_TYPE_HASHED:
+      YK__SDS_HDR(hashed, s)->len = newlen;
+      s[-1] = flags & ~YK__SDS_HASH_VALID;
+      break;
   }
 }
 static inline void yk__sdsinclen(yk__sds s, size_t inc) {
@@ -163,6 +204,10 @@ static inline void yk__sdsinclen(yk__sds s, size_t inc) {
     case YK__SDS_TYPE_64:
       YK__SDS_HDR(64, s)->len += inc;
       break;
+    case YK__SDS_TYPE_HASHED:
+      YK__SDS_HDR(hashed, s)->len += inc;
+      s[-1] = flags & ~YK__SDS_HASH_VALID;
+      break;
   }
 }
 /* yk__sdsalloc() = yk__sdsavail() + yk__sdslen() */
@@ -179,9 +224,17 @@ static inline size_t yk__sdsalloc(const yk__sds s) {
       return YK__SDS_HDR(32, s)->alloc;
     case YK__SDS_TYPE_64:
       return YK__SDS_HDR(64, s)->alloc;
+    case YK__SDS_TYPE_HASHED:
+      return YK__SDS_HDR(hashed, s)->alloc;
   }
   return 0;
 }
+static inline int yk__sdsgetgrowth(const yk__sds s) {
+  unsigned char flags = s[-1];
+  if ((flags & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_5)
+    return YK__SDS_GROW_DEFAULT;
+  return (flags & YK__SDS_GROW_MASK) >> YK__SDS_TYPE_BITS;
+}
 static inline void yk__sdssetalloc(yk__sds s, size_t newlen) {
   unsigned char flags = s[-1];
   switch (flags & YK__SDS_TYPE_MASK) {
@@ -200,17 +253,34 @@ static inline void yk__sdssetalloc(yk__sds s, size_t newlen) {
     case YK__SDS_TYPE_64:
       YK__SDS_HDR(64, s)->alloc = newlen;
       break;
+    case YK__SDS_TYPE_HASHED:
+      YK__SDS_HDR(hashed, s)->alloc = newlen;
+      break;
   }
 }
+/* Forget the cached hash of 's', needed only if the content of the string
+ * was modified by hand without changing its length. */
+static inline void yk__sdshashreset(yk__sds s) {
+  if ((s[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED)
+    s[-1] &= ~YK__SDS_HASH_VALID;
+}
 yk__sds yk__sdsnewlen(const void *init, size_t initlen);
 yk__sds yk__sdsnew(const char *init);
 yk__sds yk__sdsempty(void);
+yk__sds yk__sdsnewhashed(const void *init, size_t initlen);
+size_t yk__sdshash(const yk__sds s);
+size_t yk__sdshashlen(const void *p, size_t len, size_t seed);
 yk__sds yk__sdsdup(const yk__sds s);
+size_t yk__sdsdupsize(const yk__sds s);
+yk__sds yk__sdsdupat(void *mem, const yk__sds s);
 void yk__sdsfree(yk__sds s);
 yk__sds yk__sdsgrowzero(yk__sds s, size_t len);
 yk__sds yk__sdscatlen(yk__sds s, const void *t, size_t len);
 yk__sds yk__sdscat(yk__sds s, const char *t);
 yk__sds yk__sdscatsds(yk__sds s, const yk__sds t);
+yk__sds yk__sdscatv(yk__sds s, const void *const *parts, const size_t *lens,
+                    size_t count);
+yk__sds yk__sdscatsdsv(yk__sds s, const yk__sds *parts, size_t count);
 yk__sds yk__sdscpylen(yk__sds s, const char *t, size_t len);
 yk__sds yk__sdscpy(yk__sds s, const char *t);
 yk__sds yk__sdscatvprintf(yk__sds s, const char *fmt, va_list ap);
@@ -233,13 +303,18 @@ void yk__sdstolower(yk__sds s);
 void yk__sdstoupper(yk__sds s);
 yk__sds yk__sdsfromlonglong(long long value);
 yk__sds yk__sdscatrepr(yk__sds s, const char *p, size_t len);
+size_t yk__sdsreprlen(const char *p, size_t len);
+char *yk__sdsreprcpy(char *dst, const char *p, size_t len);
 yk__sds *yk__sdssplitargs(const char *line, int *argc);
+int yk__sdssplitargsbuf(const char *line, char *buf, char **argv, size_t *lens,
+                        int maxargs);
 yk__sds yk__sdsmapchars(yk__sds s, const char *from, const char *to,
                         size_t setlen);
 yk__sds yk__sdsjoin(char **argv, int argc, char *sep);
 yk__sds yk__sdsjoinsds(yk__sds *argv, int argc, const char *sep, size_t seplen);
 /* Low level functions exposed to the user API */
 yk__sds yk__sdsMakeRoomFor(yk__sds s, size_t addlen);
+yk__sds yk__sdssetgrowth(yk__sds s, int policy);
 void yk__sdsIncrLen(yk__sds s, ssize_t incr);
 yk__sds yk__sdsRemoveFreeSpace(yk__sds s);
 size_t yk__sdsAllocSize(yk__sds s);
@@ -285,6 +360,8 @@ static inline int yk__sdsHdrSize(char type) {
       return sizeof(struct yk__sdshdr32);
     case YK__SDS_TYPE_64:
       return sizeof(struct yk__sdshdr64);
+    case YK__SDS_TYPE_HASHED:
+      return sizeof(struct yk__sdshdrhashed);
   }
   return 0;
 }
@@ -374,8 +451,160 @@ yk__sds yk__sdsnew(const char *init) {
   size_t initlen = (init == NULL) ? 0 : strlen(init);
   return yk__sdsnewlen(init, initlen);
 }
+/* Create a new yk__sds string that caches its yk__sdshash() value in the
+ * header. It is meant for strings used as hash map keys many times, and
+ * behaves exactly like a normal yk__sds string otherwise. */
+yk__sds yk__sdsnewhashed(const void *init, size_t initlen) {
+  struct yk__sdshdrhashed *sh;
+  sh = yk__s_malloc(sizeof(struct yk__sdshdrhashed) + initlen + 1);
+  if (sh == NULL) return NULL;
+  if (init == YK__SDS_NOINIT) init = NULL;
+  else if (!init)
+    memset(sh->buf, 0, initlen + 1);
+  sh->hash = 0;
+  sh->len = initlen;
+  sh->alloc = initlen;
+  sh->flags = YK__SDS_TYPE_HASHED;
+  if (initlen && init) memcpy(sh->buf, init, initlen);
+  sh->buf[initlen] = '\0';
+  return sh->buf;
+}
+/* 64x64 -> 128 bit multiply, low half is stored in *a and high half in *b */
+static void yk__sdsmum(uint64_t *a, uint64_t *b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = *a;
+  r *= *b;
+  *a = (uint64_t) r;
+  *b = (uint64_t) (r >> 64);
+#else
+  uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+  uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  uint64_t t = rl + (rm0 << 32), c = t < rl, lo, hi;
+  lo = t + (rm1 << 32);
+  c += lo < t;
+  hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  *a = lo;
+  *b = hi;
+#endif
+}
+static uint64_t yk__sdsmix(uint64_t a, uint64_t b) {
+  yk__sdsmum(&a, &b);
+  return a ^ b;
+}
+static uint64_t yk__sdsread64(const unsigned char *p) {
+  uint64_t v;
+  memcpy(&v, p, 8);
+  return v;
+}
+static uint64_t yk__sdsread32(const unsigned char *p) {
+  uint32_t v;
+  memcpy(&v, p, 4);
+  return v;
+}
+/* Hash 'len' bytes at 'p'. This is wyhash (final version 4), it reads the
+ * input 8 or 16 bytes at a time and mixes with full 64 bit multiplies.
+ * Results depend on the byte order of the machine. */
+size_t yk__sdshashlen(const void *p, size_t len, size_t seed) {
+  static const uint64_t secret[4] = {
+      0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull,
+      0x589965cc75374cc3ull};
+  const unsigned char *d = (const unsigned char *) p;
+  uint64_t a, b, see = seed;
+  see ^= yk__sdsmix(see ^ secret[0], secret[1]);
+  if (len <= 16) {
+    if (len >= 4) {
+      a = (yk__sdsread32(d) << 32) | yk__sdsread32(d + ((len >> 3) << 2));
+      b = (yk__sdsread32(d + len - 4) << 32) |
+          yk__sdsread32(d + len - 4 - ((len >> 3) << 2));
+    } else if (len > 0) {
+      a = ((uint64_t) d[0] << 16) | ((uint64_t) d[len >> 1] << 8) |
+          d[len - 1];
+      b = 0;
+    } else {
+      a = b = 0;
+    }
+  } else {
+    size_t i = len;
+    if (i > 48) {
+      uint64_t see1 = see, see2 = see;
+      do {
+        see = yk__sdsmix(yk__sdsread64(d) ^ secret[1],
+                         yk__sdsread64(d + 8) ^ see);
+        see1 = yk__sdsmix(yk__sdsread64(d + 16) ^ secret[2],
+                          yk__sdsread64(d + 24) ^ see1);
+        see2 = yk__sdsmix(yk__sdsread64(d + 32) ^ secret[3],
+                          yk__sdsread64(d + 40) ^ see2);
+        d += 48;
+        i -= 48;
+      } while (i > 48);
+      see ^= see1 ^ see2;
+    }
+    while (i > 16) {
+      see = yk__sdsmix(yk__sdsread64(d) ^ secret[1],
+                       yk__sdsread64(d + 8) ^ see);
+      i -= 16;
+      d += 16;
+    }
+    /* the last 16 bytes, overlapping already hashed ones if needed */
+    a = yk__sdsread64(d + i - 16);
+    b = yk__sdsread64(d + i - 8);
+  }
+  a ^= secret[1];
+  b ^= see;
+  yk__sdsmum(&a, &b);
+  return (size_t) yk__sdsmix(a ^ secret[0] ^ len, b ^ secret[1]);
+}
+/* Hash the content of an yk__sds string with yk__sdshashlen().
+ * YK__SDS_TYPE_HASHED strings compute it only once, until they are modified.
+ * The value does not depend on any seed, hash tables mix in their own seed
+ * afterwards. */
+size_t yk__sdshash(const yk__sds s) {
+  size_t hash;
+  unsigned char flags = s[-1];
+  if ((flags & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED &&
+      (flags & YK__SDS_HASH_VALID))
+    return YK__SDS_HDR(hashed, s)->hash;
+  hash = yk__sdshashlen(s, yk__sdslen(s), 0);
+  if ((flags & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED) {
+    YK__SDS_HDR(hashed, s)->hash = hash;
+    s[-1] = flags | YK__SDS_HASH_VALID;
+  }
+  return hash;
+}
 /* Duplicate an yk__sds string. */
-yk__sds yk__sdsdup(const yk__sds s) { return yk__sdsnewlen(s, yk__sdslen(s)); }
+yk__sds yk__sdsdup(const yk__sds s) {
+  if ((s[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED)
+    return yk__sdsnewhashed(s, yk__sdslen(s));
+  return yk__sdsnewlen(s, yk__sdslen(s));
+}
+/* Type of the header yk__sdsdupat() gives a copy of 's'. */
+static char yk__sdsduptype(const yk__sds s) {
+  if ((s[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED)
+    return YK__SDS_TYPE_HASHED;
+  return yk__sdsReqType(yk__sdslen(s));
+}
+/* Bytes yk__sdsdupat() needs to copy 's', header and null term included. */
+size_t yk__sdsdupsize(const yk__sds s) {
+  return yk__sdsHdrSize(yk__sdsduptype(s)) + yk__sdslen(s) + 1;
+}
+/* Duplicate an yk__sds string into yk__sdsdupsize(s) bytes at 'mem' instead
+ * of allocating it, so many strings can share one block of memory. The copy
+ * has no free space and must not be grown or passed to yk__sdsfree(), it is
+ * released with the memory. A hash cached by yk__sdsnewhashed() is kept. */
+yk__sds yk__sdsdupat(void *mem, const yk__sds s) {
+  size_t len = yk__sdslen(s);
+  char type = yk__sdsduptype(s);
+  yk__sds d = (char *) mem + yk__sdsHdrSize(type);
+  d[-1] = type;
+  yk__sdssetlen(d, len);
+  yk__sdssetalloc(d, len);
+  if (type == YK__SDS_TYPE_HASHED) {
+    YK__SDS_HDR(hashed, d)->hash = YK__SDS_HDR(hashed, s)->hash;
+    d[-1] = s[-1] & (YK__SDS_TYPE_MASK | YK__SDS_HASH_VALID);
+  }
+  memcpy(d, s, len + 1);
+  return d;
+}
 /* Free an yk__sds string. No operation is performed if 's' is NULL. */
 void yk__sdsfree(yk__sds s) {
   if (s == NULL) return;
@@ -418,16 +647,32 @@ yk__sds yk__sdsMakeRoomFor(yk__sds s, size_t addlen) {
   size_t avail = yk__sdsavail(s);
   size_t len, newlen;
   char type, oldtype = s[-1] & YK__SDS_TYPE_MASK;
-  int hdrlen;
+  int hdrlen, growth;
   /* Return ASAP if there is enough space left. */
   if (avail >= addlen) return s;
   len = yk__sdslen(s);
   sh = (char *) s - yk__sdsHdrSize(oldtype);
   newlen = (len + addlen);
-  if (newlen < YK__SDS_MAX_PREALLOC) newlen *= 2;
-  else
-    newlen += YK__SDS_MAX_PREALLOC;
+  growth = yk__sdsgetgrowth(s);
+  switch (growth) {
+    case YK__SDS_GROW_GEOMETRIC:
+      newlen *= YK__SDS_GROW_FACTOR;
+      break;
+    case YK__SDS_GROW_CHUNK:
+      newlen = ((newlen + YK__SDS_GROW_CHUNK_SIZE - 1) /
+                YK__SDS_GROW_CHUNK_SIZE) *
+               YK__SDS_GROW_CHUNK_SIZE;
+      break;
+    case YK__SDS_GROW_EXACT:
+      break;
+    default:
+      if (newlen < YK__SDS_MAX_PREALLOC) newlen *= 2;
+      else
+        newlen += YK__SDS_MAX_PREALLOC;
+      break;
+  }
   type = yk__sdsReqType(newlen);
+  if (oldtype == YK__SDS_TYPE_HASHED) type = YK__SDS_TYPE_HASHED;
   /* Don't use type 5: the user is appending to the string and type 5 is
      * not able to remember empty space, so yk__sdsMakeRoomFor() must be called
      * at every appending operation. */
@@ -445,12 +690,37 @@ yk__sds yk__sdsMakeRoomFor(yk__sds s, size_t addlen) {
     memcpy((char *) newsh + hdrlen, s, len + 1);
     yk__s_free(sh);
     s = (char *) newsh + hdrlen;
-    s[-1] = type;
+    s[-1] = type | (growth << YK__SDS_TYPE_BITS);
     yk__sdssetlen(s, len);
   }
   yk__sdssetalloc(s, newlen);
   return s;
 }
+/* Change the growth policy used when 's' needs to be enlarged, 'policy' is
+ * one of the YK__SDS_GROW_* values. A large buffer that is built by many
+ * appends should use YK__SDS_GROW_GEOMETRIC, so it is reallocated only a
+ * logarithmic number of times.
+ *
+ * Type 5 strings cannot remember a policy, so they are converted to a type 8
+ * string first. After the call, the passed yk__sds string is no longer valid
+ * and all the references must be substituted with the new pointer returned
+ * by the call. */
+yk__sds yk__sdssetgrowth(yk__sds s, int policy) {
+  policy &= YK__SDS_GROW_MASK >> YK__SDS_TYPE_BITS;
+  if ((s[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_5) {
+    yk__sds t;
+    if (policy == YK__SDS_GROW_DEFAULT) return s;
+    t = yk__sdsempty();
+    if (t == NULL) return NULL;
+    t[-1] = YK__SDS_TYPE_8 | (policy << YK__SDS_TYPE_BITS);
+    t = yk__sdscatlen(t, s, yk__sdslen(s));
+    if (t == NULL) return NULL;
+    yk__sdsfree(s);
+    return t;
+  }
+  s[-1] = (s[-1] & ~YK__SDS_GROW_MASK) | (policy << YK__SDS_TYPE_BITS);
+  return s;
+}
 /* Reallocate the yk__sds string so that it has no free space at the end. The
  * contained string remains not altered, but next concatenation operations
  * will require a reallocation.
@@ -461,6 +731,7 @@ yk__sds yk__sdsRemoveFreeSpace(yk__sds s) {
   void *sh, *newsh;
   char type, oldtype = s[-1] & YK__SDS_TYPE_MASK;
   int hdrlen, oldhdrlen = yk__sdsHdrSize(oldtype);
+  int growth = yk__sdsgetgrowth(s);
   size_t len = yk__sdslen(s);
   size_t avail = yk__sdsavail(s);
   sh = (char *) s - oldhdrlen;
@@ -469,6 +740,10 @@ yk__sds yk__sdsRemoveFreeSpace(yk__sds s) {
   /* Check what would be the minimum SDS header that is just good enough to
      * fit this string. */
   type = yk__sdsReqType(len);
+  /* Keep a header that is able to remember the growth policy. */
+  if (type == YK__SDS_TYPE_5 && growth != YK__SDS_GROW_DEFAULT)
+    type = YK__SDS_TYPE_8;
+  if (oldtype == YK__SDS_TYPE_HASHED) type = YK__SDS_TYPE_HASHED;
   hdrlen = yk__sdsHdrSize(type);
   /* If the type is the same, or at least a large enough type is still
      * required, we just realloc(), letting the allocator to do the copy
@@ -484,7 +759,7 @@ yk__sds yk__sdsRemoveFreeSpace(yk__sds s) {
     memcpy((char *) newsh + hdrlen, s, len + 1);
     yk__s_free(sh);
     s = (char *) newsh + hdrlen;
-    s[-1] = type;
+    s[-1] = type | (growth << YK__SDS_TYPE_BITS);
     yk__sdssetlen(s, len);
   }
   yk__sdssetalloc(s, len);
@@ -570,6 +845,14 @@ void yk__sdsIncrLen(yk__sds s, ssize_t incr) {
       len = (sh->len += incr);
       break;
     }
+    case YK__SDS_TYPE_HASHED: {
+      YK__SDS_HDR_VAR(hashed, s);
+      assert((incr >= 0 && sh->alloc - sh->len >= (uint64_t) incr) ||
+             (incr < 0 && sh->len >= (uint64_t) (-incr)));
+      len = (sh->len += incr);
+      s[-1] = flags & ~YK__SDS_HASH_VALID;
+      break;
+    }
     default:
       len = 0; /* Just to avoid compilation warnings. */
   }
@@ -618,6 +901,46 @@ yk__sds yk__sdscat(yk__sds s, const char *t) {
 yk__sds yk__sdscatsds(yk__sds s, const yk__sds t) {
   return yk__sdscatlen(s, t, yk__sdslen(t));
 }
+/* Append 'count' binary safe pieces to 's', where parts[j] points to lens[j]
+ * bytes. Room for all the pieces is made with a single yk__sdsMakeRoomFor()
+ * call, so the string is reallocated at most once.
+ *
+ * After the call, the passed yk__sds string is no longer valid and all the
+ * references must be substituted with the new pointer returned by the call. */
+yk__sds yk__sdscatv(yk__sds s, const void *const *parts, const size_t *lens,
+                    size_t count) {
+  size_t curlen = yk__sdslen(s), total = 0, j;
+  char *p;
+  for (j = 0; j < count; j++) total += lens[j];
+  s = yk__sdsMakeRoomFor(s, total);
+  if (s == NULL) return NULL;
+  p = s + curlen;
+  for (j = 0; j < count; j++) {
+    if (lens[j] == 0) continue;
+    memcpy(p, parts[j], lens[j]);
+    p += lens[j];
+  }
+  yk__sdssetlen(s, curlen + total);
+  s[curlen + total] = '\0';
+  return s;
+}
+/* Like yk__sdscatv() but appends an array of yk__sds strings. */
+yk__sds yk__sdscatsdsv(yk__sds s, const yk__sds *parts, size_t count) {
+  size_t curlen = yk__sdslen(s), total = 0, j;
+  char *p;
+  for (j = 0; j < count; j++) total += yk__sdslen(parts[j]);
+  s = yk__sdsMakeRoomFor(s, total);
+  if (s == NULL) return NULL;
+  p = s + curlen;
+  for (j = 0; j < count; j++) {
+    size_t l = yk__sdslen(parts[j]);
+    memcpy(p, parts[j], l);
+    p += l;
+  }
+  yk__sdssetlen(s, curlen + total);
+  s[curlen + total] = '\0';
+  return s;
+}
 /* Destructively modify the yk__sds string 's' to hold the specified binary
  * safe string pointed by 't' of length 'len' bytes. */
 yk__sds yk__sdscpylen(yk__sds s, const char *t, size_t len) {
@@ -929,11 +1252,13 @@ void yk__sdsrange(yk__sds s, ssize_t start, ssize_t end) {
 void yk__sdstolower(yk__sds s) {
   size_t len = yk__sdslen(s), j;
   for (j = 0; j < len; j++) s[j] = tolower(s[j]);
+  yk__sdshashreset(s);
 }
 /* Apply toupper() to every character of the yk__sds string 's'. */
 void yk__sdstoupper(yk__sds s) {
   size_t len = yk__sdslen(s), j;
   for (j = 0; j < len; j++) s[j] = toupper(s[j]);
+  yk__sdshashreset(s);
 }
 /* Compare two yk__sds strings s1 and s2 with memcmp().
  *
@@ -1023,44 +1348,90 @@ void yk__sdsfreesplitres(yk__sds *tokens, int count) {
   while (count--) yk__sdsfree(tokens[count]);
   yk__s_free(tokens);
 }
-/* Append to the yk__sds string "s" an escaped string representation where
- * all the non-printable characters (tested with isprint()) are turned into
- * escapes in the form "\n\r\a...." or "\x<hex-number>".
- *
- * After the call, the modified yk__sds string is no longer valid and all the
- * references must be substituted with the new pointer returned by the call. */
-yk__sds yk__sdscatrepr(yk__sds s, const char *p, size_t len) {
-  s = yk__sdscatlen(s, "\"", 1);
+/* Return the number of bytes yk__sdscatrepr() appends for 'p', including
+ * the surrounding quotes. */
+size_t yk__sdsreprlen(const char *p, size_t len) {
+  size_t n = 2;
   while (len--) {
     switch (*p) {
       case '\\':
       case '"':
-        s = yk__sdscatprintf(s, "\\%c", *p);
+      case '\n':
+      case '\r':
+      case '\t':
+      case '\a':
+      case '\b':
+        n += 2;
+        break;
+      default:
+        n += isprint(*p) ? 1 : 4;
+        break;
+    }
+    p++;
+  }
+  return n;
+}
+/* Write the escaped representation of 'p' to 'dst', which must have room for
+ * yk__sdsreprlen(p, len) bytes. No null terminator is added. Returns a pointer
+ * just past the last written byte, so calls can be chained into one buffer. */
+char *yk__sdsreprcpy(char *dst, const char *p, size_t len) {
+  static const char hex[] = "0123456789abcdef";
+  const char *end = p + len, *run;
+  *dst++ = '"';
+  while (p < end) {
+    /* copy runs of characters that need no escaping at once */
+    run = p;
+    while (p < end && *p != '\\' && *p != '"' && isprint(*p)) p++;
+    memcpy(dst, run, p - run);
+    dst += p - run;
+    if (p == end) break;
+    *dst++ = '\\';
+    switch (*p) {
+      case '\\':
+      case '"':
+        *dst++ = *p;
         break;
       case '\n':
-        s = yk__sdscatlen(s, "\\n", 2);
+        *dst++ = 'n';
         break;
       case '\r':
-        s = yk__sdscatlen(s, "\\r", 2);
+        *dst++ = 'r';
         break;
       case '\t':
-        s = yk__sdscatlen(s, "\\t", 2);
+        *dst++ = 't';
         break;
       case '\a':
-        s = yk__sdscatlen(s, "\\a", 2);
+        *dst++ = 'a';
         break;
       case '\b':
-        s = yk__sdscatlen(s, "\\b", 2);
+        *dst++ = 'b';
         break;
       default:
-        if (isprint(*p)) s = yk__sdscatprintf(s, "%c", *p);
-        else
-          s = yk__sdscatprintf(s, "\\x%02x", (unsigned char) *p);
+        *dst++ = 'x';
+        *dst++ = hex[(unsigned char) *p >> 4];
+        *dst++ = hex[(unsigned char) *p & 15];
         break;
     }
     p++;
   }
-  return yk__sdscatlen(s, "\"", 1);
+  *dst++ = '"';
+  return dst;
+}
+/* Append to the yk__sds string "s" an escaped string representation where
+ * all the non-printable characters (tested with isprint()) are turned into
+ * escapes in the form "\n\r\a...." or "\x<hex-number>".
+ *
+ * The output is measured first so the string grows at most once.
+ *
+ * After the call, the modified yk__sds string is no longer valid and all the
+ * references must be substituted with the new pointer returned by the call. */
+yk__sds yk__sdscatrepr(yk__sds s, const char *p, size_t len) {
+  size_t n = yk__sdsreprlen(p, len);
+  s = yk__sdsMakeRoomFor(s, n);
+  if (s == NULL) return NULL;
+  yk__sdsreprcpy(s + yk__sdslen(s), p, len);
+  yk__sdsIncrLen(s, n);
+  return s;
 }
 /* Helper function for yk__sdssplitargs() that returns non zero if 'c'
  * is a valid hex digit. */
@@ -1114,6 +1485,104 @@ int hex_digit_to_int(char c) {
       return 0;
   }
 }
+/* Helper function for yk__sdssplitargs() that parses the argument starting
+ * at 'p', which must not be a space or the end of the line. The decoded bytes
+ * are written to 'dst' unless it is NULL, and their count is stored in *len.
+ * Returns a pointer just past the argument, or NULL if the quotes are
+ * unbalanced or a closing quote is followed by a non space character. */
+static const char *yk__sdsargparse(const char *p, char *dst, size_t *len) {
+  const char *run;
+  size_t n = 0;
+  int inq = 0;  /* set to 1 if we are in "quotes" */
+  int insq = 0; /* set to 1 if we are in 'single quotes' */
+  char c;
+  while (1) {
+    /* plain characters are copied in runs, only the special ones are
+     * handled one by one */
+    run = p;
+    if (inq) {
+      while (*p && *p != '\\' && *p != '"') p++;
+    } else if (insq) {
+      while (*p && *p != '\\' && *p != '\'') p++;
+    } else {
+      while (*p && *p != ' ' && *p != '\n' && *p != '\r' && *p != '\t' &&
+             *p != '"' && *p != '\'')
+        p++;
+    }
+    if (dst) memcpy(dst + n, run, p - run);
+    n += p - run;
+    if (inq) {
+      if (*p == '\\' && *(p + 1) == 'x' && is_hex_digit(*(p + 2)) &&
+          is_hex_digit(*(p + 3))) {
+        c = (char) ((hex_digit_to_int(*(p + 2)) * 16) +
+                    hex_digit_to_int(*(p + 3)));
+        p += 4;
+      } else if (*p == '\\' && *(p + 1)) {
+        switch (*(p + 1)) {
+          case 'n':
+            c = '\n';
+            break;
+          case 'r':
+            c = '\r';
+            break;
+          case 't':
+            c = '\t';
+            break;
+          case 'b':
+            c = '\b';
+            break;
+          case 'a':
+            c = '\a';
+            break;
+          default:
+            c = *(p + 1);
+            break;
+        }
+        p += 2;
+      } else if (*p == '"') {
+        /* closing quote must be followed by a space or
+         * nothing at all. */
+        if (*(p + 1) && !isspace(*(p + 1))) return NULL;
+        break;
+      } else if (!*p) {
+        /* unterminated quotes */
+        return NULL;
+      } else {
+        c = *p++;
+      }
+    } else if (insq) {
+      if (*p == '\\' && *(p + 1) == '\'') {
+        c = '\'';
+        p += 2;
+      } else if (*p == '\'') {
+        /* closing quote must be followed by a space or
+         * nothing at all. */
+        if (*(p + 1) && !isspace(*(p + 1))) return NULL;
+        break;
+      } else if (!*p) {
+        /* unterminated quotes */
+        return NULL;
+      } else {
+        c = *p++;
+      }
+    } else if (*p == '"') {
+      inq = 1;
+      p++;
+      continue;
+    } else if (*p == '\'') {
+      insq = 1;
+      p++;
+      continue;
+    } else {
+      *len = n;
+      return p;
+    }
+    if (dst) dst[n] = c;
+    n++;
+  }
+  *len = n;
+  return p + 1;
+}
 /* Split a line into arguments, where every argument can be in the
  * following programming-language REPL-alike form:
  *
@@ -1128,6 +1597,10 @@ int hex_digit_to_int(char c) {
  * Note that yk__sdscatrepr() is able to convert back a string into
  * a quoted string in the same format yk__sdssplitargs() is able to parse.
  *
+ * The line is validated and the arguments are counted first, so the array is
+ * allocated once and every argument is decoded straight into a string of the
+ * right size.
+ *
  * The function returns the allocated tokens on success, even when the
  * input string is empty, or NULL if the input contains unbalanced
  * quotes or closed quotes followed by non space characters
@@ -1135,117 +1608,64 @@ int hex_digit_to_int(char c) {
  */
 yk__sds *yk__sdssplitargs(const char *line, int *argc) {
   const char *p = line;
-  char *current = NULL;
-  char **vector = NULL;
+  yk__sds *vector;
+  size_t len;
+  int count = 0;
   *argc = 0;
   while (1) {
     /* skip blanks */
     while (*p && isspace(*p)) p++;
-    if (*p) {
-      /* get a token */
-      int inq = 0;  /* set to 1 if we are in "quotes" */
-      int insq = 0; /* set to 1 if we are in 'single quotes' */
-      int done = 0;
-      if (current == NULL) current = yk__sdsempty();
-      while (!done) {
-        if (inq) {
-          if (*p == '\\' && *(p + 1) == 'x' && is_hex_digit(*(p + 2)) &&
-              is_hex_digit(*(p + 3))) {
-            unsigned char byte;
-            byte =
-                (hex_digit_to_int(*(p + 2)) * 16) + hex_digit_to_int(*(p + 3));
-            current = yk__sdscatlen(current, (char *) &byte, 1);
-            p += 3;
-          } else if (*p == '\\' && *(p + 1)) {
-            char c;
-            p++;
-            switch (*p) {
-              case 'n':
-                c = '\n';
-                break;
-              case 'r':
-                c = '\r';
-                break;
-              case 't':
-                c = '\t';
-                break;
-              case 'b':
-                c = '\b';
-                break;
-              case 'a':
-                c = '\a';
-                break;
-              default:
-                c = *p;
-                break;
-            }
-            current = yk__sdscatlen(current, &c, 1);
-          } else if (*p == '"') {
-            /* closing quote must be followed by a space or
-                         * nothing at all. */
-            if (*(p + 1) && !isspace(*(p + 1))) goto err;
-            done = 1;
-          } else if (!*p) {
-            /* unterminated quotes */
-            goto err;
-          } else {
-            current = yk__sdscatlen(current, p, 1);
-          }
-        } else if (insq) {
-          if (*p == '\\' && *(p + 1) == '\'') {
-            p++;
-            current = yk__sdscatlen(current, "'", 1);
-          } else if (*p == '\'') {
-            /* closing quote must be followed by a space or
-                         * nothing at all. */
-            if (*(p + 1) && !isspace(*(p + 1))) goto err;
-            done = 1;
-          } else if (!*p) {
-            /* unterminated quotes */
-            goto err;
-          } else {
-            current = yk__sdscatlen(current, p, 1);
-          }
-        } else {
-          switch (*p) {
-            case ' ':
-            case '\n':
-            case '\r':
-            case '\t':
-            case '\0':
-              done = 1;
-              break;
-            case '"':
-              inq = 1;
-              break;
-            case '\'':
-              insq = 1;
-              break;
-            default:
-              current = yk__sdscatlen(current, p, 1);
-              break;
-          }
-        }
-        if (*p) p++;
-      }
-      /* add the token to the vector */
-      vector = yk__s_realloc(vector, ((*argc) + 1) * sizeof(char *));
-      vector[*argc] = current;
-      (*argc)++;
-      current = NULL;
-    } else {
-      /* Even on empty input string return something not NULL. */
-      if (vector == NULL) vector = yk__s_malloc(sizeof(void *));
-      return vector;
-    }
+    if (!*p) break;
+    p = yk__sdsargparse(p, NULL, &len);
+    if (p == NULL) return NULL;
+    count++;
+  }
+  /* Even on empty input string return something not NULL. */
+  vector = yk__s_malloc(sizeof(yk__sds) * (count ? count : 1));
+  if (vector == NULL) return NULL;
+  for (p = line; *argc < count; (*argc)++) {
+    const char *start;
+    while (isspace(*p)) p++;
+    start = p;
+    p = yk__sdsargparse(start, NULL, &len);
+    vector[*argc] = yk__sdsnewlen(YK__SDS_NOINIT, len);
+    if (vector[*argc] == NULL) goto err;
+    yk__sdsargparse(start, vector[*argc], &len);
   }
+  return vector;
 err:
   while ((*argc)--) yk__sdsfree(vector[*argc]);
   yk__s_free(vector);
-  if (current) yk__sdsfree(current);
   *argc = 0;
   return NULL;
 }
+/* Like yk__sdssplitargs() but without any allocation. Arguments are decoded
+ * into 'buf' as null terminated strings, 'buf' must have room for
+ * strlen(line) + 1 bytes as the output is never longer than the input.
+ * Pointers to the first 'maxargs' arguments are stored in 'argv' and their
+ * lengths in 'lens' unless it is NULL.
+ *
+ * Returns the number of arguments in the line, that can be greater than
+ * 'maxargs', or -1 on the same errors yk__sdssplitargs() returns NULL for. */
+int yk__sdssplitargsbuf(const char *line, char *buf, char **argv, size_t *lens,
+                        int maxargs) {
+  const char *p = line;
+  size_t len;
+  int count = 0;
+  while (1) {
+    while (*p && isspace(*p)) p++;
+    if (!*p) return count;
+    p = yk__sdsargparse(p, buf, &len);
+    if (p == NULL) return -1;
+    if (count < maxargs) {
+      argv[count] = buf;
+      if (lens) lens[count] = len;
+    }
+    buf[len] = '\0';
+    buf += len + 1;
+    count++;
+  }
+}
 /* Modify the string substituting all the occurrences of the set of
  * characters specified in the 'from' string to the corresponding character
  * in the 'to' array.
@@ -1266,6 +1686,7 @@ yk__sds yk__sdsmapchars(yk__sds s, const char *from, const char *to,
       }
     }
   }
+  yk__sdshashreset(s);
   return s;
 }
 /* Join an array of C strings using the specified separator (also a C string).
@@ -1279,14 +1700,27 @@ yk__sds yk__sdsjoin(char **argv, int argc, char *sep) {
   }
   return join;
 }
-/* Like yk__sdsjoin, but joins an array of SDS strings. */
+/* Like yk__sdsjoin, but joins an array of SDS strings. The final length is
+ * known up front, so the result is allocated exactly once. */
 yk__sds yk__sdsjoinsds(yk__sds *argv, int argc, const char *sep,
                        size_t seplen) {
-  yk__sds join = yk__sdsempty();
+  yk__sds join;
+  size_t total = 0;
+  char *p;
   int j;
+  for (j = 0; j < argc; j++) total += yk__sdslen(argv[j]);
+  if (argc > 1) total += seplen * (argc - 1);
+  join = yk__sdsnewlen(YK__SDS_NOINIT, total);
+  if (join == NULL) return NULL;
+  p = join;
   for (j = 0; j < argc; j++) {
-    join = yk__sdscatsds(join, argv[j]);
-    if (j != argc - 1) join = yk__sdscatlen(join, sep, seplen);
+    size_t l = yk__sdslen(argv[j]);
+    memcpy(p, argv[j], l);
+    p += l;
+    if (j != argc - 1 && seplen) {
+      memcpy(p, sep, seplen);
+      p += seplen;
+    }
   }
   return join;
 }
@@ -1435,97 +1869,547 @@ int main(void) { return yk__sdsTest(); }
 #endif /* YK__SDS_IMPLEMENTATION */
 /*
 */
-/* yk__stb_ds.h - v0.67 - public domain data structures - Sean Barrett 2019
-
-   This is a single-header-file library that provides easy-to-use
-   dynamic arrays and hash tables for C (also works in C++).
-
-   For a gentle introduction:
-      http://nothings.org/stb_ds
-
-   To use this library, do this in *one* C or C++ file:
-      #define YK__STB_DS_IMPLEMENTATION
-      #include "yk__stb_ds.h"
-
-TABLE OF CONTENTS
-
-  Table of Contents
-  Compile-time options
-  License
-  Documentation
-  Notes
-  Notes - Dynamic arrays
-  Notes - Hash maps
-  Credits
-
-COMPILE-TIME OPTIONS
-
-  #define YK__STBDS_NO_SHORT_NAMES
-
-     This flag needs to be set globally.
-
-     By default stb_ds exposes shorter function names that are not qualified
-     with the "stbds_" prefix. If these names conflict with the names in your
-     code, define this flag.
-
-  #define YK__STBDS_SIPHASH_2_4
-
-     This flag only needs to be set in the file containing #define YK__STB_DS_IMPLEMENTATION.
-
-     By default yk__stb_ds.h hashes using a weaker variant of SipHash and a custom hash for
-     4- and 8-byte keys. On 64-bit platforms, you can define the above flag to force
-     yk__stb_ds.h to use specification-compliant SipHash-2-4 for all keys. Doing so makes
-     hash table insertion about 20% slower on 4- and 8-byte keys, 5% slower on
-     64-byte keys, and 10% slower on 256-byte keys on my test computer.
-
-  #define YK__STBDS_REALLOC(context,ptr,size) better_realloc
-  #define YK__STBDS_FREE(context,ptr)         better_free
-
-     These defines only need to be set in the file containing #define YK__STB_DS_IMPLEMENTATION.
-
-     By default stb_ds uses stdlib realloc() and free() for memory management. You can
-     substitute your own functions instead by defining these symbols. You must either
-     define both, or neither. Note that at the moment, 'context' will always be NULL.
-     @TODO add an yk__array/hash initialization function that takes a memory context pointer.
-
-  #define YK__STBDS_UNIT_TESTS
-
-     Defines a function yk__stbds_unit_tests() that checks the functioning of the data structures.
-
-  Note that on older versions of gcc (e.g. 5.x.x) you may need to build with '-std=c++0x'
-     (or equivalentally '-std=c++11') when using anonymous structures as seen on the web
-     page or in YK__STBDS_UNIT_TESTS.
-
-LICENSE
-
-  Placed in the public domain and also MIT licensed.
-  See end of file for detailed license information.
-
-DOCUMENTATION
-
-  Dynamic Arrays
-
-    Non-function interface:
+/**
+Chunked string builder (rope) on top of yk__sds as a single file header by Bhathiya Perera
 
-      Declare an empty dynamic yk__array of type T
-        T* foo = NULL;
+MIT License
+Copyright (c) 2022 Bhathiya Perera
 
-      Access the i'th item of a dynamic yk__array 'foo' of type T, T* foo:
-        foo[i]
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
 
-    Functions (actually macros)
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
 
-      yk__arrfree:
-        void yk__arrfree(T*);
-          Frees the yk__array.
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
 
-      yk__arrlen:
-        ptrdiff_t yk__arrlen(T*);
-          Returns the number of elements in the yk__array.
+// ======================================================================= //
+//                               Notes                                     //
+// ======================================================================= //
 
-      yk__arrlenu:
-        size_t yk__arrlenu(T*);
-          Returns the number of elements in the yk__array as an unsigned type.
+A rope is a deque of yk__sds chunks. Small appends are copied into the free
+space of the last chunk (chunks are YK__SDSROPE_CHUNK_SIZE bytes), large
+pieces become chunks of their own. Small prepends and inserts go into the
+free space of the chunk they touch, moving at most a chunk worth of bytes. Nothing is ever moved once written, so
+building a large text costs a single copy per byte, plus one more when the
+rope is flattened (or none at all if it is written with writev).
+*/
+#ifndef YK__SDSROPE
+#define YK__SDSROPE
+#include <stddef.h>
+#ifndef YK__SDSROPE_CHUNK_SIZE
+#define YK__SDSROPE_CHUNK_SIZE 4096
+#endif
+/**
+ * Rope of yk__sds chunks, initialize with yk__sdsrope_init()
+ */
+typedef struct yk__sdsrope {
+  yk__sds *chunks;// storage for the chunk deque
+  size_t head;    // index of the first chunk in storage
+  size_t count;   // number of chunks in use
+  size_t capacity;// number of slots in storage
+  size_t length;  // total number of bytes
+} yk__sdsrope;
+/**
+ * Initialize an empty rope
+ * @param r rope
+ */
+void yk__sdsrope_init(yk__sdsrope *r);
+/**
+ * Free all chunks of the rope, rope can be reused after init
+ * @param r rope
+ */
+void yk__sdsrope_free(yk__sdsrope *r);
+/**
+ * Append bytes to end of rope (amortized O(1))
+ * @param r rope
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_append(yk__sdsrope *r, const void *data, size_t len);
+/**
+ * Append a copy of an yk__sds string to end of rope
+ * @param r rope
+ * @param s string
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_append_sds(yk__sdsrope *r, const yk__sds s);
+/**
+ * Append an yk__sds string as a chunk without copying it
+ * Rope takes ownership of s, do not free or modify it afterwards
+ * @param r rope
+ * @param s string
+ * @return 0 if successful, -1 if out of memory (s is not taken)
+ */
+int yk__sdsrope_adopt(yk__sdsrope *r, yk__sds s);
+/**
+ * Add bytes to the beginning of rope, small pieces are copied into the free
+ * space of the first chunk (O(YK__SDSROPE_CHUNK_SIZE))
+ * @param r rope
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_prepend(yk__sdsrope *r, const void *data, size_t len);
+/**
+ * Insert bytes at given byte position, cost is O(number of chunks)
+ * @param r rope
+ * @param pos position (clamped to length of rope)
+ * @param data bytes to copy
+ * @param len number of bytes
+ * @return 0 if successful, -1 if out of memory
+ */
+int yk__sdsrope_insert(yk__sdsrope *r, size_t pos, const void *data,
+                       size_t len);
+/**
+ * Get total length of rope in bytes
+ */
+size_t yk__sdsrope_len(const yk__sdsrope *r);
+/**
+ * Get number of chunks in rope
+ */
+size_t yk__sdsrope_chunk_count(const yk__sdsrope *r);
+/**
+ * Get a chunk of the rope, it is owned by the rope so only read it
+ * @param r rope
+ * @param i index of the chunk
+ * @return yk__sds chunk
+ */
+yk__sds yk__sdsrope_chunk(const yk__sdsrope *r, size_t i);
+/**
+ * Copy the rope to a single new yk__sds string (allocated only once)
+ * @param r rope
+ * @return new yk__sds string or NULL if out of memory
+ */
+yk__sds yk__sdsrope_flatten(const yk__sdsrope *r);
+/**
+ * Write the rope to a file descriptor (uses writev where available)
+ * @param r rope
+ * @param fd file descriptor
+ * @return 0 if successful, -1 if write failed
+ */
+int yk__sdsrope_write(const yk__sdsrope *r, int fd);
+#ifdef YK__SDSROPE_IMPLEMENTATION
+#include <errno.h>
+#include <stdlib.h>// malloc
+#include <string.h>// memcpy
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#ifndef YK__SDSROPE_IOV_MAX
+#define YK__SDSROPE_IOV_MAX 64
+#endif
+#define yk__sdsrope_at(r, i) ((r)->chunks[(r)->head + (i)])
+void yk__sdsrope_init(yk__sdsrope *r) { memset(r, 0, sizeof(yk__sdsrope)); }
+void yk__sdsrope_free(yk__sdsrope *r) {
+  size_t i;
+  for (i = 0; i < r->count; i++) { yk__sdsfree(yk__sdsrope_at(r, i)); }
+  free(r->chunks);
+  memset(r, 0, sizeof(yk__sdsrope));
+}
+/**
+ * Make sure there are at least front free slots before the first chunk and
+ * back free slots after the last chunk
+ * @return 0 if successful, -1 if out of memory
+ */
+static int yk__sdsrope_reserve(yk__sdsrope *r, size_t front, size_t back) {
+  size_t cap, head;
+  yk__sds *chunks;
+  if (r->head >= front && r->capacity - r->head - r->count >= back) return 0;
+  cap = r->capacity * 2;
+  if (cap < 8) cap = 8;
+  while (cap < r->count + front + back) cap *= 2;
+  chunks = malloc(cap * sizeof(yk__sds));
+  if (chunks == NULL) return -1;
+  // appending is the common case, only keep slack in front if asked for it
+  head = 0;
+  if (front > 0) head = front + (cap - r->count - front - back) / 2;
+  if (r->count > 0) {
+    memcpy(chunks + head, r->chunks + r->head, r->count * sizeof(yk__sds));
+  }
+  free(r->chunks);
+  r->chunks = chunks;
+  r->head = head;
+  r->capacity = cap;
+  return 0;
+}
+/**
+ * Create a new chunk holding given data
+ * small chunks get YK__SDSROPE_CHUNK_SIZE capacity so later appends fit in
+ */
+static yk__sds yk__sdsrope_new_chunk(const void *data, size_t len) {
+  yk__sds chunk;
+  if (len >= YK__SDSROPE_CHUNK_SIZE) return yk__sdsnewlen(data, len);
+  chunk = yk__sdssetgrowth(yk__sdsempty(), YK__SDS_GROW_EXACT);
+  if (chunk == NULL) return NULL;
+  chunk = yk__sdsMakeRoomFor(chunk, YK__SDSROPE_CHUNK_SIZE);
+  if (chunk == NULL) return NULL;
+  return yk__sdscatlen(chunk, data, len);
+}
+/**
+ * Check that len bytes can go into the free space of a chunk that is small
+ * enough to move its bytes around
+ */
+#define yk__sdsrope_fits(chunk, len)                                           \
+  (yk__sdslen(chunk) <= YK__SDSROPE_CHUNK_SIZE && yk__sdsavail(chunk) >= (len))
+/**
+ * Copy data into the free space of chunk at offset, moving the bytes after
+ * offset up (the caller checks that it fits)
+ */
+static void yk__sdsrope_fill(yk__sds chunk, size_t offset, const void *data,
+                             size_t len) {
+  memmove(chunk + offset + len, chunk + offset, yk__sdslen(chunk) - offset);
+  memcpy(chunk + offset, data, len);
+  yk__sdsIncrLen(chunk, (ssize_t) len);
+}
+/**
+ * Insert already created chunks at chunk index i
+ * @return 0 if successful, -1 if out of memory
+ */
+static int yk__sdsrope_insert_chunks(yk__sdsrope *r, size_t i, yk__sds *items,
+                                     size_t n) {
+  if (i == 0 && r->count > 0) {
+    if (yk__sdsrope_reserve(r, n, 0) != 0) return -1;
+    r->head -= n;
+  } else {
+    if (yk__sdsrope_reserve(r, 0, n) != 0) return -1;
+    memmove(&yk__sdsrope_at(r, i + n), &yk__sdsrope_at(r, i),
+            (r->count - i) * sizeof(yk__sds));
+  }
+  memcpy(&yk__sdsrope_at(r, i), items, n * sizeof(yk__sds));
+  r->count += n;
+  return 0;
+}
+int yk__sdsrope_append(yk__sdsrope *r, const void *data, size_t len) {
+  const char *p = (const char *) data;
+  yk__sds chunk;
+  if (len == 0) return 0;
+  if (r->count > 0) {
+    // fill the free space of the last chunk first
+    yk__sds last = yk__sdsrope_at(r, r->count - 1);
+    size_t fill = yk__sdsavail(last);
+    if (fill > len) fill = len;
+    if (fill > 0) {
+      memcpy(last + yk__sdslen(last), p, fill);
+      yk__sdsIncrLen(last, (ssize_t) fill);
+      r->length += fill;
+      p += fill;
+      len -= fill;
+      if (len == 0) return 0;
+    }
+  }
+  chunk = yk__sdsrope_new_chunk(p, len);
+  if (chunk == NULL) return -1;
+  if (yk__sdsrope_insert_chunks(r, r->count, &chunk, 1) != 0) {
+    yk__sdsfree(chunk);
+    return -1;
+  }
+  r->length += len;
+  return 0;
+}
+int yk__sdsrope_append_sds(yk__sdsrope *r, const yk__sds s) {
+  return yk__sdsrope_append(r, s, yk__sdslen(s));
+}
+int yk__sdsrope_adopt(yk__sdsrope *r, yk__sds s) {
+  if (yk__sdsrope_insert_chunks(r, r->count, &s, 1) != 0) return -1;
+  r->length += yk__sdslen(s);
+  return 0;
+}
+int yk__sdsrope_prepend(yk__sdsrope *r, const void *data, size_t len) {
+  yk__sds chunk;
+  if (len == 0) return 0;
+  if (r->count > 0 && yk__sdsrope_fits(yk__sdsrope_at(r, 0), len)) {
+    yk__sdsrope_fill(yk__sdsrope_at(r, 0), 0, data, len);
+    r->length += len;
+    return 0;
+  }
+  chunk = yk__sdsrope_new_chunk(data, len);
+  if (chunk == NULL) return -1;
+  if (yk__sdsrope_insert_chunks(r, 0, &chunk, 1) != 0) {
+    yk__sdsfree(chunk);
+    return -1;
+  }
+  r->length += len;
+  return 0;
+}
+int yk__sdsrope_insert(yk__sdsrope *r, size_t pos, const void *data,
+                       size_t len) {
+  size_t i, offset, chunk_len = 0;
+  yk__sds chunk, parts[2];
+  if (len == 0) return 0;
+  if (pos >= r->length) return yk__sdsrope_append(r, data, len);
+  if (pos == 0) return yk__sdsrope_prepend(r, data, len);
+  // find chunk i that contains byte at pos
+  offset = pos;
+  for (i = 0; i < r->count; i++) {
+    chunk_len = yk__sdslen(yk__sdsrope_at(r, i));
+    if (offset < chunk_len) break;
+    offset -= chunk_len;
+  }
+  if (offset == 0) {
+    // insert between chunk i - 1 and chunk i, at the end of the first one or
+    // the start of the second one if it fits
+    chunk = yk__sdsrope_at(r, i - 1);
+    if (yk__sdsavail(chunk) >= len) {
+      yk__sdsrope_fill(chunk, yk__sdslen(chunk), data, len);
+      r->length += len;
+      return 0;
+    }
+    chunk = yk__sdsrope_at(r, i);
+    if (yk__sdsrope_fits(chunk, len)) {
+      yk__sdsrope_fill(chunk, 0, data, len);
+      r->length += len;
+      return 0;
+    }
+    chunk = yk__sdsrope_new_chunk(data, len);
+    if (chunk == NULL) return -1;
+    if (yk__sdsrope_insert_chunks(r, i, &chunk, 1) != 0) {
+      yk__sdsfree(chunk);
+      return -1;
+    }
+    r->length += len;
+    return 0;
+  }
+  chunk = yk__sdsrope_at(r, i);
+  if (yk__sdsrope_fits(chunk, len)) {
+    // chunks are small, just make a gap in place
+    yk__sdsrope_fill(chunk, offset, data, len);
+    r->length += len;
+    return 0;
+  }
+  // split chunk i at offset and put data in between
+  parts[0] = yk__sdsrope_new_chunk(data, len);
+  if (parts[0] == NULL) return -1;
+  parts[1] = yk__sdsnewlen(chunk + offset, chunk_len - offset);
+  if (parts[1] == NULL || yk__sdsrope_insert_chunks(r, i + 1, parts, 2) != 0) {
+    yk__sdsfree(parts[0]);
+    yk__sdsfree(parts[1]);
+    return -1;
+  }
+  yk__sdsIncrLen(chunk, -(ssize_t) (chunk_len - offset));
+  r->length += len;
+  return 0;
+}
+size_t yk__sdsrope_len(const yk__sdsrope *r) { return r->length; }
+size_t yk__sdsrope_chunk_count(const yk__sdsrope *r) { return r->count; }
+yk__sds yk__sdsrope_chunk(const yk__sdsrope *r, size_t i) {
+  return yk__sdsrope_at(r, i);
+}
+yk__sds yk__sdsrope_flatten(const yk__sdsrope *r) {
+  size_t i;
+  char *p;
+  yk__sds s = yk__sdsnewlen(YK__SDS_NOINIT, r->length);
+  if (s == NULL) return NULL;
+  p = s;
+  for (i = 0; i < r->count; i++) {
+    yk__sds chunk = yk__sdsrope_at(r, i);
+    memcpy(p, chunk, yk__sdslen(chunk));
+    p += yk__sdslen(chunk);
+  }
+  return s;
+}
+int yk__sdsrope_write(const yk__sdsrope *r, int fd) {
+#if defined(_WIN32)
+  size_t i;
+  for (i = 0; i < r->count; i++) {
+    const char *p = yk__sdsrope_at(r, i);
+    size_t left = yk__sdslen(yk__sdsrope_at(r, i));
+    while (left > 0) {
+      unsigned int n = left > 0x40000000 ? 0x40000000 : (unsigned int) left;
+      int written = _write(fd, p, n);
+      if (written <= 0) return -1;// 0 would never finish
+      p += written;
+      left -= (size_t) written;
+    }
+  }
+  return 0;
+#else
+  struct iovec iov[YK__SDSROPE_IOV_MAX];
+  size_t i = 0, skip = 0;// skip bytes of chunk i that are already written
+  while (i < r->count) {
+    int n = 0;
+    size_t j = i;
+    ssize_t written;
+    while (j < r->count && n < YK__SDSROPE_IOV_MAX) {
+      yk__sds chunk = yk__sdsrope_at(r, j);
+      size_t offset = (j == i) ? skip : 0;
+      if (yk__sdslen(chunk) > offset) {
+        iov[n].iov_base = chunk + offset;
+        iov[n].iov_len = yk__sdslen(chunk) - offset;
+        n++;
+      }
+      j++;
+    }
+    if (n == 0) break;
+    written = writev(fd, iov, n);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    // advance over fully and partially written chunks
+    while (i < r->count && written > 0) {
+      size_t left = yk__sdslen(yk__sdsrope_at(r, i)) - skip;
+      if ((size_t) written < left) {
+        skip += (size_t) written;
+        written = 0;
+      } else {
+        written -= (ssize_t) left;
+        skip = 0;
+        i++;
+      }
+    }
+    // skip empty chunks
+    while (i < r->count && yk__sdslen(yk__sdsrope_at(r, i)) == skip) {
+      skip = 0;
+      i++;
+    }
+  }
+  return 0;
+#endif
+}
+#endif
+#endif
+/* yk__stb_ds.h - v0.67 - public domain data structures - Sean Barrett 2019
+
+   This is a single-header-file library that provides easy-to-use
+   dynamic arrays and hash tables for C (also works in C++).
+
+   For a gentle introduction:
+      http://nothings.org/stb_ds
+
+   To use this library, do this in *one* C or C++ file:
+      #define YK__STB_DS_IMPLEMENTATION
+      #include "yk__stb_ds.h"
+
+TABLE OF CONTENTS
+
+  Table of Contents
+  Compile-time options
+  License
+  Documentation
+  Notes
+  Notes - Dynamic arrays
+  Notes - Hash maps
+  Credits
+
+COMPILE-TIME OPTIONS
+
+  #define YK__STBDS_NO_SHORT_NAMES
+
+     This flag needs to be set globally.
+
+     By default stb_ds exposes shorter function names that are not qualified
+     with the "stbds_" prefix. If these names conflict with the names in your
+     code, define this flag.
+
+  #define YK__STBDS_SIPHASH_2_4
+
+     This flag only needs to be set in the file containing #define YK__STB_DS_IMPLEMENTATION,
+     and in the files that use yk__stbds_hash_size_t / yk__stbds_hash_ptr as the
+     hashfn of a YK__DEFINE_HASHMAP, so those keys are SipHash-2-4 hashed too.
+
+     By default yk__stb_ds.h hashes using a weaker variant of SipHash and a custom hash for
+     4- and 8-byte keys. On 64-bit platforms, you can define the above flag to force
+     yk__stb_ds.h to use specification-compliant SipHash-2-4 for all keys. Doing so makes
+     hash table insertion about 20% slower on 4- and 8-byte keys, 5% slower on
+     64-byte keys, and 10% slower on 256-byte keys on my test computer.
+
+  #define YK__STBDS_INCREMENTAL_REHASH
+
+     This flag only needs to be set in the file containing #define YK__STB_DS_IMPLEMENTATION.
+
+     Makes every hashmap resize incrementally, as if yk__hm_set_incremental()
+     was called on it. YK__STBDS_MIGRATE_BUCKETS (default 64) sets how many
+     buckets of the old index each insert or delete moves.
+
+  #define YK__STBDS_SNAPSHOTS
+
+     This flag has to be set in every file that uses the snapshot functions
+     (yk__arrsave, yk__hmload, ...) and in the file containing #define
+     YK__STB_DS_IMPLEMENTATION.
+
+     Adds the snapshot functions. They map files into memory, so their
+     implementation includes <windows.h> or the POSIX <sys/mman.h> family,
+     which is why they are left out unless asked for.
+
+  #define YK__STBDS_STATISTICS
+
+     This flag only needs to be set in the file containing #define YK__STB_DS_IMPLEMENTATION.
+
+     Counts lookups, inserts, the buckets they probe, index rebuilds and the
+     time spent in them for every hashmap, see yk__hmstats. Without it only
+     the counts that yk__hmstats can work out from the index are filled in
+     and the hashmap operations do no extra work. Lookups with yk__hmget_ts
+     are not counted, so readers can share a hashmap. The yk__stbds_*
+     totals are shared by all hashmaps and not atomic, they are only exact
+     when a single thread uses hashmaps.
+
+  #define YK__STBDS_REALLOC(context,ptr,size) better_realloc
+  #define YK__STBDS_FREE(context,ptr)         better_free
+  #define YK__STBDS_CALLOC(context,size)      better_calloc
+
+     These defines only need to be set in the file containing #define YK__STB_DS_IMPLEMENTATION.
+
+     By default stb_ds uses stdlib realloc() and free() for memory management. You can
+     substitute your own functions instead by defining these symbols. You must either
+     define both, or neither. Note that at the moment, 'context' will always be NULL.
+     YK__STBDS_CALLOC is optional, it returns zeroed memory for the new index of
+     an incremental resize and defaults to calloc() with the stdlib functions,
+     or YK__STBDS_REALLOC followed by memset() with your own.
+     @TODO add an yk__array/hash initialization function that takes a memory context pointer.
+
+  #define YK__STBDS_UNIT_TESTS
+
+     Defines a function yk__stbds_unit_tests() that checks the functioning of the data structures.
+
+  Note that on older versions of gcc (e.g. 5.x.x) you may need to build with '-std=c++0x'
+     (or equivalentally '-std=c++11') when using anonymous structures as seen on the web
+     page or in YK__STBDS_UNIT_TESTS.
+
+LICENSE
+
+  Placed in the public domain and also MIT licensed.
+  See end of file for detailed license information.
+
+DOCUMENTATION
+
+  Dynamic Arrays
+
+    Non-function interface:
+
+      Declare an empty dynamic yk__array of type T
+        T* foo = NULL;
+
+      Access the i'th item of a dynamic yk__array 'foo' of type T, T* foo:
+        foo[i]
+
+    Functions (actually macros)
+
+      yk__arrfree:
+        void yk__arrfree(T*);
+          Frees the yk__array.
+
+      yk__arrlen:
+        ptrdiff_t yk__arrlen(T*);
+          Returns the number of elements in the yk__array.
+
+      yk__arrlenu:
+        size_t yk__arrlenu(T*);
+          Returns the number of elements in the yk__array as an unsigned type.
 
       yk__arrpop:
         T yk__arrpop(T* a)
@@ -1598,7 +2482,10 @@ DOCUMENTATION
 
       yk__stbds_hash_string:
         size_t yk__stbds_hash_string(char *str, size_t seed);
-          Returns a hash value for a string.
+          Returns a hash value for a string. The content is hashed with
+          wyhash (yk__sdshash) and the seed is mixed in afterwards, so
+          strings created with yk__sdsnewhashed() can cache the expensive
+          part of this in their header.
 
       yk__stbds_hash_bytes:
         size_t yk__stbds_hash_bytes(void *p, size_t len, size_t seed);
@@ -1608,6 +2495,16 @@ DOCUMENTATION
           specification-compliant SipHash-2-4 on all data by defining
           YK__STBDS_SIPHASH_2_4, at a significant cost in speed.
 
+      yk__stbds_hash_bytes_fast:
+        size_t yk__stbds_hash_bytes_fast(void *p, size_t len, size_t seed);
+          Hashes bytes with wyhash, much faster than the above for keys
+          longer than 8 bytes.
+
+      yk__stbds_hash_bytes_siphash:
+        size_t yk__stbds_hash_bytes_siphash(void *p, size_t len, size_t seed);
+          Hashes bytes with SipHash-2-4 keyed with the seed (a 32-bit
+          variant on 32-bit platforms), regardless of YK__STBDS_SIPHASH_2_4.
+
     Non-function interface:
 
       Declare an empty hash map of type T
@@ -1654,6 +2551,16 @@ DOCUMENTATION
           Returns the value corresponding to 'key' in the hashmap.
           The structure must have a 'value' field
 
+      yk__hmget_batch
+      yk__shget_batch
+        void yk__hmget_batch(T*, TK* keys, size_t n, ptrdiff_t* out)
+        void yk__shget_batch(T*, char** keys, size_t n, ptrdiff_t* out)
+          Looks up n keys and stores their indexes into out, -1 for keys that
+          are not present, so T[out[i]] is the entry or the default one like
+          with yk__hmgeti. Keys are hashed and their buckets and entries are
+          prefetched YK__STBDS_BATCH_SIZE (16) at a time before they are
+          compared, which hides most cache misses on big hashmaps.
+
       yk__hmgets
       yk__shgets
         T yk__hmgets(T*, TK key)
@@ -1703,6 +2610,22 @@ DOCUMENTATION
           Inserts a struct with T.key into the hashmap. If the struct is already
           present in the hashmap, updates it.
 
+      yk__hmreserve
+      yk__shreserve
+        void yk__hmreserve(T*, size_t n)
+        void yk__shreserve(T*, size_t n)
+          Allocates the hashmap if it is NULL and makes room for n entries in
+          total, so inserting up to n keys neither reallocates the entries
+          nor rebuilds the hash index.
+
+      yk__hmputs_array
+      yk__shputs_array
+        void yk__hmputs_array(T*, T* items, size_t n)
+        void yk__shputs_array(T*, T* items, size_t n)
+          Inserts n structs like yk__hmputs/yk__shputs, after reserving room
+          for all of them at once. Later items replace earlier ones with the
+          same key.
+
       yk__hmdel
       yk__shdel
         int yk__hmdel(T*, TK key)
@@ -1725,7 +2648,185 @@ DOCUMENTATION
           key to a string arena. Every string key ever used by this
           hash table remains in the arena until the arena is freed.
           Additionally, any key which is deleted and reinserted will
-          be allocated multiple times in the string arena.
+          be allocated multiple times in the string arena. Keys are
+          copied with their yk__sds header (see yk__sdsdupat), packed
+          into blocks that double in size, so they keep any embedded
+          zero bytes and a cached yk__sdsnewhashed hash, and freeing the
+          hashmap frees only a few blocks.
+
+      yk__sh_new_intern
+        void yk__sh_new_intern(T*);
+          Overwrites the existing pointer with a newly allocated
+          string hashmap whose keys must be interned strings (see
+          yk__intern below). Keys are never copied, they are hashed
+          and compared by pointer only.
+
+      yk__hm_set_hash
+      yk__sh_set_hash
+        void yk__hm_set_hash(T*, int func);
+        void yk__sh_set_hash(T*, int func);
+          Selects the hash function of an empty hashmap, allocating it
+          if it is NULL. For string hashmaps call it after yk__sh_new_*.
+            YK__STBDS_HASH_FUNC_DEFAULT  yk__stbds_hash_bytes and
+                                         yk__stbds_hash_string
+            YK__STBDS_HASH_FUNC_FAST     wyhash for keys of any size,
+                                         same as default for strings
+            YK__STBDS_HASH_FUNC_SIPHASH  SipHash-2-4 keyed with the table
+                                         seed for binary and string keys,
+                                         cached string hashes are not used
+
+      yk__hmstats
+      yk__shstats
+        void yk__hmstats(T*, yk__stbds_hmstats_t* stats);
+        void yk__shstats(T*, yk__stbds_hmstats_t* stats);
+          Fills in the entry count, load factor, tombstones and a histogram
+          of how many buckets a lookup of each stored key has to visit,
+          found by walking the hash index. Lookup / insert probe counts and
+          rebuild counts and time are only kept with YK__STBDS_STATISTICS,
+          they are 0 otherwise.
+
+      YK__DEFINE_HASHMAP
+        YK__DEFINE_HASHMAP(name, TK, TV, hashfn, eqfn)
+          Defines the struct name_entry { TK key; TV value; } and static
+          inline functions for hashmaps of it that call
+            size_t hashfn(TK key, size_t seed) and int eqfn(TK a, TK b)
+          directly instead of hashing and comparing bytes, so both can be
+          inlined. yk__stbds_hash_size_t / yk__stbds_hash_ptr and
+          yk__stbds_equal work for integer and pointer keys.
+            ptrdiff_t name_geti(name_entry* t, TK key)
+            TV name_get(name_entry* t, TK key)
+            name_entry* name_getp_null(name_entry* t, TK key)
+            void name_put(name_entry** t, TK key, TV value)
+            int name_del(name_entry** t, TK key)
+          These behave like yk__hmgeti, yk__hmget, yk__hmgetp_null, yk__hmput
+          and yk__hmdel. The result is an ordinary hashmap using the same
+          index, so yk__hmlen, yk__hmfree, yk__hmdefault, yk__hmreserve,
+          yk__hm_set_incremental, iteration and snapshots work on it, but
+          the other yk__hm* functions hash keys differently and must not
+          be used to look up, put or delete.
+
+      YK__DEFINE_HASHMAP_SOA
+        YK__DEFINE_HASHMAP_SOA(name, TK, TV, hashfn, eqfn)
+          Same as above with keys and values in two parallel arrays, so
+          probing only touches keys and loops over values read nothing
+          else. Defines the struct name { name_key* keys; TV* values; },
+          where keys is a hashmap of name_key { TK key; } and values[i] is
+          the value of keys[i].key, and
+            ptrdiff_t name_geti(name* m, TK key)
+            TV name_get(name* m, TK key)     0 if the key is not present
+            TV* name_getp_null(name* m, TK key)
+            void name_put(name* m, TK key, TV value)
+            int name_del(name* m, TK key)
+            ptrdiff_t name_len(name* m)
+            void name_free(name* m)
+          Initialize the struct with {0}.
+
+      yk__hm_set_incremental
+      yk__sh_set_incremental
+        void yk__hm_set_incremental(T*, int on);
+        void yk__sh_set_incremental(T*, int on);
+          Allocates the hashmap if it is NULL. When on, growing, shrinking
+          and rebuilding the hash index keeps the old index alive and each
+          following insert or delete moves a few of its buckets to the new
+          one, instead of rehashing every entry at once. Lookups check both
+          indexes until the move is done. Turning it off finishes a pending
+          move.
+
+  Hash sets
+
+    A set of TK is declared as TK* foo = NULL and holds only the keys, in
+    foo[0] to foo[yk__setlen(foo)-1], with the hashmap index. The set
+    functions compare keys like the yk__hm* ones, yk__sset* are the same
+    for yk__sds keys and yk__sh_new_strdup / arena / intern work on them.
+
+      yk__setput
+      yk__ssetput
+        void yk__setput(TK*, TK key)
+          Adds 'key' if it is not in the set yet.
+
+      yk__sethas
+      yk__setgeti
+      yk__ssethas
+      yk__ssetgeti
+        int yk__sethas(TK*, TK key)
+        ptrdiff_t yk__setgeti(TK*, TK key)
+          Returns 1 / the index of 'key' if it is in the set, 0 / -1 if not.
+
+      yk__setdel
+      yk__ssetdel
+        int yk__setdel(TK*, TK key)
+          Removes 'key', returns 1 if it was in the set.
+
+      yk__setunion
+      yk__setintersect
+      yk__ssetunion
+      yk__ssetintersect
+        void yk__setunion(TK* a, TK* b)
+        void yk__setintersect(TK* a, TK* b)
+          Adds every key of b to a / removes the keys of a that are not in
+          b, walking the dense key array of the set that is changed or read.
+
+      yk__setreserve
+      yk__setlen
+      yk__setfree
+        Same as yk__hmreserve, yk__hmlen and yk__hmfree.
+
+  String interning
+
+      yk__intern
+        yk__sds yk__intern(yk__stbds_intern_pool* pool, const char* str, size_t len);
+          Returns the canonical yk__sds string holding these bytes,
+          creating it if needed. Initialize the pool with {0}.
+          Canonical strings are owned by the pool and must not be
+          modified or freed, two of them are equal only if they are
+          the same pointer. Returns NULL if the copy could not be
+          allocated, the pool is unchanged then.
+
+      yk__intern_sds
+        yk__sds yk__intern_sds(yk__stbds_intern_pool* pool, yk__sds s);
+          Same as above for an existing yk__sds string (s is not taken).
+
+      yk__intern_find
+        yk__sds yk__intern_find(yk__stbds_intern_pool* pool, yk__sds s);
+          Returns the canonical string or NULL if it was never interned.
+
+      yk__intern_free
+        void yk__intern_free(yk__stbds_intern_pool* pool);
+          Frees the pool and every canonical string in it.
+
+  Snapshots (#define YK__STBDS_SNAPSHOTS)
+
+      yk__arrsave
+      yk__hmsave
+      yk__shsave
+        int yk__arrsave(T* a, const char* path);
+        int yk__hmsave(T*, const char* path);
+        int yk__shsave(T*, const char* path);
+          Writes the entries, the hash index and the string keys to a
+          single file, returns 0 or -1 if the file could not be written.
+          Arrays and hashmap values must not hold pointers, they are
+          saved as they are. Interned string hashmaps can not be saved.
+
+      yk__arrload
+      yk__hmload
+      yk__shload
+        T* yk__arrload(T* a, const char* path);
+        T* yk__hmload(T*, const char* path);
+        T* yk__shload(T*, const char* path);
+          Maps a saved file copy-on-write and overwrites the pointer with
+          it, or with NULL if the file can not be used (it was saved from
+          another element type or by a build with another hash layout).
+          Nothing is rehashed or copied, only the pointers inside are
+          relocated (one pass over the entries for string keys), so loading
+          is about as fast as the page faults on first use. The result is
+          read-only: look up, iterate and yk__hmget it, but do not put,
+          delete or free it, release it with yk__*unload.
+
+      yk__arrunload
+      yk__hmunload
+      yk__shunload
+        void yk__hmunload(T*);
+          Unmaps a loaded snapshot and sets the pointer to NULL.
 
 NOTES
 
@@ -1795,7 +2896,8 @@ NOTES - HASH MAP
     this can just replace current arena implementation.
 
   * If adversarial input is a serious concern and you're on a 64-bit platform,
-    enable YK__STBDS_SIPHASH_2_4 (see the 'Compile-time options' section), and pass
+    enable YK__STBDS_SIPHASH_2_4 (see the 'Compile-time options' section), or
+    select YK__STBDS_HASH_FUNC_SIPHASH for the exposed hashmaps only, and pass
     a strong random number to yk__stbds_rand_seed.
 
   * The default value for the hash table is stored in foo[-1], so if you
@@ -1866,6 +2968,12 @@ CREDITS
 #define yk__shput yk__stbds_shput
 #define yk__shputi yk__stbds_shputi
 #define yk__shputs yk__stbds_shputs
+#define yk__hmget_batch yk__stbds_hmget_batch
+#define yk__shget_batch yk__stbds_shget_batch
+#define yk__hmreserve yk__stbds_hmreserve
+#define yk__shreserve yk__stbds_shreserve
+#define yk__hmputs_array yk__stbds_hmputs_array
+#define yk__shputs_array yk__stbds_shputs_array
 #define yk__shget yk__stbds_shget
 #define yk__shgeti yk__stbds_shgeti
 #define yk__shgets yk__stbds_shgets
@@ -1879,6 +2987,47 @@ CREDITS
 #define yk__shdefaults yk__stbds_shdefaults
 #define yk__sh_new_arena yk__stbds_sh_new_arena
 #define yk__sh_new_strdup yk__stbds_sh_new_strdup
+#define yk__sh_new_intern yk__stbds_sh_new_intern
+#define yk__hm_set_hash yk__stbds_hm_set_hash
+#define yk__sh_set_hash yk__stbds_sh_set_hash
+#define yk__hm_set_incremental yk__stbds_hm_set_incremental
+#define yk__hmstats yk__stbds_hmstats
+#define yk__shstats yk__stbds_shstats
+#define yk__sh_set_incremental yk__stbds_sh_set_incremental
+#define YK__DEFINE_HASHMAP YK__STBDS_DEFINE_HASHMAP
+#define YK__DEFINE_HASHMAP_SOA YK__STBDS_DEFINE_HASHMAP_SOA
+#define yk__setput yk__stbds_setput
+#define yk__sethas yk__stbds_sethas
+#define yk__setgeti yk__stbds_setgeti
+#define yk__setdel yk__stbds_setdel
+#define yk__setunion yk__stbds_setunion
+#define yk__setintersect yk__stbds_setintersect
+#define yk__setreserve yk__stbds_setreserve
+#define yk__setlen yk__stbds_setlen
+#define yk__setfree yk__stbds_setfree
+#define yk__ssetput yk__stbds_ssetput
+#define yk__ssethas yk__stbds_ssethas
+#define yk__ssetgeti yk__stbds_ssetgeti
+#define yk__ssetdel yk__stbds_ssetdel
+#define yk__ssetunion yk__stbds_ssetunion
+#define yk__ssetintersect yk__stbds_ssetintersect
+#define yk__ssetreserve yk__stbds_ssetreserve
+#define yk__ssetlen yk__stbds_setlen
+#define yk__ssetfree yk__stbds_setfree
+#define yk__intern yk__stbds_intern
+#define yk__intern_sds yk__stbds_intern_sds
+#define yk__intern_find yk__stbds_intern_find
+#define yk__intern_count yk__stbds_intern_count
+#define yk__intern_free yk__stbds_intern_free
+#define yk__arrsave yk__stbds_arrsave
+#define yk__hmsave yk__stbds_hmsave
+#define yk__shsave yk__stbds_shsave
+#define yk__arrload yk__stbds_arrload
+#define yk__hmload yk__stbds_hmload
+#define yk__shload yk__stbds_shload
+#define yk__arrunload yk__stbds_arrunload
+#define yk__hmunload yk__stbds_hmunload
+#define yk__shunload yk__stbds_shunload
 #define stralloc yk__stbds_stralloc
 #define strreset yk__stbds_strreset
 #endif
@@ -1890,6 +3039,7 @@ CREDITS
 #include <stdlib.h>
 #define YK__STBDS_REALLOC(c, p, s) realloc(p, s)
 #define YK__STBDS_FREE(c, p) free(p)
+#define YK__STBDS_CALLOC(c, s) calloc(1, s)
 #endif
 #ifdef _MSC_VER
 #define YK__STBDS_NOTUSED(v) (void) (v)
@@ -1904,10 +3054,40 @@ extern void yk__stbds_rand_seed(size_t seed);
 // these are the hash functions used internally if you want to test them or use them for other purposes
 extern size_t yk__stbds_hash_bytes(void *p, size_t len, size_t seed);
 extern size_t yk__stbds_hash_string(yk__sds str, size_t seed);
+extern size_t yk__stbds_hash_bytes_fast(void *p, size_t len, size_t seed);
+extern size_t yk__stbds_hash_bytes_siphash(void *p, size_t len, size_t seed);
+// hash functions that can be selected per hashmap with yk__hm_set_hash
+enum {
+  YK__STBDS_HASH_FUNC_DEFAULT,
+  YK__STBDS_HASH_FUNC_FAST,
+  YK__STBDS_HASH_FUNC_SIPHASH
+};
 // this is a simple string arena allocator, initialize with e.g. 'yk__stbds_string_arena my_arena={0}'.
 typedef struct yk__stbds_string_arena yk__stbds_string_arena;
-extern char *yk__stbds_stralloc(yk__stbds_string_arena *a, char *str);
+extern yk__sds yk__stbds_stralloc(yk__stbds_string_arena *a, yk__sds str);
 extern void yk__stbds_strreset(yk__stbds_string_arena *a);
+// string interning pool, initialize with e.g. 'yk__stbds_intern_pool my_pool={0}'.
+typedef struct yk__stbds_intern_pool {
+  yk__sds *map;// string hashmap, each entry is only the canonical key
+} yk__stbds_intern_pool;
+extern yk__sds yk__stbds_intern(yk__stbds_intern_pool *pool, const char *str,
+                                size_t len);
+extern yk__sds yk__stbds_intern_sds(yk__stbds_intern_pool *pool, yk__sds s);
+extern yk__sds yk__stbds_intern_find(yk__stbds_intern_pool *pool, yk__sds s);
+extern size_t yk__stbds_intern_count(yk__stbds_intern_pool *pool);
+extern void yk__stbds_intern_free(yk__stbds_intern_pool *pool);
+#ifdef YK__STBDS_SNAPSHOTS
+// snapshots, 'kind' is one of YK__STBDS_SNAPSHOT_*
+enum {
+  YK__STBDS_SNAPSHOT_ARRAY,
+  YK__STBDS_SNAPSHOT_HASHMAP,
+  YK__STBDS_SNAPSHOT_STRING_HASHMAP
+};
+extern int yk__stbds_save_func(void *a, size_t elemsize, const char *path,
+                               int kind);
+extern void *yk__stbds_load_func(const char *path, size_t elemsize, int kind);
+extern void yk__stbds_unload_func(void *a);
+#endif
 // have to #define YK__STBDS_UNIT_TESTS to call this
 extern void yk__stbds_unit_tests(void);
 ///////////////
@@ -1928,6 +3108,49 @@ extern void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key,
 extern void *yk__stbds_hmdel_key(void *a, size_t elemsize, void *key,
                                  size_t keysize, size_t keyoffset, int mode);
 extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
+extern void *yk__stbds_hmhash_func(void *a, size_t elemsize, int func,
+                                   int mode);
+extern void *yk__stbds_hmincremental_func(void *a, size_t elemsize, int on,
+                                          int mode);
+extern void *yk__stbds_hmreserve_func(void *a, size_t elemsize, size_t n,
+                                      int mode);
+extern void *yk__stbds_hmput_hash(void *a, size_t elemsize, size_t hash);
+extern void *yk__stbds_hmdel_hash(void *a, size_t elemsize, size_t hash,
+                                  ptrdiff_t index, size_t last_hash);
+#define YK__STBDS_PROBE_HISTOGRAM 16
+typedef struct {
+  size_t count;     // entries
+  size_t slot_count;// slots of the hash index
+  size_t tombstones;// deleted slots that are not reused yet
+  double load_factor;
+  // buckets visited to find each stored key, probe_histogram[i] counts keys
+  // found in i + 1 buckets, the last one counts longer probes too
+  double avg_probe;
+  size_t max_probe;
+  size_t probe_histogram[YK__STBDS_PROBE_HISTOGRAM];
+  // only counted with YK__STBDS_STATISTICS
+  size_t lookups;      // hmget / hmdel searches, not the _ts ones
+  size_t lookup_probes;// buckets visited by them
+  size_t inserts;      // new keys
+  size_t insert_probes;// buckets visited by them
+  size_t grows;
+  size_t shrinks;
+  size_t rebuilds;        // to clean up tombstones
+  double rebuild_seconds; // time spent making the new indexes
+} yk__stbds_hmstats_t;
+extern void yk__stbds_hmstats_func(void *a, size_t elemsize,
+                                   yk__stbds_hmstats_t *stats);
+extern void *yk__stbds_hmget_batch_func(void *a, size_t elemsize,
+                                        const void *keys, size_t n,
+                                        ptrdiff_t *out, size_t keysize,
+                                        int mode);
+extern void *yk__stbds_hmputs_array_func(void *a, size_t elemsize,
+                                         const void *items, size_t n,
+                                         size_t keysize, int mode);
+extern void *yk__stbds_setunion_func(void *a, void *b, size_t elemsize,
+                                     int mode);
+extern void *yk__stbds_setintersect_func(void *a, void *b, size_t elemsize,
+                                         int mode);
 #ifdef __cplusplus
 }
 #endif
@@ -2018,6 +3241,12 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
   ((t) = yk__stbds_hmput_key_wrapper((t), sizeof *(t), &(s).key,               \
                                      sizeof(s).key, YK__STBDS_HM_BINARY),      \
    (t)[yk__stbds_temp((t) -1)] = (s))
+#define yk__stbds_hmreserve(t, n)                                              \
+  ((t) = yk__stbds_hmreserve_func_wrapper((t), sizeof *(t), (n),               \
+                                          YK__STBDS_HM_BINARY))
+#define yk__stbds_hmputs_array(t, s, n)                                        \
+  ((t) = yk__stbds_hmputs_array_func_wrapper(                                  \
+       (t), sizeof *(t), (s), (n), sizeof(t)->key, YK__STBDS_HM_BINARY))
 #define yk__stbds_hmgeti(t, k)                                                 \
   ((t) = yk__stbds_hmget_key_wrapper(                                          \
        (t), sizeof *(t), (void *) YK__STBDS_ADDRESSOF((t)->key, (k)),          \
@@ -2028,6 +3257,10 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
        (t), sizeof *(t), (void *) YK__STBDS_ADDRESSOF((t)->key, (k)),          \
        sizeof(t)->key, &(temp), YK__STBDS_HM_BINARY),                          \
    (temp))
+#define yk__stbds_hmget_batch(t, k, n, out)                                    \
+  ((t) = yk__stbds_hmget_batch_func_wrapper((t), sizeof *(t), (k), (n), (out), \
+                                            sizeof(t)->key,                    \
+                                            YK__STBDS_HM_BINARY))
 #define yk__stbds_hmgetp(t, k)                                                 \
   ((void) yk__stbds_hmgeti(t, k), &(t)[yk__stbds_temp((t) -1)])
 #define yk__stbds_hmgetp_ts(t, k, temp)                                        \
@@ -2066,6 +3299,12 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
    (t)[yk__stbds_temp((t) -1)] = (s),                                          \
    (t)[yk__stbds_temp((t) -1)].key = yk__stbds_temp_key((                      \
        t) -1))// above line overwrites whole structure, so must rewrite key here if it was allocated internally
+#define yk__stbds_shreserve(t, n)                                              \
+  ((t) = yk__stbds_hmreserve_func_wrapper((t), sizeof *(t), (n),               \
+                                          YK__STBDS_HM_STRING))
+#define yk__stbds_shputs_array(t, s, n)                                        \
+  ((t) = yk__stbds_hmputs_array_func_wrapper(                                  \
+       (t), sizeof *(t), (s), (n), sizeof(t)->key, YK__STBDS_HM_STRING))
 #define yk__stbds_pshput(t, p)                                                 \
   ((t) = yk__stbds_hmput_key_wrapper((t), sizeof *(t), (void *) (p)->key,      \
                                      sizeof(p)->key,                           \
@@ -2080,6 +3319,10 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
                                      sizeof(*(t))->key,                        \
                                      YK__STBDS_HM_PTR_TO_STRING),              \
    yk__stbds_temp((t) -1))
+#define yk__stbds_shget_batch(t, k, n, out)                                    \
+  ((t) = yk__stbds_hmget_batch_func_wrapper((t), sizeof *(t), (k), (n), (out), \
+                                            sizeof(t)->key,                    \
+                                            YK__STBDS_HM_STRING))
 #define yk__stbds_shgetp(t, k)                                                 \
   ((void) yk__stbds_shgeti(t, k), &(t)[yk__stbds_temp((t) -1)])
 #define yk__stbds_pshget(t, k)                                                 \
@@ -2098,6 +3341,49 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
   ((t) = yk__stbds_shmode_func_wrapper(t, sizeof *(t), YK__STBDS_SH_ARENA))
 #define yk__stbds_sh_new_strdup(t)                                             \
   ((t) = yk__stbds_shmode_func_wrapper(t, sizeof *(t), YK__STBDS_SH_STRDUP))
+#define yk__stbds_sh_new_intern(t)                                             \
+  ((t) = yk__stbds_shmode_func_wrapper(t, sizeof *(t), YK__STBDS_SH_INTERN))
+#define yk__stbds_hm_set_hash(t, f)                                            \
+  ((t) = yk__stbds_hmhash_func_wrapper((t), sizeof *(t), (f),                  \
+                                       YK__STBDS_SH_NONE))
+#define yk__stbds_sh_set_hash(t, f)                                            \
+  ((t) = yk__stbds_hmhash_func_wrapper((t), sizeof *(t), (f),                  \
+                                       YK__STBDS_SH_DEFAULT))
+#define yk__stbds_hmstats(t, s)                                                \
+  yk__stbds_hmstats_func((t) ? (t) -1 : NULL, sizeof *(t), (s))
+#define yk__stbds_shstats yk__stbds_hmstats
+#define yk__stbds_hm_set_incremental(t, on)                                    \
+  ((t) = yk__stbds_hmincremental_func_wrapper((t), sizeof *(t), (on),          \
+                                              YK__STBDS_SH_NONE))
+#define yk__stbds_sh_set_incremental(t, on)                                    \
+  ((t) = yk__stbds_hmincremental_func_wrapper((t), sizeof *(t), (on),          \
+                                              YK__STBDS_SH_DEFAULT))
+#define yk__stbds_arrsave(a, path)                                             \
+  ((a) ? yk__stbds_save_func((a), sizeof *(a), (path),                         \
+                             YK__STBDS_SNAPSHOT_ARRAY)                         \
+       : -1)
+#define yk__stbds_hmsave(t, path)                                              \
+  ((t) ? yk__stbds_save_func((t) -1, sizeof *(t), (path),                      \
+                             YK__STBDS_SNAPSHOT_HASHMAP)                       \
+       : -1)
+#define yk__stbds_shsave(t, path)                                              \
+  ((t) ? yk__stbds_save_func((t) -1, sizeof *(t), (path),                      \
+                             YK__STBDS_SNAPSHOT_STRING_HASHMAP)                \
+       : -1)
+#define yk__stbds_arrload(a, path)                                             \
+  ((a) = yk__stbds_load_func_wrapper((a), (path), sizeof *(a),                 \
+                                     YK__STBDS_SNAPSHOT_ARRAY))
+#define yk__stbds_hmload(t, path)                                              \
+  ((t) = yk__stbds_load_func_wrapper((t), (path), sizeof *(t),                 \
+                                     YK__STBDS_SNAPSHOT_HASHMAP))
+#define yk__stbds_shload(t, path)                                              \
+  ((t) = yk__stbds_load_func_wrapper((t), (path), sizeof *(t),                 \
+                                     YK__STBDS_SNAPSHOT_STRING_HASHMAP))
+#define yk__stbds_arrunload(a)                                                 \
+  ((void) ((a) ? yk__stbds_unload_func(a), 0 : 0), (a) = NULL)
+#define yk__stbds_hmunload(t)                                                  \
+  ((void) ((t) ? yk__stbds_unload_func((t) -1), 0 : 0), (t) = NULL)
+#define yk__stbds_shunload yk__stbds_hmunload
 #define yk__stbds_shdefault(t, v) yk__stbds_hmdefault(t, v)
 #define yk__stbds_shdefaults(t, s) yk__stbds_hmdefaults(t, s)
 #define yk__stbds_shfree yk__stbds_hmfree
@@ -2107,6 +3393,53 @@ extern void *yk__stbds_shmode_func(size_t elemsize, int mode);
 #define yk__stbds_shgetp_null(t, k)                                            \
   (yk__stbds_shgeti(t, k) == -1 ? NULL : &(t)[yk__stbds_temp((t) -1)])
 #define yk__stbds_shlen yk__stbds_hmlen
+#define yk__stbds_setput(s, k)                                                 \
+  ((s) = yk__stbds_hmput_key_wrapper(                                          \
+       (s), sizeof *(s), (void *) YK__STBDS_ADDRESSOF(*(s), (k)), sizeof *(s), \
+       YK__STBDS_HM_BINARY))
+#define yk__stbds_setgeti(s, k)                                                \
+  ((s) = yk__stbds_hmget_key_wrapper(                                          \
+       (s), sizeof *(s), (void *) YK__STBDS_ADDRESSOF(*(s), (k)), sizeof *(s), \
+       YK__STBDS_HM_BINARY),                                                   \
+   yk__stbds_temp((s) -1))
+#define yk__stbds_sethas(s, k) (yk__stbds_setgeti(s, k) >= 0)
+#define yk__stbds_setdel(s, k)                                                 \
+  (((s) = yk__stbds_hmdel_key_wrapper(                                         \
+        (s), sizeof *(s), (void *) YK__STBDS_ADDRESSOF(*(s), (k)),             \
+        sizeof *(s), 0, YK__STBDS_HM_BINARY)),                                 \
+   (s) ? yk__stbds_temp((s) -1) : 0)
+#define yk__stbds_setunion(s, o)                                               \
+  ((s) = yk__stbds_setunion_func_wrapper((s), (o), sizeof *(s),                \
+                                         YK__STBDS_HM_BINARY))
+#define yk__stbds_setintersect(s, o)                                           \
+  ((s) = yk__stbds_setintersect_func_wrapper((s), (o), sizeof *(s),            \
+                                             YK__STBDS_HM_BINARY))
+#define yk__stbds_setreserve(s, n)                                             \
+  ((s) = yk__stbds_hmreserve_func_wrapper((s), sizeof *(s), (n),               \
+                                          YK__STBDS_HM_BINARY))
+#define yk__stbds_setlen yk__stbds_hmlen
+#define yk__stbds_setfree yk__stbds_hmfree
+#define yk__stbds_ssetput(s, k)                                                \
+  ((s) = yk__stbds_hmput_key_wrapper((s), sizeof *(s), (void *) (k),           \
+                                     sizeof *(s), YK__STBDS_HM_STRING))
+#define yk__stbds_ssetgeti(s, k)                                               \
+  ((s) = yk__stbds_hmget_key_wrapper((s), sizeof *(s), (void *) (k),           \
+                                     sizeof *(s), YK__STBDS_HM_STRING),        \
+   yk__stbds_temp((s) -1))
+#define yk__stbds_ssethas(s, k) (yk__stbds_ssetgeti(s, k) >= 0)
+#define yk__stbds_ssetdel(s, k)                                                \
+  (((s) = yk__stbds_hmdel_key_wrapper((s), sizeof *(s), (void *) (k),          \
+                                      sizeof *(s), 0, YK__STBDS_HM_STRING)),   \
+   (s) ? yk__stbds_temp((s) -1) : 0)
+#define yk__stbds_ssetunion(s, o)                                              \
+  ((s) = yk__stbds_setunion_func_wrapper((s), (o), sizeof *(s),                \
+                                         YK__STBDS_HM_STRING))
+#define yk__stbds_ssetintersect(s, o)                                          \
+  ((s) = yk__stbds_setintersect_func_wrapper((s), (o), sizeof *(s),            \
+                                             YK__STBDS_HM_STRING))
+#define yk__stbds_ssetreserve(s, n)                                            \
+  ((s) = yk__stbds_hmreserve_func_wrapper((s), sizeof *(s), (n),               \
+                                          YK__STBDS_HM_STRING))
 typedef struct {
   size_t length;
   size_t capacity;
@@ -2129,25 +3462,239 @@ enum {
   YK__STBDS_SH_NONE,
   YK__STBDS_SH_DEFAULT,
   YK__STBDS_SH_STRDUP,
-  YK__STBDS_SH_ARENA
+  YK__STBDS_SH_ARENA,
+  YK__STBDS_SH_INTERN
 };
-#ifdef __cplusplus
-// in C we use implicit assignment from these void*-returning functions to T*.
-// in C++ these templates make the same code work
-template<class T>
-static T *yk__stbds_arrgrowf_wrapper(T *a, size_t elemsize, size_t addlen,
-                                     size_t min_cap) {
-  return (T *) yk__stbds_arrgrowf((void *) a, elemsize, addlen, min_cap);
-}
-template<class T>
-static T *yk__stbds_hmget_key_wrapper(T *a, size_t elemsize, void *key,
-                                      size_t keysize, int mode) {
-  return (T *) yk__stbds_hmget_key((void *) a, elemsize, key, keysize, mode);
-}
-template<class T>
-static T *yk__stbds_hmget_key_ts_wrapper(T *a, size_t elemsize, void *key,
-                                         size_t keysize, ptrdiff_t *temp,
-                                         int mode) {
+#ifdef YK__STBDS_INTERNAL_SMALL_BUCKET
+#define YK__STBDS_BUCKET_LENGTH 4
+#else
+#define YK__STBDS_BUCKET_LENGTH 8
+#endif
+#define YK__STBDS_BUCKET_SHIFT (YK__STBDS_BUCKET_LENGTH == 8 ? 3 : 2)
+#define YK__STBDS_BUCKET_MASK (YK__STBDS_BUCKET_LENGTH - 1)
+typedef struct {
+  size_t hash[YK__STBDS_BUCKET_LENGTH];
+  ptrdiff_t index[YK__STBDS_BUCKET_LENGTH];
+} yk__stbds_hash_bucket;// in 32-bit, this is one 64-byte cache line; in 64-bit, each yk__array is one 64-byte cache line
+typedef struct yk__stbds_hash_index {
+  char *temp_key;// this MUST be the first field of the hash table
+  size_t slot_count;
+  size_t used_count;
+  size_t used_count_threshold;
+  size_t used_count_shrink_threshold;
+  size_t tombstone_count;
+  size_t tombstone_count_threshold;
+  size_t seed;
+  size_t slot_count_log2;
+  int hash_func;  // one of YK__STBDS_HASH_FUNC_*
+  int incremental;// resize by moving a few buckets per insert / delete
+  struct yk__stbds_hash_index *old;// index being moved to this one, if any
+  size_t migrate_pos;              // next bucket of 'old' to move
+  yk__stbds_string_arena string;
+  yk__stbds_hash_bucket *
+      storage;// not a separate allocation, just 64-byte aligned storage after this struct
+#ifdef YK__STBDS_STATISTICS
+  // last, YK__STBDS_STATISTICS is only defined in the implementation file
+  yk__stbds_hmstats_t stats;// only the counted fields are kept here
+#endif
+} yk__stbds_hash_index;
+#define YK__STBDS_INDEX_EMPTY -1
+#define YK__STBDS_INDEX_DELETED -2
+#define YK__STBDS_HASH_EMPTY 0
+#define YK__STBDS_HASH_DELETED 1
+// empty slots of an index from calloc have index 0, only the hash tells if a
+// slot is in use
+#define YK__STBDS_SLOT_IN_USE(b, j) ((b)->hash[j] > YK__STBDS_HASH_DELETED)
+#ifdef YK__STBDS_INTERNAL_BUCKET_START
+#define YK__STBDS_PROBE_START(hash, slot_count)                                \
+  ((hash) & ((slot_count) -1) & ~(size_t) YK__STBDS_BUCKET_MASK)
+#else
+#define YK__STBDS_PROBE_START(hash, slot_count) ((hash) & ((slot_count) -1))
+#endif
+// hashmaps specialized for one key and value type, see YK__DEFINE_HASHMAP
+#define YK__STBDS_TYPED_TABLE(t)                                               \
+  ((yk__stbds_hash_index *) yk__stbds_header((t) -1)->hash_table)
+// lookup, insert and delete of the keys of a hashmap of E, a struct with a
+// 'key' field, for the generated hashmaps below. name_insert returns the index
+// of 'key', adding an entry with only the key set if it is new
+#define YK__STBDS_DEFINE_HASHMAP_INDEX(name, E, K, hashfn, eqfn)               \
+  static inline size_t name##_hash(yk__stbds_hash_index *table, K key) {       \
+    size_t hash = hashfn(key, table->seed);                                    \
+    return hash < 2 ? hash + 2 : hash;                                         \
+  }                                                                            \
+  static inline ptrdiff_t name##_find(E *t, yk__stbds_hash_index *table,       \
+                                      size_t hash, K key) {                    \
+    size_t pos = YK__STBDS_PROBE_START(hash, table->slot_count);               \
+    size_t step = YK__STBDS_BUCKET_LENGTH, k;                                  \
+    for (;;) {                                                                 \
+      yk__stbds_hash_bucket *b =                                               \
+          &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];                      \
+      for (k = 0; k < YK__STBDS_BUCKET_LENGTH; ++k) {                          \
+        size_t z = (pos + k) & YK__STBDS_BUCKET_MASK;                          \
+        if (b->hash[z] == hash && eqfn(t[b->index[z]].key, key))               \
+          return b->index[z];                                                  \
+        if (b->hash[z] == YK__STBDS_HASH_EMPTY) return -1;                     \
+      }                                                                        \
+      pos = (pos + step) & (table->slot_count - 1);                            \
+      step += YK__STBDS_BUCKET_LENGTH;                                         \
+    }                                                                          \
+  }                                                                            \
+  static inline ptrdiff_t name##_geti(E *t, K key) {                           \
+    yk__stbds_hash_index *table;                                               \
+    size_t hash;                                                               \
+    ptrdiff_t i;                                                               \
+    if (t == NULL || (table = YK__STBDS_TYPED_TABLE(t)) == NULL) return -1;    \
+    hash = name##_hash(table, key);                                            \
+    i = name##_find(t, table, hash, key);                                      \
+    if (i < 0 && table->old) i = name##_find(t, table->old, hash, key);        \
+    return i;                                                                  \
+  }                                                                            \
+  static inline ptrdiff_t name##_insert(E **t, K key, int *added) {            \
+    yk__stbds_hash_index *table;                                               \
+    size_t hash;                                                               \
+    ptrdiff_t i;                                                               \
+    if (*t == NULL || YK__STBDS_TYPED_TABLE(*t) == NULL)                       \
+      *t = (E *) yk__stbds_hmreserve_func(*t, sizeof(E), 0,                    \
+                                          YK__STBDS_HM_BINARY);                \
+    table = YK__STBDS_TYPED_TABLE(*t);                                         \
+    hash = name##_hash(table, key);                                            \
+    i = name##_find(*t, table, hash, key);                                     \
+    if (i < 0 && table->old) i = name##_find(*t, table->old, hash, key);       \
+    *added = i < 0;                                                            \
+    if (i < 0) {                                                               \
+      *t = (E *) yk__stbds_hmput_hash(*t, sizeof(E), hash);                    \
+      i = yk__stbds_temp(*t - 1);                                              \
+      (*t)[i].key = key;                                                       \
+    }                                                                          \
+    return i;                                                                  \
+  }                                                                            \
+  static inline void name##_remove(E **t, ptrdiff_t i) {                       \
+    yk__stbds_hash_index *table = YK__STBDS_TYPED_TABLE(*t);                   \
+    ptrdiff_t last = (ptrdiff_t) yk__stbds_header(*t - 1)->length - 2;         \
+    *t = (E *) yk__stbds_hmdel_hash(*t, sizeof(E),                             \
+                                    name##_hash(table, (*t)[i].key), i,        \
+                                    name##_hash(table, (*t)[last].key));       \
+  }
+#define YK__STBDS_DEFINE_HASHMAP(name, K, V, hashfn, eqfn)                     \
+  typedef struct {                                                             \
+    K key;                                                                     \
+    V value;                                                                   \
+  } name##_entry;                                                              \
+  YK__STBDS_DEFINE_HASHMAP_INDEX(name, name##_entry, K, hashfn, eqfn)          \
+  static inline name##_entry *name##_getp_null(name##_entry *t, K key) {       \
+    ptrdiff_t i = name##_geti(t, key);                                         \
+    return i < 0 ? NULL : &t[i];                                               \
+  }                                                                            \
+  static inline V name##_get(name##_entry *t, K key) {                         \
+    V zero;                                                                    \
+    if (t == NULL) {                                                           \
+      memset(&zero, 0, sizeof(V));                                             \
+      return zero;                                                             \
+    }                                                                          \
+    return t[name##_geti(t, key)].value;                                       \
+  }                                                                            \
+  static inline void name##_put(name##_entry **t, K key, V value) {            \
+    int added;                                                                 \
+    ptrdiff_t i = name##_insert(t, key, &added);                               \
+    (*t)[i].value = value;                                                     \
+  }                                                                            \
+  static inline int name##_del(name##_entry **t, K key) {                      \
+    ptrdiff_t i = name##_geti(*t, key);                                        \
+    if (i < 0) return 0;                                                       \
+    name##_remove(t, i);                                                       \
+    return 1;                                                                  \
+  }
+#define YK__STBDS_DEFINE_HASHMAP_SOA(name, K, V, hashfn, eqfn)                 \
+  typedef struct {                                                             \
+    K key;                                                                     \
+  } name##_key;                                                                \
+  typedef struct {                                                             \
+    name##_key *keys;                                                          \
+    V *values;                                                                 \
+  } name;                                                                      \
+  YK__STBDS_DEFINE_HASHMAP_INDEX(name##_keys, name##_key, K, hashfn, eqfn)     \
+  static inline ptrdiff_t name##_geti(name *m, K key) {                        \
+    return name##_keys_geti(m->keys, key);                                     \
+  }                                                                            \
+  static inline V *name##_getp_null(name *m, K key) {                          \
+    ptrdiff_t i = name##_keys_geti(m->keys, key);                              \
+    return i < 0 ? NULL : &m->values[i];                                       \
+  }                                                                            \
+  static inline V name##_get(name *m, K key) {                                 \
+    V zero;                                                                    \
+    ptrdiff_t i = name##_keys_geti(m->keys, key);                              \
+    if (i >= 0) return m->values[i];                                           \
+    memset(&zero, 0, sizeof(V));                                               \
+    return zero;                                                               \
+  }                                                                            \
+  static inline void name##_put(name *m, K key, V value) {                     \
+    int added;                                                                 \
+    ptrdiff_t i = name##_keys_insert(&m->keys, key, &added);                   \
+    if (added) yk__stbds_arrput(m->values, value);                             \
+    else                                                                       \
+      m->values[i] = value;                                                    \
+  }                                                                            \
+  static inline int name##_del(name *m, K key) {                               \
+    ptrdiff_t i = name##_keys_geti(m->keys, key);                              \
+    if (i < 0) return 0;                                                       \
+    name##_keys_remove(&m->keys, i);                                           \
+    yk__stbds_arrdelswap(m->values, i);                                        \
+    return 1;                                                                  \
+  }                                                                            \
+  static inline ptrdiff_t name##_len(name *m) {                                \
+    return yk__stbds_hmlen(m->keys);                                           \
+  }                                                                            \
+  static inline void name##_free(name *m) {                                    \
+    yk__stbds_hmfree(m->keys);                                                 \
+    yk__stbds_arrfree(m->values);                                              \
+  }
+// integer hash usable as hashfn, on 64-bit platforms the same as the 8 byte
+// key hash of yk__stbds_hash_bytes, which is SipHash-2-4 with
+// YK__STBDS_SIPHASH_2_4
+static inline size_t yk__stbds_hash_size_t(size_t hash, size_t seed) {
+#ifdef YK__STBDS_SIPHASH_2_4
+  return yk__stbds_hash_bytes(&hash, sizeof(hash), seed);
+#else
+  if (sizeof(size_t) == 4) {
+    hash ^= seed;
+    hash = (hash ^ 61) ^ (hash >> 16);
+    hash = hash + (hash << 3);
+    hash = hash ^ (hash >> 4);
+    hash = hash * 0x27d4eb2d;
+    hash ^= seed;
+    return hash ^ (hash >> 15);
+  }
+  hash ^= seed;
+  hash = (~hash) + (hash << 21);
+  hash ^= (hash >> 24) | (hash << (sizeof(size_t) * 8 - 24));
+  hash *= 265;
+  hash ^= (hash >> 14) | (hash << (sizeof(size_t) * 8 - 14));
+  hash ^= seed;
+  hash *= 21;
+  hash ^= (hash >> 28) | (hash << (sizeof(size_t) * 8 - 28));
+  hash += (hash << 31);
+  return (~hash) + (hash << 18);
+#endif
+}
+#define yk__stbds_hash_ptr(p, seed) yk__stbds_hash_size_t((size_t) (p), (seed))
+#define yk__stbds_equal(a, b) ((a) == (b))
+#ifdef __cplusplus
+// in C we use implicit assignment from these void*-returning functions to T*.
+// in C++ these templates make the same code work
+template<class T>
+static T *yk__stbds_arrgrowf_wrapper(T *a, size_t elemsize, size_t addlen,
+                                     size_t min_cap) {
+  return (T *) yk__stbds_arrgrowf((void *) a, elemsize, addlen, min_cap);
+}
+template<class T>
+static T *yk__stbds_hmget_key_wrapper(T *a, size_t elemsize, void *key,
+                                      size_t keysize, int mode) {
+  return (T *) yk__stbds_hmget_key((void *) a, elemsize, key, keysize, mode);
+}
+template<class T>
+static T *yk__stbds_hmget_key_ts_wrapper(T *a, size_t elemsize, void *key,
+                                         size_t keysize, ptrdiff_t *temp,
+                                         int mode) {
   return (T *) yk__stbds_hmget_key_ts((void *) a, elemsize, key, keysize, temp,
                                       mode);
 }
@@ -2171,6 +3718,54 @@ template<class T>
 static T *yk__stbds_shmode_func_wrapper(T *, size_t elemsize, int mode) {
   return (T *) yk__stbds_shmode_func(elemsize, mode);
 }
+template<class T>
+static T *yk__stbds_hmhash_func_wrapper(T *a, size_t elemsize, int func,
+                                        int mode) {
+  return (T *) yk__stbds_hmhash_func((void *) a, elemsize, func, mode);
+}
+template<class T>
+static T *yk__stbds_hmincremental_func_wrapper(T *a, size_t elemsize, int on,
+                                               int mode) {
+  return (T *) yk__stbds_hmincremental_func((void *) a, elemsize, on, mode);
+}
+#ifdef YK__STBDS_SNAPSHOTS
+template<class T>
+static T *yk__stbds_load_func_wrapper(T *, const char *path, size_t elemsize,
+                                      int kind) {
+  return (T *) yk__stbds_load_func(path, elemsize, kind);
+}
+#endif
+template<class T>
+static T *yk__stbds_hmget_batch_func_wrapper(T *a, size_t elemsize,
+                                             const void *keys, size_t n,
+                                             ptrdiff_t *out, size_t keysize,
+                                             int mode) {
+  return (T *) yk__stbds_hmget_batch_func((void *) a, elemsize, keys, n, out,
+                                          keysize, mode);
+}
+template<class T>
+static T *yk__stbds_hmreserve_func_wrapper(T *a, size_t elemsize, size_t n,
+                                           int mode) {
+  return (T *) yk__stbds_hmreserve_func((void *) a, elemsize, n, mode);
+}
+template<class T>
+static T *yk__stbds_hmputs_array_func_wrapper(T *a, size_t elemsize,
+                                              const T *items, size_t n,
+                                              size_t keysize, int mode) {
+  return (T *) yk__stbds_hmputs_array_func((void *) a, elemsize, items, n,
+                                           keysize, mode);
+}
+template<class T>
+static T *yk__stbds_setunion_func_wrapper(T *a, T *b, size_t elemsize,
+                                          int mode) {
+  return (T *) yk__stbds_setunion_func((void *) a, (void *) b, elemsize, mode);
+}
+template<class T>
+static T *yk__stbds_setintersect_func_wrapper(T *a, T *b, size_t elemsize,
+                                              int mode) {
+  return (T *) yk__stbds_setintersect_func((void *) a, (void *) b, elemsize,
+                                           mode);
+}
 #else
 #define yk__stbds_arrgrowf_wrapper yk__stbds_arrgrowf
 #define yk__stbds_hmget_key_wrapper yk__stbds_hmget_key
@@ -2179,6 +3774,14 @@ static T *yk__stbds_shmode_func_wrapper(T *, size_t elemsize, int mode) {
 #define yk__stbds_hmput_key_wrapper yk__stbds_hmput_key
 #define yk__stbds_hmdel_key_wrapper yk__stbds_hmdel_key
 #define yk__stbds_shmode_func_wrapper(t, e, m) yk__stbds_shmode_func(e, m)
+#define yk__stbds_hmhash_func_wrapper yk__stbds_hmhash_func
+#define yk__stbds_hmincremental_func_wrapper yk__stbds_hmincremental_func
+#define yk__stbds_hmget_batch_func_wrapper yk__stbds_hmget_batch_func
+#define yk__stbds_load_func_wrapper(t, p, e, k) yk__stbds_load_func(p, e, k)
+#define yk__stbds_hmreserve_func_wrapper yk__stbds_hmreserve_func
+#define yk__stbds_hmputs_array_func_wrapper yk__stbds_hmputs_array_func
+#define yk__stbds_setunion_func_wrapper yk__stbds_setunion_func
+#define yk__stbds_setintersect_func_wrapper yk__stbds_setintersect_func
 #endif
 #endif// YK__INCLUDE_STB_DS_H
 //////////////////////////////////////////////////////////////////////////////
@@ -2188,11 +3791,38 @@ static T *yk__stbds_shmode_func_wrapper(T *, size_t elemsize, int mode) {
 #ifdef YK__STB_DS_IMPLEMENTATION
 #include <assert.h>
 #include <string.h>
+#define YK__STBDS_CACHE_LINE_SIZE 64
+#define YK__STBDS_ALIGN_FWD(n, a) (((n) + (a) -1) & ~((a) -1))
+// bucket probing compares all hashes of a bucket at once where possible,
+// #define YK__STBDS_NO_SIMD to use the portable version
+#if !defined(YK__STBDS_NO_SIMD) && defined(__AVX2__)
+#define YK__STBDS_SIMD_AVX2
+#include <immintrin.h>
+#elif !defined(YK__STBDS_NO_SIMD) &&                                           \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define YK__STBDS_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+#if (defined(__x86_64__) && !defined(__ILP32__)) || defined(_M_X64)
+#define YK__STBDS_SIMD_64BIT_HASH
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+#define YK__STBDS_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(YK__STBDS_SIMD_SSE2) || defined(YK__STBDS_SIMD_AVX2)
+#define YK__STBDS_PREFETCH(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+#define YK__STBDS_PREFETCH(p) ((void) 0)
+#endif
 #ifndef YK__STBDS_ASSERT
 #define YK__STBDS_ASSERT_WAS_UNDEFINED
 #define YK__STBDS_ASSERT(x) ((void) 0)
 #endif
 #ifdef YK__STBDS_STATISTICS
+#include <time.h>
 #define YK__STBDS_STATS(x) x
 size_t yk__stbds_array_grow;
 size_t yk__stbds_hash_grow;
@@ -2244,38 +3874,6 @@ void yk__stbds_arrfreef(void *a) { YK__STBDS_FREE(NULL, yk__stbds_header(a)); }
 //
 // stbds_hm hash table implementation
 //
-#ifdef YK__STBDS_INTERNAL_SMALL_BUCKET
-#define YK__STBDS_BUCKET_LENGTH 4
-#else
-#define YK__STBDS_BUCKET_LENGTH 8
-#endif
-#define YK__STBDS_BUCKET_SHIFT (YK__STBDS_BUCKET_LENGTH == 8 ? 3 : 2)
-#define YK__STBDS_BUCKET_MASK (YK__STBDS_BUCKET_LENGTH - 1)
-#define YK__STBDS_CACHE_LINE_SIZE 64
-#define YK__STBDS_ALIGN_FWD(n, a) (((n) + (a) -1) & ~((a) -1))
-typedef struct {
-  size_t hash[YK__STBDS_BUCKET_LENGTH];
-  ptrdiff_t index[YK__STBDS_BUCKET_LENGTH];
-} yk__stbds_hash_bucket;// in 32-bit, this is one 64-byte cache line; in 64-bit, each yk__array is one 64-byte cache line
-typedef struct {
-  char *temp_key;// this MUST be the first field of the hash table
-  size_t slot_count;
-  size_t used_count;
-  size_t used_count_threshold;
-  size_t used_count_shrink_threshold;
-  size_t tombstone_count;
-  size_t tombstone_count_threshold;
-  size_t seed;
-  size_t slot_count_log2;
-  yk__stbds_string_arena string;
-  yk__stbds_hash_bucket *
-      storage;// not a separate allocation, just 64-byte aligned storage after this struct
-} yk__stbds_hash_index;
-#define YK__STBDS_INDEX_EMPTY -1
-#define YK__STBDS_INDEX_DELETED -2
-#define YK__STBDS_INDEX_IN_USE(x) ((x) >= 0)
-#define YK__STBDS_HASH_EMPTY 0
-#define YK__STBDS_HASH_DELETED 1
 static size_t yk__stbds_hash_seed = 0x31415926;
 void yk__stbds_rand_seed(size_t seed) { yk__stbds_hash_seed = seed; }
 #define yk__stbds_load_32_or_64(var, temp, v32, v64_hi, v64_lo)                \
@@ -2286,13 +3884,8 @@ void yk__stbds_rand_seed(size_t seed) { yk__stbds_hash_seed = seed; }
 #define YK__STBDS_SIZE_T_BITS ((sizeof(size_t)) * 8)
 static size_t yk__stbds_probe_position(size_t hash, size_t slot_count,
                                        size_t slot_log2) {
-  size_t pos;
   YK__STBDS_NOTUSED(slot_log2);
-  pos = hash & (slot_count - 1);
-#ifdef YK__STBDS_INTERNAL_BUCKET_START
-  pos &= ~YK__STBDS_BUCKET_MASK;
-#endif
-  return pos;
+  return YK__STBDS_PROBE_START(hash, slot_count);
 }
 static size_t yk__stbds_log2(size_t slot_count) {
   size_t n = 0;
@@ -2302,13 +3895,72 @@ static size_t yk__stbds_log2(size_t slot_count) {
   }
   return n;
 }
+// put an entry of another index into the first empty slot of its probe sequence
+static void yk__stbds_hash_index_insert(yk__stbds_hash_index *t, size_t hash,
+                                        ptrdiff_t index) {
+  size_t pos =
+      yk__stbds_probe_position(hash, t->slot_count, t->slot_count_log2);
+  size_t step = YK__STBDS_BUCKET_LENGTH;
+  YK__STBDS_STATS(++yk__stbds_rehash_items);
+  for (;;) {
+    size_t limit, z;
+    yk__stbds_hash_bucket *bucket;
+    bucket = &t->storage[pos >> YK__STBDS_BUCKET_SHIFT];
+    YK__STBDS_STATS(++yk__stbds_rehash_probes);
+    for (z = pos & YK__STBDS_BUCKET_MASK; z < YK__STBDS_BUCKET_LENGTH; ++z) {
+      if (bucket->hash[z] == 0) {
+        bucket->hash[z] = hash;
+        bucket->index[z] = index;
+        return;
+      }
+    }
+    limit = pos & YK__STBDS_BUCKET_MASK;
+    for (z = 0; z < limit; ++z) {
+      if (bucket->hash[z] == 0) {
+        bucket->hash[z] = hash;
+        bucket->index[z] = index;
+        return;
+      }
+    }
+    pos += step;// quadratic probing
+    step += YK__STBDS_BUCKET_LENGTH;
+    pos &= (t->slot_count - 1);
+  }
+}
+#ifndef YK__STBDS_CALLOC
+static void *yk__stbds_calloc(size_t size) {
+  void *p = YK__STBDS_REALLOC(NULL, NULL, size);
+  if (p) memset(p, 0, size);
+  return p;
+}
+#define YK__STBDS_CALLOC(c, s) yk__stbds_calloc(s)
+#endif
+#define YK__STBDS_PAGE_SIZE 4096
+// commit the zeroed pages of buckets [begin, end) of 't' in order, writing a
+// slot back as it is, so the inserts landing on them later do not fault
+static void yk__stbds_touch_buckets(yk__stbds_hash_index *t, size_t begin,
+                                    size_t end) {
+  size_t step = YK__STBDS_PAGE_SIZE / sizeof(yk__stbds_hash_bucket);
+  if (end > t->slot_count >> YK__STBDS_BUCKET_SHIFT)
+    end = t->slot_count >> YK__STBDS_BUCKET_SHIFT;
+  for (; begin < end; begin += step)
+    ((volatile size_t *) t->storage[begin].hash)[0] += 0;
+}
+// an incremental 'ot' is not copied, it becomes t->old and its entries are
+// moved later by yk__stbds_hm_migrate
+// zeroed buckets are all empty slots, the index of an incremental resize
+// comes from calloc, which leaves large blocks to the OS to zero a page at a
+// time when first written, so the resize does not stall clearing it
 static yk__stbds_hash_index *
 yk__stbds_make_hash_index(size_t slot_count, yk__stbds_hash_index *ot) {
   yk__stbds_hash_index *t;
-  t = (yk__stbds_hash_index *) YK__STBDS_REALLOC(
-      NULL, 0,
+  size_t size =
       (slot_count >> YK__STBDS_BUCKET_SHIFT) * sizeof(yk__stbds_hash_bucket) +
-          sizeof(yk__stbds_hash_index) + YK__STBDS_CACHE_LINE_SIZE - 1);
+      sizeof(yk__stbds_hash_index) + YK__STBDS_CACHE_LINE_SIZE - 1;
+  int lazy = ot && ot->incremental;
+  if (lazy) t = (yk__stbds_hash_index *) YK__STBDS_CALLOC(NULL, size);
+  else
+    t = (yk__stbds_hash_index *) YK__STBDS_REALLOC(NULL, 0, size);
   t->storage = (yk__stbds_hash_bucket *) YK__STBDS_ALIGN_FWD(
       (size_t) (t + 1), YK__STBDS_CACHE_LINE_SIZE);
   t->slot_count = slot_count;
@@ -2365,9 +4017,19 @@ yk__stbds_make_hash_index(size_t slot_count, yk__stbds_hash_index *ot) {
     t->string = ot->string;
     // reuse old seed so we can reuse old hashes so below "copy out old data" doesn't do any hashing
     t->seed = ot->seed;
+    t->hash_func = ot->hash_func;
+    t->incremental = ot->incremental;
+    YK__STBDS_STATS(t->stats = ot->stats);
   } else {
     size_t a, b, temp;
     memset(&t->string, 0, sizeof(t->string));
+    YK__STBDS_STATS(memset(&t->stats, 0, sizeof(t->stats)));
+    t->hash_func = YK__STBDS_HASH_FUNC_DEFAULT;
+#ifdef YK__STBDS_INCREMENTAL_REHASH
+    t->incremental = 1;
+#else
+    t->incremental = 0;
+#endif
     t->seed = yk__stbds_hash_seed;
     // LCG
     // in 32-bit, a =          2147001325   b =  715136305
@@ -2376,7 +4038,7 @@ yk__stbds_make_hash_index(size_t slot_count, yk__stbds_hash_index *ot) {
     yk__stbds_load_32_or_64(b, temp, 715136305, 0, 0xb504f32d);
     yk__stbds_hash_seed = yk__stbds_hash_seed * a + b;
   }
-  {
+  if (!lazy) {
     size_t i, j;
     for (i = 0; i < slot_count >> YK__STBDS_BUCKET_SHIFT; ++i) {
       yk__stbds_hash_bucket *b = &t->storage[i];
@@ -2386,49 +4048,76 @@ yk__stbds_make_hash_index(size_t slot_count, yk__stbds_hash_index *ot) {
         b->index[j] = YK__STBDS_INDEX_EMPTY;
     }
   }
+  t->old = NULL;
+  t->migrate_pos = 0;
   // copy out the old data, if any
   if (ot) {
     size_t i, j;
     t->used_count = ot->used_count;
+    YK__STBDS_ASSERT(ot->old == NULL);
+    if (ot->incremental) {
+      t->old = ot;
+      return t;
+    }
     for (i = 0; i < ot->slot_count >> YK__STBDS_BUCKET_SHIFT; ++i) {
       yk__stbds_hash_bucket *ob = &ot->storage[i];
-      for (j = 0; j < YK__STBDS_BUCKET_LENGTH; ++j) {
-        if (YK__STBDS_INDEX_IN_USE(ob->index[j])) {
-          size_t hash = ob->hash[j];
-          size_t pos =
-              yk__stbds_probe_position(hash, t->slot_count, t->slot_count_log2);
-          size_t step = YK__STBDS_BUCKET_LENGTH;
-          YK__STBDS_STATS(++yk__stbds_rehash_items);
-          for (;;) {
-            size_t limit, z;
-            yk__stbds_hash_bucket *bucket;
-            bucket = &t->storage[pos >> YK__STBDS_BUCKET_SHIFT];
-            YK__STBDS_STATS(++yk__stbds_rehash_probes);
-            for (z = pos & YK__STBDS_BUCKET_MASK; z < YK__STBDS_BUCKET_LENGTH;
-                 ++z) {
-              if (bucket->hash[z] == 0) {
-                bucket->hash[z] = hash;
-                bucket->index[z] = ob->index[j];
-                goto done;
-              }
-            }
-            limit = pos & YK__STBDS_BUCKET_MASK;
-            for (z = 0; z < limit; ++z) {
-              if (bucket->hash[z] == 0) {
-                bucket->hash[z] = hash;
-                bucket->index[z] = ob->index[j];
-                goto done;
-              }
-            }
-            pos += step;// quadratic probing
-            step += YK__STBDS_BUCKET_LENGTH;
-            pos &= (t->slot_count - 1);
-          }
-        }
-      done:;
+      for (j = 0; j < YK__STBDS_BUCKET_LENGTH; ++j)
+        if (YK__STBDS_SLOT_IN_USE(ob, j))
+          yk__stbds_hash_index_insert(t, ob->hash[j], ob->index[j]);
+    }
+  }
+  return t;
+}
+#ifndef YK__STBDS_MIGRATE_BUCKETS
+#define YK__STBDS_MIGRATE_BUCKETS 64
+#endif
+// buckets of the new index whose pages are faulted in per bucket moved, the
+// new index is twice the size of the old one so all of its pages are in
+// after the first 1/16th of the move, before random inserts fault most of
+// them in one at a time
+#define YK__STBDS_TOUCH_BUCKETS 32
+// move the entries of up to 'buckets' buckets of t->old to 't', the old index
+// is freed once it is empty
+static void yk__stbds_hm_migrate(yk__stbds_hash_index *t, size_t buckets) {
+  yk__stbds_hash_index *ot = t->old;
+  size_t count = ot->slot_count >> YK__STBDS_BUCKET_SHIFT, j;
+  size_t end = count - t->migrate_pos < buckets ? count
+                                                : t->migrate_pos + buckets;
+  yk__stbds_touch_buckets(t, t->migrate_pos * YK__STBDS_TOUCH_BUCKETS,
+                          end * YK__STBDS_TOUCH_BUCKETS);
+  for (; buckets > 0 && t->migrate_pos < count; --buckets) {
+    yk__stbds_hash_bucket *ob = &ot->storage[t->migrate_pos++];
+    for (j = 0; j < YK__STBDS_BUCKET_LENGTH; ++j) {
+      if (YK__STBDS_SLOT_IN_USE(ob, j)) {
+        yk__stbds_hash_index_insert(t, ob->hash[j], ob->index[j]);
+        // a tombstone keeps the probe sequences through this slot intact
+        ob->hash[j] = YK__STBDS_HASH_DELETED;
+        ob->index[j] = YK__STBDS_INDEX_DELETED;
       }
     }
   }
+  if (t->migrate_pos == count) {
+    YK__STBDS_FREE(NULL, ot);
+    t->old = NULL;
+  }
+}
+// replace index 'ot' of a hashmap with one that has 'slot_count' slots
+static yk__stbds_hash_index *yk__stbds_hm_resize(yk__stbds_hash_index *ot,
+                                                 size_t slot_count) {
+  yk__stbds_hash_index *t;
+  YK__STBDS_STATS(clock_t start = clock());
+  // finish the previous incremental resize first
+  if (ot->old) yk__stbds_hm_migrate(ot, ot->old->slot_count);
+  t = yk__stbds_make_hash_index(slot_count, ot);
+#ifdef YK__STBDS_STATISTICS
+  t->stats.rebuild_seconds += (double) (clock() - start) / CLOCKS_PER_SEC;
+  if (slot_count > ot->slot_count) ++t->stats.grows;
+  else if (slot_count < ot->slot_count)
+    ++t->stats.shrinks;
+  else
+    ++t->stats.rebuilds;
+#endif
+  if (!ot->incremental) YK__STBDS_FREE(NULL, ot);
   return t;
 }
 #define YK__STBDS_ROTATE_LEFT(val, n)                                          \
@@ -2436,13 +4125,9 @@ yk__stbds_make_hash_index(size_t slot_count, yk__stbds_hash_index *ot) {
 #define YK__STBDS_ROTATE_RIGHT(val, n)                                         \
   (((val) >> (n)) | ((val) << (YK__STBDS_SIZE_T_BITS - (n))))
 size_t yk__stbds_hash_string(yk__sds str, size_t seed) {
-  size_t hash = seed;
-  size_t string_length = yk__sdslen(str);
-  if (string_length > 0) {
-    for (size_t i = 0; i < string_length; i++) {
-      hash = YK__STBDS_ROTATE_LEFT(hash, 9) + (unsigned char) *str++;
-    }
-  }
+  // content hash does not depend on the seed, so yk__sdsnewhashed() strings
+  // can cache it and only the mix below is done per lookup
+  size_t hash = yk__sdshash(str);
   // Thomas Wang 64-to-32 bit mix function, hopefully also works in 32 bits
   hash ^= seed;
   hash = (~hash) + (hash << 18);
@@ -2470,9 +4155,11 @@ typedef int YK__STBDS_SIPHASH_2_4_can_only_be_used_in_64_bit_builds
 #pragma warning(                                                               \
     disable : 4127)// conditional expression is constant, for do..while(0) and sizeof()==
 #endif
-static size_t yk__stbds_siphash_bytes(void *p, size_t len, size_t seed) {
+static size_t yk__stbds_siphash(void *p, size_t len, size_t seed,
+                                int c_rounds, int d_rounds) {
   unsigned char *d = (unsigned char *) p;
-  size_t i, j;
+  size_t i;
+  int j;
   size_t v0, v1, v2, v3, data;
   // hash that works on 32- or 64-bit registers without knowing which we have
   // (computes different results on 32-bit and 64-bit platform)
@@ -2511,7 +4198,7 @@ static size_t yk__stbds_siphash_bytes(void *p, size_t len, size_t seed) {
     data |= (size_t) (d[4] | (d[5] << 8) | (d[6] << 16) | (d[7] << 24))
             << 16 << 16;// discarded if size_t == 4
     v3 ^= data;
-    for (j = 0; j < YK__STBDS_SIPHASH_C_ROUNDS; ++j) YK__STBDS_SIPROUND();
+    for (j = 0; j < c_rounds; ++j) YK__STBDS_SIPROUND();
     v0 ^= data;
   }
   data = len << (YK__STBDS_SIZE_T_BITS - 8);
@@ -2534,16 +4221,23 @@ static size_t yk__stbds_siphash_bytes(void *p, size_t len, size_t seed) {
       break;
   }
   v3 ^= data;
-  for (j = 0; j < YK__STBDS_SIPHASH_C_ROUNDS; ++j) YK__STBDS_SIPROUND();
+  for (j = 0; j < c_rounds; ++j) YK__STBDS_SIPROUND();
   v0 ^= data;
   v2 ^= 0xff;
-  for (j = 0; j < YK__STBDS_SIPHASH_D_ROUNDS; ++j) YK__STBDS_SIPROUND();
-#ifdef YK__STBDS_SIPHASH_2_4
-  return v0 ^ v1 ^ v2 ^ v3;
-#else
+  for (j = 0; j < d_rounds; ++j) YK__STBDS_SIPROUND();
+  if (c_rounds == 2 && d_rounds == 4) return v0 ^ v1 ^ v2 ^ v3;
   return v1 ^ v2 ^
          v3;// slightly stronger since v0^v3 in above cancels out final round operation? I tweeted at the authors of SipHash about this but they didn't reply
-#endif
+}
+static size_t yk__stbds_siphash_bytes(void *p, size_t len, size_t seed) {
+  return yk__stbds_siphash(p, len, seed, YK__STBDS_SIPHASH_C_ROUNDS,
+                           YK__STBDS_SIPHASH_D_ROUNDS);
+}
+size_t yk__stbds_hash_bytes_siphash(void *p, size_t len, size_t seed) {
+  return yk__stbds_siphash(p, len, seed, 2, 4);
+}
+size_t yk__stbds_hash_bytes_fast(void *p, size_t len, size_t seed) {
+  return yk__sdshashlen(p, len, seed);
 }
 size_t yk__stbds_hash_bytes(void *p, size_t len, size_t seed) {
 #ifdef YK__STBDS_SIPHASH_2_4
@@ -2628,6 +4322,21 @@ size_t yk__stbds_hash_bytes(void *p, size_t len, size_t seed) {
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
+// hash a key with the hash function selected for the table
+static size_t yk__stbds_hm_hash(yk__stbds_hash_index *table, void *key,
+                                size_t keysize, int mode) {
+  switch (table->hash_func) {
+    case YK__STBDS_HASH_FUNC_FAST:
+      if (mode >= YK__STBDS_HM_STRING) break;
+      return yk__stbds_hash_bytes_fast(key, keysize, table->seed);
+    case YK__STBDS_HASH_FUNC_SIPHASH:
+      if (mode >= YK__STBDS_HM_STRING) keysize = yk__sdslen((char *) key);
+      return yk__stbds_hash_bytes_siphash(key, keysize, table->seed);
+  }
+  return mode >= YK__STBDS_HM_STRING
+             ? yk__stbds_hash_string((char *) key, table->seed)
+             : yk__stbds_hash_bytes(key, keysize, table->seed);
+}
 static int yk__stbds_is_key_equal(void *a, size_t elemsize, void *key,
                                   size_t keysize, size_t keyoffset, int mode,
                                   size_t i) {
@@ -2651,53 +4360,133 @@ void yk__stbds_hmfree_func(void *a, size_t elemsize) {
         yk__sdsfree(*(char **) ((char *) a + elemsize * i));
     }
     yk__stbds_strreset(&yk__stbds_hash_table(a)->string);
+    if (yk__stbds_hash_table(a)->old)
+      YK__STBDS_FREE(NULL, yk__stbds_hash_table(a)->old);
   }
   YK__STBDS_FREE(NULL, yk__stbds_header(a)->hash_table);
   YK__STBDS_FREE(NULL, yk__stbds_header(a));
 }
-static ptrdiff_t yk__stbds_hm_find_slot(void *a, size_t elemsize, void *key,
-                                        size_t keysize, size_t keyoffset,
-                                        int mode) {
-  void *raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
-  yk__stbds_hash_index *table = yk__stbds_hash_table(raw_a);
-  size_t hash = mode >= YK__STBDS_HM_STRING
-                    ? yk__stbds_hash_string((char *) key, table->seed)
-                    : yk__stbds_hash_bytes(key, keysize, table->seed);
+// index of the lowest set bit, 'x' must not be 0
+static int yk__stbds_ctz(unsigned int x) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(x);
+#elif defined(_MSC_VER)
+  unsigned long r;
+  _BitScanForward(&r, x);
+  return (int) r;
+#else
+  int r = 0;
+  while (!(x & 1)) x >>= 1, ++r;
+  return r;
+#endif
+}
+// bit i of the result is set if bucket->hash[i] == hash, bit i of *empty is
+// set if slot i is empty
+static unsigned int yk__stbds_bucket_match(yk__stbds_hash_bucket *bucket,
+                                           size_t hash, unsigned int *empty) {
+  unsigned int match = 0, none = 0;
+  int k;
+#if defined(YK__STBDS_SIMD_AVX2) && defined(YK__STBDS_SIMD_64BIT_HASH)
+  __m256i h = _mm256_set1_epi64x((long long) hash);
+  __m256i zero = _mm256_setzero_si256();
+  for (k = 0; k < YK__STBDS_BUCKET_LENGTH; k += 4) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &bucket->hash[k]);
+    match |= (unsigned int) _mm256_movemask_pd(
+                 _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, h)))
+             << k;
+    none |= (unsigned int) _mm256_movemask_pd(
+                _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zero)))
+            << k;
+  }
+#elif defined(YK__STBDS_SIMD_AVX2)
+  __m256i h = _mm256_set1_epi32((int) hash);
+  __m256i zero = _mm256_setzero_si256();
+  for (k = 0; k < YK__STBDS_BUCKET_LENGTH; k += 8) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) &bucket->hash[k]);
+    match |= (unsigned int) _mm256_movemask_ps(
+                 _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, h)))
+             << k;
+    none |= (unsigned int) _mm256_movemask_ps(
+                _mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero)))
+            << k;
+  }
+#elif defined(YK__STBDS_SIMD_SSE2) && defined(YK__STBDS_SIMD_64BIT_HASH)
+  // no 64-bit compare in SSE2, a lane matches if both of its halves match
+  __m128i h = _mm_set1_epi64x((long long) hash);
+  __m128i zero = _mm_setzero_si128();
+  for (k = 0; k < YK__STBDS_BUCKET_LENGTH; k += 2) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &bucket->hash[k]);
+    __m128i eq = _mm_cmpeq_epi32(v, h);
+    __m128i ez = _mm_cmpeq_epi32(v, zero);
+    eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    ez = _mm_and_si128(ez, _mm_shuffle_epi32(ez, _MM_SHUFFLE(2, 3, 0, 1)));
+    match |= (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(eq)) << k;
+    none |= (unsigned int) _mm_movemask_pd(_mm_castsi128_pd(ez)) << k;
+  }
+#elif defined(YK__STBDS_SIMD_SSE2)
+  __m128i h = _mm_set1_epi32((int) hash);
+  __m128i zero = _mm_setzero_si128();
+  for (k = 0; k < YK__STBDS_BUCKET_LENGTH; k += 4) {
+    __m128i v = _mm_loadu_si128((const __m128i *) &bucket->hash[k]);
+    match |= (unsigned int) _mm_movemask_ps(
+                 _mm_castsi128_ps(_mm_cmpeq_epi32(v, h)))
+             << k;
+    none |= (unsigned int) _mm_movemask_ps(
+                _mm_castsi128_ps(_mm_cmpeq_epi32(v, zero)))
+            << k;
+  }
+#else
+  for (k = 0; k < YK__STBDS_BUCKET_LENGTH; ++k) {
+    match |= (unsigned int) (bucket->hash[k] == hash) << k;
+    none |= (unsigned int) (bucket->hash[k] == YK__STBDS_HASH_EMPTY) << k;
+  }
+#endif
+  *empty = none;
+  return match;
+}
+// rotate the bucket bitmask 'm' right by 'n' so bit 0 is slot n
+#define YK__STBDS_BUCKET_ROTATE(m, n)                                          \
+  ((((m) >> (n)) | ((m) << (YK__STBDS_BUCKET_LENGTH - (n)))) &                 \
+   ((1u << YK__STBDS_BUCKET_LENGTH) - 1))
+// count is 1 to add the search to the statistics of the table, 0 for
+// searches that may run concurrently with others on the same table
+static ptrdiff_t yk__stbds_hm_find_slot_in(void *a, size_t elemsize,
+                                           yk__stbds_hash_index *table,
+                                           size_t hash, void *key,
+                                           size_t keysize, size_t keyoffset,
+                                           int mode, int count) {
   size_t step = YK__STBDS_BUCKET_LENGTH;
-  size_t limit, i;
+  size_t start, i;
   size_t pos;
+  unsigned int match, empty;
   yk__stbds_hash_bucket *bucket;
-  if (hash < 2)
-    hash +=
-        2;// stored hash values are forbidden from being 0, so we can detect empty slots
+  (void) count;
+  YK__STBDS_STATS(if (count) ++table->stats.lookups);
   pos =
       yk__stbds_probe_position(hash, table->slot_count, table->slot_count_log2);
   for (;;) {
-    YK__STBDS_STATS(++yk__stbds_hash_probes);
+    YK__STBDS_STATS(if (count) {
+      ++yk__stbds_hash_probes;
+      ++table->stats.lookup_probes;
+    })
     bucket = &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];
-    // start searching from pos to end of bucket, this should help performance on small hash tables that fit in cache
-    for (i = pos & YK__STBDS_BUCKET_MASK; i < YK__STBDS_BUCKET_LENGTH; ++i) {
-      if (bucket->hash[i] == hash) {
-        if (yk__stbds_is_key_equal(a, elemsize, key, keysize, keyoffset, mode,
-                                   bucket->index[i])) {
-          return (pos & ~YK__STBDS_BUCKET_MASK) + i;
-        }
-      } else if (bucket->hash[i] == YK__STBDS_HASH_EMPTY) {
-        return -1;
-      }
-    }
-    // search from beginning of bucket to pos
-    limit = pos & YK__STBDS_BUCKET_MASK;
-    for (i = 0; i < limit; ++i) {
-      if (bucket->hash[i] == hash) {
-        if (yk__stbds_is_key_equal(a, elemsize, key, keysize, keyoffset, mode,
-                                   bucket->index[i])) {
-          return (pos & ~YK__STBDS_BUCKET_MASK) + i;
-        }
-      } else if (bucket->hash[i] == YK__STBDS_HASH_EMPTY) {
-        return -1;
+    match = yk__stbds_bucket_match(bucket, hash, &empty);
+    // search from pos to end of bucket and then from beginning of bucket to
+    // pos, this should help performance on small hash tables that fit in cache
+    start = pos & YK__STBDS_BUCKET_MASK;
+    match = YK__STBDS_BUCKET_ROTATE(match, start);
+    empty = YK__STBDS_BUCKET_ROTATE(empty, start);
+    // the first empty slot ends the search, matches after it do not count
+    if (empty) match &= (empty & (0u - empty)) - 1;
+    while (match) {
+      i = (start + yk__stbds_ctz(match)) & YK__STBDS_BUCKET_MASK;
+      if (yk__stbds_is_key_equal(a, elemsize, key, keysize, keyoffset, mode,
+                                 bucket->index[i])) {
+        return (pos & ~YK__STBDS_BUCKET_MASK) + i;
       }
+      match &= match - 1;
     }
+    if (empty) return -1;
     // quadratic probing
     pos += step;
     step += YK__STBDS_BUCKET_LENGTH;
@@ -2705,8 +4494,41 @@ static ptrdiff_t yk__stbds_hm_find_slot(void *a, size_t elemsize, void *key,
   }
   /* NOTREACHED */
 }
-void *yk__stbds_hmget_key_ts(void *a, size_t elemsize, void *key,
-                             size_t keysize, ptrdiff_t *temp, int mode) {
+// *in is set to the index that holds the returned slot, which is the old one
+// of an incremental resize if the key was not moved yet
+static ptrdiff_t yk__stbds_hm_find_slot(void *a, size_t elemsize, void *key,
+                                        size_t keysize, size_t keyoffset,
+                                        int mode, yk__stbds_hash_index **in,
+                                        int count) {
+  void *raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
+  yk__stbds_hash_index *table = yk__stbds_hash_table(raw_a);
+  void *key_ptr = key;
+  size_t hash;
+  ptrdiff_t slot;
+  // interned keys are plain pointers, hash and compare the pointer itself
+  if (mode >= YK__STBDS_HM_STRING &&
+      table->string.mode == YK__STBDS_SH_INTERN) {
+    key = &key_ptr;
+    keysize = sizeof(char *);
+    mode = YK__STBDS_HM_BINARY;
+  }
+  hash = yk__stbds_hm_hash(table, key, keysize, mode);
+  if (hash < 2)
+    hash +=
+        2;// stored hash values are forbidden from being 0, so we can detect empty slots
+  *in = table;
+  slot = yk__stbds_hm_find_slot_in(a, elemsize, table, hash, key, keysize,
+                                   keyoffset, mode, count);
+  if (slot < 0 && table->old) {
+    *in = table->old;
+    slot = yk__stbds_hm_find_slot_in(a, elemsize, table->old, hash, key,
+                                     keysize, keyoffset, mode, count);
+  }
+  return slot;
+}
+static void *yk__stbds_hmget_key_in(void *a, size_t elemsize, void *key,
+                                    size_t keysize, ptrdiff_t *temp, int mode,
+                                    int count) {
   size_t keyoffset = 0;
   if (a == NULL) {
     // make it non-empty so we can return a temp
@@ -2724,8 +4546,8 @@ void *yk__stbds_hmget_key_ts(void *a, size_t elemsize, void *key,
     if (table == 0) {
       *temp = -1;
     } else {
-      ptrdiff_t slot =
-          yk__stbds_hm_find_slot(a, elemsize, key, keysize, keyoffset, mode);
+      ptrdiff_t slot = yk__stbds_hm_find_slot(a, elemsize, key, keysize,
+                                              keyoffset, mode, &table, count);
       if (slot < 0) {
         *temp = YK__STBDS_INDEX_EMPTY;
       } else {
@@ -2737,10 +4559,81 @@ void *yk__stbds_hmget_key_ts(void *a, size_t elemsize, void *key,
     return a;
   }
 }
+// readers sharing a lock call this one, so it does not touch the statistics
+void *yk__stbds_hmget_key_ts(void *a, size_t elemsize, void *key,
+                             size_t keysize, ptrdiff_t *temp, int mode) {
+  return yk__stbds_hmget_key_in(a, elemsize, key, keysize, temp, mode, 0);
+}
+#ifndef YK__STBDS_BATCH_SIZE
+#define YK__STBDS_BATCH_SIZE 16
+#endif
+void *yk__stbds_hmget_batch_func(void *a, size_t elemsize, const void *keys,
+                                 size_t n, ptrdiff_t *out, size_t keysize,
+                                 int mode) {
+  yk__stbds_hash_index *table;
+  void *key[YK__STBDS_BATCH_SIZE];
+  size_t hash[YK__STBDS_BATCH_SIZE];
+  size_t done, count, i;
+  ptrdiff_t temp;
+  // allocate the default entry that T[-1] refers to
+  if (a == NULL) a = yk__stbds_hmget_key_ts(a, elemsize, NULL, 0, &temp, mode);
+  table = yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(a, elemsize));
+  if (table == NULL) {
+    for (i = 0; i < n; ++i) out[i] = -1;
+    return a;
+  }
+  // interned keys are plain pointers, hash and compare the pointer itself
+  if (mode >= YK__STBDS_HM_STRING &&
+      table->string.mode == YK__STBDS_SH_INTERN) {
+    keysize = sizeof(char *);
+    mode = YK__STBDS_HM_BINARY;
+  }
+  for (done = 0; done < n; done += count) {
+    count = n - done < YK__STBDS_BATCH_SIZE ? n - done : YK__STBDS_BATCH_SIZE;
+    // hash everything first, so all the bucket loads are in flight together
+    for (i = 0; i < count; ++i) {
+      key[i] = (char *) keys + (done + i) * keysize;
+      if (mode >= YK__STBDS_HM_STRING) key[i] = *(void **) key[i];
+      hash[i] = yk__stbds_hm_hash(table, key[i], keysize, mode);
+      if (hash[i] < 2) hash[i] += 2;
+      YK__STBDS_PREFETCH(
+          &table->storage[yk__stbds_probe_position(hash[i], table->slot_count,
+                                                   table->slot_count_log2) >>
+                          YK__STBDS_BUCKET_SHIFT]);
+    }
+    // then the entry of the first matching hash, usually the one compared
+    for (i = 0; i < count; ++i) {
+      size_t pos = yk__stbds_probe_position(hash[i], table->slot_count,
+                                            table->slot_count_log2);
+      yk__stbds_hash_bucket *bucket =
+          &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];
+      unsigned int empty;
+      unsigned int match = yk__stbds_bucket_match(bucket, hash[i], &empty);
+      if (match)
+        YK__STBDS_PREFETCH((char *) a + elemsize * bucket->index[yk__stbds_ctz(
+                                                       match)]);
+    }
+    for (i = 0; i < count; ++i) {
+      yk__stbds_hash_index *in = table;
+      ptrdiff_t slot = yk__stbds_hm_find_slot_in(a, elemsize, table, hash[i],
+                                                 key[i], keysize, 0, mode, 1);
+      if (slot < 0 && table->old) {
+        in = table->old;
+        slot = yk__stbds_hm_find_slot_in(a, elemsize, in, hash[i], key[i],
+                                         keysize, 0, mode, 1);
+      }
+      out[done + i] =
+          slot < 0 ? -1
+                   : in->storage[slot >> YK__STBDS_BUCKET_SHIFT]
+                         .index[slot & YK__STBDS_BUCKET_MASK];
+    }
+  }
+  return a;
+}
 void *yk__stbds_hmget_key(void *a, size_t elemsize, void *key, size_t keysize,
                           int mode) {
   ptrdiff_t temp;
-  void *p = yk__stbds_hmget_key_ts(a, elemsize, key, keysize, &temp, mode);
+  void *p = yk__stbds_hmget_key_in(a, elemsize, key, keysize, &temp, mode, 1);
   yk__stbds_temp(YK__STBDS_HASH_TO_ARR(p, elemsize)) = temp;
   return p;
 }
@@ -2760,10 +4653,33 @@ void *yk__stbds_hmput_default(void *a, size_t elemsize) {
   return a;
 }
 static char *yk__stbds_strdup(char *str);
+// move a few buckets of a pending incremental resize and grow the index of
+// the hashmap 'a' (pointing to the default entry) if it is full
+static yk__stbds_hash_index *yk__stbds_hm_make_room(void *a, int mode) {
+  yk__stbds_hash_index *table =
+      (yk__stbds_hash_index *) yk__stbds_header(a)->hash_table;
+  if (table && table->old)
+    yk__stbds_hm_migrate(table, YK__STBDS_MIGRATE_BUCKETS);
+  if (table == NULL || table->used_count >= table->used_count_threshold) {
+    yk__stbds_hash_index *nt;
+    size_t slot_count;
+    slot_count =
+        (table == NULL) ? YK__STBDS_BUCKET_LENGTH : table->slot_count * 2;
+    if (table) nt = yk__stbds_hm_resize(table, slot_count);
+    else {
+      nt = yk__stbds_make_hash_index(slot_count, NULL);
+      nt->string.mode = mode >= YK__STBDS_HM_STRING ? YK__STBDS_SH_DEFAULT : 0;
+    }
+    yk__stbds_header(a)->hash_table = table = nt;
+    YK__STBDS_STATS(++yk__stbds_hash_grow);
+  }
+  return table;
+}
 void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key, size_t keysize,
                           int mode) {
   size_t keyoffset = 0;
   void *raw_a;
+  void *key_ptr = key;
   yk__stbds_hash_index *table;
   if (a == NULL) {
     a = yk__stbds_arrgrowf(0, elemsize, 0, 1);
@@ -2775,41 +4691,51 @@ void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key, size_t keysize,
   // adjust a to point to the default element
   raw_a = a;
   a = YK__STBDS_HASH_TO_ARR(a, elemsize);
-  table = (yk__stbds_hash_index *) yk__stbds_header(a)->hash_table;
-  if (table == NULL || table->used_count >= table->used_count_threshold) {
-    yk__stbds_hash_index *nt;
-    size_t slot_count;
-    slot_count =
-        (table == NULL) ? YK__STBDS_BUCKET_LENGTH : table->slot_count * 2;
-    nt = yk__stbds_make_hash_index(slot_count, table);
-    if (table) YK__STBDS_FREE(NULL, table);
-    else
-      nt->string.mode = mode >= YK__STBDS_HM_STRING ? YK__STBDS_SH_DEFAULT : 0;
-    yk__stbds_header(a)->hash_table = table = nt;
-    YK__STBDS_STATS(++yk__stbds_hash_grow);
+  table = yk__stbds_hm_make_room(a, mode);
+  // interned keys are plain pointers, hash and compare the pointer itself
+  if (mode >= YK__STBDS_HM_STRING &&
+      table->string.mode == YK__STBDS_SH_INTERN) {
+    key = &key_ptr;
+    keysize = sizeof(char *);
   }
   // we iterate hash table explicitly because we want to track if we saw a tombstone
   {
-    size_t hash = mode >= YK__STBDS_HM_STRING
-                      ? yk__stbds_hash_string((char *) key, table->seed)
-                      : yk__stbds_hash_bytes(key, keysize, table->seed);
+    int key_mode =
+        key != key_ptr ? YK__STBDS_HM_BINARY : mode;// binary if interned
+    size_t hash = yk__stbds_hm_hash(table, key, keysize, key_mode);
     size_t step = YK__STBDS_BUCKET_LENGTH;
     size_t pos;
     ptrdiff_t tombstone = -1;
     yk__stbds_hash_bucket *bucket;
     // stored hash values are forbidden from being 0, so we can detect empty slots to early out quickly
     if (hash < 2) hash += 2;
+    // keys that were not moved by an incremental resize yet are found in place
+    if (table->old) {
+      ptrdiff_t slot =
+          yk__stbds_hm_find_slot_in(raw_a, elemsize, table->old, hash, key,
+                                    keysize, keyoffset, key_mode, 1);
+      if (slot >= 0) {
+        ptrdiff_t index = table->old->storage[slot >> YK__STBDS_BUCKET_SHIFT]
+                              .index[slot & YK__STBDS_BUCKET_MASK];
+        yk__stbds_temp(a) = index;
+        if (mode >= YK__STBDS_HM_STRING)
+          yk__stbds_temp_key(a) =
+              *(char **) ((char *) raw_a + elemsize * index + keyoffset);
+        return YK__STBDS_ARR_TO_HASH(a, elemsize);
+      }
+    }
     pos = yk__stbds_probe_position(hash, table->slot_count,
                                    table->slot_count_log2);
     for (;;) {
       size_t limit, i;
       YK__STBDS_STATS(++yk__stbds_hash_probes);
+      YK__STBDS_STATS(++table->stats.insert_probes);
       bucket = &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];
       // start searching from pos to end of bucket
       for (i = pos & YK__STBDS_BUCKET_MASK; i < YK__STBDS_BUCKET_LENGTH; ++i) {
         if (bucket->hash[i] == hash) {
           if (yk__stbds_is_key_equal(raw_a, elemsize, key, keysize, keyoffset,
-                                     mode, bucket->index[i])) {
+                                     key_mode, bucket->index[i])) {
             yk__stbds_temp(a) = bucket->index[i];
             if (mode >= YK__STBDS_HM_STRING)
               yk__stbds_temp_key(a) =
@@ -2830,9 +4756,13 @@ void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key, size_t keysize,
       for (i = 0; i < limit; ++i) {
         if (bucket->hash[i] == hash) {
           if (yk__stbds_is_key_equal(raw_a, elemsize, key, keysize, keyoffset,
-                                     mode, bucket->index[i])) {
+                                     key_mode, bucket->index[i])) {
             yk__stbds_temp(a) = bucket->index[i];
-            return YK__STBDS_ARR_TO_HASH(a, elemsize);
+            if (mode >= YK__STBDS_HM_STRING)
+              yk__stbds_temp_key(a) =
+                  *(char **) ((char *) raw_a + elemsize * bucket->index[i] +
+                              keyoffset);
+            return YK__STBDS_ARR_TO_HASH(a, elemsize);
           }
         } else if (bucket->hash[i] == 0) {
           pos = (pos & ~YK__STBDS_BUCKET_MASK) + i;
@@ -2848,6 +4778,7 @@ void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key, size_t keysize,
       pos &= (table->slot_count - 1);
     }
   found_empty_slot:
+    YK__STBDS_STATS(++table->stats.inserts);
     if (tombstone >= 0) {
       pos = tombstone;
       --table->tombstone_count;
@@ -2878,6 +4809,10 @@ void *yk__stbds_hmput_key(void *a, size_t elemsize, void *key, size_t keysize,
           yk__stbds_temp_key(a) = *(char **) ((char *) a + elemsize * i) =
               (char *) key;
           break;
+        case YK__STBDS_SH_INTERN:
+          yk__stbds_temp_key(a) = *(char **) ((char *) a + elemsize * i) =
+              (char *) key_ptr;
+          break;
         default:
           memcpy((char *) a + elemsize * i, key, keysize);
           break;
@@ -2897,6 +4832,164 @@ void *yk__stbds_shmode_func(size_t elemsize, int mode) {
   h->string.mode = (unsigned char) mode;
   return YK__STBDS_ARR_TO_HASH(a, elemsize);
 }
+// allocate the hashmap and its hash index if needed, so it can keep settings
+static void *yk__stbds_hm_with_index(void *a, size_t elemsize, int mode) {
+  void *raw_a;
+  if (a == NULL) return yk__stbds_shmode_func(elemsize, mode);
+  raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
+  if (yk__stbds_hash_table(raw_a) == NULL) {
+    // hmdefault creates the yk__array without an index
+    yk__stbds_hash_index *table =
+        yk__stbds_make_hash_index(YK__STBDS_BUCKET_LENGTH, NULL);
+    table->string.mode = (unsigned char) mode;
+    yk__stbds_header(raw_a)->hash_table = table;
+  }
+  return a;
+}
+void *yk__stbds_hmhash_func(void *a, size_t elemsize, int func, int mode) {
+  void *raw_a;
+  a = yk__stbds_hm_with_index(a, elemsize, mode);
+  raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
+  // stored hashes would not match the new function
+  YK__STBDS_ASSERT(yk__stbds_header(raw_a)->length == 1);
+  yk__stbds_hash_table(raw_a)->hash_func = func;
+  return a;
+}
+void *yk__stbds_hmincremental_func(void *a, size_t elemsize, int on,
+                                   int mode) {
+  yk__stbds_hash_index *table;
+  a = yk__stbds_hm_with_index(a, elemsize, mode);
+  table = yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(a, elemsize));
+  if (!on && table->old) yk__stbds_hm_migrate(table, table->old->slot_count);
+  table->incremental = on;
+  return a;
+}
+void yk__stbds_hmstats_func(void *a, size_t elemsize,
+                             yk__stbds_hmstats_t *stats) {
+  yk__stbds_hash_index *table = a ? yk__stbds_hash_table(a) : NULL;
+  size_t i, j, probes = 0, keys = 0;
+  memset(stats, 0, sizeof(yk__stbds_hmstats_t));
+  (void) elemsize;
+  if (table == NULL) {
+    if (a) stats->count = yk__stbds_header(a)->length - 1;
+    return;
+  }
+#ifdef YK__STBDS_STATISTICS
+  *stats = table->stats;
+#endif
+  stats->count = yk__stbds_header(a)->length - 1;
+  stats->slot_count = table->slot_count;
+  stats->tombstones = table->tombstone_count;
+  stats->load_factor = (double) table->used_count / table->slot_count;
+  // follow the probe sequence of every stored hash to its bucket, keys left
+  // in the old index of an incremental resize are not counted
+  for (i = 0; i < table->slot_count >> YK__STBDS_BUCKET_SHIFT; ++i) {
+    yk__stbds_hash_bucket *bucket = &table->storage[i];
+    for (j = 0; j < YK__STBDS_BUCKET_LENGTH; ++j) {
+      size_t pos, step = YK__STBDS_BUCKET_LENGTH, n = 1;
+      if (!YK__STBDS_SLOT_IN_USE(bucket, j)) continue;
+      pos = yk__stbds_probe_position(bucket->hash[j], table->slot_count,
+                                     table->slot_count_log2);
+      while ((pos >> YK__STBDS_BUCKET_SHIFT) != i) {
+        pos = (pos + step) & (table->slot_count - 1);
+        step += YK__STBDS_BUCKET_LENGTH;
+        ++n;
+      }
+      probes += n;
+      ++keys;
+      if (n > stats->max_probe) stats->max_probe = n;
+      ++stats->probe_histogram[n < YK__STBDS_PROBE_HISTOGRAM
+                                   ? n - 1
+                                   : YK__STBDS_PROBE_HISTOGRAM - 1];
+    }
+  }
+  if (keys) stats->avg_probe = (double) probes / keys;
+}
+void *yk__stbds_hmreserve_func(void *a, size_t elemsize, size_t n, int mode) {
+  void *raw_a;
+  yk__stbds_hash_index *table;
+  size_t slot_count = YK__STBDS_BUCKET_LENGTH;
+  a = yk__stbds_hm_with_index(a, elemsize,
+                              mode >= YK__STBDS_HM_STRING ? YK__STBDS_SH_DEFAULT
+                                                          : YK__STBDS_SH_NONE);
+  // the default entry is stored in front of the others
+  raw_a = yk__stbds_arrgrowf(YK__STBDS_HASH_TO_ARR(a, elemsize), elemsize, 0,
+                             n + 1);
+  table = yk__stbds_hash_table(raw_a);
+  // yk__stbds_hmput_key grows the index once used_count reaches the threshold
+  while (slot_count - (slot_count >> 2) < n) slot_count *= 2;
+  if (slot_count > table->slot_count)
+    yk__stbds_header(raw_a)->hash_table =
+        yk__stbds_hm_resize(table, slot_count);
+  return YK__STBDS_ARR_TO_HASH(raw_a, elemsize);
+}
+void *yk__stbds_hmputs_array_func(void *a, size_t elemsize, const void *items,
+                                  size_t n, size_t keysize, int mode) {
+  const char *item = (const char *) items;
+  size_t i, len = 0;
+  if (n == 0) return a;
+  if (a != NULL)
+    len = yk__stbds_header(YK__STBDS_HASH_TO_ARR(a, elemsize))->length - 1;
+  a = yk__stbds_hmreserve_func(a, elemsize, len + n, mode);
+  for (i = 0; i < n; ++i, item += elemsize) {
+    void *key = mode == YK__STBDS_HM_STRING ? *(void *const *) item
+                                            : (void *) item;
+    char *raw_a;
+    char *entry;
+    a = yk__stbds_hmput_key(a, elemsize, key, keysize, mode);
+    raw_a = (char *) YK__STBDS_HASH_TO_ARR(a, elemsize);
+    entry = (char *) a + elemsize * yk__stbds_temp(raw_a);
+    memcpy(entry, item, elemsize);
+    // the key may have been copied by a yk__sh_new_strdup / arena hashmap
+    if (mode == YK__STBDS_HM_STRING) *(char **) entry = yk__stbds_temp_key(raw_a);
+  }
+  return a;
+}
+// shrink or rebuild the index of 'raw_a' after a delete if needed
+static void yk__stbds_hm_shrink(void *raw_a, yk__stbds_hash_index *table) {
+  if (table->used_count < table->used_count_shrink_threshold &&
+      table->slot_count > YK__STBDS_BUCKET_LENGTH) {
+    yk__stbds_header(raw_a)->hash_table =
+        yk__stbds_hm_resize(table, table->slot_count >> 1);
+    YK__STBDS_STATS(++yk__stbds_hash_shrink);
+  } else if (table->tombstone_count > table->tombstone_count_threshold) {
+    yk__stbds_header(raw_a)->hash_table =
+        yk__stbds_hm_resize(table, table->slot_count);
+    YK__STBDS_STATS(++yk__stbds_hash_rebuild);
+  }
+}
+// sets are hashmaps whose entries are the bare keys
+void *yk__stbds_setunion_func(void *a, void *b, size_t elemsize, int mode) {
+  size_t i, n;
+  if (b == NULL || a == b) return a;
+  n = yk__stbds_header(YK__STBDS_HASH_TO_ARR(b, elemsize))->length - 1;
+  for (i = 0; i < n; ++i) {
+    char *key = (char *) b + elemsize * i;
+    // new binary keys are copied by yk__stbds_hmput_key
+    a = yk__stbds_hmput_key(
+        a, elemsize, mode == YK__STBDS_HM_STRING ? *(char **) key : key,
+        elemsize, mode);
+  }
+  return a;
+}
+void *yk__stbds_setintersect_func(void *a, void *b, size_t elemsize,
+                                  int mode) {
+  ptrdiff_t i;
+  yk__stbds_hash_index *in;
+  int empty = b == NULL || yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(
+                               b, elemsize)) == NULL;
+  if (a == NULL || a == b) return a;
+  // deleting moves the last key into place, which was checked already
+  i = (ptrdiff_t) yk__stbds_header(YK__STBDS_HASH_TO_ARR(a, elemsize))->length;
+  for (i -= 2; i >= 0; --i) {
+    char *key = (char *) a + elemsize * i;
+    void *k = mode == YK__STBDS_HM_STRING ? *(char **) key : key;
+    if (empty ||
+        yk__stbds_hm_find_slot(b, elemsize, k, elemsize, 0, mode, &in, 1) < 0)
+      a = yk__stbds_hmdel_key(a, elemsize, k, elemsize, 0, mode);
+  }
+  return a;
+}
 void *yk__stbds_hmdel_key(void *a, size_t elemsize, void *key, size_t keysize,
                           size_t keyoffset, int mode) {
   if (a == NULL) {
@@ -2910,19 +5003,22 @@ void *yk__stbds_hmdel_key(void *a, size_t elemsize, void *key, size_t keysize,
       return a;
     } else {
       ptrdiff_t slot;
-      slot = yk__stbds_hm_find_slot(a, elemsize, key, keysize, keyoffset, mode);
+      yk__stbds_hash_index *in;
+      if (table->old) yk__stbds_hm_migrate(table, YK__STBDS_MIGRATE_BUCKETS);
+      slot = yk__stbds_hm_find_slot(a, elemsize, key, keysize, keyoffset, mode,
+                                    &in, 1);
       if (slot < 0) return a;
       else {
-        yk__stbds_hash_bucket *b =
-            &table->storage[slot >> YK__STBDS_BUCKET_SHIFT];
+        yk__stbds_hash_bucket *b = &in->storage[slot >> YK__STBDS_BUCKET_SHIFT];
         int i = slot & YK__STBDS_BUCKET_MASK;
         ptrdiff_t old_index = b->index[i];
         ptrdiff_t final_index =
             (ptrdiff_t) yk__stbds_arrlen(raw_a) - 1 -
             1;// minus one for the raw_a vs a, and minus one for 'last'
-        YK__STBDS_ASSERT(slot < (ptrdiff_t) table->slot_count);
+        YK__STBDS_ASSERT(slot < (ptrdiff_t) in->slot_count);
+        // used_count of the current index counts the entries of both
         --table->used_count;
-        ++table->tombstone_count;
+        if (in == table) ++table->tombstone_count;
         yk__stbds_temp(raw_a) = 1;
         YK__STBDS_ASSERT(table->used_count >= 0);
         //YK__STBDS_ASSERT(table->tombstone_count < table->slot_count/4);
@@ -2941,36 +5037,113 @@ void *yk__stbds_hmdel_key(void *a, size_t elemsize, void *key, size_t keysize,
             slot = yk__stbds_hm_find_slot(
                 a, elemsize,
                 *(char **) ((char *) a + elemsize * old_index + keyoffset),
-                keysize, keyoffset, mode);
+                keysize, keyoffset, mode, &in, 1);
           else
             slot = yk__stbds_hm_find_slot(
                 a, elemsize, (char *) a + elemsize * old_index + keyoffset,
-                keysize, keyoffset, mode);
+                keysize, keyoffset, mode, &in, 1);
           YK__STBDS_ASSERT(slot >= 0);
-          b = &table->storage[slot >> YK__STBDS_BUCKET_SHIFT];
+          b = &in->storage[slot >> YK__STBDS_BUCKET_SHIFT];
           i = slot & YK__STBDS_BUCKET_MASK;
           YK__STBDS_ASSERT(b->index[i] == final_index);
           b->index[i] = old_index;
         }
         yk__stbds_header(raw_a)->length -= 1;
-        if (table->used_count < table->used_count_shrink_threshold &&
-            table->slot_count > YK__STBDS_BUCKET_LENGTH) {
-          yk__stbds_header(raw_a)->hash_table =
-              yk__stbds_make_hash_index(table->slot_count >> 1, table);
-          YK__STBDS_FREE(NULL, table);
-          YK__STBDS_STATS(++yk__stbds_hash_shrink);
-        } else if (table->tombstone_count > table->tombstone_count_threshold) {
-          yk__stbds_header(raw_a)->hash_table =
-              yk__stbds_make_hash_index(table->slot_count, table);
-          YK__STBDS_FREE(NULL, table);
-          YK__STBDS_STATS(++yk__stbds_hash_rebuild);
-        }
+        yk__stbds_hm_shrink(raw_a, table);
         return a;
       }
     }
   }
   /* NOTREACHED */
 }
+// slot of the entry 'index' stored with 'hash' in 'table', or -1
+static ptrdiff_t yk__stbds_hm_find_index(yk__stbds_hash_index *table,
+                                         size_t hash, ptrdiff_t index) {
+  size_t pos = yk__stbds_probe_position(hash, table->slot_count,
+                                        table->slot_count_log2);
+  size_t step = YK__STBDS_BUCKET_LENGTH, k;
+  for (;;) {
+    yk__stbds_hash_bucket *b = &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];
+    for (k = 0; k < YK__STBDS_BUCKET_LENGTH; ++k) {
+      size_t z = (pos + k) & YK__STBDS_BUCKET_MASK;
+      if (b->hash[z] == hash && b->index[z] == index)
+        return (ptrdiff_t) ((pos & ~YK__STBDS_BUCKET_MASK) + z);
+      if (b->hash[z] == YK__STBDS_HASH_EMPTY) return -1;
+    }
+    pos = (pos + step) & (table->slot_count - 1);
+    step += YK__STBDS_BUCKET_LENGTH;
+  }
+}
+// add an entry for a key with 'hash' that the caller knows is not in the
+// hashmap, its index is left in yk__stbds_temp and its key is not set
+void *yk__stbds_hmput_hash(void *a, size_t elemsize, size_t hash) {
+  void *raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
+  yk__stbds_hash_index *table =
+      yk__stbds_hm_make_room(raw_a, YK__STBDS_HM_BINARY);
+  size_t pos = yk__stbds_probe_position(hash, table->slot_count,
+                                        table->slot_count_log2);
+  size_t step = YK__STBDS_BUCKET_LENGTH, k, z;
+  ptrdiff_t i = (ptrdiff_t) yk__stbds_header(raw_a)->length;
+  yk__stbds_hash_bucket *b;
+  YK__STBDS_STATS(++table->stats.inserts);
+  for (;;) {
+    YK__STBDS_STATS(++table->stats.insert_probes);
+    b = &table->storage[pos >> YK__STBDS_BUCKET_SHIFT];
+    for (k = 0; k < YK__STBDS_BUCKET_LENGTH; ++k) {
+      z = (pos + k) & YK__STBDS_BUCKET_MASK;
+      if (b->hash[z] == YK__STBDS_HASH_EMPTY) goto found;
+      if (b->index[z] == YK__STBDS_INDEX_DELETED) {
+        --table->tombstone_count;
+        goto found;
+      }
+    }
+    pos = (pos + step) & (table->slot_count - 1);
+    step += YK__STBDS_BUCKET_LENGTH;
+  }
+found:
+  b->hash[z] = hash;
+  b->index[z] = i - 1;
+  ++table->used_count;
+  if ((size_t) i + 1 > yk__stbds_arrcap(raw_a))
+    raw_a = yk__stbds_arrgrowf(raw_a, elemsize, 1, 0);
+  yk__stbds_header(raw_a)->length = i + 1;
+  yk__stbds_temp(raw_a) = i - 1;
+  return YK__STBDS_ARR_TO_HASH(raw_a, elemsize);
+}
+// delete entry 'index' stored with 'hash', the last entry (stored with
+// 'last_hash') is moved into its place like yk__stbds_hmdel_key does
+void *yk__stbds_hmdel_hash(void *a, size_t elemsize, size_t hash,
+                           ptrdiff_t index, size_t last_hash) {
+  void *raw_a = YK__STBDS_HASH_TO_ARR(a, elemsize);
+  yk__stbds_hash_index *table = yk__stbds_hash_table(raw_a), *in = table;
+  ptrdiff_t last = (ptrdiff_t) yk__stbds_header(raw_a)->length - 2;
+  ptrdiff_t slot;
+  if (table->old) yk__stbds_hm_migrate(table, YK__STBDS_MIGRATE_BUCKETS);
+  slot = yk__stbds_hm_find_index(table, hash, index);
+  if (slot < 0 && table->old)
+    slot = yk__stbds_hm_find_index(in = table->old, hash, index);
+  YK__STBDS_ASSERT(slot >= 0);
+  in->storage[slot >> YK__STBDS_BUCKET_SHIFT].hash[slot & YK__STBDS_BUCKET_MASK] =
+      YK__STBDS_HASH_DELETED;
+  in->storage[slot >> YK__STBDS_BUCKET_SHIFT]
+      .index[slot & YK__STBDS_BUCKET_MASK] = YK__STBDS_INDEX_DELETED;
+  --table->used_count;
+  if (in == table) ++table->tombstone_count;
+  if (index != last) {
+    memmove((char *) a + elemsize * index, (char *) a + elemsize * last,
+            elemsize);
+    in = table;
+    slot = yk__stbds_hm_find_index(table, last_hash, last);
+    if (slot < 0 && table->old)
+      slot = yk__stbds_hm_find_index(in = table->old, last_hash, last);
+    YK__STBDS_ASSERT(slot >= 0);
+    in->storage[slot >> YK__STBDS_BUCKET_SHIFT]
+        .index[slot & YK__STBDS_BUCKET_MASK] = index;
+  }
+  yk__stbds_header(raw_a)->length -= 1;
+  yk__stbds_hm_shrink(raw_a, table);
+  return a;
+}
 static yk__sds yk__stbds_strdup(yk__sds str) { return yk__sdsdup(str); }
 #ifndef YK__STBDS_STRING_ARENA_BLOCKSIZE_MIN
 #define YK__STBDS_STRING_ARENA_BLOCKSIZE_MIN 512u
@@ -2978,9 +5151,9 @@ static yk__sds yk__stbds_strdup(yk__sds str) { return yk__sdsdup(str); }
 #ifndef YK__STBDS_STRING_ARENA_BLOCKSIZE_MAX
 #define YK__STBDS_STRING_ARENA_BLOCKSIZE_MAX (1u << 20)
 #endif
-char *yk__stbds_stralloc(yk__stbds_string_arena *a, char *str) {
+// 'len' bytes from the arena, strings are packed without alignment
+static char *yk__stbds_arena_alloc(yk__stbds_string_arena *a, size_t len) {
   char *p;
-  size_t len = strlen(str) + 1;
   if (len > a->remaining) {
     // compute the next blocksize
     size_t blocksize = a->block;
@@ -2997,7 +5170,6 @@ char *yk__stbds_stralloc(yk__stbds_string_arena *a, char *str) {
       // eventually the arena will start doubling and handling those as well
       yk__stbds_string_block *sb = (yk__stbds_string_block *) YK__STBDS_REALLOC(
           NULL, 0, sizeof(*sb) - 8 + len);
-      memmove(sb->storage, str, len);
       if (a->storage) {
         // insert it after the first element, so that we don't waste the space there
         sb->next = a->storage->next;
@@ -3019,9 +5191,12 @@ char *yk__stbds_stralloc(yk__stbds_string_arena *a, char *str) {
   YK__STBDS_ASSERT(len <= a->remaining);
   p = a->storage->storage + a->remaining - len;
   a->remaining -= len;
-  memmove(p, str, len);
   return p;
 }
+// copy 'str' with its yk__sds header into the arena, binary safe
+yk__sds yk__stbds_stralloc(yk__stbds_string_arena *a, yk__sds str) {
+  return yk__sdsdupat(yk__stbds_arena_alloc(a, yk__sdsdupsize(str)), str);
+}
 void yk__stbds_strreset(yk__stbds_string_arena *a) {
   yk__stbds_string_block *x, *y;
   x = a->storage;
@@ -3032,6 +5207,403 @@ void yk__stbds_strreset(yk__stbds_string_arena *a) {
   }
   memset(a, 0, sizeof(*a));
 }
+//
+// string interning
+//
+// canonical strings are keys of a YK__STBDS_SH_DEFAULT string hashmap, so the
+// content hash of every canonical string is kept in the hash index and
+// growing the pool never hashes a string again
+yk__sds yk__stbds_intern_sds(yk__stbds_intern_pool *pool, yk__sds s) {
+  size_t length = yk__stbds_hmlenu(pool->map);
+  ptrdiff_t i;
+  pool->map = (yk__sds *) yk__stbds_hmput_key(
+      pool->map, sizeof(yk__sds), s, sizeof(yk__sds), YK__STBDS_HM_STRING);
+  i = yk__stbds_temp(YK__STBDS_HASH_TO_ARR(pool->map, sizeof(yk__sds)));
+  // a new entry points to the caller's string, replace it with a copy we own,
+  // canonical strings cache their hash as they are likely used as keys again
+  if (yk__stbds_hmlenu(pool->map) != length) {
+    yk__sds canonical = yk__sdsnewhashed(s, yk__sdslen(s));
+    if (canonical == NULL) {
+      // out of memory, do not leave the caller's string in the pool
+      pool->map = (yk__sds *) yk__stbds_hmdel_key(
+          pool->map, sizeof(yk__sds), s, sizeof(yk__sds), 0,
+          YK__STBDS_HM_STRING);
+      return NULL;
+    }
+    pool->map[i] = canonical;
+  }
+  return pool->map[i];
+}
+yk__sds yk__stbds_intern(yk__stbds_intern_pool *pool, const char *str,
+                         size_t len) {
+  // short strings are wrapped in a temporary sds header on the stack
+  char buf[sizeof(struct yk__sdshdr8) + 256];
+  yk__sds tmp, canonical;
+  if (len < 256) {
+    struct yk__sdshdr8 *sh = (struct yk__sdshdr8 *) buf;
+    sh->len = (uint8_t) len;
+    sh->alloc = (uint8_t) len;
+    sh->flags = YK__SDS_TYPE_8;
+    memcpy(sh->buf, str, len);
+    sh->buf[len] = '\0';
+    return yk__stbds_intern_sds(pool, sh->buf);
+  }
+  tmp = yk__sdsnewlen(str, len);
+  if (tmp == NULL) return NULL;
+  canonical = yk__stbds_intern_sds(pool, tmp);
+  yk__sdsfree(tmp);
+  return canonical;
+}
+yk__sds yk__stbds_intern_find(yk__stbds_intern_pool *pool, yk__sds s) {
+  ptrdiff_t i;
+  if (pool->map == NULL) return NULL;
+  pool->map = (yk__sds *) yk__stbds_hmget_key(pool->map, sizeof(yk__sds), s,
+                                              sizeof(yk__sds),
+                                              YK__STBDS_HM_STRING);
+  i = yk__stbds_temp(YK__STBDS_HASH_TO_ARR(pool->map, sizeof(yk__sds)));
+  return i < 0 ? NULL : pool->map[i];
+}
+size_t yk__stbds_intern_count(yk__stbds_intern_pool *pool) {
+  return yk__stbds_hmlenu(pool->map);
+}
+void yk__stbds_intern_free(yk__stbds_intern_pool *pool) {
+  size_t i;
+  if (pool->map == NULL) return;
+  for (i = 0; i < yk__stbds_hmlenu(pool->map); ++i) yk__sdsfree(pool->map[i]);
+  yk__stbds_hmfree_func(YK__STBDS_HASH_TO_ARR(pool->map, sizeof(yk__sds)),
+                        sizeof(yk__sds));
+  pool->map = NULL;
+}
+#ifdef YK__STBDS_SNAPSHOTS
+//////////////////////////////////////////////////////////////////////////////
+//
+//   snapshots
+//
+// file layout, every part starts at a multiple of 64 bytes:
+//   yk__stbds_snapshot_header
+//   yk__stbds_array_header and the elements (default entry first for maps)
+//   yk__stbds_hash_index and its buckets (hashmaps with an index only)
+//   string keys as yk__sdshdr64 strings (string hashmaps only)
+// pointers inside are stored as offsets from the start of the file
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#define YK__STBDS_SNAPSHOT_MAGIC "YKSTBDS1"
+// a file is only usable by builds that agree on word size, byte order,
+// bucket layout and the default hash function
+#define YK__STBDS_SNAPSHOT_LAYOUT                                              \
+  ((sizeof(size_t) << 24) | (sizeof(yk__stbds_hash_index) << 12) |             \
+   (YK__STBDS_BUCKET_LENGTH << 8) | (YK__STBDS_SIPHASH_C_ROUNDS << 4) |        \
+   YK__STBDS_SIPHASH_D_ROUNDS)
+typedef struct {
+  char magic[8];
+  unsigned int byte_order;// 0x01020304 as written by the saving machine
+  unsigned int layout;    // YK__STBDS_SNAPSHOT_LAYOUT
+  int kind;               // YK__STBDS_SNAPSHOT_*
+  int reserved;
+  size_t elemsize;
+  size_t size;        // size of the whole file
+  size_t index_offset;// 0 if there is no hash index
+  size_t keys_offset; // 0 if there are no string keys
+} yk__stbds_snapshot_header;
+// the array header is at a fixed offset, so unload can find the start
+#define YK__STBDS_SNAPSHOT_ARRAY_OFFSET                                        \
+  YK__STBDS_ALIGN_FWD(sizeof(yk__stbds_snapshot_header),                     \
+                      YK__STBDS_CACHE_LINE_SIZE)
+static int yk__stbds_snapshot_pad(FILE *f, size_t *pos) {
+  static const char zeros[YK__STBDS_CACHE_LINE_SIZE] = {0};
+  size_t n = YK__STBDS_ALIGN_FWD(*pos, YK__STBDS_CACHE_LINE_SIZE) - *pos;
+  *pos += n;
+  return fwrite(zeros, 1, n, f) == n ? 0 : -1;
+}
+int yk__stbds_save_func(void *a, size_t elemsize, const char *path, int kind) {
+  yk__stbds_array_header header = *yk__stbds_header(a);
+  yk__stbds_hash_index *table = NULL;
+  yk__stbds_snapshot_header snap;
+  size_t pos, i, entries_size = header.length * elemsize, buckets_size = 0;
+  size_t key_pos, keys_size = 0;
+  int string_keys = kind == YK__STBDS_SNAPSHOT_STRING_HASHMAP;
+  char *entry = NULL;
+  FILE *f;
+  if (kind != YK__STBDS_SNAPSHOT_ARRAY) {
+    table = yk__stbds_hash_table(a);
+    if (table != NULL) {
+      if (table->string.mode == YK__STBDS_SH_INTERN) return -1;
+      // a pending incremental resize is finished, the file has one index
+      if (table->old) yk__stbds_hm_migrate(table, table->old->slot_count);
+      buckets_size = (table->slot_count >> YK__STBDS_BUCKET_SHIFT) *
+                     sizeof(yk__stbds_hash_bucket);
+    }
+  }
+  memset(&snap, 0, sizeof(snap));
+  memcpy(snap.magic, YK__STBDS_SNAPSHOT_MAGIC, 8);
+  snap.byte_order = 0x01020304;
+  snap.layout = YK__STBDS_SNAPSHOT_LAYOUT;
+  snap.kind = kind;
+  snap.elemsize = elemsize;
+  pos = YK__STBDS_SNAPSHOT_ARRAY_OFFSET + sizeof(header) + entries_size;
+  if (table) {
+    snap.index_offset = YK__STBDS_ALIGN_FWD(pos, YK__STBDS_CACHE_LINE_SIZE);
+    pos = snap.index_offset +
+          YK__STBDS_ALIGN_FWD(sizeof(yk__stbds_hash_index),
+                              YK__STBDS_CACHE_LINE_SIZE) +
+          buckets_size;
+  }
+  if (string_keys) {
+    snap.keys_offset = YK__STBDS_ALIGN_FWD(pos, YK__STBDS_CACHE_LINE_SIZE);
+    for (i = 1; i < header.length; ++i)
+      keys_size += sizeof(struct yk__sdshdr64) + 1 +
+                   yk__sdslen(*(char **) ((char *) a + elemsize * i));
+    pos = snap.keys_offset + keys_size;
+  }
+  snap.size = pos;
+  f = fopen(path, "wb");
+  if (f == NULL) return -1;
+  pos = 0;
+  // the saved yk__array has no spare room, it is never grown in place
+  header.capacity = header.length;
+  header.hash_table = (void *) snap.index_offset;
+  header.temp = 0;
+  if (fwrite(&snap, sizeof(snap), 1, f) != 1) goto fail;
+  pos += sizeof(snap);
+  if (yk__stbds_snapshot_pad(f, &pos) ||
+      fwrite(&header, sizeof(header), 1, f) != 1)
+    goto fail;
+  pos += sizeof(header);
+  if (!string_keys) {
+    if (fwrite(a, 1, entries_size, f) != entries_size) goto fail;
+  } else {
+    // key pointers become offsets of the saved strings
+    entry = (char *) YK__STBDS_REALLOC(NULL, NULL, elemsize);
+    if (entry == NULL) goto fail;
+    key_pos = snap.keys_offset;
+    for (i = 0; i < header.length; ++i) {
+      char *key = *(char **) ((char *) a + elemsize * i);
+      memcpy(entry, (char *) a + elemsize * i, elemsize);
+      // the default entry has no key
+      *(size_t *) entry = 0;
+      if (i > 0) {
+        *(size_t *) entry = key_pos + sizeof(struct yk__sdshdr64);
+        key_pos += sizeof(struct yk__sdshdr64) + yk__sdslen(key) + 1;
+      }
+      if (fwrite(entry, 1, elemsize, f) != elemsize) goto fail;
+    }
+  }
+  pos += entries_size;
+  if (table) {
+    yk__stbds_hash_index index = *table;
+    index.temp_key = NULL;
+    index.old = NULL;
+    index.migrate_pos = 0;
+    memset(&index.string, 0, sizeof(index.string));
+    // keys of a loaded hashmap belong to the file, not to the hashmap
+    if (string_keys) index.string.mode = YK__STBDS_SH_DEFAULT;
+    index.storage = (yk__stbds_hash_bucket *) (snap.index_offset +
+                                               YK__STBDS_ALIGN_FWD(
+                                                   sizeof(index),
+                                                   YK__STBDS_CACHE_LINE_SIZE));
+    if (yk__stbds_snapshot_pad(f, &pos) ||
+        fwrite(&index, sizeof(index), 1, f) != 1)
+      goto fail;
+    pos += sizeof(index);
+    if (yk__stbds_snapshot_pad(f, &pos) ||
+        fwrite(table->storage, 1, buckets_size, f) != buckets_size)
+      goto fail;
+    pos += buckets_size;
+  }
+  if (string_keys) {
+    if (yk__stbds_snapshot_pad(f, &pos)) goto fail;
+    for (i = 1; i < header.length; ++i) {
+      char *key = *(char **) ((char *) a + elemsize * i);
+      struct yk__sdshdr64 sh;
+      sh.len = sh.alloc = yk__sdslen(key);
+      sh.flags = YK__SDS_TYPE_64;
+      if (fwrite(&sh, sizeof(sh), 1, f) != 1 ||
+          fwrite(key, 1, sh.len + 1, f) != sh.len + 1)
+        goto fail;
+    }
+  }
+  YK__STBDS_FREE(NULL, entry);
+  return fclose(f) == 0 ? 0 : -1;
+fail:
+  YK__STBDS_FREE(NULL, entry);
+  fclose(f);
+  remove(path);
+  return -1;
+}
+// a file of the right size can still be corrupt, every offset and count is
+// checked so relocating it and using the result stays inside the mapping
+static int yk__stbds_snapshot_check(char *base,
+                                    yk__stbds_snapshot_header *snap,
+                                    size_t elemsize, int kind) {
+  yk__stbds_array_header *header =
+      (yk__stbds_array_header *) (base + YK__STBDS_SNAPSHOT_ARRAY_OFFSET);
+  size_t entries = YK__STBDS_SNAPSHOT_ARRAY_OFFSET + sizeof(*header);
+  // each part ends where the next one starts
+  size_t index_end = snap->keys_offset ? snap->keys_offset : snap->size;
+  size_t entries_end = snap->index_offset ? snap->index_offset : index_end;
+  size_t i, j;
+  if (snap->size < entries || index_end > snap->size ||
+      entries_end > index_end || entries_end < entries || elemsize == 0)
+    return 0;
+  if ((kind == YK__STBDS_SNAPSHOT_ARRAY && snap->index_offset) ||
+      (kind != YK__STBDS_SNAPSHOT_STRING_HASHMAP && snap->keys_offset))
+    return 0;
+  if (header->length > (entries_end - entries) / elemsize ||
+      (kind != YK__STBDS_SNAPSHOT_ARRAY && header->length == 0))
+    return 0;
+  if (snap->index_offset) {
+    yk__stbds_hash_index *table =
+        (yk__stbds_hash_index *) (base + snap->index_offset);
+    yk__stbds_hash_bucket *bucket;
+    size_t used = 0, tombstones = 0, empty = 0;
+    size_t storage =
+        snap->index_offset + YK__STBDS_ALIGN_FWD(sizeof(yk__stbds_hash_index),
+                                                 YK__STBDS_CACHE_LINE_SIZE);
+    if (snap->index_offset % YK__STBDS_CACHE_LINE_SIZE != 0 ||
+        storage > index_end || (size_t) table->storage != storage ||
+        table->slot_count < YK__STBDS_BUCKET_LENGTH ||
+        (table->slot_count & (table->slot_count - 1)) != 0 ||
+        (table->slot_count >> YK__STBDS_BUCKET_SHIFT) >
+            (index_end - storage) / sizeof(yk__stbds_hash_bucket))
+      return 0;
+    if (table->hash_func < YK__STBDS_HASH_FUNC_DEFAULT ||
+        table->hash_func > YK__STBDS_HASH_FUNC_SIPHASH ||
+        table->used_count_threshold >= table->slot_count ||
+        table->tombstone_count_threshold >=
+            table->slot_count - table->used_count_threshold ||
+        table->used_count >= table->slot_count ||
+        table->tombstone_count >= table->slot_count - table->used_count)
+      return 0;
+    // slots in use must point at an entry
+    bucket = (yk__stbds_hash_bucket *) (base + storage);
+    for (i = 0; i < table->slot_count >> YK__STBDS_BUCKET_SHIFT; ++i)
+      for (j = 0; j < YK__STBDS_BUCKET_LENGTH; ++j) {
+        if (bucket[i].hash[j] == YK__STBDS_HASH_EMPTY) ++empty;
+        else if (bucket[i].hash[j] == YK__STBDS_HASH_DELETED)
+          ++tombstones;
+        else if (bucket[i].index[j] < 0 ||
+                 (size_t) bucket[i].index[j] >= header->length - 1)
+          return 0;
+        else
+          ++used;
+      }
+    // probes stop at an empty slot, the counts keep one free as the map
+    // grows and rebuilds after loading
+    if (empty == 0 || used != header->length - 1 ||
+        used != table->used_count || tombstones > table->tombstone_count)
+      return 0;
+  }
+  if (snap->keys_offset) {
+    // keys are yk__sdshdr64 strings with their terminator inside the file
+    for (i = 1; i < header->length; ++i) {
+      size_t key = *(size_t *) ((char *) (header + 1) + elemsize * i);
+      struct yk__sdshdr64 *sh;
+      if (key < snap->keys_offset + sizeof(struct yk__sdshdr64) ||
+          key >= snap->size)
+        return 0;
+      sh = (struct yk__sdshdr64 *) (base + key - sizeof(struct yk__sdshdr64));
+      if (sh->flags != YK__SDS_TYPE_64 || sh->len >= snap->size - key ||
+          base[key + sh->len] != '\0')
+        return 0;
+    }
+  }
+  return 1;
+}
+static void yk__stbds_snapshot_unmap(char *base, size_t size) {
+#ifdef _WIN32
+  (void) size;
+  UnmapViewOfFile(base);
+#else
+  munmap(base, size);
+#endif
+}
+void *yk__stbds_load_func(const char *path, size_t elemsize, int kind) {
+  yk__stbds_snapshot_header snap;
+  yk__stbds_array_header *header;
+  char *base;
+  size_t i;
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) return NULL;
+  i = fread(&snap, sizeof(snap), 1, f);
+  fclose(f);
+  if (i != 1 || memcmp(snap.magic, YK__STBDS_SNAPSHOT_MAGIC, 8) != 0 ||
+      snap.byte_order != 0x01020304 ||
+      snap.layout != YK__STBDS_SNAPSHOT_LAYOUT || snap.kind != kind ||
+      snap.elemsize != elemsize)
+    return NULL;
+#ifdef _WIN32
+  {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE mapping;
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL) return NULL;
+    base = (char *) MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, snap.size);
+    CloseHandle(mapping);
+    if (base == NULL) return NULL;
+  }
+#else
+  {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size != snap.size) {
+      close(fd);
+      return NULL;
+    }
+    // private mapping, so hmget can still write its temp to the header
+    base = (char *) mmap(NULL, snap.size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         fd, 0);
+    close(fd);
+    if (base == (char *) MAP_FAILED) return NULL;
+  }
+#endif
+  if (memcmp(base, &snap, sizeof(snap)) != 0 ||
+      !yk__stbds_snapshot_check(base, &snap, elemsize, kind)) {
+    yk__stbds_snapshot_unmap(base, snap.size);
+    return NULL;
+  }
+  header = (yk__stbds_array_header *) (base + YK__STBDS_SNAPSHOT_ARRAY_OFFSET);
+  header->capacity = header->length;
+  header->hash_table = NULL;
+  header->temp = 0;
+  if (snap.index_offset) {
+    yk__stbds_hash_index *table =
+        (yk__stbds_hash_index *) (base + snap.index_offset);
+    table->storage =
+        (yk__stbds_hash_bucket *) (base + (size_t) table->storage);
+    table->temp_key = NULL;
+    table->old = NULL;
+    table->migrate_pos = 0;
+    memset(&table->string, 0, sizeof(table->string));
+    if (kind == YK__STBDS_SNAPSHOT_STRING_HASHMAP)
+      table->string.mode = YK__STBDS_SH_DEFAULT;
+    table->slot_count_log2 = yk__stbds_log2(table->slot_count);
+    header->hash_table = table;
+  }
+  if (snap.keys_offset) {
+    for (i = 1; i < header->length; ++i) {
+      char **key = (char **) ((char *) (header + 1) + elemsize * i);
+      *key = base + (size_t) *key;
+    }
+  }
+  if (kind == YK__STBDS_SNAPSHOT_ARRAY) return header + 1;
+  return YK__STBDS_ARR_TO_HASH(header + 1, elemsize);
+}
+void yk__stbds_unload_func(void *a) {
+  char *base = (char *) yk__stbds_header(a) - YK__STBDS_SNAPSHOT_ARRAY_OFFSET;
+  yk__stbds_snapshot_unmap(base, ((yk__stbds_snapshot_header *) base)->size);
+}
+#endif// YK__STBDS_SNAPSHOTS
 #endif
 //////////////////////////////////////////////////////////////////////////////
 //
@@ -3423,6 +5995,20 @@ MIT License
 Copyright (c) 2020 ismdeep
 
 
+## Reference - pattern defeating quick sort
+https://github.com/orlp/pdqsort
+
+zlib License
+Copyright (c) 2021 Orson Peters
+
+
+## Reference - timsort run detection, merge rules and galloping
+https://github.com/python/cpython/blob/main/Objects/listsort.txt
+
+Python Software Foundation License
+Copyright (c) 2001 Python Software Foundation
+
+
 ## Reference - memswap
 https://gist.github.com/JadenGeller/3ab6fbc3f75690103ea6
 Unknown license, asked in above link
@@ -3430,6 +6016,8 @@ Unknown license, asked in above link
 #ifndef YK__SORT
 #define YK__SORT
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>// memcpy
 /**
  * Comparison function, returns 0 if equal > 0 for larger and < 0 for smaller
  */
@@ -3440,27 +6028,585 @@ typedef int (*yk__compare_function)(const void *, const void *);
  * @param item_size single item size
  * @param elements number of elements
  * @param cmp_func compare function
- * @return 0 if successful, -1 if partial
+ * @return 0 if successful, -1 if the temporary element could not be allocated
  */
 int yk__quicksort(void *arr, size_t item_size, size_t elements,
                   yk__compare_function cmp_func);
 /**
  * Perform a quick sort for given array (no malloc)
+ * Pattern defeating quick sort, O(n log n) worst case (falls back to heap
+ * sort), linear for sorted, reversed and all equal input, not stable.
  * @param arr array
  * @param item_size single item size
  * @param elements number of elements
  * @param cmp_func compare function
  * @param single_elem_buffer buffer for a single temporary element (item_size can be held)
- * @return 0 if successful, -1 if partial
+ * @return 0, the array is always fully sorted
  */
 int yk__quicksort_ex(void *arr, size_t item_size, size_t elements,
                      yk__compare_function cmp_func, void *single_elem_buffer);
+#define YK__SORT_INSERTION_THRESHOLD 24
+#define YK__SORT_NINTHER_THRESHOLD 128
+#define YK__SORT_PARTIAL_INSERTION_LIMIT 8
+#define YK__SORT_STACK_SIZE 64
+/**
+ * less for YK__DEFINE_SORT on integers and floats, the float version orders
+ * NaNs after every number so they do not break the sort
+ */
+#define YK__SORT_NUMBER_LESS(a, b) ((a) < (b))
+#define YK__SORT_FLOAT_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+/**
+ * Define a sort specialized for arrays of T, same algorithm as
+ * yk__quicksort_ex with the comparison and element moves inlined
+ * (scope is the linkage of the sort function, helpers are static inline)
+ */
+#define YK__SORT_DEFINE_TYPED(name, T, less, scope)                            \
+  static inline void name##_swap(T *arr, size_t a, size_t b) {                 \
+    T tmp = arr[a];                                                            \
+    arr[a] = arr[b];                                                           \
+    arr[b] = tmp;                                                              \
+  }                                                                            \
+  static inline int name##_insertion(T *arr, size_t begin, size_t end,         \
+                                     size_t limit) {                           \
+    size_t i, j, moved = 0;                                                    \
+    for (i = begin + 1; i < end; i++) {                                        \
+      T tmp;                                                                   \
+      if (!less(arr[i], arr[i - 1])) continue;                                 \
+      tmp = arr[i];                                                            \
+      j = i;                                                                   \
+      do {                                                                     \
+        arr[j] = arr[j - 1];                                                   \
+        j--;                                                                   \
+      } while (j > begin && less(tmp, arr[j - 1]));                            \
+      arr[j] = tmp;                                                            \
+      moved += i - j;                                                          \
+      if (moved > limit && i + 1 < end) return 0;                              \
+    }                                                                          \
+    return 1;                                                                  \
+  }                                                                            \
+  static inline void name##_sort3(T *arr, size_t a, size_t b, size_t c) {      \
+    if (less(arr[b], arr[a])) name##_swap(arr, a, b);                          \
+    if (less(arr[c], arr[b])) name##_swap(arr, b, c);                          \
+    if (less(arr[b], arr[a])) name##_swap(arr, a, b);                          \
+  }                                                                            \
+  static inline void name##_sift_down(T *arr, size_t root, size_t n) {         \
+    for (;;) {                                                                 \
+      size_t child = 2 * root + 1;                                             \
+      if (child >= n) return;                                                  \
+      if (child + 1 < n && less(arr[child], arr[child + 1])) child++;          \
+      if (!less(arr[root], arr[child])) return;                                \
+      name##_swap(arr, root, child);                                           \
+      root = child;                                                            \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_sift_up(T *arr, size_t pos) {                      \
+    while (pos > 0 && less(arr[(pos - 1) / 2], arr[pos])) {                    \
+      name##_swap(arr, (pos - 1) / 2, pos);                                    \
+      pos = (pos - 1) / 2;                                                     \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_sort_heap(T *arr, size_t n) {                      \
+    size_t i;                                                                  \
+    for (i = n; i > 1; i--) {                                                  \
+      name##_swap(arr, 0, i - 1);                                              \
+      name##_sift_down(arr, 0, i - 1);                                         \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_heapsort(T *arr, size_t n) {                       \
+    size_t i;                                                                  \
+    for (i = n / 2; i > 0; i--) name##_sift_down(arr, i - 1, n);               \
+    name##_sort_heap(arr, n);                                                  \
+  }                                                                            \
+  static inline size_t name##_partition_right(T *arr, size_t begin,            \
+                                              size_t end,                      \
+                                              int *already_partitioned) {      \
+    T pivot = arr[begin];                                                      \
+    size_t first = begin, last = end;                                          \
+    while (++first < end && less(arr[first], pivot)) {}                        \
+    if (first - 1 == begin) {                                                  \
+      while (first < last) {                                                   \
+        last--;                                                                \
+        if (less(arr[last], pivot)) break;                                     \
+      }                                                                        \
+    } else {                                                                   \
+      while (--last > begin && !less(arr[last], pivot)) {}                     \
+    }                                                                          \
+    *already_partitioned = first >= last;                                      \
+    while (first < last) {                                                     \
+      name##_swap(arr, first, last);                                           \
+      while (++first < end && less(arr[first], pivot)) {}                      \
+      while (--last > begin && !less(arr[last], pivot)) {}                     \
+    }                                                                          \
+    arr[begin] = arr[first - 1];                                               \
+    arr[first - 1] = pivot;                                                    \
+    return first - 1;                                                          \
+  }                                                                            \
+  static inline size_t name##_partition_left(T *arr, size_t begin,             \
+                                             size_t end) {                     \
+    T pivot = arr[begin];                                                      \
+    size_t first = begin, last = end;                                          \
+    while (--last > begin && less(pivot, arr[last])) {}                        \
+    if (last + 1 == end) {                                                     \
+      while (first < last) {                                                   \
+        first++;                                                               \
+        if (less(pivot, arr[first])) break;                                    \
+      }                                                                        \
+    } else {                                                                   \
+      while (++first < end && !less(pivot, arr[first])) {}                     \
+    }                                                                          \
+    while (first < last) {                                                     \
+      name##_swap(arr, first, last);                                           \
+      while (--last > begin && less(pivot, arr[last])) {}                      \
+      while (++first < end && !less(pivot, arr[first])) {}                     \
+    }                                                                          \
+    arr[begin] = arr[last];                                                    \
+    arr[last] = pivot;                                                         \
+    return last;                                                               \
+  }                                                                            \
+  static inline void name##_break_patterns(T *arr, size_t begin, size_t end) { \
+    size_t size = end - begin, q = size / 4;                                   \
+    if (size < YK__SORT_INSERTION_THRESHOLD) return;                           \
+    name##_swap(arr, begin, begin + q);                                        \
+    name##_swap(arr, end - 1, end - q);                                        \
+    if (size > YK__SORT_NINTHER_THRESHOLD) {                                   \
+      name##_swap(arr, begin + 1, begin + (q + 1));                            \
+      name##_swap(arr, begin + 2, begin + (q + 2));                            \
+      name##_swap(arr, end - 2, end - (q + 1));                                \
+      name##_swap(arr, end - 3, end - (q + 2));                                \
+    }                                                                          \
+  }                                                                            \
+  static inline void name##_choose_pivot(T *arr, size_t begin, size_t end) {   \
+    size_t size = end - begin, s2 = size / 2;                                  \
+    if (size > YK__SORT_NINTHER_THRESHOLD) {                                   \
+      name##_sort3(arr, begin, begin + s2, end - 1);                           \
+      name##_sort3(arr, begin + 1, begin + s2 - 1, end - 2);                   \
+      name##_sort3(arr, begin + 2, begin + s2 + 1, end - 3);                   \
+      name##_sort3(arr, begin + s2 - 1, begin + s2, begin + s2 + 1);           \
+      name##_swap(arr, begin, begin + s2);                                     \
+    } else {                                                                   \
+      name##_sort3(arr, begin + s2, begin, end - 1);                           \
+    }                                                                          \
+  }                                                                            \
+  scope void name(T *arr, size_t elements) {                                   \
+    struct {                                                                   \
+      size_t begin, end;                                                       \
+      int bad_allowed, leftmost;                                               \
+    } stack[YK__SORT_STACK_SIZE];                                              \
+    int top = 0, bad_allowed = 0, leftmost, already_partitioned;               \
+    size_t begin, end, size, pivot_pos, l_size, r_size;                        \
+    for (size = elements; size > 1; size >>= 1) bad_allowed++;                 \
+    stack[0].begin = 0;                                                        \
+    stack[0].end = elements;                                                   \
+    stack[0].bad_allowed = bad_allowed;                                        \
+    stack[0].leftmost = 1;                                                     \
+    while (top >= 0) {                                                         \
+      begin = stack[top].begin;                                                \
+      end = stack[top].end;                                                    \
+      bad_allowed = stack[top].bad_allowed;                                    \
+      leftmost = stack[top--].leftmost;                                        \
+      for (;;) {                                                               \
+        size = end - begin;                                                    \
+        if (size < YK__SORT_INSERTION_THRESHOLD) {                             \
+          name##_insertion(arr, begin, end, (size_t) -1);                      \
+          break;                                                               \
+        }                                                                      \
+        name##_choose_pivot(arr, begin, end);                                  \
+        if (!leftmost && !less(arr[begin - 1], arr[begin])) {                  \
+          begin = name##_partition_left(arr, begin, end) + 1;                  \
+          continue;                                                            \
+        }                                                                      \
+        pivot_pos =                                                            \
+            name##_partition_right(arr, begin, end, &already_partitioned);     \
+        l_size = pivot_pos - begin;                                            \
+        r_size = end - (pivot_pos + 1);                                        \
+        if (l_size < size / 8 || r_size < size / 8) {                          \
+          if (--bad_allowed == 0) {                                            \
+            name##_heapsort(arr + begin, size);                                \
+            break;                                                             \
+          }                                                                    \
+          name##_break_patterns(arr, begin, pivot_pos);                        \
+          name##_break_patterns(arr, pivot_pos + 1, end);                      \
+        } else if (already_partitioned &&                                      \
+                   name##_insertion(arr, begin, pivot_pos,                     \
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT) &&       \
+                   name##_insertion(arr, pivot_pos + 1, end,                   \
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT)) {       \
+          break;                                                               \
+        }                                                                      \
+        top++;                                                                 \
+        if (l_size < r_size) {                                                 \
+          stack[top].begin = pivot_pos + 1;                                    \
+          stack[top].end = end;                                                \
+          stack[top].leftmost = 0;                                             \
+          end = pivot_pos;                                                     \
+        } else {                                                               \
+          stack[top].begin = begin;                                            \
+          stack[top].end = pivot_pos;                                          \
+          stack[top].leftmost = leftmost;                                      \
+          begin = pivot_pos + 1;                                               \
+          leftmost = 0;                                                        \
+        }                                                                      \
+        stack[top].bad_allowed = bad_allowed;                                  \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope void name##_nth_element(T *arr, size_t elements, size_t nth) {         \
+    int bad_allowed = 0, leftmost = 1, already_partitioned;                    \
+    size_t begin = 0, end = elements, size, pivot_pos;                         \
+    if (nth >= elements) return;                                               \
+    for (size = elements; size > 1; size >>= 1) bad_allowed++;                 \
+    for (;;) {                                                                 \
+      size = end - begin;                                                      \
+      if (size < YK__SORT_INSERTION_THRESHOLD) {                               \
+        name##_insertion(arr, begin, end, (size_t) -1);                        \
+        return;                                                                \
+      }                                                                        \
+      name##_choose_pivot(arr, begin, end);                                    \
+      if (!leftmost && !less(arr[begin - 1], arr[begin])) {                    \
+        begin = name##_partition_left(arr, begin, end) + 1;                    \
+        if (nth < begin) return;                                               \
+        continue;                                                              \
+      }                                                                        \
+      pivot_pos =                                                              \
+          name##_partition_right(arr, begin, end, &already_partitioned);       \
+      if (pivot_pos - begin < size / 8 || end - pivot_pos - 1 < size / 8) {    \
+        if (--bad_allowed == 0) {                                              \
+          name##_heapsort(arr + begin, size);                                  \
+          return;                                                              \
+        }                                                                      \
+        name##_break_patterns(arr, begin, pivot_pos);                          \
+        name##_break_patterns(arr, pivot_pos + 1, end);                        \
+      }                                                                        \
+      if (nth == pivot_pos) return;                                            \
+      if (nth < pivot_pos) {                                                   \
+        end = pivot_pos;                                                       \
+      } else {                                                                 \
+        begin = pivot_pos + 1;                                                 \
+        leftmost = 0;                                                          \
+      }                                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope void name##_partial_sort(T *arr, size_t elements, size_t k) {          \
+    if (k >= elements) {                                                       \
+      name(arr, elements);                                                     \
+    } else if (k > 0) {                                                        \
+      name##_nth_element(arr, elements, k - 1);                                \
+      name(arr, k - 1);                                                        \
+    }                                                                          \
+  }                                                                            \
+  scope size_t name##_topk_push(T *heap, size_t count, size_t k, T item) {     \
+    if (count < k) {                                                           \
+      heap[count] = item;                                                      \
+      name##_sift_up(heap, count);                                             \
+      return count + 1;                                                        \
+    }                                                                          \
+    if (k > 0 && less(item, heap[0])) {                                        \
+      heap[0] = item;                                                          \
+      name##_sift_down(heap, 0, k);                                            \
+    }                                                                          \
+    return count;                                                              \
+  }                                                                            \
+  scope void name##_topk_sort(T *heap, size_t count) {                         \
+    name##_sort_heap(heap, count);                                             \
+  }                                                                            \
+/**                                                                            \
+ * Define static inline functions for arrays of T, the same as the generic     \
+ * ones without item_size, cmp_func and buffers:                               \
+ * void name(T *arr, size_t elements)                                          \
+ * void name##_nth_element(T *arr, size_t elements, size_t nth)                \
+ * void name##_partial_sort(T *arr, size_t elements, size_t k)                 \
+ * size_t name##_topk_push(T *heap, size_t count, size_t k, T item)            \
+ *   returns the new count, pass 0 for the first item                          \
+ * void name##_topk_sort(T *heap, size_t count)                                \
+ * @param name name of the sort function, also prefixes its helpers            \
+ * @param T element type                                                       \
+ * @param less less(a, b) is called with two T lvalues and must be true when   \
+ * a sorts before b, a strict weak ordering like < (can be a macro)            \
+ */
+#define YK__DEFINE_SORT(name, T, less)                                         \
+  YK__SORT_DEFINE_TYPED(name, T, less, static inline)
+#define YK__SORT_DECLARE_TYPED(name, T)                                        \
+  void name(T *arr, size_t elements);                                          \
+  void name##_nth_element(T *arr, size_t elements, size_t nth);                \
+  void name##_partial_sort(T *arr, size_t elements, size_t k);                 \
+  size_t name##_topk_push(T *heap, size_t count, size_t k, T item);            \
+  void name##_topk_sort(T *heap, size_t count);
+/**
+ * Sorts for the number types of Yaksha (i8 to i64, u8 to u64, f32 and f64),
+ * yk__sort_i32 and yk__sort_i32_nth_element, _partial_sort, _topk_push and
+ * _topk_sort, see YK__DEFINE_SORT
+ */
+YK__SORT_DECLARE_TYPED(yk__sort_i8, int8_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i16, int16_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i32, int32_t)
+YK__SORT_DECLARE_TYPED(yk__sort_i64, int64_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u8, uint8_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u16, uint16_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u32, uint32_t)
+YK__SORT_DECLARE_TYPED(yk__sort_u64, uint64_t)
+YK__SORT_DECLARE_TYPED(yk__sort_f32, float)
+YK__SORT_DECLARE_TYPED(yk__sort_f64, double)
+/**
+ * Radix sort keys, unsigned integers that sort in the same order as the
+ * values they were made from
+ */
+typedef uint64_t (*yk__radix_key_function)(const void *);
+static inline uint64_t yk__radix_key_i32(int32_t x) {
+  return (uint32_t) x ^ ((uint32_t) 1 << 31);
+}
+static inline uint64_t yk__radix_key_i64(int64_t x) {
+  return (uint64_t) x ^ ((uint64_t) 1 << 63);
+}
+static inline uint64_t yk__radix_key_f32(float x) {
+  uint32_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits >> 31 ? ~bits : bits | ((uint32_t) 1 << 31);
+}
+static inline uint64_t yk__radix_key_f64(double x) {
+  uint64_t bits;
+  memcpy(&bits, &x, sizeof(bits));
+  return bits >> 63 ? ~bits : bits | ((uint64_t) 1 << 63);
+}
+/**
+ * Perform a LSD radix sort, one pass per key byte, skipping bytes that are
+ * the same for all keys. Stable, floats order -NaN < -inf < -0.0 < 0.0 <
+ * inf < NaN.
+ * @param arr array
+ * @param elements number of elements
+ * @return 0 if successful, -1 if the scratch array could not be allocated
+ */
+int yk__radixsort_u32(uint32_t *arr, size_t elements);
+int yk__radixsort_u64(uint64_t *arr, size_t elements);
+int yk__radixsort_i64(int64_t *arr, size_t elements);
+int yk__radixsort_f64(double *arr, size_t elements);
+/**
+ * Perform a LSD radix sort (no malloc)
+ * @param arr array
+ * @param elements number of elements
+ * @param scratch array of the same type that can hold elements
+ */
+void yk__radixsort_u32_ex(uint32_t *arr, size_t elements, uint32_t *scratch);
+void yk__radixsort_u64_ex(uint64_t *arr, size_t elements, uint64_t *scratch);
+void yk__radixsort_i64_ex(int64_t *arr, size_t elements, int64_t *scratch);
+void yk__radixsort_f64_ex(double *arr, size_t elements, double *scratch);
+/**
+ * Perform a LSD radix sort of any elements by an integer key, for example a
+ * field of a struct read with one of the yk__radix_key_* helpers
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func returns the key of an element, called once per pass
+ * @return 0 if successful, -1 if the scratch array could not be allocated
+ */
+int yk__radixsort_key(void *arr, size_t item_size, size_t elements,
+                      yk__radix_key_function key_func);
+/**
+ * Perform a LSD radix sort by an integer key (no malloc)
+ * @param scratch buffer that can hold elements items
+ */
+void yk__radixsort_key_ex(void *arr, size_t item_size, size_t elements,
+                          yk__radix_key_function key_func, void *scratch);
+/**
+ * Perform a MSD radix sort of yk__sds strings in yk__sdscmp order, one byte
+ * at a time, small buckets are finished with a quick sort
+ * @param arr array
+ * @param elements number of elements
+ * @return 0 if successful, -1 if the scratch arrays could not be allocated
+ */
+int yk__radixsort_sds(yk__sds *arr, size_t elements);
+/**
+ * Perform a stable sort for given array, equal elements keep their order
+ * Merges natural runs like timsort, O(n) for sorted or reversed input and
+ * O(n log n) worst case.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the scratch buffer could not be allocated
+ */
+int yk__stablesort(void *arr, size_t item_size, size_t elements,
+                   yk__compare_function cmp_func);
+/**
+ * Perform a stable sort for given array (no malloc)
+ * Runs that do not fit the scratch buffer are merged in place by rotating
+ * them, which is slower but needs no more memory.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function
+ * @param scratch buffer of scratch_elements elements
+ * @param scratch_elements at least 1, elements / 2 never has to rotate
+ */
+void yk__stablesort_ex(void *arr, size_t item_size, size_t elements,
+                       yk__compare_function cmp_func, void *scratch,
+                       size_t scratch_elements);
+/**
+ * Move the element that would be at nth in the sorted array there, with
+ * no larger element before it and no smaller one after it. Quick select
+ * with the same pivots and partitions as yk__quicksort, O(n) on average.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param nth position to fill, nothing is done if it is >= elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the temporary element could not be allocated
+ */
+int yk__nth_element(void *arr, size_t item_size, size_t elements, size_t nth,
+                    yk__compare_function cmp_func);
+/**
+ * Same as yk__nth_element (no malloc)
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__nth_element_ex(void *arr, size_t item_size, size_t elements,
+                        size_t nth, yk__compare_function cmp_func,
+                        void *single_elem_buffer);
+/**
+ * Sort the k smallest elements into the start of the array, the order of
+ * the others is unspecified. O(n + k log k), selects then sorts k elements.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param k number of elements to sort, the whole array if it is >= elements
+ * @param cmp_func compare function
+ * @return 0 if successful, -1 if the temporary element could not be allocated
+ */
+int yk__partial_sort(void *arr, size_t item_size, size_t elements, size_t k,
+                     yk__compare_function cmp_func);
+/**
+ * Same as yk__partial_sort (no malloc)
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__partial_sort_ex(void *arr, size_t item_size, size_t elements,
+                         size_t k, yk__compare_function cmp_func,
+                         void *single_elem_buffer);
+/**
+ * Keeps the k smallest items pushed to it in a max heap, for streams that
+ * do not fit in memory or are not known up front. Use a reversed compare
+ * function to keep the k largest.
+ */
+typedef struct yk__topk {
+  char *items;// buffer of k items, a heap until yk__topk_sort
+  size_t item_size;
+  size_t k;
+  size_t count;
+  yk__compare_function cmp_func;
+} yk__topk;
+/**
+ * Start an empty top k heap
+ * @param topk heap to initialize
+ * @param items buffer that can hold k items
+ * @param item_size single item size
+ * @param k number of items to keep
+ * @param cmp_func compare function
+ */
+void yk__topk_init(yk__topk *topk, void *items, size_t item_size, size_t k,
+                   yk__compare_function cmp_func);
+/**
+ * Offer an item, O(log k) if it is kept and one comparison if not
+ * @param topk heap
+ * @param item item to copy in
+ * @return 1 if the item is one of the k smallest so far, 0 if not
+ */
+int yk__topk_push(yk__topk *topk, const void *item);
+/**
+ * Sort the kept items in place, smallest first, and empty the heap
+ * @param topk heap
+ * @return number of items in topk->items
+ */
+size_t yk__topk_sort(yk__topk *topk);
+/**
+ * Sort indices instead of the elements, perm[i] becomes the index of the
+ * element that belongs at i. Stable, arr is not modified.
+ * Every comparison reads two elements from anywhere in arr, so on records
+ * much larger than their key this is slower than sorting the records: for
+ * 262144 records of 256 bytes argsort + yk__apply_permutation takes 100 ms
+ * against 60 ms for yk__quicksort (620 against 410 ms parsing a string key).
+ * yk__argsort_by_key keeps the keys next to the indices and takes 71 ms
+ * (85 ms), use it or yk__sort_by_key for such records.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function, called with elements of arr
+ * @param perm output, elements indices
+ * @return 0 if successful, -1 if the scratch buffer could not be allocated
+ */
+int yk__argsort(const void *arr, size_t item_size, size_t elements,
+                yk__compare_function cmp_func, size_t *perm);
+/**
+ * Same as yk__argsort (no malloc)
+ * @param scratch buffer of scratch_elements indices, see yk__stablesort_ex
+ * @param scratch_elements at least 1
+ */
+void yk__argsort_ex(const void *arr, size_t item_size, size_t elements,
+                    yk__compare_function cmp_func, size_t *perm,
+                    size_t *scratch, size_t scratch_elements);
+/**
+ * Reorder the array so element i is the one that was at perm[i], following
+ * the cycles of the permutation so every element is copied once (plus one
+ * copy per cycle through the temporary element)
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param perm permutation from yk__argsort, reset to 0, 1, 2, ... on return
+ * @param single_elem_buffer buffer for a single temporary element
+ */
+void yk__apply_permutation(void *arr, size_t item_size, size_t elements,
+                           size_t *perm, void *single_elem_buffer);
+/**
+ * Write the sort key of item to key
+ */
+typedef void (*yk__key_extract_function)(const void *item, void *key);
+/**
+ * Perform a stable sort by a key that is extracted once per element instead
+ * of on every comparison (decorate, sort, undecorate). Keys are stably
+ * sorted next to the index of their element and the records moved once
+ * with yk__apply_permutation, which suits records much larger than keys.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func extracts the key of an element
+ * @param key_size size of a key
+ * @param key_cmp_func compare function for two keys
+ * @return 0 if successful, -1 if memory for keys and indices could not be
+ *         allocated, the array is not modified then
+ */
+int yk__sort_by_key(void *arr, size_t item_size, size_t elements,
+                    yk__key_extract_function key_func, size_t key_size,
+                    yk__compare_function key_cmp_func);
+/**
+ * Same as yk__argsort, with keys extracted once per element and sorted next
+ * to their index like yk__sort_by_key, arr is not modified.
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param key_func extracts the key of an element
+ * @param key_size size of a key
+ * @param key_cmp_func compare function for two keys
+ * @param perm output, elements indices
+ * @return 0 if successful, -1 if memory for keys and indices could not be
+ *         allocated
+ */
+int yk__argsort_by_key(const void *arr, size_t item_size, size_t elements,
+                       yk__key_extract_function key_func, size_t key_size,
+                       yk__compare_function key_cmp_func, size_t *perm);
 #ifdef YK__SORT_IMPLEMENTATION
 #include <stdlib.h>// malloc
-#include <string.h>// memcpy
-#define YK__SORT_MAX_LEVELS 48
+// swaps move 16 (SSE2) or 32 (AVX) bytes at a time where possible,
+// #define YK__SORT_NO_SIMD to use the portable version
+#if !defined(YK__SORT_NO_SIMD) &&                                              \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define YK__SORT_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define YK__SORT_SIMD_AVX
+#include <immintrin.h>
+#endif
+#endif
+typedef void (*yk__swap_function)(void *, void *, size_t);
 /**
- * Swap memory between a and b of given item_size
+ * Swap memory between a and b of given item_size, in vector and word sized
+ * pieces first and byte by byte for the tail
  * @param a pointer to position a
  * @param b pointer to position b
  * @param item_size single element size
@@ -3469,6 +6615,29 @@ void yk__memswap(void *a, void *b, size_t item_size) {
   char *a_swap = (char *) a;
   char *b_swap = (char *) b;
   char *a_end = a_swap + item_size;
+#if defined(YK__SORT_SIMD_AVX)
+  for (; a_end - a_swap >= 32; a_swap += 32, b_swap += 32) {
+    __m256i x = _mm256_loadu_si256((const __m256i *) a_swap);
+    __m256i y = _mm256_loadu_si256((const __m256i *) b_swap);
+    _mm256_storeu_si256((__m256i *) a_swap, y);
+    _mm256_storeu_si256((__m256i *) b_swap, x);
+  }
+#endif
+#if defined(YK__SORT_SIMD_SSE2)
+  for (; a_end - a_swap >= 16; a_swap += 16, b_swap += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i *) a_swap);
+    __m128i y = _mm_loadu_si128((const __m128i *) b_swap);
+    _mm_storeu_si128((__m128i *) a_swap, y);
+    _mm_storeu_si128((__m128i *) b_swap, x);
+  }
+#endif
+  for (; a_end - a_swap >= 8; a_swap += 8, b_swap += 8) {
+    uint64_t x, y;
+    memcpy(&x, a_swap, 8);
+    memcpy(&y, b_swap, 8);
+    memcpy(a_swap, &y, 8);
+    memcpy(b_swap, &x, 8);
+  }
   while (a_swap < a_end) {
     char temp = *a_swap;
     *a_swap = *b_swap;
@@ -3498,64 +6667,309 @@ void yk__memswap(void *a, void *b, size_t item_size) {
  */
 #define yk__generic_get(arr, pos, item_size)                                   \
   ((void *) (((char *) arr) + ((pos) * (item_size))))
+/**
+ * Swap of a single T sized element, memcpy keeps unaligned access legal and
+ * compiles to plain loads and stores
+ */
+#define YK__SORT_DEFINE_SWAP(bytes, T)                                         \
+  static void yk__memswap_##bytes(void *a, void *b, size_t item_size) {        \
+    T x, y;                                                                    \
+    (void) item_size;                                                          \
+    memcpy(&x, a, sizeof(T));                                                  \
+    memcpy(&y, b, sizeof(T));                                                  \
+    memcpy(a, &y, sizeof(T));                                                  \
+    memcpy(b, &x, sizeof(T));                                                  \
+  }
+YK__SORT_DEFINE_SWAP(1, uint8_t)
+YK__SORT_DEFINE_SWAP(2, uint16_t)
+YK__SORT_DEFINE_SWAP(4, uint32_t)
+YK__SORT_DEFINE_SWAP(8, uint64_t)
+#if defined(YK__SORT_SIMD_SSE2)
+YK__SORT_DEFINE_SWAP(16, __m128i)
+#endif
+#if defined(YK__SORT_SIMD_AVX)
+YK__SORT_DEFINE_SWAP(32, __m256i)
+#endif
+/**
+ * Pick the swap for elements of item_size, done once per sort instead of
+ * looking at the size on every swap
+ * @param item_size single element size
+ * @return swap function
+ */
+static yk__swap_function yk__sort_swapper(size_t item_size) {
+  switch (item_size) {
+    case 1:
+      return yk__memswap_1;
+    case 2:
+      return yk__memswap_2;
+    case 4:
+      return yk__memswap_4;
+    case 8:
+      return yk__memswap_8;
+#if defined(YK__SORT_SIMD_SSE2)
+    case 16:
+      return yk__memswap_16;
+#endif
+#if defined(YK__SORT_SIMD_AVX)
+    case 32:
+      return yk__memswap_32;
+#endif
+    default:
+      return yk__memswap;
+  }
+}
+#define YK__SORT_AT(pos) yk__generic_get(arr, pos, item_size)
+#define YK__SORT_SWAP(pos1, pos2)                                              \
+  swap_func(YK__SORT_AT(pos1), YK__SORT_AT(pos2), item_size)
+#define YK__SORT_LESS(pos1, pos2)                                              \
+  (cmp_func(YK__SORT_AT(pos1), YK__SORT_AT(pos2)) < 0)
+/**
+ * Insertion sort [begin, end), each element is moved into place with a single
+ * memmove
+ * @param limit stop once more than limit elements were moved
+ * @return 1 if the range is sorted, 0 if the limit was hit
+ */
+static int yk__sort_insertion(void *arr, size_t item_size, size_t begin,
+                              size_t end, yk__compare_function cmp_func,
+                              void *tmp, size_t limit) {
+  size_t i, j, moved = 0;
+  for (i = begin + 1; i < end; i++) {
+    if (!YK__SORT_LESS(i, i - 1)) continue;
+    memcpy(tmp, YK__SORT_AT(i), item_size);
+    j = i - 1;
+    while (j > begin && cmp_func(tmp, YK__SORT_AT(j - 1)) < 0) j--;
+    memmove(YK__SORT_AT(j + 1), YK__SORT_AT(j), (i - j) * item_size);
+    memcpy(YK__SORT_AT(j), tmp, item_size);
+    moved += i - j;
+    if (moved > limit && i + 1 < end) return 0;
+  }
+  return 1;
+}
+static void yk__sort2(void *arr, size_t item_size, size_t a, size_t b,
+                      yk__compare_function cmp_func,
+                      yk__swap_function swap_func) {
+  if (YK__SORT_LESS(b, a)) YK__SORT_SWAP(a, b);
+}
+static void yk__sort3(void *arr, size_t item_size, size_t a, size_t b,
+                      size_t c, yk__compare_function cmp_func,
+                      yk__swap_function swap_func) {
+  yk__sort2(arr, item_size, a, b, cmp_func, swap_func);
+  yk__sort2(arr, item_size, b, c, cmp_func, swap_func);
+  yk__sort2(arr, item_size, a, b, cmp_func, swap_func);
+}
+/**
+ * Heap sort elements [begin, end), used when quick sort keeps picking bad
+ * pivots so the sort stays O(n log n)
+ */
+static void yk__sort_sift_down(void *arr, size_t item_size, size_t begin,
+                               size_t root, size_t n,
+                               yk__compare_function cmp_func,
+                               yk__swap_function swap_func) {
+  for (;;) {
+    size_t child = 2 * root + 1;
+    if (child >= n) return;
+    if (child + 1 < n && YK__SORT_LESS(begin + child, begin + child + 1))
+      child++;
+    if (!YK__SORT_LESS(begin + root, begin + child)) return;
+    YK__SORT_SWAP(begin + root, begin + child);
+    root = child;
+  }
+}
+static void yk__sort_sift_up(void *arr, size_t item_size, size_t pos,
+                             yk__compare_function cmp_func,
+                             yk__swap_function swap_func) {
+  while (pos > 0 && YK__SORT_LESS((pos - 1) / 2, pos)) {
+    YK__SORT_SWAP((pos - 1) / 2, pos);
+    pos = (pos - 1) / 2;
+  }
+}
+/**
+ * Sort the max heap [begin, end) by moving its top to the end n - 1 times
+ */
+static void yk__sort_sort_heap(void *arr, size_t item_size, size_t begin,
+                               size_t end, yk__compare_function cmp_func,
+                               yk__swap_function swap_func) {
+  size_t i;
+  for (i = end - begin; i > 1; i--) {
+    YK__SORT_SWAP(begin, begin + i - 1);
+    yk__sort_sift_down(arr, item_size, begin, 0, i - 1, cmp_func, swap_func);
+  }
+}
+static void yk__sort_heapsort(void *arr, size_t item_size, size_t begin,
+                              size_t end, yk__compare_function cmp_func,
+                              yk__swap_function swap_func) {
+  size_t n = end - begin, i;
+  for (i = n / 2; i > 0; i--)
+    yk__sort_sift_down(arr, item_size, begin, i - 1, n, cmp_func, swap_func);
+  yk__sort_sort_heap(arr, item_size, begin, end, cmp_func, swap_func);
+}
+/**
+ * Partition [begin, end) around the pivot at begin, elements equal to the
+ * pivot go to the right. The scans are bounded by the range, so a compare
+ * function that is not a strict weak ordering gives a wrong order instead
+ * of reading outside the array.
+ * @param already_partitioned set to 1 if no elements had to be swapped
+ * @return final position of the pivot
+ */
+static size_t yk__sort_partition_right(void *arr, size_t item_size,
+                                       size_t begin, size_t end,
+                                       yk__compare_function cmp_func,
+                                       yk__swap_function swap_func,
+                                       int *already_partitioned) {
+  size_t first = begin, last = end;
+  while (++first < end && YK__SORT_LESS(first, begin)) {}
+  if (first - 1 == begin) {
+    while (first < last && !YK__SORT_LESS(--last, begin)) {}
+  } else {
+    while (--last > begin && !YK__SORT_LESS(last, begin)) {}
+  }
+  *already_partitioned = first >= last;
+  while (first < last) {
+    YK__SORT_SWAP(first, last);
+    while (++first < end && YK__SORT_LESS(first, begin)) {}
+    while (--last > begin && !YK__SORT_LESS(last, begin)) {}
+  }
+  YK__SORT_SWAP(begin, first - 1);
+  return first - 1;
+}
+/**
+ * Partition [begin, end) around the pivot at begin, elements equal to the
+ * pivot go to the left. Used when the element before begin equals the pivot,
+ * then everything left of the returned position is equal and already sorted.
+ */
+static size_t yk__sort_partition_left(void *arr, size_t item_size,
+                                      size_t begin, size_t end,
+                                      yk__compare_function cmp_func,
+                                      yk__swap_function swap_func) {
+  size_t first = begin, last = end;
+  while (--last > begin && YK__SORT_LESS(begin, last)) {}
+  if (last + 1 == end) {
+    while (first < last && !YK__SORT_LESS(begin, ++first)) {}
+  } else {
+    while (++first < end && !YK__SORT_LESS(begin, first)) {}
+  }
+  while (first < last) {
+    YK__SORT_SWAP(first, last);
+    while (--last > begin && YK__SORT_LESS(begin, last)) {}
+    while (++first < end && !YK__SORT_LESS(begin, first)) {}
+  }
+  YK__SORT_SWAP(begin, last);
+  return last;
+}
+/**
+ * Swap a few elements of [begin, end) around after an unbalanced partition,
+ * so a pattern in the input does not keep producing bad pivots
+ */
+static void yk__sort_break_patterns(void *arr, size_t item_size, size_t begin,
+                                    size_t end, yk__swap_function swap_func) {
+  size_t size = end - begin, q = size / 4;
+  if (size < YK__SORT_INSERTION_THRESHOLD) return;
+  YK__SORT_SWAP(begin, begin + q);
+  YK__SORT_SWAP(end - 1, end - q);
+  if (size > YK__SORT_NINTHER_THRESHOLD) {
+    YK__SORT_SWAP(begin + 1, begin + (q + 1));
+    YK__SORT_SWAP(begin + 2, begin + (q + 2));
+    YK__SORT_SWAP(end - 2, end - (q + 1));
+    YK__SORT_SWAP(end - 3, end - (q + 2));
+  }
+}
+/**
+ * Move the median of 3 (or for large ranges the ninther, a median of 3
+ * medians) to begin, the elements it was picked from are left in order
+ */
+static void yk__sort_choose_pivot(void *arr, size_t item_size, size_t begin,
+                                  size_t end, yk__compare_function cmp_func,
+                                  yk__swap_function swap_func) {
+  size_t size = end - begin, s2 = size / 2;
+  if (size > YK__SORT_NINTHER_THRESHOLD) {
+    yk__sort3(arr, item_size, begin, begin + s2, end - 1, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + 1, begin + s2 - 1, end - 2, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + 2, begin + s2 + 1, end - 3, cmp_func,
+              swap_func);
+    yk__sort3(arr, item_size, begin + s2 - 1, begin + s2, begin + s2 + 1,
+              cmp_func, swap_func);
+    YK__SORT_SWAP(begin, begin + s2);
+  } else {
+    yk__sort3(arr, item_size, begin + s2, begin, end - 1, cmp_func,
+              swap_func);
+  }
+}
 int yk__quicksort_ex(void *arr, size_t item_size, size_t elements,
                      yk__compare_function cmp_func, void *single_elem_buffer) {
-  size_t beg[YK__SORT_MAX_LEVELS], end[YK__SORT_MAX_LEVELS], L, R;
-  int i = 0;
-  beg[0] = 0;
-  end[0] = elements;
-  // NOTE: You can probably change this to a some MAX_SIZE char[]
-  void *piv = single_elem_buffer;
-  while (i >= 0) {
-    L = beg[i];
-    R = end[i];
-    if (R - L > 1) {
-      size_t M = L + ((R - L) >> 1);
-      // T piv = arr[M];
-      memcpy(piv, yk__generic_get(arr, M, item_size), item_size);
-      // arr[M] = arr[L];
-      memcpy(yk__generic_get(arr, M, item_size),
-             yk__generic_get(arr, L, item_size), item_size);
-      if (i == YK__SORT_MAX_LEVELS - 1) { return -1; }
-      R--;
-      while (L < R) {
-        // while (arr[R] >= piv && L < R)
-        while (cmp_func(yk__generic_get(arr, R, item_size), piv) >= 0 &&
-               L < R) {
-          R--;
-        }
-        if (L < R) { yk__generic_swap(arr, L++, R, item_size); }
-        // while (arr[L] <= piv && L < R)
-        while (cmp_func(yk__generic_get(arr, L, item_size), piv) <= 0 &&
-               L < R) {
-          L++;
-        }
-        if (L < R) { yk__generic_swap(arr, R--, L, item_size); }
+  // pattern defeating quick sort: median of 3 or ninther pivots, insertion
+  // sort for small ranges, and heap sort once too many partitions were bad.
+  // The larger side is pushed so the stack never holds more than log2(n).
+  struct {
+    size_t begin, end;
+    int bad_allowed, leftmost;
+  } stack[YK__SORT_STACK_SIZE];
+  int top = 0, bad_allowed = 0, leftmost, already_partitioned;
+  size_t begin, end, size, pivot_pos, l_size, r_size;
+  yk__swap_function swap_func = yk__sort_swapper(item_size);
+  for (size = elements; size > 1; size >>= 1) bad_allowed++;
+  stack[0].begin = 0;
+  stack[0].end = elements;
+  stack[0].bad_allowed = bad_allowed;
+  stack[0].leftmost = 1;
+  while (top >= 0) {
+    begin = stack[top].begin;
+    end = stack[top].end;
+    bad_allowed = stack[top].bad_allowed;
+    leftmost = stack[top--].leftmost;
+    for (;;) {
+      size = end - begin;
+      if (size < YK__SORT_INSERTION_THRESHOLD) {
+        yk__sort_insertion(arr, item_size, begin, end, cmp_func,
+                           single_elem_buffer, (size_t) -1);
+        break;
       }
-      // arr[L] = piv;
-      memcpy(yk__generic_get(arr, L, item_size), piv, item_size);
-      M = L + 1;
-      // while (L > beg[i] && arr[L - 1] == piv)
-      while (L > beg[i] &&
-             cmp_func(yk__generic_get(arr, L - 1, item_size), piv) == 0) {
-        L--;
+      yk__sort_choose_pivot(arr, item_size, begin, end, cmp_func, swap_func);
+      // many elements equal to the previous pivot, skip them
+      if (!leftmost && !YK__SORT_LESS(begin - 1, begin)) {
+        begin = yk__sort_partition_left(arr, item_size, begin, end, cmp_func,
+                                        swap_func) +
+                1;
+        continue;
       }
-      // while (M < end[i] && arr[M] == piv)
-      while (M < end[i] &&
-             cmp_func(yk__generic_get(arr, M, item_size), piv) == 0) {
-        M++;
+      pivot_pos =
+          yk__sort_partition_right(arr, item_size, begin, end, cmp_func,
+                                   swap_func, &already_partitioned);
+      l_size = pivot_pos - begin;
+      r_size = end - (pivot_pos + 1);
+      if (l_size < size / 8 || r_size < size / 8) {
+        if (--bad_allowed == 0) {
+          yk__sort_heapsort(arr, item_size, begin, end, cmp_func, swap_func);
+          break;
+        }
+        yk__sort_break_patterns(arr, item_size, begin, pivot_pos, swap_func);
+        yk__sort_break_patterns(arr, item_size, pivot_pos + 1, end,
+                                swap_func);
+      } else if (already_partitioned &&
+                 yk__sort_insertion(arr, item_size, begin, pivot_pos, cmp_func,
+                                    single_elem_buffer,
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT) &&
+                 yk__sort_insertion(arr, item_size, pivot_pos + 1, end,
+                                    cmp_func, single_elem_buffer,
+                                    YK__SORT_PARTIAL_INSERTION_LIMIT)) {
+        // input was (nearly) sorted already
+        break;
       }
-      if (L - beg[i] > end[i] - M) {
-        beg[i + 1] = M;
-        end[i + 1] = end[i];
-        end[i++] = L;
+      top++;
+      if (l_size < r_size) {
+        stack[top].begin = pivot_pos + 1;
+        stack[top].end = end;
+        stack[top].leftmost = 0;
+        end = pivot_pos;
       } else {
-        beg[i + 1] = beg[i];
-        end[i + 1] = L;
-        beg[i++] = M;
+        stack[top].begin = begin;
+        stack[top].end = pivot_pos;
+        stack[top].leftmost = leftmost;
+        begin = pivot_pos + 1;
+        leftmost = 0;
       }
-    } else {
-      i--;
+      stack[top].bad_allowed = bad_allowed;
     }
   }
   return 0;
@@ -3570,6 +6984,717 @@ int yk__quicksort(void *arr, size_t item_size, size_t elements,
   free(single_elem_buffer);
   return return_value;
 }
+void yk__nth_element_ex(void *arr, size_t item_size, size_t elements,
+                        size_t nth, yk__compare_function cmp_func,
+                        void *single_elem_buffer) {
+  // yk__quicksort_ex that only continues with the side holding nth
+  int bad_allowed = 0, leftmost = 1, already_partitioned;
+  size_t begin = 0, end = elements, size, pivot_pos;
+  yk__swap_function swap_func = yk__sort_swapper(item_size);
+  if (nth >= elements) return;
+  for (size = elements; size > 1; size >>= 1) bad_allowed++;
+  for (;;) {
+    size = end - begin;
+    if (size < YK__SORT_INSERTION_THRESHOLD) {
+      yk__sort_insertion(arr, item_size, begin, end, cmp_func,
+                         single_elem_buffer, (size_t) -1);
+      return;
+    }
+    yk__sort_choose_pivot(arr, item_size, begin, end, cmp_func, swap_func);
+    if (!leftmost && !YK__SORT_LESS(begin - 1, begin)) {
+      // everything before the returned position equals the pivot
+      begin = yk__sort_partition_left(arr, item_size, begin, end, cmp_func,
+                                      swap_func) +
+              1;
+      if (nth < begin) return;
+      continue;
+    }
+    pivot_pos = yk__sort_partition_right(arr, item_size, begin, end, cmp_func,
+                                         swap_func, &already_partitioned);
+    if (pivot_pos - begin < size / 8 || end - pivot_pos - 1 < size / 8) {
+      if (--bad_allowed == 0) {
+        yk__sort_heapsort(arr, item_size, begin, end, cmp_func, swap_func);
+        return;
+      }
+      yk__sort_break_patterns(arr, item_size, begin, pivot_pos, swap_func);
+      yk__sort_break_patterns(arr, item_size, pivot_pos + 1, end, swap_func);
+    }
+    if (nth == pivot_pos) return;
+    if (nth < pivot_pos) {
+      end = pivot_pos;
+    } else {
+      begin = pivot_pos + 1;
+      leftmost = 0;
+    }
+  }
+}
+int yk__nth_element(void *arr, size_t item_size, size_t elements, size_t nth,
+                    yk__compare_function cmp_func) {
+  void *single_elem_buffer = malloc(item_size);
+  if (NULL == single_elem_buffer) return -1;
+  yk__nth_element_ex(arr, item_size, elements, nth, cmp_func,
+                     single_elem_buffer);
+  free(single_elem_buffer);
+  return 0;
+}
+void yk__partial_sort_ex(void *arr, size_t item_size, size_t elements,
+                         size_t k, yk__compare_function cmp_func,
+                         void *single_elem_buffer) {
+  if (k >= elements) {
+    yk__quicksort_ex(arr, item_size, elements, cmp_func, single_elem_buffer);
+  } else if (k > 0) {
+    // arr[k - 1] is the largest of the k, only the ones before it are left
+    yk__nth_element_ex(arr, item_size, elements, k - 1, cmp_func,
+                       single_elem_buffer);
+    yk__quicksort_ex(arr, item_size, k - 1, cmp_func, single_elem_buffer);
+  }
+}
+int yk__partial_sort(void *arr, size_t item_size, size_t elements, size_t k,
+                     yk__compare_function cmp_func) {
+  void *single_elem_buffer = malloc(item_size);
+  if (NULL == single_elem_buffer) return -1;
+  yk__partial_sort_ex(arr, item_size, elements, k, cmp_func,
+                      single_elem_buffer);
+  free(single_elem_buffer);
+  return 0;
+}
+void yk__topk_init(yk__topk *topk, void *items, size_t item_size, size_t k,
+                   yk__compare_function cmp_func) {
+  topk->items = (char *) items;
+  topk->item_size = item_size;
+  topk->k = k;
+  topk->count = 0;
+  topk->cmp_func = cmp_func;
+}
+int yk__topk_push(yk__topk *topk, const void *item) {
+  size_t item_size = topk->item_size;
+  char *arr = topk->items;
+  if (topk->count < topk->k) {
+    memcpy(YK__SORT_AT(topk->count), item, item_size);
+    yk__sort_sift_up(arr, item_size, topk->count++, topk->cmp_func,
+                     yk__sort_swapper(item_size));
+    return 1;
+  }
+  // the top is the largest item kept, anything not smaller is dropped
+  if (topk->k == 0 || topk->cmp_func(item, arr) >= 0) return 0;
+  memcpy(arr, item, item_size);
+  yk__sort_sift_down(arr, item_size, 0, 0, topk->k, topk->cmp_func,
+                     yk__sort_swapper(item_size));
+  return 1;
+}
+size_t yk__topk_sort(yk__topk *topk) {
+  size_t count = topk->count;
+  yk__sort_sort_heap(topk->items, topk->item_size, 0, count, topk->cmp_func,
+                     yk__sort_swapper(topk->item_size));
+  topk->count = 0;
+  return count;
+}
+#define YK__SORT_MIN_GALLOP 7
+#define YK__SORT_MAX_RUNS 128
+/**
+ * State of one stable sort
+ */
+typedef struct yk__stablesort_state {
+  size_t item_size;
+  yk__compare_function cmp_func;
+  yk__swap_function swap_func;
+  char *tmp;           // scratch buffer
+  size_t tmp_elements; // capacity of tmp
+  size_t min_gallop;   // lower when galloping pays off, higher when not
+  const char *items;   // argsort: elements are indices of these, or NULL
+  size_t items_size;
+} yk__stablesort_state;
+/**
+ * Compare two elements, or for an argsort the items they index
+ */
+static inline int yk__stable_cmp(yk__stablesort_state *s, const void *a,
+                                 const void *b) {
+  if (s->items == NULL) return s->cmp_func(a, b);
+  return s->cmp_func(s->items + *(const size_t *) a * s->items_size,
+                     s->items + *(const size_t *) b * s->items_size);
+}
+#define YK__STABLE_AT(base, pos) ((base) + (pos) * s->item_size)
+#define YK__STABLE_LESS(a, b) (yk__stable_cmp(s, a, b) < 0)
+/**
+ * Number of leading elements of base that are smaller than key (upper = 0)
+ * or not larger than key (upper = 1), searching 1, 3, 7, ... elements from
+ * the start and then binary
+ */
+static size_t yk__stable_gallop(yk__stablesort_state *s, const void *key,
+                                char *base, size_t n, int upper) {
+  size_t lo = 0, hi = 1;
+  while (hi <= n) {
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, hi - 1), key);
+    if (c > 0 || (!upper && c == 0)) break;
+    lo = hi;
+    hi = hi * 2 + 1;
+  }
+  if (hi > n) hi = n;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, mid), key);
+    if (c < 0 || (upper && c == 0)) lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+/**
+ * Same as yk__stable_gallop, searching from the end of base
+ */
+static size_t yk__stable_gallop_back(yk__stablesort_state *s,
+                                     const void *key, char *base, size_t n,
+                                     int upper) {
+  size_t lo, hi = n, step = 1;
+  while (step <= n) {
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, n - step), key);
+    if (c < 0 || (upper && c == 0)) break;
+    hi = n - step;
+    step = step * 2 + 1;
+  }
+  lo = step > n ? 0 : n - step + 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = yk__stable_cmp(s, YK__STABLE_AT(base, mid), key);
+    if (c < 0 || (upper && c == 0)) lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+static void yk__stable_reverse(yk__stablesort_state *s, char *base, size_t n) {
+  char *lo = base, *hi = YK__STABLE_AT(base, n);
+  while (n > 1) {
+    hi -= s->item_size;
+    s->swap_func(lo, hi, s->item_size);
+    lo += s->item_size;
+    n -= 2;
+  }
+}
+/**
+ * Binary insertion sort of base, the first sorted elements are in order
+ */
+static void yk__stable_insertion(yk__stablesort_state *s, char *base,
+                                 size_t sorted, size_t n) {
+  for (; sorted < n; sorted++) {
+    char *item = YK__STABLE_AT(base, sorted);
+    size_t lo = 0, hi = sorted;
+    if (!YK__STABLE_LESS(item, YK__STABLE_AT(base, sorted - 1))) continue;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (YK__STABLE_LESS(item, YK__STABLE_AT(base, mid))) hi = mid;
+      else
+        lo = mid + 1;
+    }
+    memcpy(s->tmp, item, s->item_size);
+    memmove(YK__STABLE_AT(base, lo + 1), YK__STABLE_AT(base, lo),
+            (sorted - lo) * s->item_size);
+    memcpy(YK__STABLE_AT(base, lo), s->tmp, s->item_size);
+  }
+}
+/**
+ * Length of the run at the start of base, a strictly descending run is
+ * reversed (there are no equal elements in it whose order could change)
+ */
+static size_t yk__stable_count_run(yk__stablesort_state *s, char *base,
+                                   size_t n) {
+  size_t end = 1;
+  if (n < 2) return n;
+  if (YK__STABLE_LESS(YK__STABLE_AT(base, 1), base)) {
+    while (end + 1 < n && YK__STABLE_LESS(YK__STABLE_AT(base, end + 1),
+                                          YK__STABLE_AT(base, end)))
+      end++;
+    yk__stable_reverse(s, base, end + 1);
+  } else {
+    while (end + 1 < n && !YK__STABLE_LESS(YK__STABLE_AT(base, end + 1),
+                                           YK__STABLE_AT(base, end)))
+      end++;
+  }
+  return end + 1;
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements), na fits
+ * the scratch buffer, the smallest element of b is smaller than a[0]
+ */
+static void yk__stable_merge_lo(yk__stablesort_state *s, char *a, size_t na,
+                                size_t nb) {
+  size_t size = s->item_size, count_a, count_b;
+  char *pa = s->tmp, *pb = YK__STABLE_AT(a, na), *dest = a;
+  char *a_end = YK__STABLE_AT(s->tmp, na), *b_end = YK__STABLE_AT(pb, nb);
+  memcpy(s->tmp, a, na * size);
+  while (pa < a_end && pb < b_end) {
+    count_a = count_b = 0;
+    // one element at a time until one run keeps winning
+    do {
+      if (YK__STABLE_LESS(pb, pa)) {
+        memcpy(dest, pb, size);
+        pb += size;
+        count_b++;
+        count_a = 0;
+      } else {
+        memcpy(dest, pa, size);
+        pa += size;
+        count_a++;
+        count_b = 0;
+      }
+      dest += size;
+    } while (pa < a_end && pb < b_end &&
+             (count_a | count_b) < s->min_gallop);
+    // then copy whole stretches found by galloping
+    while (pa < a_end && pb < b_end) {
+      count_a = yk__stable_gallop(s, pb, pa, (a_end - pa) / size, 1);
+      memcpy(dest, pa, count_a * size);
+      dest += count_a * size;
+      pa += count_a * size;
+      if (pa == a_end) break;
+      memcpy(dest, pb, size);
+      dest += size;
+      pb += size;
+      if (pb == b_end) break;
+      count_b = yk__stable_gallop(s, pa, pb, (b_end - pb) / size, 0);
+      memmove(dest, pb, count_b * size);
+      dest += count_b * size;
+      pb += count_b * size;
+      if (pb == b_end) break;
+      memcpy(dest, pa, size);
+      dest += size;
+      pa += size;
+      if (s->min_gallop > 1) s->min_gallop--;
+      if (count_a < YK__SORT_MIN_GALLOP && count_b < YK__SORT_MIN_GALLOP) {
+        s->min_gallop += 2;
+        break;
+      }
+    }
+  }
+  // what is left of b is already in place
+  memcpy(dest, pa, a_end - pa);
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements) from the
+ * end, nb fits the scratch buffer, the largest element of a is larger than
+ * the last one of b
+ */
+static void yk__stable_merge_hi(yk__stablesort_state *s, char *a, size_t na,
+                                size_t nb) {
+  size_t size = s->item_size, count_a, count_b;
+  char *b = YK__STABLE_AT(a, na);
+  // one past the last element left in a and b, and where the next one goes
+  char *pa = b, *pb = YK__STABLE_AT(s->tmp, nb), *dest = YK__STABLE_AT(b, nb);
+  memcpy(s->tmp, b, nb * size);
+  while (pa > a && pb > s->tmp) {
+    count_a = count_b = 0;
+    do {
+      dest -= size;
+      if (YK__STABLE_LESS(pb - size, pa - size)) {
+        pa -= size;
+        memcpy(dest, pa, size);
+        count_a++;
+        count_b = 0;
+      } else {
+        pb -= size;
+        memcpy(dest, pb, size);
+        count_b++;
+        count_a = 0;
+      }
+    } while (pa > a && pb > s->tmp && (count_a | count_b) < s->min_gallop);
+    while (pa > a && pb > s->tmp) {
+      size_t left = (pa - a) / size;
+      count_a = left - yk__stable_gallop_back(s, pb - size, a, left, 1);
+      dest -= count_a * size;
+      pa -= count_a * size;
+      memmove(dest, pa, count_a * size);
+      if (pa == a) break;
+      dest -= size;
+      pb -= size;
+      memcpy(dest, pb, size);
+      if (pb == s->tmp) break;
+      left = (pb - s->tmp) / size;
+      count_b = left - yk__stable_gallop_back(s, pa - size, s->tmp, left, 0);
+      dest -= count_b * size;
+      pb -= count_b * size;
+      memcpy(dest, pb, count_b * size);
+      if (pb == s->tmp) break;
+      dest -= size;
+      pa -= size;
+      memcpy(dest, pa, size);
+      if (s->min_gallop > 1) s->min_gallop--;
+      if (count_a < YK__SORT_MIN_GALLOP && count_b < YK__SORT_MIN_GALLOP) {
+        s->min_gallop += 2;
+        break;
+      }
+    }
+  }
+  // what is left of a is already in place
+  memcpy(a, s->tmp, pb - s->tmp);
+}
+/**
+ * Merge runs a (na elements) and the one after it (nb elements), rotating
+ * pieces of them around while neither fits the scratch buffer
+ */
+static void yk__stable_merge(yk__stablesort_state *s, char *a, size_t na,
+                             size_t nb) {
+  size_t skip;
+  while (na > 0 && nb > 0) {
+    size_t ma, mb;
+    // elements of a that are not larger than b[0] are in place already, so
+    // are elements of b not smaller than the last one of a
+    skip = yk__stable_gallop(s, YK__STABLE_AT(a, na), a, na, 1);
+    a = YK__STABLE_AT(a, skip);
+    na -= skip;
+    if (na == 0) return;
+    nb = yk__stable_gallop_back(s, YK__STABLE_AT(a, na - 1),
+                                YK__STABLE_AT(a, na), nb, 0);
+    if (nb == 0) return;
+    if (na <= nb && na <= s->tmp_elements) {
+      yk__stable_merge_lo(s, a, na, nb);
+      return;
+    }
+    if (nb <= s->tmp_elements) {
+      yk__stable_merge_hi(s, a, na, nb);
+      return;
+    }
+    // a[ma] stays before the elements of b that are not smaller than it
+    if (na >= nb) {
+      ma = na / 2;
+      mb = yk__stable_gallop(s, YK__STABLE_AT(a, ma), YK__STABLE_AT(a, na),
+                             nb, 0);
+    } else {
+      mb = nb / 2;
+      ma = yk__stable_gallop(s, YK__STABLE_AT(a, na + mb), a, na, 1);
+    }
+    // rotate a[ma, na) b[0, mb) into b[0, mb) a[ma, na)
+    yk__stable_reverse(s, YK__STABLE_AT(a, ma), na - ma);
+    yk__stable_reverse(s, YK__STABLE_AT(a, na), mb);
+    yk__stable_reverse(s, YK__STABLE_AT(a, ma), na - ma + mb);
+    // merge the smaller half now and the other one in the next iteration
+    if (ma + mb < (na - ma) + (nb - mb)) {
+      yk__stable_merge(s, a, ma, mb);
+      a = YK__STABLE_AT(a, ma + mb);
+      na -= ma;
+      nb -= mb;
+    } else {
+      yk__stable_merge(s, YK__STABLE_AT(a, ma + mb), na - ma, nb - mb);
+      na = ma;
+      nb = mb;
+    }
+  }
+}
+static void yk__stable_init(yk__stablesort_state *s, size_t item_size,
+                            yk__compare_function cmp_func, void *scratch,
+                            size_t scratch_elements) {
+  s->item_size = item_size;
+  s->cmp_func = cmp_func;
+  s->swap_func = yk__sort_swapper(item_size);
+  s->tmp = (char *) scratch;
+  s->tmp_elements = scratch_elements;
+  s->min_gallop = YK__SORT_MIN_GALLOP;
+  s->items = NULL;
+  s->items_size = 0;
+}
+static void yk__stable_sort(yk__stablesort_state *s, char *base,
+                            size_t elements) {
+  size_t run_start[YK__SORT_MAX_RUNS], run_length[YK__SORT_MAX_RUNS];
+  size_t runs = 0, lo = 0, min_run = elements, r = 0;
+  // runs shorter than min_run are extended with insertion sort, min_run is
+  // picked so elements / min_run is a power of two or just below one
+  while (min_run >= 64) {
+    r |= min_run & 1;
+    min_run >>= 1;
+  }
+  min_run += r;
+  while (lo < elements) {
+    size_t n = yk__stable_count_run(s, YK__STABLE_AT(base, lo),
+                                    elements - lo);
+    if (n < min_run) {
+      size_t forced = elements - lo < min_run ? elements - lo : min_run;
+      yk__stable_insertion(s, YK__STABLE_AT(base, lo), n, forced);
+      n = forced;
+    }
+    run_start[runs] = lo;
+    run_length[runs++] = n;
+    lo += n;
+    // keep run lengths growing faster than fibonacci from the top of the
+    // stack down, so there are at most YK__SORT_MAX_RUNS of them
+    while (runs > 1) {
+      size_t k = runs - 2;
+      if ((k > 0 && run_length[k - 1] <= run_length[k] + run_length[k + 1]) ||
+          (k > 1 && run_length[k - 2] <= run_length[k - 1] + run_length[k])) {
+        if (run_length[k - 1] < run_length[k + 1]) k--;
+      } else if (lo < elements && run_length[k] > run_length[k + 1]) {
+        break;// the last runs are merged once there are no more
+      }
+      yk__stable_merge(s, YK__STABLE_AT(base, run_start[k]), run_length[k],
+                       run_length[k + 1]);
+      run_length[k] += run_length[k + 1];
+      if (k + 2 < runs) {
+        run_start[k + 1] = run_start[k + 2];
+        run_length[k + 1] = run_length[k + 2];
+      }
+      runs--;
+    }
+  }
+}
+void yk__stablesort_ex(void *arr, size_t item_size, size_t elements,
+                       yk__compare_function cmp_func, void *scratch,
+                       size_t scratch_elements) {
+  yk__stablesort_state state;
+  yk__stable_init(&state, item_size, cmp_func, scratch, scratch_elements);
+  yk__stable_sort(&state, (char *) arr, elements);
+}
+int yk__stablesort(void *arr, size_t item_size, size_t elements,
+                   yk__compare_function cmp_func) {
+  size_t scratch_elements = elements / 2 + 1;
+  void *scratch = malloc(scratch_elements * item_size);
+  if (scratch == NULL) return -1;
+  yk__stablesort_ex(arr, item_size, elements, cmp_func, scratch,
+                    scratch_elements);
+  free(scratch);
+  return 0;
+}
+void yk__argsort_ex(const void *arr, size_t item_size, size_t elements,
+                    yk__compare_function cmp_func, size_t *perm,
+                    size_t *scratch, size_t scratch_elements) {
+  yk__stablesort_state state;
+  size_t i;
+  for (i = 0; i < elements; i++) perm[i] = i;
+  yk__stable_init(&state, sizeof(size_t), cmp_func, scratch,
+                  scratch_elements);
+  state.items = (const char *) arr;
+  state.items_size = item_size;
+  yk__stable_sort(&state, (char *) perm, elements);
+}
+int yk__argsort(const void *arr, size_t item_size, size_t elements,
+                yk__compare_function cmp_func, size_t *perm) {
+  size_t scratch_elements = elements / 2 + 1;
+  size_t *scratch = malloc(scratch_elements * sizeof(size_t));
+  if (scratch == NULL) return -1;
+  yk__argsort_ex(arr, item_size, elements, cmp_func, perm, scratch,
+                 scratch_elements);
+  free(scratch);
+  return 0;
+}
+void yk__apply_permutation(void *arr, size_t item_size, size_t elements,
+                           size_t *perm, void *single_elem_buffer) {
+  size_t i, j, k;
+  for (i = 0; i < elements; i++) {
+    if (perm[i] == i) continue;
+    // walk the cycle through i, pulling each element into the hole left by
+    // the previous one, and mark the positions that are done
+    memcpy(single_elem_buffer, YK__SORT_AT(i), item_size);
+    for (j = i; (k = perm[j]) != i; j = k) {
+      memcpy(YK__SORT_AT(j), YK__SORT_AT(k), item_size);
+      perm[j] = j;
+    }
+    memcpy(YK__SORT_AT(j), single_elem_buffer, item_size);
+    perm[j] = j;
+  }
+}
+// each key is followed by the index of its element, so the sort compares
+// and moves small contiguous pairs, key_cmp_func sees the key at the start
+#define YK__SORT_KEY_BYTES(key_size)                                           \
+  (((key_size) + sizeof(size_t) - 1) / sizeof(size_t) * sizeof(size_t))
+/**
+ * Stably sort the (key, index) pairs of arr in pairs, using scratch of
+ * elements / 2 + 1 pairs, and write the indices to perm (can be scratch)
+ */
+static void yk__sort_key_pairs(const void *arr, size_t item_size,
+                               size_t elements,
+                               yk__key_extract_function key_func,
+                               size_t key_size,
+                               yk__compare_function key_cmp_func, char *pairs,
+                               char *scratch, size_t *perm) {
+  size_t key_bytes = YK__SORT_KEY_BYTES(key_size);
+  size_t pair_size = key_bytes + sizeof(size_t), i;
+  yk__stablesort_state state;
+  for (i = 0; i < elements; i++) {
+    char *pair = pairs + i * pair_size;
+    key_func(YK__SORT_AT(i), pair);
+    memcpy(pair + key_bytes, &i, sizeof(size_t));
+  }
+  yk__stable_init(&state, pair_size, key_cmp_func, scratch, elements / 2 + 1);
+  yk__stable_sort(&state, pairs, elements);
+  for (i = 0; i < elements; i++)
+    memcpy(&perm[i], pairs + i * pair_size + key_bytes, sizeof(size_t));
+}
+int yk__argsort_by_key(const void *arr, size_t item_size, size_t elements,
+                       yk__key_extract_function key_func, size_t key_size,
+                       yk__compare_function key_cmp_func, size_t *perm) {
+  size_t pair_size = YK__SORT_KEY_BYTES(key_size) + sizeof(size_t);
+  char *pairs = malloc((elements + elements / 2 + 1) * pair_size);
+  if (pairs == NULL) return -1;
+  yk__sort_key_pairs(arr, item_size, elements, key_func, key_size,
+                     key_cmp_func, pairs, pairs + elements * pair_size, perm);
+  free(pairs);
+  return 0;
+}
+int yk__sort_by_key(void *arr, size_t item_size, size_t elements,
+                    yk__key_extract_function key_func, size_t key_size,
+                    yk__compare_function key_cmp_func) {
+  size_t pair_size = YK__SORT_KEY_BYTES(key_size) + sizeof(size_t);
+  size_t scratch_elements = elements / 2 + 1;
+  // pairs, then the sort scratch (reused for the permutation, a pair is at
+  // least two indices) and the temporary record
+  char *pairs = malloc((elements + scratch_elements) * pair_size + item_size);
+  char *scratch;
+  if (pairs == NULL) return -1;
+  scratch = pairs + elements * pair_size;
+  yk__sort_key_pairs(arr, item_size, elements, key_func, key_size,
+                     key_cmp_func, pairs, scratch, (size_t *) scratch);
+  yk__apply_permutation(arr, item_size, elements, (size_t *) scratch,
+                        scratch + scratch_elements * pair_size);
+  free(pairs);
+  return 0;
+}
+#undef YK__SORT_KEY_BYTES
+#undef YK__STABLE_AT
+#undef YK__STABLE_LESS
+YK__SORT_DEFINE_TYPED(yk__sort_i8, int8_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i16, int16_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i32, int32_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_i64, int64_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u8, uint8_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u16, uint16_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u32, uint32_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_u64, uint64_t, YK__SORT_NUMBER_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_f32, float, YK__SORT_FLOAT_LESS, )
+YK__SORT_DEFINE_TYPED(yk__sort_f64, double, YK__SORT_FLOAT_LESS, )
+#define YK__SORT_RADIX_KEY(x) (x)
+#define YK__SORT_DEFINE_RADIX(name, T, key_bytes, to_key)                      \
+  void name##_ex(T *arr, size_t elements, T *scratch) {                        \
+    size_t count[key_bytes][256], i, b, offset;                                \
+    T *from = arr, *to = scratch, *t;                                          \
+    memset(count, 0, sizeof(count));                                           \
+    for (i = 0; i < elements; i++) {                                           \
+      uint64_t key = to_key(arr[i]);                                           \
+      for (b = 0; b < key_bytes; b++) count[b][(key >> (8 * b)) & 255]++;      \
+    }                                                                          \
+    for (b = 0; b < key_bytes && elements > 0; b++) {                          \
+      size_t *c = count[b];                                                    \
+      if (c[(to_key(arr[0]) >> (8 * b)) & 255] == elements) continue;          \
+      for (i = 0, offset = 0; i < 256; i++) {                                  \
+        size_t n = c[i];                                                       \
+        c[i] = offset;                                                         \
+        offset += n;                                                           \
+      }                                                                        \
+      for (i = 0; i < elements; i++)                                           \
+        to[c[(to_key(from[i]) >> (8 * b)) & 255]++] = from[i];                 \
+      t = from;                                                                \
+      from = to;                                                               \
+      to = t;                                                                  \
+    }                                                                          \
+    if (from != arr) memcpy(arr, from, elements * sizeof(T));                  \
+  }                                                                            \
+  int name(T *arr, size_t elements) {                                          \
+    T *scratch = (T *) malloc(elements * sizeof(T) + 1);                       \
+    if (scratch == NULL) return -1;                                            \
+    name##_ex(arr, elements, scratch);                                         \
+    free(scratch);                                                             \
+    return 0;                                                                  \
+  }
+YK__SORT_DEFINE_RADIX(yk__radixsort_u32, uint32_t, 4, YK__SORT_RADIX_KEY)
+YK__SORT_DEFINE_RADIX(yk__radixsort_u64, uint64_t, 8, YK__SORT_RADIX_KEY)
+YK__SORT_DEFINE_RADIX(yk__radixsort_i64, int64_t, 8, yk__radix_key_i64)
+YK__SORT_DEFINE_RADIX(yk__radixsort_f64, double, 8, yk__radix_key_f64)
+void yk__radixsort_key_ex(void *arr, size_t item_size, size_t elements,
+                          yk__radix_key_function key_func, void *scratch) {
+  size_t count[8][256], i, b, offset;
+  char *from = (char *) arr, *to = (char *) scratch, *t;
+  uint64_t first;
+  memset(count, 0, sizeof(count));
+  for (i = 0; i < elements; i++) {
+    uint64_t key = key_func(from + i * item_size);
+    for (b = 0; b < 8; b++) count[b][(key >> (8 * b)) & 255]++;
+  }
+  if (elements == 0) return;
+  first = key_func(arr);
+  for (b = 0; b < 8; b++) {
+    size_t *c = count[b];
+    if (c[(first >> (8 * b)) & 255] == elements) continue;
+    for (i = 0, offset = 0; i < 256; i++) {
+      size_t n = c[i];
+      c[i] = offset;
+      offset += n;
+    }
+    for (i = 0; i < elements; i++) {
+      char *item = from + i * item_size;
+      memcpy(to + c[(key_func(item) >> (8 * b)) & 255]++ * item_size, item,
+             item_size);
+    }
+    t = from;
+    from = to;
+    to = t;
+  }
+  if (from != (char *) arr) memcpy(arr, from, elements * item_size);
+}
+int yk__radixsort_key(void *arr, size_t item_size, size_t elements,
+                      yk__radix_key_function key_func) {
+  void *scratch = malloc(elements * item_size + 1);
+  if (scratch == NULL) return -1;
+  yk__radixsort_key_ex(arr, item_size, elements, key_func, scratch);
+  free(scratch);
+  return 0;
+}
+#define YK__SORT_SDS_LESS(a, b) (yk__sdscmp(a, b) < 0)
+#define YK__SORT_SDS_THRESHOLD 64
+YK__SORT_DEFINE_TYPED(yk__sort_sds, yk__sds, YK__SORT_SDS_LESS,
+                      static inline)
+int yk__radixsort_sds(yk__sds *arr, size_t elements) {
+  // buckets still to sort, they never overlap and hold 2 or more strings
+  struct yk__sort_sds_bucket {
+    size_t begin, end, depth;
+  } *stack;
+  size_t count[257], i, top = 0;
+  yk__sds *scratch = (yk__sds *) malloc(elements * sizeof(yk__sds) + 1);
+  uint16_t *digits = (uint16_t *) malloc(elements * sizeof(uint16_t) + 1);
+  stack = (struct yk__sort_sds_bucket *) malloc(
+      (elements / 2 + 1) * sizeof(struct yk__sort_sds_bucket));
+  if (scratch == NULL || digits == NULL || stack == NULL) {
+    free(scratch);
+    free(digits);
+    free(stack);
+    return -1;
+  }
+  stack[0].begin = 0;
+  stack[0].end = elements;
+  stack[0].depth = 0;
+  if (elements > 1) top = 1;
+  while (top > 0) {
+    size_t begin = stack[--top].begin, end = stack[top].end;
+    size_t depth = stack[top].depth, offset;
+    if (end - begin < YK__SORT_SDS_THRESHOLD) {
+      yk__sort_sds(arr + begin, end - begin);
+      continue;
+    }
+    // digit 0 is the end of the string, so shorter strings come first
+    memset(count, 0, sizeof(count));
+    for (i = begin; i < end; i++) {
+      yk__sds s = arr[i];
+      digits[i] = yk__sdslen(s) > depth ? (unsigned char) s[depth] + 1 : 0;
+      count[digits[i]]++;
+    }
+    for (i = 0, offset = begin; i < 257; i++) {
+      size_t n = count[i];
+      count[i] = offset;
+      offset += n;
+    }
+    for (i = begin; i < end; i++) scratch[count[digits[i]]++] = arr[i];
+    memcpy(arr + begin, scratch + begin, (end - begin) * sizeof(yk__sds));
+    // count[i] is now the end of bucket i, strings in bucket 0 are equal
+    for (i = 1; i < 257; i++) {
+      if (count[i] - count[i - 1] < 2) continue;
+      stack[top].begin = count[i - 1];
+      stack[top].end = count[i];
+      stack[top++].depth = depth + 1;
+    }
+  }
+  free(scratch);
+  free(digits);
+  free(stack);
+  return 0;
+}
+#undef YK__SORT_AT
+#undef YK__SORT_SWAP
+#undef YK__SORT_LESS
 #endif
 #endif
 #include <stdbool.h>
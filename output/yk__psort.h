@@ -0,0 +1,259 @@
+/**
+Parallel sample sort on top of yk__sort and yk__thread as a single file header by Bhathiya Perera
+
+MIT License
+Copyright (c) 2022 Bhathiya Perera
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+// ======================================================================= //
+//                               Notes                                     //
+// ======================================================================= //
+
+A sorted sample of the input picks splitters that cut the value range into
+a few buckets per thread. Every thread then finds the bucket of each element
+of its slice of the input, and after a prefix sum over the counts copies them
+into their buckets in a scratch array. Finally the threads take buckets from
+a shared counter, sort each one with yk__quicksort_ex and copy it back. The
+buckets are already in order, so nothing has to be merged.
+
+Elements equal to a run of equal splitters are spread over the buckets
+between them, so many duplicates of one value do not end up in one bucket.
+
+Each of the three steps starts its threads and joins them, the calling
+thread works too. If a thread can not be created its share runs on the
+calling thread, and if the scratch memory can not be allocated the input
+is sorted with yk__quicksort, so the array is always sorted.
+
+Include yk__lib.h and yk__thread.h before this file, and define
+YK__PSORT_IMPLEMENTATION in one file to get the implementation
+(YK__SORT_IMPLEMENTATION must be defined in one file too).
+*/
+#ifndef YK__PSORT
+#define YK__PSORT
+#include <stddef.h>
+#ifndef YK__PSORT_THREADS
+#define YK__PSORT_THREADS 4
+#endif
+#ifndef YK__PSORT_MIN_ELEMENTS
+#define YK__PSORT_MIN_ELEMENTS 16384// per thread, smaller inputs use less
+#endif
+#define YK__PSORT_MAX_THREADS 256
+/**
+ * Perform a parallel sort for given array, not stable
+ * @param arr array
+ * @param item_size single item size
+ * @param elements number of elements
+ * @param cmp_func compare function, called from many threads at once
+ * @param threads number of threads including the calling one, 0 for
+ *                YK__PSORT_THREADS, fewer are used for small inputs and
+ *                below 2 * YK__PSORT_MIN_ELEMENTS the sort is sequential
+ * @return 0 if successful, -1 if a sequential sort could not allocate its
+ *         temporary element
+ */
+int yk__psort(void *arr, size_t item_size, size_t elements,
+              yk__compare_function cmp_func, int threads);
+#ifdef YK__PSORT_IMPLEMENTATION
+#include <stdint.h>
+#include <stdlib.h>// malloc
+#include <string.h>// memcpy
+#define YK__PSORT_BUCKETS_PER_THREAD 4
+#define YK__PSORT_OVERSAMPLING 32
+/**
+ * State shared by the threads of one sort
+ */
+typedef struct yk__psort_job {
+  char *arr;
+  char *scratch;    // elements, grouped by bucket
+  char *splitters;  // buckets - 1 sorted elements
+  char *tmp;        // one element for each thread
+  uint16_t *bucket; // bucket of each element
+  size_t *counts;   // threads x buckets, then where each thread copies to
+  size_t *starts;   // first element of each bucket, and the end
+  size_t item_size;
+  size_t elements;
+  size_t buckets;
+  int threads;
+  yk__compare_function cmp_func;
+  yk__thread_atomic_int_t next_bucket;
+} yk__psort_job;
+typedef struct yk__psort_worker {
+  yk__psort_job *job;
+  int id;
+} yk__psort_worker;
+#define yk__psort_at(base, pos) ((base) + (pos) * job->item_size)
+// first and last element of the slice of thread 'id'
+#define yk__psort_slice_begin(id) (job->elements * (size_t) (id) / job->threads)
+#define yk__psort_slice_end(id)                                                \
+  (job->elements * (size_t) ((id) + 1) / job->threads)
+/**
+ * Number of splitters that are smaller (or_equal = 0) or not larger
+ * (or_equal = 1) than item
+ */
+static size_t yk__psort_search(yk__psort_job *job, const void *item,
+                               int or_equal) {
+  size_t lo = 0, hi = job->buckets - 1;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    int c = job->cmp_func(yk__psort_at(job->splitters, mid), item);
+    if (c < 0 || (or_equal && c == 0)) lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+static int yk__psort_classify(void *user_data) {
+  yk__psort_worker *w = (yk__psort_worker *) user_data;
+  yk__psort_job *job = w->job;
+  size_t *counts = job->counts + (size_t) w->id * job->buckets;
+  size_t i, end = yk__psort_slice_end(w->id);
+  for (i = yk__psort_slice_begin(w->id); i < end; i++) {
+    const void *item = yk__psort_at(job->arr, i);
+    size_t lo = yk__psort_search(job, item, 1), hi;
+    if (lo > 0 &&
+        job->cmp_func(yk__psort_at(job->splitters, lo - 1), item) == 0) {
+      // equal to splitters [hi, lo), any bucket from hi to lo keeps order
+      hi = lo;
+      lo = yk__psort_search(job, item, 0);
+      lo += i % (hi - lo + 1);
+    }
+    job->bucket[i] = (uint16_t) lo;
+    counts[lo]++;
+  }
+  return 0;
+}
+static int yk__psort_scatter(void *user_data) {
+  yk__psort_worker *w = (yk__psort_worker *) user_data;
+  yk__psort_job *job = w->job;
+  size_t *offsets = job->counts + (size_t) w->id * job->buckets;
+  size_t i, end = yk__psort_slice_end(w->id);
+  for (i = yk__psort_slice_begin(w->id); i < end; i++) {
+    memcpy(yk__psort_at(job->scratch, offsets[job->bucket[i]]++),
+           yk__psort_at(job->arr, i), job->item_size);
+  }
+  return 0;
+}
+static int yk__psort_sort_buckets(void *user_data) {
+  yk__psort_worker *w = (yk__psort_worker *) user_data;
+  yk__psort_job *job = w->job;
+  void *tmp = yk__psort_at(job->tmp, (size_t) w->id);
+  for (;;) {
+    size_t b = (size_t) yk__thread_atomic_int_inc(&job->next_bucket);
+    size_t begin, size;
+    if (b >= job->buckets) return 0;
+    begin = job->starts[b];
+    size = job->starts[b + 1] - begin;
+    yk__quicksort_ex(yk__psort_at(job->scratch, begin), job->item_size, size,
+                     job->cmp_func, tmp);
+    memcpy(yk__psort_at(job->arr, begin), yk__psort_at(job->scratch, begin),
+           size * job->item_size);
+  }
+}
+/**
+ * Run proc on every thread of the job and wait for all of them
+ */
+static void yk__psort_run(yk__psort_job *job, int (*proc)(void *)) {
+  yk__psort_worker workers[YK__PSORT_MAX_THREADS];
+  yk__thread_ptr_t ids[YK__PSORT_MAX_THREADS];
+  int i;
+  for (i = 0; i < job->threads; i++) {
+    workers[i].job = job;
+    workers[i].id = i;
+  }
+  for (i = 1; i < job->threads; i++) {
+    ids[i] = yk__thread_create(proc, &workers[i], "yk__psort",
+                               YK__THREAD_STACK_SIZE_DEFAULT);
+    if (ids[i] == NULL) proc(&workers[i]);
+  }
+  proc(&workers[0]);
+  for (i = 1; i < job->threads; i++) {
+    if (ids[i] == NULL) continue;
+    yk__thread_join(ids[i]);
+    yk__thread_destroy(ids[i]);
+  }
+}
+int yk__psort(void *arr, size_t item_size, size_t elements,
+              yk__compare_function cmp_func, int threads) {
+  yk__psort_job job_data, *job = &job_data;
+  size_t samples, stride, i, b, pos;
+  char *sample;
+  if (threads <= 0) threads = YK__PSORT_THREADS;
+  if (threads > YK__PSORT_MAX_THREADS) threads = YK__PSORT_MAX_THREADS;
+  if ((size_t) threads > elements / YK__PSORT_MIN_ELEMENTS)
+    threads = (int) (elements / YK__PSORT_MIN_ELEMENTS);
+  if (threads < 2) return yk__quicksort(arr, item_size, elements, cmp_func);
+  memset(job, 0, sizeof(yk__psort_job));
+  job->arr = (char *) arr;
+  job->item_size = item_size;
+  job->elements = elements;
+  job->threads = threads;
+  job->cmp_func = cmp_func;
+  job->buckets = (size_t) threads * YK__PSORT_BUCKETS_PER_THREAD;
+  samples = job->buckets * YK__PSORT_OVERSAMPLING;
+  stride = elements / samples;
+  job->scratch = malloc(elements * item_size);
+  job->bucket = malloc(elements * sizeof(uint16_t));
+  job->counts = calloc((size_t) threads * job->buckets, sizeof(size_t));
+  job->starts = malloc((job->buckets + 1) * sizeof(size_t));
+  sample = malloc((samples + job->buckets + threads) * item_size);
+  if (job->scratch == NULL || job->bucket == NULL || job->counts == NULL ||
+      job->starts == NULL || sample == NULL) {
+    free(job->scratch);
+    free(job->bucket);
+    free(job->counts);
+    free(job->starts);
+    free(sample);
+    return yk__quicksort(arr, item_size, elements, cmp_func);
+  }
+  job->splitters = sample + samples * item_size;
+  job->tmp = job->splitters + job->buckets * item_size;
+  // evenly spaced sample, every YK__PSORT_OVERSAMPLING-th one is a splitter
+  for (i = 0; i < samples; i++) {
+    memcpy(yk__psort_at(sample, i),
+           yk__psort_at(job->arr, i * stride + stride / 2), item_size);
+  }
+  yk__quicksort_ex(sample, item_size, samples, cmp_func, job->tmp);
+  for (b = 1; b < job->buckets; b++) {
+    memcpy(yk__psort_at(job->splitters, b - 1),
+           yk__psort_at(sample, b * YK__PSORT_OVERSAMPLING), item_size);
+  }
+  yk__psort_run(job, yk__psort_classify);
+  // counts of thread t for bucket b become where t copies its first one to
+  for (b = 0, pos = 0; b < job->buckets; b++) {
+    job->starts[b] = pos;
+    for (i = 0; i < (size_t) threads; i++) {
+      size_t *c = &job->counts[i * job->buckets + b];
+      size_t n = *c;
+      *c = pos;
+      pos += n;
+    }
+  }
+  job->starts[job->buckets] = pos;
+  yk__psort_run(job, yk__psort_scatter);
+  yk__thread_atomic_int_store(&job->next_bucket, 0);
+  yk__psort_run(job, yk__psort_sort_buckets);
+  free(job->scratch);
+  free(job->bucket);
+  free(job->counts);
+  free(job->starts);
+  free(sample);
+  return 0;
+}
+#endif
+#endif
@@ -0,0 +1,152 @@
+// Concurrent hash map test, followed by a 90% read / 10% write throughput
+// comparison against one stb_ds hashmap behind a single mutex
+// run with any argument to also run the benchmark
+#define _GNU_SOURCE// pthread_setname_np used by yk__thread
+#include <errno.h>
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#define YK__THREAD_IMPLEMENTATION
+#define YK__CHASHMAP_IMPLEMENTATION
+#include "yk__lib.h"
+#include "yk__thread.h"
+#include "yk__chashmap.h"
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#define THREADS 4
+#define KEYS 20000
+#define OPS 1000000
+typedef struct {
+  yk__chashmap *map;
+  int id;
+} worker;
+static int writer_proc(void *user_data) {
+  worker *w = (worker *) user_data;
+  for (int i = 0; i < KEYS; i++) {
+    long long key = (long long) w->id * KEYS + i, value = key * 2;
+    yk__chmput(w->map, key, value);
+  }
+  for (int i = 0; i < KEYS; i += 2) {
+    long long key = (long long) w->id * KEYS + i, value;
+    assert(yk__chmget(w->map, key, value) && value == key * 2);
+    assert(yk__chmdel(w->map, key));
+  }
+  return 0;
+}
+static void test_threads(void) {
+  yk__chashmap map;
+  yk__thread_ptr_t threads[THREADS];
+  worker workers[THREADS];
+  assert(yk__chashmap_init(&map, 0, sizeof(long long), sizeof(long long)) ==
+         0);
+  assert((size_t) map.shards % YK__CHASHMAP_CACHE_LINE_SIZE == 0);
+  for (int t = 0; t < THREADS; t++) {
+    workers[t].map = &map;
+    workers[t].id = t;
+    threads[t] = yk__thread_create(writer_proc, &workers[t], "writer",
+                                   YK__THREAD_STACK_SIZE_DEFAULT);
+  }
+  for (int t = 0; t < THREADS; t++) {
+    yk__thread_join(threads[t]);
+    yk__thread_destroy(threads[t]);
+  }
+  assert(yk__chmlen(&map) == THREADS * KEYS / 2);
+  for (long long key = 0; key < THREADS * KEYS; key++) {
+    long long value = -1;
+    int found = yk__chmget(&map, key, value);
+    assert(key % 2 ? found && value == key * 2 : !found && value == -1);
+  }
+  yk__chashmap_free(&map);
+}
+static void test_strings(void) {
+  yk__chashmap map;
+  yk__sds key = yk__sdsnew("hello");
+  int value = 1, out = 0;
+  assert(yk__chashmap_init_str(&map, 4, sizeof(int)) == 0);
+  yk__chmput(&map, key, value);
+  key[0] = 'j';// the map has its own copy
+  assert(!yk__chmget(&map, key, out));
+  key[0] = 'h';
+  assert(yk__chmget(&map, key, out) && out == 1);
+  assert(yk__chmdel(&map, key) && !yk__chmdel(&map, key));
+  yk__chashmap_free(&map);
+  yk__sdsfree(key);
+}
+// ---- 90/10 benchmark ----
+typedef struct {
+  long long key;
+  long long value;
+} entry;
+typedef struct {
+  yk__chashmap *map;
+  yk__thread_mutex_t *lock;
+  entry **locked;
+  unsigned int seed;
+} bench_worker;
+static int bench_proc(void *user_data) {
+  bench_worker *w = (bench_worker *) user_data;
+  long long sum = 0;
+  for (int i = 0; i < OPS; i++) {
+    w->seed = w->seed * 1103515245u + 12345u;
+    long long key = (w->seed >> 8) % (KEYS * 4), value = key;
+    int write = (w->seed & 0xff) < 26;
+    if (w->map) {
+      if (write) yk__chmput(w->map, key, value);
+      else if (yk__chmget(w->map, key, value))
+        sum += value;
+    } else {
+      yk__thread_mutex_lock(w->lock);
+      if (write) yk__hmput(*w->locked, key, value);
+      else
+        sum += yk__hmget(*w->locked, key);
+      yk__thread_mutex_unlock(w->lock);
+    }
+  }
+  return (int) (sum & 1);
+}
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static double bench(int threads, int sharded) {
+  yk__chashmap map;
+  yk__thread_mutex_t lock;
+  entry *locked = NULL;
+  bench_worker workers[8];
+  yk__thread_ptr_t ids[8];
+  yk__chashmap_init(&map, 0, sizeof(long long), sizeof(long long));
+  yk__thread_mutex_init(&lock);
+  double t = now();
+  for (int i = 0; i < threads; i++) {
+    workers[i].map = sharded ? &map : NULL;
+    workers[i].lock = &lock;
+    workers[i].locked = &locked;
+    workers[i].seed = i * 7919 + 1;
+    ids[i] = yk__thread_create(bench_proc, &workers[i], "bench",
+                               YK__THREAD_STACK_SIZE_DEFAULT);
+  }
+  for (int i = 0; i < threads; i++) {
+    yk__thread_join(ids[i]);
+    yk__thread_destroy(ids[i]);
+  }
+  t = now() - t;
+  yk__thread_mutex_term(&lock);
+  yk__hmfree(locked);
+  yk__chashmap_free(&map);
+  return threads * (double) OPS / t / 1e6;
+}
+int main(int argc, char **argv) {
+  (void) argv;// only the argument count turns on the benchmark
+  test_strings();
+  test_threads();
+  printf("chashmap_test done\n");
+  if (argc > 1) {
+    printf("threads  mutex Mops/s  sharded Mops/s\n");
+    for (int threads = 1; threads <= 8; threads *= 2)
+      printf("%7d  %12.2f  %14.2f\n", threads, bench(threads, 0),
+             bench(threads, 1));
+  }
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Parallel sort test, followed by a scaling benchmark from 1 to 8 threads
+// against the sequential yk__quicksort
+// run with any argument to also run the benchmark
+#define _GNU_SOURCE// pthread_setname_np used by yk__thread
+#include <errno.h>
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#define YK__SORT_IMPLEMENTATION
+#define YK__THREAD_IMPLEMENTATION
+#define YK__PSORT_IMPLEMENTATION
+#include "yk__lib.h"
+#include "yk__thread.h"
+#include "yk__psort.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define ELEMENTS ((size_t) 1 << 24)
+typedef struct {
+  long long key;
+  char payload[24];
+} record;
+static int compare_int(const void *a, const void *b) {
+  int x = *((const int *) a), y = *((const int *) b);
+  return (x > y) - (x < y);
+}
+static int compare_record(const void *a, const void *b) {
+  long long x = ((const record *) a)->key, y = ((const record *) b)->key;
+  return (x > y) - (x < y);
+}
+static void fill(int *x, size_t n, int pattern) {
+  for (size_t i = 0; i < n; i++) {
+    switch (pattern) {
+      case 0: x[i] = rand(); break;
+      case 1: x[i] = (int) i; break;
+      case 2: x[i] = (int) (n - i); break;
+      case 3: x[i] = rand() % 3; break;
+      default: x[i] = 7; break;
+    }
+  }
+}
+static void test_ints(void) {
+  size_t sizes[] = {0, 1, 1000, 2 * YK__PSORT_MIN_ELEMENTS - 1,
+                    2 * YK__PSORT_MIN_ELEMENTS, 300000};
+  int *x = malloc(sizeof(int) * 300000);
+  for (int s = 0; s < 6; s++) {
+    for (int p = 0; p < 5; p++) {
+      for (int threads = 0; threads <= 8; threads += 3) {
+        size_t n = sizes[s];
+        long long sum = 0;
+        fill(x, n, p);
+        for (size_t i = 0; i < n; i++) sum += x[i];
+        assert(yk__psort(x, sizeof(int), n, compare_int, threads) == 0);
+        for (size_t i = 0; i < n; i++) sum -= x[i];
+        for (size_t i = 1; i < n; i++) assert(x[i - 1] <= x[i]);
+        assert(sum == 0);
+      }
+    }
+  }
+  free(x);
+}
+static void test_records(void) {
+  size_t n = 200000;
+  record *r = malloc(sizeof(record) * n);
+  for (size_t i = 0; i < n; i++) {
+    r[i].key = (long long) rand() * rand();
+    sprintf(r[i].payload, "%lld", r[i].key);
+  }
+  assert(yk__psort(r, sizeof(record), n, compare_record, 5) == 0);
+  for (size_t i = 0; i < n; i++) {
+    assert(i == 0 || r[i - 1].key <= r[i].key);
+    assert(atoll(r[i].payload) == r[i].key);
+  }
+  free(r);
+}
+// ---- scaling benchmark ----
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static double bench(int *x, int threads) {
+  double t;
+  srand(1);
+  fill(x, ELEMENTS, 0);
+  t = now();
+  if (threads == 0) yk__quicksort(x, sizeof(int), ELEMENTS, compare_int);
+  else
+    yk__psort(x, sizeof(int), ELEMENTS, compare_int, threads);
+  t = now() - t;
+  for (size_t i = 1; i < ELEMENTS; i++) assert(x[i - 1] <= x[i]);
+  return t * 1e3;
+}
+int main(int argc, char **argv) {
+  (void) argv;// only the argument count turns on the benchmark
+  test_ints();
+  test_records();
+  printf("psort_test done\n");
+  if (argc > 1) {
+    int *x = malloc(sizeof(int) * ELEMENTS);
+    double sequential = bench(x, 0);
+    printf("%zu ints, yk__quicksort %.1f ms\n", ELEMENTS, sequential);
+    printf("threads  yk__psort ms  speedup\n");
+    for (int threads = 1; threads <= 8; threads *= 2) {
+      double t = bench(x, threads);
+      printf("%7d  %12.1f  %7.2f\n", threads, t, sequential / t);
+    }
+    free(x);
+  }
+  return 0;
+}
@@ -0,0 +1,118 @@
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#include "yk__lib.h"
+#include <assert.h>
+#include <stdio.h>
+static int count_growths(int policy, size_t target) {
+  char piece[4096];
+  int growths = 0;
+  yk__sds s = yk__sdssetgrowth(yk__sdsempty(), policy);
+  size_t alloc = yk__sdsalloc(s);
+  memset(piece, 'x', sizeof(piece));
+  while (yk__sdslen(s) < target) {
+    s = yk__sdscatlen(s, piece, sizeof(piece));
+    if (yk__sdsalloc(s) != alloc) {
+      alloc = yk__sdsalloc(s);
+      growths++;
+    }
+  }
+  assert(yk__sdsgetgrowth(s) == policy);
+  yk__sdsfree(s);
+  return growths;
+}
+int main(void) {
+  // Growth policies
+  size_t target = 32 * 1024 * 1024;
+  int def = count_growths(YK__SDS_GROW_DEFAULT, target);
+  int geo = count_growths(YK__SDS_GROW_GEOMETRIC, target);
+  int chunk = count_growths(YK__SDS_GROW_CHUNK, target);
+  printf("growths for 32MB: default=%d geometric=%d chunk=%d\n", def, geo,
+         chunk);
+  assert(geo < def);
+  assert(geo <= 20);
+  // Type 5 strings are converted so they can remember the policy
+  yk__sds small = yk__sdsnew("abc");
+  small = yk__sdssetgrowth(small, YK__SDS_GROW_EXACT);
+  assert(yk__sdsgetgrowth(small) == YK__SDS_GROW_EXACT);
+  small = yk__sdscatlen(small, "de", 2);
+  assert(yk__sdsalloc(small) == 5 && memcmp(small, "abcde", 6) == 0);
+  small = yk__sdsRemoveFreeSpace(small);
+  assert(yk__sdsgetgrowth(small) == YK__SDS_GROW_EXACT);
+  yk__sdsfree(small);
+  // Scatter / gather appends
+  const void *parts[] = {"hello", " ", "wor\0ld"};
+  size_t lens[] = {5, 1, 6};
+  yk__sds v = yk__sdscatv(yk__sdsnew(">"), parts, lens, 3);
+  assert(yk__sdslen(v) == 13 && memcmp(v, ">hello wor\0ld", 14) == 0);
+  yk__sds pieces[] = {yk__sdsnew("a"), yk__sdsnew("bc"), yk__sdsempty()};
+  v = yk__sdscatsdsv(v, pieces, 3);
+  assert(yk__sdslen(v) == 16 && memcmp(v + 13, "abc", 4) == 0);
+  yk__sdsfree(v);
+  v = yk__sdsjoinsds(pieces, 3, ", ", 2);
+  assert(yk__sdslen(v) == 7 && memcmp(v, "a, bc, ", 8) == 0);
+  yk__sdsfree(v);
+  for (int i = 0; i < 3; i++) yk__sdsfree(pieces[i]);
+  // Cached hash
+  yk__sds plain = yk__sdsnew("Key");
+  yk__sds h = yk__sdsnewhashed("Key", 3);
+  assert(!(h[-1] & YK__SDS_HASH_VALID));
+  assert(yk__sdshash(h) == yk__sdshash(plain));
+  assert(h[-1] & YK__SDS_HASH_VALID);
+  h = yk__sdscat(h, "s");
+  assert(!(h[-1] & YK__SDS_HASH_VALID));
+  plain = yk__sdscat(plain, "s");
+  assert(yk__sdshash(h) == yk__sdshash(plain));
+  yk__sdstolower(h);
+  yk__sdstolower(plain);
+  assert(yk__sdshash(h) == yk__sdshash(plain));
+  yk__sdsrange(h, 1, -1);
+  assert(yk__sdslen(h) == 3 && yk__sdshash(h) != yk__sdshash(plain));
+  yk__sds hd = yk__sdsdup(h);
+  assert((hd[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED);
+  h = yk__sdsgrowzero(h, 1000);
+  assert((h[-1] & YK__SDS_TYPE_MASK) == YK__SDS_TYPE_HASHED);
+  assert(yk__sdslen(h) == 1000 && memcmp(h, "eys", 3) == 0);
+  yk__sdsfree(hd);
+  yk__sdsfree(h);
+  yk__sdsfree(plain);
+  // Streaming repr / splitargs
+  const char blob[] = "a\"b\\\n\x01\xff";
+  size_t rl = yk__sdsreprlen(blob, 7);
+  yk__sds r = yk__sdscatrepr(yk__sdsnew(">"), blob, 7);
+  assert(yk__sdslen(r) == rl + 1);
+  assert(strcmp(r, ">\"a\\\"b\\\\\\n\\x01\\xff\"") == 0);
+  int argc;
+  yk__sds *args = yk__sdssplitargs(r + 1, &argc);
+  assert(argc == 1 && yk__sdslen(args[0]) == 7);
+  assert(memcmp(args[0], blob, 7) == 0);
+  yk__sdsfreesplitres(args, argc);
+  const char *line = " set 'it\\'s' \"x\\ty\" plain ";
+  char buf[64];
+  char *argv[2];
+  size_t alens[2];
+  assert(yk__sdssplitargsbuf(line, buf, argv, alens, 2) == 4);
+  assert(strcmp(argv[0], "set") == 0 && alens[1] == 4);
+  assert(strcmp(argv[1], "it's") == 0);
+  assert(yk__sdssplitargsbuf("\"open", buf, argv, alens, 2) == -1);
+  assert(yk__sdssplitargs("\"a\"b", &argc) == NULL && argc == 0);
+  yk__sdsfree(r);
+  // Copies into caller memory
+  char mem[2048];
+  size_t used = 0;
+  yk__sds originals[] = {yk__sdsnewlen("a\0b", 3),
+                         yk__sdsgrowzero(yk__sdsempty(), 300),
+                         yk__sdsnewhashed("hashed", 6), yk__sdsempty()};
+  yk__sdshash(originals[2]);
+  for (int i = 0; i < 4; i++) {
+    yk__sds c = yk__sdsdupat(mem + used, originals[i]);
+    used += yk__sdsdupsize(originals[i]);
+    assert(c + yk__sdslen(c) + 1 == mem + used);
+    assert(yk__sdscmp(c, originals[i]) == 0 && yk__sdsavail(c) == 0);
+    if (i == 2) assert(c[-1] & YK__SDS_HASH_VALID);// hash was copied
+    assert(yk__sdshash(c) == yk__sdshash(originals[i]));
+    yk__sdsfree(originals[i]);
+  }
+  printf("sds_patched_test done\n");
+  return 0;
+}
@@ -0,0 +1,87 @@
+#define YK__SDS_IMPLEMENTATION
+#define YK__SDSROPE_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#include "yk__lib.h"
+#include <assert.h>
+#include <stdio.h>
+#include <unistd.h>
+int main(void) {
+  yk__sdsrope r;
+  yk__sdsrope_init(&r);
+  // many small appends end up in a few chunks
+  yk__sds expected = yk__sdsempty();
+  for (int i = 0; i < 10000; i++) {
+    char buf[32];
+    int n = snprintf(buf, sizeof(buf), "line %d\n", i);
+    assert(yk__sdsrope_append(&r, buf, n) == 0);
+    expected = yk__sdscatlen(expected, buf, n);
+  }
+  assert(yk__sdsrope_len(&r) == yk__sdslen(expected));
+  assert(yk__sdsrope_chunk_count(&r) <=
+         yk__sdslen(expected) / YK__SDSROPE_CHUNK_SIZE + 1);
+  // prepend, insert in the middle of a chunk and at a chunk boundary
+  assert(yk__sdsrope_prepend(&r, "<<", 2) == 0);
+  yk__sds t = yk__sdscatsds(yk__sdsnew("<<"), expected);
+  yk__sdsfree(expected);
+  expected = t;
+  assert(yk__sdsrope_insert(&r, 5, "[mid]", 5) == 0);
+  t = yk__sdsnewlen(expected, 5);
+  t = yk__sdscat(t, "[mid]");
+  t = yk__sdscatlen(t, expected + 5, yk__sdslen(expected) - 5);
+  yk__sdsfree(expected);
+  expected = t;
+  size_t boundary = yk__sdslen(yk__sdsrope_chunk(&r, 0));
+  assert(yk__sdsrope_insert(&r, boundary, "|", 1) == 0);
+  t = yk__sdsnewlen(expected, boundary);
+  t = yk__sdscat(t, "|");
+  t = yk__sdscatlen(t, expected + boundary, yk__sdslen(expected) - boundary);
+  yk__sdsfree(expected);
+  expected = t;
+  // adopted chunks are not copied
+  yk__sds big = yk__sdsnew(" the end");
+  assert(yk__sdsrope_adopt(&r, big) == 0);
+  assert(yk__sdsrope_chunk(&r, yk__sdsrope_chunk_count(&r) - 1) == big);
+  expected = yk__sdscat(expected, " the end");
+  yk__sds flat = yk__sdsrope_flatten(&r);
+  assert(yk__sdscmp(flat, expected) == 0);
+  // write a small rope (fits in the pipe buffer) with writev
+  yk__sdsrope small;
+  yk__sdsrope_init(&small);
+  yk__sdsrope_append(&small, "world", 5);
+  yk__sdsrope_prepend(&small, "hello ", 6);
+  yk__sdsrope_insert(&small, 5, ",", 1);
+  int fds[2];
+  assert(pipe(fds) == 0);
+  assert(yk__sdsrope_write(&small, fds[1]) == 0);
+  char buf[32] = {0};
+  assert(read(fds[0], buf, sizeof(buf)) == 12);
+  assert(memcmp(buf, "hello, world", 12) == 0);
+  close(fds[0]);
+  close(fds[1]);
+  printf("rope: %zu bytes in %zu chunks\n", yk__sdsrope_len(&r),
+         yk__sdsrope_chunk_count(&r));
+  yk__sdsfree(flat);
+  yk__sdsfree(expected);
+  yk__sdsrope_free(&r);
+  yk__sdsrope_free(&small);
+  // small prepends and boundary inserts share chunks
+  yk__sdsrope_init(&r);
+  for (int i = 0; i < 10000; i++) {
+    char piece[2] = {(char) ('a' + i % 26), '.'};
+    assert(yk__sdsrope_prepend(&r, piece, 2) == 0);
+  }
+  assert(yk__sdsrope_chunk_count(&r) <= 20000 / YK__SDSROPE_CHUNK_SIZE + 1);
+  boundary = yk__sdslen(yk__sdsrope_chunk(&r, 0));
+  size_t chunks = yk__sdsrope_chunk_count(&r);
+  for (int i = 0; i < 100; i++)
+    assert(yk__sdsrope_insert(&r, boundary, "|", 1) == 0);
+  assert(yk__sdsrope_chunk_count(&r) <= chunks + 1);
+  flat = yk__sdsrope_flatten(&r);
+  assert(yk__sdslen(flat) == 20100);
+  assert(flat[0] == 'a' + 9999 % 26 && flat[1] == '.' && flat[20099] == '.');
+  assert(flat[boundary] == '|' && flat[boundary + 99] == '|');
+  yk__sdsfree(flat);
+  yk__sdsrope_free(&r);
+  return 0;
+}
@@ -0,0 +1,349 @@
+// Hash map lookup benchmark at different load factors, hash function
+// quality / throughput on a few key distributions, insert latency with
+// and without incremental rehashing, presized builds, batched lookups and
+// snapshot loading, specialized YK__DEFINE_HASHMAP maps and their struct of
+// arrays variant, sets against maps with a dummy value, probe lengths are
+// reported with yk__hmstats
+// Build with -DYK__STBDS_NO_SIMD to compare with scalar bucket probing
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#define YK__STBDS_SNAPSHOTS
+#include "yk__lib.h"
+#include <assert.h>
+#include <stdio.h>
+#include <time.h>
+#define SLOTS (1 << 16)
+#define LOOKUPS 4000000
+#define KEYS (1 << 16)
+#define SEED 0x31415926
+#define INSERTS ((size_t) 1 << 22)
+#define BIG_MAP ((size_t) 1 << 23)
+typedef struct {
+  size_t key;
+  size_t value;
+} entry;
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+// rebuild the index of 'map' with 'slots' slots to get an exact load factor,
+// growing would never let the table be fuller than 75%
+static void set_slot_count(entry *map, size_t slots) {
+  void *raw = YK__STBDS_HASH_TO_ARR(map, sizeof(entry));
+  yk__stbds_hash_index *old = yk__stbds_hash_table(raw);
+  old->incremental = 0;// copy now, do not migrate during the lookups
+  yk__stbds_header(raw)->hash_table = yk__stbds_make_hash_index(slots, old);
+  YK__STBDS_FREE(NULL, old);
+}
+static double bench_lookups(entry *map, size_t n, size_t offset) {
+  size_t sum = 0, k = 0;
+  double t = now();
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    k += 7919;
+    if (k >= n) k -= n;
+    sum += yk__hmget(map, k * 2654435761u + offset);
+  }
+  t = now() - t;
+  if (sum == 42) printf(" ");
+  return t * 1e9 / LOOKUPS;
+}
+// string hash used before yk__sdshash switched to wyhash
+static size_t rotate_add_hash(void *p, size_t len, size_t seed) {
+  unsigned char *d = (unsigned char *) p;
+  size_t hash = seed;
+  for (size_t i = 0; i < len; i++)
+    hash = ((hash << 9) | (hash >> (sizeof(size_t) * 8 - 9))) + d[i];
+  return yk__stbds_hash_bytes(&hash, sizeof(hash), seed);
+}
+typedef struct {
+  const char *name;
+  size_t (*hash)(void *p, size_t len, size_t seed);
+} hash_func;
+static const hash_func hash_funcs[] = {
+    {"default", yk__stbds_hash_bytes},
+    {"rotate-add", rotate_add_hash},
+    {"wyhash", yk__stbds_hash_bytes_fast},
+    {"siphash-2-4", yk__stbds_hash_bytes_siphash}};
+// chi-squared of the low bits of the hashes over KEYS buckets, divided by
+// KEYS, should be close to 1.0 for a good hash, bigger means more collisions
+static double bucket_chi2(yk__sds *keys, size_t (*hash)(void *, size_t, size_t)) {
+  static unsigned int counts[KEYS];
+  double chi2 = 0;
+  memset(counts, 0, sizeof(counts));
+  for (int i = 0; i < KEYS; i++)
+    counts[hash(keys[i], yk__sdslen(keys[i]), SEED) & (KEYS - 1)]++;
+  for (int i = 0; i < KEYS; i++) chi2 += (counts[i] - 1.0) * (counts[i] - 1.0);
+  return chi2 / KEYS;
+}
+static double hash_mb_per_s(yk__sds *keys, size_t (*hash)(void *, size_t, size_t)) {
+  size_t sum = 0, bytes = 0;
+  double t = now();
+  for (int r = 0; r < 20; r++)
+    for (int i = 0; i < KEYS; i++) {
+      sum += hash(keys[i], yk__sdslen(keys[i]), SEED);
+      bytes += yk__sdslen(keys[i]);
+    }
+  t = now() - t;
+  if (sum == 42) printf(" ");
+  return bytes / t / 1e6;
+}
+static void bench_hashes(void) {
+  const char *names[] = {"8 byte ints", "identifiers", "urls", "1KB blobs"};
+  yk__sds *keys = malloc(sizeof(yk__sds) * KEYS);
+  printf("keys          hash          chi2/n     MB/s\n");
+  for (int kind = 0; kind < 4; kind++) {
+    for (int i = 0; i < KEYS; i++) {
+      size_t v = (size_t) i << 8;
+      if (kind == 0) keys[i] = yk__sdsnewlen(&v, sizeof(v));
+      else if (kind == 1)
+        keys[i] = yk__sdscatprintf(yk__sdsempty(), "key_%d", i);
+      else if (kind == 2)
+        keys[i] = yk__sdscatprintf(yk__sdsempty(),
+                                   "https://example.com/item/%d?page=%d",
+                                   i * 37, i % 10);
+      else {
+        keys[i] = yk__sdsgrowzero(yk__sdsempty(), 1024);
+        memcpy(keys[i] + (i % 1000), &v, sizeof(v));
+      }
+    }
+    for (size_t f = 0; f < sizeof(hash_funcs) / sizeof(hash_funcs[0]); f++)
+      printf("%-13s %-13s %6.3f %8.0f\n", names[kind], hash_funcs[f].name,
+             bucket_chi2(keys, hash_funcs[f].hash),
+             hash_mb_per_s(keys, hash_funcs[f].hash));
+    for (int i = 0; i < KEYS; i++) yk__sdsfree(keys[i]);
+  }
+  free(keys);
+}
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+// worst case single insert latency, a resize copies the whole index at once
+// unless the map is incremental
+static void bench_insert_latency(void) {
+  static double times[INSERTS];
+  printf("incremental  p99 ns  p99.9 ns     max ns\n");
+  for (int incremental = 0; incremental < 2; incremental++) {
+    entry *map = NULL;
+    yk__hm_set_incremental(map, incremental);
+    for (size_t i = 0; i < INSERTS; i++) {
+      double t = now();
+      yk__hmput(map, i * 2654435761u, i);
+      times[i] = (now() - t) * 1e9;
+    }
+    qsort(times, INSERTS, sizeof(double), compare_double);
+    printf("%11d  %6.0f  %8.0f  %9.0f\n", incremental,
+           times[INSERTS * 99 / 100], times[INSERTS * 999 / 1000],
+           times[INSERTS - 1]);
+    yk__hmfree(map);
+  }
+}
+// building a map of known size, growing from empty or reserved up front
+static void bench_build(void) {
+  entry *items = malloc(sizeof(entry) * INSERTS);
+  for (size_t i = 0; i < INSERTS; i++) {
+    items[i].key = i * 2654435761u;
+    items[i].value = i;
+  }
+  printf("build          ns/insert\n");
+  for (int kind = 0; kind < 3; kind++) {
+    entry *map = NULL;
+    double t = now();
+    if (kind == 2) yk__hmputs_array(map, items, INSERTS);
+    else {
+      if (kind == 1) yk__hmreserve(map, INSERTS);
+      for (size_t i = 0; i < INSERTS; i++) yk__hmputs(map, items[i]);
+    }
+    t = now() - t;
+    printf("%-13s  %9.1f\n",
+           kind == 0 ? "grow" : kind == 1 ? "hmreserve" : "hmputs_array",
+           t * 1e9 / INSERTS);
+    yk__hmfree(map);
+  }
+  free(items);
+}
+// random lookups in a map bigger than the last level cache, one at a time
+// and in batches that prefetch the buckets and entries
+static void bench_batch(void) {
+  enum { BATCH = 64 };
+  entry *map = NULL;
+  size_t *keys = malloc(sizeof(size_t) * LOOKUPS);
+  ptrdiff_t out[BATCH];
+  size_t sum = 0, k = 0;
+  yk__hmreserve(map, BIG_MAP);
+  for (size_t i = 0; i < BIG_MAP; i++) yk__hmput(map, i * 2654435761u, i);
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    k = (k + 1000003) % (BIG_MAP * 2);// every other key is a miss
+    keys[i] = k * 2654435761u;
+  }
+  double t = now();
+  for (size_t i = 0; i < LOOKUPS; i++) sum += yk__hmget(map, keys[i]);
+  double single = now() - t;
+  t = now();
+  for (size_t i = 0; i < LOOKUPS; i += BATCH) {
+    yk__hmget_batch(map, keys + i, BATCH, out);
+    for (int j = 0; j < BATCH; j++) sum -= map[out[j]].value;
+  }
+  double batch = now() - t;
+  printf("%zu entries   hmget %.1f ns/op   hmget_batch %.1f ns/op\n",
+         (size_t) BIG_MAP, single * 1e9 / LOOKUPS, batch * 1e9 / LOOKUPS);
+  assert(sum == 0);
+  free(keys);
+  yk__hmfree(map);
+}
+YK__DEFINE_HASHMAP(sizemap, size_t, size_t, yk__stbds_hash_size_t,
+                   yk__stbds_equal)
+// generic yk__hmput / yk__hmget compared to the inlined hash and compare of a
+// generated map with the same keys, hash and index
+static void bench_typed(void) {
+  entry *map = NULL;
+  sizemap_entry *typed = NULL;
+  size_t sum = 0, k = 0;
+  double t = now();
+  for (size_t i = 0; i < KEYS; i++) yk__hmput(map, i * 2654435761u, i);
+  double put = now() - t;
+  t = now();
+  for (size_t i = 0; i < KEYS; i++) sizemap_put(&typed, i * 2654435761u, i);
+  double typed_put = now() - t;
+  t = now();
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    k += 7919;
+    if (k >= KEYS) k -= KEYS;
+    sum += yk__hmget(map, k * 2654435761u);
+  }
+  double get = now() - t;
+  k = 0;
+  t = now();
+  for (size_t i = 0; i < LOOKUPS; i++) {
+    k += 7919;
+    if (k >= KEYS) k -= KEYS;
+    sum -= sizemap_get(typed, k * 2654435761u);
+  }
+  double typed_get = now() - t;
+  assert(sum == 0);
+  printf("%d entries   ns/op   hmput %.1f  typed put %.1f   hmget %.1f  "
+         "typed get %.1f\n",
+         KEYS, put * 1e9 / KEYS, typed_put * 1e9 / KEYS, get * 1e9 / LOOKUPS,
+         typed_get * 1e9 / LOOKUPS);
+  yk__hmfree(map);
+  yk__hmfree(typed);
+}
+typedef struct {
+  double v[8];
+} wide;
+YK__DEFINE_HASHMAP(widemap, size_t, wide, yk__stbds_hash_size_t,
+                   yk__stbds_equal)
+YK__DEFINE_HASHMAP_SOA(widesoa, size_t, wide, yk__stbds_hash_size_t,
+                       yk__stbds_equal)
+// 8 byte keys with 64 byte values stored together or in parallel arrays,
+// lookups that only need the index and a scan over all values
+static void bench_soa(void) {
+  widemap_entry *aos = NULL;
+  widesoa soa = {0};
+  wide w = {{0}};
+  ptrdiff_t found = 0;
+  double sum = 0;
+  for (size_t i = 0; i < BIG_MAP; i++) {
+    w.v[0] = (double) i;
+    widemap_put(&aos, i * 2654435761u, w);
+    widesoa_put(&soa, i * 2654435761u, w);
+  }
+  printf("%zu x 64 byte values   geti ns/op   value scan ns/entry\n",
+         (size_t) BIG_MAP);
+  for (int layout = 0; layout < 2; layout++) {
+    size_t k = 0;
+    double t = now();
+    for (size_t i = 0; i < LOOKUPS; i++) {
+      k = (k + 1000003) % (BIG_MAP * 2);// every other key is a miss
+      found += layout ? widesoa_geti(&soa, k * 2654435761u)
+                      : widemap_geti(aos, k * 2654435761u);
+    }
+    double lookup = now() - t;
+    t = now();
+    for (int r = 0; r < 10; r++) {
+      if (layout)
+        for (ptrdiff_t i = 0; i < widesoa_len(&soa); i++)
+          sum += soa.values[i].v[0];
+      else
+        for (ptrdiff_t i = 0; i < yk__hmlen(aos); i++) sum += aos[i].value.v[0];
+    }
+    double scan = now() - t;
+    printf("%-20s  %10.1f  %19.2f\n", layout ? "struct of arrays" : "entries",
+           lookup * 1e9 / LOOKUPS, scan * 1e9 / 10 / BIG_MAP);
+  }
+  if (sum == 42 || found == 42) printf(" ");
+  yk__hmfree(aos);
+  widesoa_free(&soa);
+}
+// deduplicating keys that repeat 4 times on average into a set and into a
+// hashmap with an unused 1 byte value, which pads every entry to 16 bytes
+static void bench_set(void) {
+  struct {
+    size_t key;
+    char value;
+  } *map = NULL;
+  size_t *set = NULL;
+  printf("dedup of %zu keys   ns/insert   entry bytes\n", (size_t) INSERTS);
+  double t = now();
+  for (size_t i = 0; i < INSERTS; i++)
+    yk__hmput(map, (i * 7919) % (INSERTS / 4), 1);
+  double hm = now() - t;
+  t = now();
+  for (size_t i = 0; i < INSERTS; i++)
+    yk__setput(set, (i * 7919) % (INSERTS / 4));
+  double st = now() - t;
+  assert(yk__setlen(set) == INSERTS / 4 && yk__hmlen(map) == INSERTS / 4);
+  printf("%-17s  %10.1f  %12zu\n", "hashmap", hm * 1e9 / INSERTS,
+         yk__arrcap(map - 1) * sizeof(*map));
+  printf("%-17s  %10.1f  %12zu\n", "set", st * 1e9 / INSERTS,
+         yk__arrcap(set - 1) * sizeof(*set));
+  yk__hmfree(map);
+  yk__setfree(set);
+}
+// warm start from a snapshot compared to inserting everything again
+static void bench_snapshot(void) {
+  entry *map = NULL, *loaded = NULL;
+  const char *path = "stb_ds_bench.snapshot";
+  size_t sum = 0;
+  double t = now();
+  for (size_t i = 0; i < INSERTS; i++) yk__hmput(map, i * 2654435761u, i);
+  double build = now() - t;
+  assert(yk__hmsave(map, path) == 0);
+  t = now();
+  yk__hmload(loaded, path);
+  for (size_t i = 0; i < 1000; i++) sum += yk__hmget(loaded, i * 2654435761u);
+  double load = now() - t;
+  assert(sum == 999 * 1000 / 2);
+  printf("%zu entries   build %.1f ms   hmload + 1000 lookups %.3f ms\n",
+         (size_t) INSERTS, build * 1e3, load * 1e3);
+  yk__hmunload(loaded);
+  yk__hmfree(map);
+  remove(path);
+}
+int main(void) {
+  bench_hashes();
+  bench_typed();
+  bench_soa();
+  bench_set();
+  bench_snapshot();
+  bench_batch();
+  bench_insert_latency();
+  bench_build();
+  printf("load  hit ns/op  miss ns/op  avg probe  max probe\n");
+  for (int load = 10; load <= 90; load += 10) {
+    entry *map = NULL;
+    size_t n = (size_t) SLOTS * load / 100;
+    for (size_t i = 0; i < n; i++) yk__hmput(map, i * 2654435761u, i);
+    set_slot_count(map, SLOTS);
+    double hit = bench_lookups(map, n, 0);
+    double miss = bench_lookups(map, n, 1);
+    yk__stbds_hmstats_t stats;
+    yk__hmstats(map, &stats);
+    printf("%3d%%  %10.1f  %10.1f  %9.2f  %9zu\n", load, hit, miss,
+           stats.avg_probe, stats.max_probe);
+    yk__hmfree(map);
+  }
+  return 0;
+}
@@ -0,0 +1,613 @@
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#define YK__STBDS_SNAPSHOTS
+#include "yk__lib.h"
+#include <assert.h>
+#include <stdio.h>
+static void test_intern(void) {
+  yk__stbds_intern_pool pool = {0};
+  yk__sds b = yk__sdsnew("b");
+  yk__sds a1 = yk__intern(&pool, "a", 1);
+  yk__sds a2 = yk__intern(&pool, "a", 1);
+  yk__sds b1 = yk__intern_sds(&pool, b);
+  assert(a1 == a2);
+  assert(b1 != b && yk__sdscmp(b1, b) == 0);
+  assert(yk__intern_find(&pool, b) == b1);
+  assert(yk__intern(&pool, "l\0\0t", 4) != yk__intern(&pool, "l", 1));
+  assert(yk__intern_count(&pool) == 4);
+  // interned keys are stored and looked up by pointer
+  struct {
+    yk__sds key;
+    int value;
+  } *map = NULL;
+  yk__sh_new_intern(map);
+  char name[32];
+  for (int i = 0; i < 1000; i++) {
+    int n = snprintf(name, sizeof(name), "key-%d", i);
+    yk__shput(map, yk__intern(&pool, name, n), i);
+  }
+  yk__shput(map, a1, -1);
+  assert(yk__shlen(map) == 1001);
+  assert(yk__shget(map, a2) == -1);
+  assert(map[yk__shgeti(map, a1)].key == a1);
+  assert(yk__shget(map, yk__intern(&pool, "key-500", 7)) == 500);
+  assert(yk__shgeti(map, b) == -1);// same content, not the canonical pointer
+  yk__shdel(map, yk__intern(&pool, "key-10", 6));
+  assert(yk__shgeti(map, yk__intern(&pool, "key-10", 6)) == -1);
+  assert(yk__shget(map, yk__intern(&pool, "key-999", 7)) == 999);
+  yk__sds batch[2] = {yk__intern(&pool, "key-7", 5), b};
+  ptrdiff_t found[2];
+  yk__shget_batch(map, batch, 2, found);
+  assert(map[found[0]].value == 7 && found[1] == -1);
+  yk__shfree(map);
+  yk__intern_free(&pool);
+  yk__sdsfree(b);
+}
+static void test_hashed_keys(void) {
+  struct {
+    yk__sds key;
+    int value;
+  } *map = NULL;
+  yk__sh_new_strdup(map);
+  yk__sds plain = yk__sdsnew("a rather long key that is slow to hash");
+  yk__sds hashed = yk__sdsnewhashed(plain, yk__sdslen(plain));
+  yk__shput(map, plain, 1);
+  assert(yk__shget(map, hashed) == 1);
+  assert(hashed[-1] & YK__SDS_HASH_VALID);
+  yk__shput(map, hashed, 2);
+  assert(yk__shlen(map) == 1 && yk__shget(map, plain) == 2);
+  hashed = yk__sdscat(hashed, "!");
+  assert(yk__shgeti(map, hashed) == -1);
+  yk__shfree(map);
+  yk__sdsfree(plain);
+  yk__sdsfree(hashed);
+}
+static void test_int_map(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL;
+  for (int i = 0; i < 20000; i++) yk__hmput(map, i * 7, i);
+  for (int i = 0; i < 20000; i += 2) assert(yk__hmdel(map, i * 7));
+  assert(yk__hmlen(map) == 10000);
+  for (int i = 0; i < 20000; i++) {
+    ptrdiff_t at = yk__hmgeti(map, i * 7);
+    assert(i % 2 ? map[at].value == i : at == -1);
+    assert(yk__hmgeti(map, i * 7 + 1) == -1);
+  }
+  yk__hmfree(map);
+}
+static void test_incremental(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL;
+  struct {
+    yk__sds key;
+    int value;
+  } *smap = NULL;
+  int pending = 0;
+  yk__hm_set_incremental(map, 1);
+  for (int i = 0; i < 100000; i++) {
+    yk__hmput(map, i, i);
+    yk__stbds_hash_index *t =
+        yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(map, sizeof(*map)));
+    if (t->old) pending++;
+  }
+  assert(pending > 0);
+  // shrinking is incremental too
+  for (int i = 0; i < 100000; i++) {
+    if (i % 10) assert(yk__hmdel(map, i));
+    assert(yk__hmget(map, i - i % 10) == i - i % 10);
+  }
+  assert(yk__hmlen(map) == 10000);
+  for (int i = 0; i < 100000; i++) {
+    ptrdiff_t at = yk__hmgeti(map, i);
+    assert(i % 10 ? at == -1 : map[at].value == i);
+  }
+  yk__hm_set_incremental(map, 0);
+  assert(yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(map, sizeof(*map)))->old ==
+         NULL);
+  yk__hmfree(map);
+  yk__sh_new_strdup(smap);
+  yk__sh_set_incremental(smap, 1);
+  for (int i = 0; i < 3000; i++) {
+    yk__sds s = yk__sdscatprintf(yk__sdsempty(), "key %d", i);
+    yk__shput(smap, s, i);
+    yk__shput(smap, s, -i);// overwrite may find the key in the old index
+    assert(yk__shget(smap, s) == -i);
+    yk__sdsfree(s);
+  }
+  assert(yk__shlen(smap) == 3000);
+  yk__shfree(smap);
+}
+static void test_reserve(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL, items[3000];
+  struct {
+    yk__sds key;
+    int value;
+  } *smap = NULL, sitems[2];
+  yk__hmreserve(map, 10000);
+  void *entries = map;
+  void *table = yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(map, sizeof(*map)));
+  for (int i = 0; i < 10000; i++) yk__hmput(map, i, i);
+  assert((void *) map == entries);
+  assert(yk__stbds_hash_table(YK__STBDS_HASH_TO_ARR(map, sizeof(*map))) ==
+         table);
+  // duplicates in the batch and keys already in the map are replaced
+  for (int i = 0; i < 3000; i++) {
+    items[i].key = 9000 + i % 2000;
+    items[i].value = -i;
+  }
+  yk__hmputs_array(map, items, 3000);
+  assert(yk__hmlen(map) == 11000);
+  assert(yk__hmget(map, 9000) == -2000 && yk__hmget(map, 10999) == -1999);
+  assert(yk__hmget(map, 8999) == 8999);
+  yk__hmfree(map);
+  yk__sds first = yk__sdsnew("first");
+  sitems[0].key = yk__sdsnew("first");
+  sitems[0].value = 1;
+  sitems[1].key = yk__sdsnew("second");
+  sitems[1].value = 2;
+  yk__sh_new_strdup(smap);
+  yk__shreserve(smap, 2);
+  yk__shputs_array(smap, sitems, 2);
+  sitems[0].key[0] = 'F';
+  assert(yk__shlen(smap) == 2 && yk__shget(smap, first) == 1);
+  assert(smap[yk__shgeti(smap, sitems[1].key)].key != sitems[1].key);
+  yk__shfree(smap);
+  yk__sdsfree(first);
+  yk__sdsfree(sitems[0].key);
+  yk__sdsfree(sitems[1].key);
+}
+static void test_batch(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL;
+  struct {
+    yk__sds key;
+    int value;
+  } *smap = NULL;
+  int keys[100] = {0};
+  yk__sds skeys[100];
+  ptrdiff_t out[100];
+  yk__hmget_batch(map, keys, 0, out);
+  assert(map != NULL && yk__hmlen(map) == 0);
+  yk__hmdefault(map, -1);
+  for (int i = 0; i < 1000; i++) yk__hmput(map, i * 3, i);
+  yk__sh_new_strdup(smap);
+  for (int i = 0; i < 100; i++) {
+    keys[i] = i * 7;
+    skeys[i] = yk__sdscatprintf(yk__sdsempty(), "%d", i * 7);
+    if (i % 2) yk__shput(smap, skeys[i], i);
+  }
+  yk__hmget_batch(map, keys, 100, out);
+  for (int i = 0; i < 100; i++) {
+    assert(out[i] == yk__hmgeti(map, keys[i]));
+    assert(map[out[i]].value == (i * 7 % 3 ? -1 : i * 7 / 3));
+  }
+  yk__shget_batch(smap, skeys, 100, out);
+  for (int i = 0; i < 100; i++) {
+    assert(i % 2 ? smap[out[i]].value == i : out[i] == -1);
+    yk__sdsfree(skeys[i]);
+  }
+  yk__hmfree(map);
+  yk__shfree(smap);
+}
+static void test_snapshot(void) {
+  struct {
+    int key;
+    double value;
+  } *map = NULL, *loaded = NULL;
+  struct {
+    yk__sds key;
+    int value;
+  } *smap = NULL, *sloaded = NULL;
+  struct {
+    int key;
+    int value;
+  } *wrong = NULL;
+  int *arr = NULL, *larr = NULL;
+  const char *path = "stb_ds_snapshot.bin";
+  yk__hmdefault(map, -1.5);
+  for (int i = 0; i < 5000; i++) yk__hmput(map, i * 11, i / 2.0);
+  for (int i = 0; i < 5000; i += 3) yk__hmdel(map, i * 11);
+  assert(yk__hmsave(map, path) == 0);
+  assert(yk__hmload(wrong, path) == NULL);// different entry size
+  assert(yk__shload(loaded, path) == NULL);// not a string hashmap
+  yk__hmload(loaded, path);
+  assert(loaded != NULL && yk__hmlen(loaded) == yk__hmlen(map));
+  for (int i = 0; i < 5000; i++)
+    assert(yk__hmget(loaded, i * 11) == yk__hmget(map, i * 11));
+  assert(yk__hmget(loaded, 1) == -1.5);
+  yk__hmunload(loaded);
+  assert(loaded == NULL);
+  yk__sh_new_strdup(smap);
+  for (int i = 0; i < 2000; i++) {
+    yk__sds s = yk__sdscatprintf(yk__sdsempty(), "key number %d", i);
+    yk__shput(smap, s, i);
+    yk__sdsfree(s);
+  }
+  assert(yk__shsave(smap, path) == 0);
+  yk__shload(sloaded, path);
+  assert(sloaded != NULL && yk__shlen(sloaded) == 2000);
+  for (int i = 0; i < 2000; i++) {
+    yk__sds s = yk__sdscatprintf(yk__sdsempty(), "key number %d", i);
+    ptrdiff_t at = yk__shgeti(sloaded, s);
+    assert(at >= 0 && sloaded[at].value == i);
+    assert(yk__sdscmp(sloaded[at].key, s) == 0);
+    yk__sdsfree(s);
+  }
+  yk__shunload(sloaded);
+  for (int i = 0; i < 100; i++) yk__arrput(arr, i * i);
+  assert(yk__arrsave(arr, path) == 0);
+  yk__arrload(larr, path);
+  assert(yk__arrlen(larr) == 100 && memcmp(arr, larr, 100 * sizeof(int)) == 0);
+  yk__arrunload(larr);
+  remove(path);
+  yk__hmfree(map);
+  yk__shfree(smap);
+  yk__arrfree(arr);
+}
+// overwrite 'size' bytes at 'offset' of the snapshot file
+static void corrupt_snapshot(const char *path, size_t offset, const void *data,
+                             size_t size) {
+  FILE *f = fopen(path, "r+b");
+  assert(f != NULL && fseek(f, (long) offset, SEEK_SET) == 0);
+  assert(fwrite(data, 1, size, f) == size && fclose(f) == 0);
+}
+static void test_snapshot_corrupt(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL, *loaded = NULL;
+  struct {
+    yk__sds key;
+    int value;
+  } *smap = NULL, *sloaded = NULL;
+  const char *path = "stb_ds_corrupt.bin";
+  yk__stbds_snapshot_header snap;
+  yk__stbds_hash_index table;
+  yk__stbds_hash_bucket bucket;
+  size_t huge = (size_t) 1 << 40, offset;
+  FILE *f;
+  for (int i = 0; i < 100; i++) yk__hmput(map, i, i);
+  // entry count past the end of the file
+  assert(yk__hmsave(map, path) == 0);
+  corrupt_snapshot(path, YK__STBDS_SNAPSHOT_ARRAY_OFFSET, &huge, sizeof(huge));
+  assert(yk__hmload(loaded, path) == NULL);
+  // hash index at the end of the file
+  assert(yk__hmsave(map, path) == 0);
+  f = fopen(path, "rb");
+  assert(fread(&snap, sizeof(snap), 1, f) == 1);
+  fseek(f, (long) snap.index_offset, SEEK_SET);
+  assert(fread(&table, sizeof(table), 1, f) == 1);
+  fseek(f, (long) (size_t) table.storage, SEEK_SET);
+  assert(fread(&bucket, sizeof(bucket), 1, f) == 1);
+  fclose(f);
+  offset = snap.size - 8;
+  corrupt_snapshot(path, offsetof(yk__stbds_snapshot_header, index_offset),
+                   &offset, sizeof(offset));
+  assert(yk__hmload(loaded, path) == NULL);
+  // slots of the first bucket pointing past the entries
+  assert(yk__hmsave(map, path) == 0);
+  for (int j = 0; j < YK__STBDS_BUCKET_LENGTH; j++) {
+    bucket.hash[j] = 2;
+    bucket.index[j] = 100000;
+  }
+  corrupt_snapshot(path, (size_t) table.storage, &bucket, sizeof(bucket));
+  assert(yk__hmload(loaded, path) == NULL);
+  // an index without an empty slot would never end a probe
+  assert(yk__hmsave(map, path) == 0);
+  f = fopen(path, "r+b");
+  fseek(f, (long) (size_t) table.storage, SEEK_SET);
+  for (size_t i = 0; i < table.slot_count >> YK__STBDS_BUCKET_SHIFT; i++) {
+    fseek(f, 0, SEEK_CUR);// switching from reading to writing
+    assert(fread(&bucket, sizeof(bucket), 1, f) == 1);
+    for (int j = 0; j < YK__STBDS_BUCKET_LENGTH; j++)
+      if (bucket.hash[j] == YK__STBDS_HASH_EMPTY) {
+        bucket.hash[j] = 2;
+        bucket.index[j] = 0;
+      }
+    fseek(f, -(long) sizeof(bucket), SEEK_CUR);
+    assert(fwrite(&bucket, sizeof(bucket), 1, f) == 1);
+  }
+  fclose(f);
+  assert(yk__hmload(loaded, path) == NULL);
+  // unknown hash function
+  assert(yk__hmsave(map, path) == 0);
+  table.hash_func = 7;
+  corrupt_snapshot(path, snap.index_offset, &table, sizeof(table));
+  assert(yk__hmload(loaded, path) == NULL);
+  // a map with tombstones still loads
+  for (int i = 0; i < 100; i += 3) yk__hmdel(map, i);
+  assert(yk__hmsave(map, path) == 0);
+  yk__hmload(loaded, path);// still fine when untouched
+  assert(loaded != NULL && yk__hmget(loaded, 43) == 43);
+  assert(yk__hmgeti(loaded, 42) < 0);
+  yk__hmunload(loaded);
+  // string key offset outside the key strings
+  yk__sh_new_strdup(smap);
+  for (int i = 0; i < 10; i++) {
+    yk__sds s = yk__sdscatprintf(yk__sdsempty(), "%d", i);
+    yk__shput(smap, s, i);
+    yk__sdsfree(s);
+  }
+  assert(yk__shsave(smap, path) == 0);
+  offset = snap.size - 2;
+  corrupt_snapshot(path,
+                   YK__STBDS_SNAPSHOT_ARRAY_OFFSET +
+                       sizeof(yk__stbds_array_header) + sizeof(*smap),
+                   &offset, sizeof(offset));
+  assert(yk__shload(sloaded, path) == NULL);
+  remove(path);
+  yk__hmfree(map);
+  yk__shfree(smap);
+}
+static void test_stats(void) {
+  struct {
+    int key;
+    int value;
+  } *map = NULL;
+  yk__stbds_hmstats_t stats;
+  yk__hmstats(map, &stats);
+  assert(stats.count == 0 && stats.slot_count == 0);
+  for (int i = 0; i < 1000; i++) yk__hmput(map, i, i);
+  for (int i = 0; i < 100; i++) yk__hmdel(map, i);
+  yk__hmstats(map, &stats);
+  assert(stats.count == 900 && stats.tombstones > 0);
+  assert(stats.load_factor > 0.1 && stats.load_factor <= 0.75);
+  size_t keys = 0;
+  for (int i = 0; i < YK__STBDS_PROBE_HISTOGRAM; i++)
+    keys += stats.probe_histogram[i];
+  assert(keys == 900 && stats.max_probe >= 1 && stats.avg_probe >= 1.0);
+#ifdef YK__STBDS_STATISTICS
+  assert(stats.inserts == 1000 && stats.grows > 0);
+  assert(stats.lookups >= 100 && stats.insert_probes >= 1000);
+#else
+  assert(stats.inserts == 0 && stats.grows == 0);
+#endif
+  yk__hmfree(map);
+}
+typedef struct {
+  long long id;
+  double weight;
+} payload;
+YK__DEFINE_HASHMAP_SOA(soamap, long long, payload, yk__stbds_hash_size_t,
+                       yk__stbds_equal)
+static void test_soa(void) {
+  static int present[30000];
+  soamap map = {0};
+  unsigned int seed = 7;
+  assert(soamap_geti(&map, 1) == -1 && soamap_get(&map, 1).id == 0);
+  for (int i = 0; i < 200000; i++) {
+    seed = seed * 1103515245u + 12345u;
+    long long key = (seed >> 8) % 30000;
+    if (seed & 0x30) {
+      payload p = {key, key * 0.5};
+      soamap_put(&map, key * 7, p);
+      present[key] = 1;
+    } else {
+      assert(soamap_del(&map, key * 7) == present[key]);
+      present[key] = 0;
+    }
+  }
+  assert(yk__arrlen(map.values) == soamap_len(&map));
+  for (ptrdiff_t i = 0; i < soamap_len(&map); i++) {
+    assert(map.values[i].id * 7 == map.keys[i].key);
+    assert(soamap_geti(&map, map.keys[i].key) == i);
+  }
+  for (long long key = 0; key < 30000; key++) {
+    payload *p = soamap_getp_null(&map, key * 7);
+    assert(present[key] ? p && p->weight == key * 0.5 : p == NULL);
+  }
+  soamap_free(&map);
+}
+static void test_set(void) {
+  long long *evens = NULL, *triples = NULL;
+  for (long long i = 0; i < 3000; i++) {
+    yk__setput(evens, i * 2);
+    yk__setput(evens, i * 2);// already there
+    yk__setput(triples, i * 3);
+  }
+  assert(yk__setlen(evens) == 3000 && yk__sethas(evens, 100));
+  assert(!yk__sethas(evens, 101) && yk__setgeti(evens, 7) == -1);
+  assert(evens[yk__setgeti(evens, 10)] == 10);
+  assert(yk__setdel(evens, 10) && !yk__setdel(evens, 10));
+  long long *both = NULL;
+  yk__setunion(both, evens);
+  yk__setintersect(both, triples);
+  // the multiples of 6 below 6000
+  assert(yk__setlen(both) == 1000);
+  for (ptrdiff_t i = 0; i < yk__setlen(both); i++) assert(both[i] % 6 == 0);
+  yk__setunion(both, triples);
+  assert(yk__setlen(both) == 3000 && yk__sethas(both, 8997));
+  yk__setintersect(both, NULL);
+  assert(yk__setlen(both) == 0);
+  yk__setfree(both);
+  yk__setfree(evens);
+  yk__setfree(triples);
+  // identifier deduplication with string keys
+  yk__sds *names = NULL, *other = NULL;
+  yk__sh_new_strdup(names);
+  yk__sh_new_arena(other);
+  for (int i = 0; i < 2000; i++) {
+    yk__sds s = yk__sdscatprintf(yk__sdsempty(), "id_%d", i % 500);
+    yk__ssetput(names, s);
+    if (i % 2) yk__ssetput(other, s);
+    yk__sdsfree(s);
+  }
+  assert(yk__ssetlen(names) == 500 && yk__ssetlen(other) == 250);
+  yk__sds probe = yk__sdsnew("id_499");
+  assert(yk__ssethas(names, probe) && yk__ssethas(other, probe));
+  assert(yk__ssetdel(names, probe) && !yk__ssethas(names, probe));
+  yk__ssetintersect(names, other);
+  assert(yk__ssetlen(names) == 249);
+  yk__ssetunion(names, other);
+  assert(yk__ssetlen(names) == 250 && yk__ssethas(names, probe));
+  assert(names[yk__ssetgeti(names, probe)] != probe);// strdup made a copy
+  yk__sdsfree(probe);
+  yk__ssetfree(names);
+  yk__ssetfree(other);
+}
+static void test_arena(void) {
+  struct {
+    yk__sds key;
+    int value;
+  } *map = NULL;
+  yk__sh_new_arena(map);
+  for (int i = 0; i < 5000; i++) {
+    // embedded zero bytes, some keys bigger than an arena block
+    yk__sds key = yk__sdsnewlen("k\0", 2);
+    key = yk__sdscatprintf(key, "%d", i);
+    if (i % 1000 == 0) key = yk__sdsgrowzero(key, 600 + i);
+    yk__shput(map, key, i);
+    assert(map[yk__shlen(map) - 1].key != key);// the map has its own copy
+    yk__sdsfree(key);
+  }
+  for (int i = 0; i < 5000; i += 2) {
+    yk__sds key = yk__sdscatprintf(yk__sdsnewlen("k\0", 2), "%d", i);
+    if (i % 1000 == 0) key = yk__sdsgrowzero(key, 600 + i);
+    assert(yk__shdel(map, key));
+    yk__sdsfree(key);
+  }
+  for (int i = 0; i < 5000; i++) {
+    yk__sds key = yk__sdscatprintf(yk__sdsnewlen("k\0", 2), "%d", i);
+    ptrdiff_t at = yk__shgeti(map, key);
+    assert(i % 2 ? map[at].value == i : at == -1);
+    yk__sdsfree(key);
+  }
+  // cached hashes are copied into the arena too
+  yk__sds hashed = yk__sdsnewhashed("hashed", 6);
+  yk__shput(map, hashed, 1);
+  yk__sds stored = map[yk__shlen(map) - 1].key;
+  assert(stored != hashed && (stored[-1] & YK__SDS_HASH_VALID));
+  assert(yk__shget(map, hashed) == 1);
+  yk__sdsfree(hashed);
+  yk__shfree(map);
+}
+YK__DEFINE_HASHMAP(intmap, long long, int, yk__stbds_hash_size_t,
+                   yk__stbds_equal)
+static size_t str_hash(const char *s, size_t seed) {
+  return yk__stbds_hash_bytes_fast((void *) s, strlen(s), seed);
+}
+#define str_equal(a, b) (strcmp((a), (b)) == 0)
+YK__DEFINE_HASHMAP(strmap, const char *, int, str_hash, str_equal)
+static void test_typed(void) {
+  static int present[30000];
+  for (int incremental = 0; incremental < 2; incremental++) {
+    intmap_entry *map = NULL;
+    assert(intmap_geti(map, 1) == -1 && intmap_get(map, 1) == 0);
+    assert(!intmap_del(&map, 1));
+    yk__hm_set_incremental(map, incremental);
+    yk__hmdefault(map, -1);
+    memset(present, 0, sizeof(present));
+    unsigned int seed = 1;
+    for (int i = 0; i < 200000; i++) {
+      seed = seed * 1103515245u + 12345u;
+      long long key = (seed >> 8) % 30000;
+      if (seed & 0x30) {
+        intmap_put(&map, key * 1000003, (int) key);
+        present[key] = 1;
+      } else {
+        assert(intmap_del(&map, key * 1000003) == present[key]);
+        present[key] = 0;
+      }
+    }
+    ptrdiff_t count = 0;
+    for (long long key = 0; key < 30000; key++) {
+      count += present[key];
+      assert(intmap_get(map, key * 1000003) == (present[key] ? key : -1));
+      assert(!intmap_getp_null(map, key * 1000003) == !present[key]);
+    }
+    assert(yk__hmlen(map) == count);
+    for (ptrdiff_t i = 0; i < yk__hmlen(map); i++)
+      assert(intmap_geti(map, map[i].key) == i);
+    yk__hmfree(map);
+  }
+  if (sizeof(size_t) == 8)
+    assert(yk__stbds_hash_size_t(12345, 99) ==
+           yk__stbds_hash_bytes(&(size_t){12345}, 8, 99));
+  strmap_entry *smap = NULL;
+  char *keys[1000];
+  for (int i = 0; i < 1000; i++) {
+    keys[i] = malloc(16);
+    snprintf(keys[i], 16, "key %d", i);
+    strmap_put(&smap, keys[i], i);
+  }
+  for (int i = 0; i < 1000; i += 2) assert(strmap_del(&smap, keys[i]));
+  for (int i = 0; i < 1000; i++) {
+    ptrdiff_t at = strmap_geti(smap, keys[i]);
+    assert(i % 2 ? smap[at].value == i : at == -1);
+  }
+  assert(strmap_get(smap, "key 999") == 999);
+  assert(strmap_geti(smap, "missing") < 0);
+  yk__hmfree(smap);
+  for (int i = 0; i < 1000; i++) free(keys[i]);
+}
+typedef struct {
+  long long a, b, c;
+} triple;
+static void test_hash_funcs(void) {
+  int funcs[] = {YK__STBDS_HASH_FUNC_DEFAULT, YK__STBDS_HASH_FUNC_FAST,
+                 YK__STBDS_HASH_FUNC_SIPHASH};
+  for (int f = 0; f < 3; f++) {
+    struct {
+      triple key;
+      int value;
+    } *map = NULL;
+    struct {
+      yk__sds key;
+      int value;
+    } *smap = NULL;
+    yk__hm_set_hash(map, funcs[f]);
+    yk__sh_new_strdup(smap);
+    yk__sh_set_hash(smap, funcs[f]);
+    for (int i = 0; i < 5000; i++) {
+      triple k = {i, i * 3, -i};
+      yk__sds s = yk__sdscatprintf(yk__sdsempty(), "key %d", i);
+      yk__hmput(map, k, i);
+      yk__shput(smap, s, i);
+      yk__sdsfree(s);
+    }
+    for (int i = 0; i < 5000; i++) {
+      triple k = {i, i * 3, -i};
+      yk__sds s = yk__sdscatprintf(yk__sdsempty(), "key %d", i);
+      assert(yk__hmget(map, k) == i && yk__shget(smap, s) == i);
+      yk__sdsfree(s);
+    }
+    yk__hmfree(map);
+    yk__shfree(smap);
+  }
+  // the same bytes hash the same, whatever the function
+  char bytes[100] = "0123456789";
+  assert(yk__stbds_hash_bytes_fast(bytes, 100, 1) ==
+         yk__sdshashlen(bytes, 100, 1));
+  assert(yk__stbds_hash_bytes_fast(bytes, 100, 1) !=
+         yk__stbds_hash_bytes_fast(bytes, 100, 2));
+  assert(yk__stbds_hash_bytes_siphash(bytes, 99, 1) !=
+         yk__stbds_hash_bytes_siphash(bytes, 100, 1));
+}
+int main(void) {
+  test_intern();
+  test_hash_funcs();
+  test_int_map();
+  test_hashed_keys();
+  test_incremental();
+  test_reserve();
+  test_batch();
+  test_snapshot();
+  test_snapshot_corrupt();
+  test_stats();
+  test_typed();
+  test_arena();
+  test_soa();
+  test_set();
+  printf("stb_ds_patched_test done\n");
+  return 0;
+}
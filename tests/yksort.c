@@ -5,9 +5,515 @@
 #define YK__BHALIB_IMPLEMENTATION
 #define YK__SORT_IMPLEMENTATION
 #include "yk__lib.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
 
+typedef struct {
+  int key;
+  char payload[20];
+} record;
 int compare_int(const void* a, const void* b) {
-  return *((const int*)a) - *((const int*)b);
+  int x = *((const int*)a), y = *((const int*)b);
+  return (x > y) - (x < y);
+}
+int compare_char(const void* a, const void* b) {
+  return *((const unsigned char*)a) - *((const unsigned char*)b);
+}
+int compare_record(const void* a, const void* b) {
+  return compare_int(&((const record*)a)->key, &((const record*)b)->key);
+}
+static long comparisons = 0;
+int counting_compare_int(const void* a, const void* b) {
+  comparisons++;
+  return compare_int(a, b);
+}
+enum { RANDOM, SORTED, REVERSED, SAWTOOTH, DUPLICATES, ORGAN_PIPE, PATTERNS };
+static void fill(int* x, int n, int pattern) {
+  for (int i = 0; i < n; i++) {
+    switch (pattern) {
+      case RANDOM: x[i] = rand(); break;
+      case SORTED: x[i] = i; break;
+      case REVERSED: x[i] = n - i; break;
+      case SAWTOOTH: x[i] = i % 100; break;
+      case DUPLICATES: x[i] = rand() % 4; break;
+      default: x[i] = i < n / 2 ? i : n - i; break;
+    }
+  }
+}
+static void check_sorted(int* x, int* copy, int n) {
+  long long sum = 0;
+  for (int i = 0; i < n; i++) sum += x[i] - copy[i];
+  for (int i = 1; i < n; i++) assert(x[i - 1] <= x[i]);
+  assert(sum == 0);
+}
+static void test_patterns(void) {
+  int sizes[] = {0, 1, 2, 3, 23, 24, 25, 100, 128, 129, 1000, 100000};
+  for (int s = 0; s < (int)(sizeof(sizes) / sizeof(int)); s++) {
+    int n = sizes[s];
+    int* x = malloc(sizeof(int) * (n + 1));
+    int* copy = malloc(sizeof(int) * (n + 1));
+    for (int p = 0; p < PATTERNS; p++) {
+      fill(x, n, p);
+      memcpy(copy, x, sizeof(int) * n);
+      comparisons = 0;
+      assert(yk__quicksort(x, sizeof(int), n, counting_compare_int) == 0);
+      check_sorted(x, copy, n);
+      if (n == 100000) assert(comparisons < 3L * n * 17);
+      if (n == 100000 && (p == SORTED || p == REVERSED || p == DUPLICATES))
+        assert(comparisons < 4L * n);// linear on these patterns
+    }
+    free(x);
+    free(copy);
+  }
+}
+static void test_item_sizes(void) {
+  unsigned char bytes[1000];
+  record records[1000];
+  char tmp[sizeof(record)];
+  for (int i = 0; i < 1000; i++) {
+    bytes[i] = (unsigned char)rand();
+    records[i].key = rand() % 100;
+    sprintf(records[i].payload, "%d", records[i].key);
+  }
+  assert(yk__quicksort(bytes, 1, 1000, compare_char) == 0);
+  for (int i = 1; i < 1000; i++) assert(bytes[i - 1] <= bytes[i]);
+  assert(yk__quicksort_ex(records, sizeof(record), 1000, compare_record,
+                          tmp) == 0);
+  for (int i = 0; i < 1000; i++) {
+    assert(i == 0 || records[i - 1].key <= records[i].key);
+    assert(atoi(records[i].payload) == records[i].key);
+  }
+  // each size has its own swap, the last byte of a record is its key too
+  int sizes[] = {8, 16, 32, 40, 64};
+  for (int s = 0; s < 5; s++) {
+    int size = sizes[s];
+    char* wide = malloc(size * 1000);
+    for (int i = 0; i < 1000; i++) {
+      int key = rand() % 100;
+      memcpy(wide + i * size, &key, sizeof(int));
+      memset(wide + i * size + sizeof(int), key, size - sizeof(int));
+    }
+    assert(yk__quicksort(wide, size, 1000, compare_int) == 0);
+    for (int i = 0; i < 1000; i++) {
+      char* r = wide + i * size;
+      assert(i == 0 || compare_int(r - size, r) <= 0);
+      assert(r[size - 1] == (char)*(int*)r);
+    }
+    free(wide);
+  }
+}
+#define record_less(a, b) ((a).key < (b).key)
+YK__DEFINE_SORT(sort_records, record, record_less)
+static void test_typed(void) {
+  int n = 100000;
+  int32_t* x = malloc(sizeof(int32_t) * n);
+  int32_t* copy = malloc(sizeof(int32_t) * n);
+  for (int p = 0; p < PATTERNS; p++) {
+    fill(x, n, p);
+    memcpy(copy, x, sizeof(int32_t) * n);
+    yk__sort_i32(x, n);
+    check_sorted(x, copy, n);
+  }
+  free(x);
+  free(copy);
+  uint8_t bytes[1000];
+  for (int i = 0; i < 1000; i++) bytes[i] = (uint8_t)rand();
+  yk__sort_u8(bytes, 1000);
+  for (int i = 1; i < 1000; i++) assert(bytes[i - 1] <= bytes[i]);
+  double d[200];
+  for (int i = 0; i < 200; i++) d[i] = i % 10 == 0 ? NAN : rand() - 1e9;
+  yk__sort_f64(d, 200);
+  for (int i = 1; i < 180; i++) assert(d[i - 1] <= d[i]);
+  for (int i = 180; i < 200; i++) assert(isnan(d[i]));// NaNs go last
+  record records[1000];
+  for (int i = 0; i < 1000; i++) {
+    records[i].key = rand() % 100;
+    sprintf(records[i].payload, "%d", records[i].key);
+  }
+  sort_records(records, 1000);
+  for (int i = 0; i < 1000; i++) {
+    assert(i == 0 || records[i - 1].key <= records[i].key);
+    assert(atoi(records[i].payload) == records[i].key);
+  }
+}
+// McIlroy's "A Killer Adversary for Quicksort": values are decided lazily
+// during the sort so that every pivot is as bad as possible
+static int* adversary_val;
+static int adversary_gas, adversary_solid, adversary_candidate;
+int adversary_compare(const void* a, const void* b) {
+  int x = *((const int*)a), y = *((const int*)b);
+  comparisons++;
+  if (adversary_val[x] == adversary_gas && adversary_val[y] == adversary_gas) {
+    adversary_val[x == adversary_candidate ? x : y] = adversary_solid++;
+  }
+  if (adversary_val[x] == adversary_gas) {
+    adversary_candidate = x;
+  } else if (adversary_val[y] == adversary_gas) {
+    adversary_candidate = y;
+  }
+  return adversary_val[x] - adversary_val[y];
+}
+static void test_adversary(void) {
+  int n = 100000;
+  int* x = malloc(sizeof(int) * n);
+  adversary_val = malloc(sizeof(int) * n);
+  adversary_gas = n;
+  adversary_solid = adversary_candidate = 0;
+  for (int i = 0; i < n; i++) {
+    x[i] = i;
+    adversary_val[i] = adversary_gas;
+  }
+  comparisons = 0;
+  assert(yk__quicksort(x, sizeof(int), n, adversary_compare) == 0);
+  printf("adversary: %ld comparisons for %d elements\n", comparisons, n);
+  assert(comparisons < 3L * n * 17);
+  for (int i = 1; i < n; i++)
+    assert(adversary_val[x[i - 1]] <= adversary_val[x[i]]);
+  free(x);
+  free(adversary_val);
+}
+#define adversary_less(a, b) (adversary_compare(&(a), &(b)) < 0)
+YK__DEFINE_SORT(sort_adversary, int, adversary_less)
+static void test_typed_adversary(void) {
+  int n = 100000;
+  int* x = malloc(sizeof(int) * n);
+  adversary_val = malloc(sizeof(int) * n);
+  adversary_gas = n;
+  adversary_solid = adversary_candidate = 0;
+  for (int i = 0; i < n; i++) {
+    x[i] = i;
+    adversary_val[i] = adversary_gas;
+  }
+  comparisons = 0;
+  sort_adversary(x, n);
+  assert(comparisons < 3L * n * 17);
+  for (int i = 1; i < n; i++)
+    assert(adversary_val[x[i - 1]] <= adversary_val[x[i]]);
+  free(x);
+  free(adversary_val);
+}
+typedef struct {
+  int32_t key;
+  int32_t order;
+} keyed;
+uint64_t keyed_key(const void* item) {
+  return yk__radix_key_i32(((const keyed*)item)->key);
+}
+static void test_radix(void) {
+  int n = 100000;
+  uint32_t* u32 = malloc(sizeof(uint32_t) * n);
+  uint64_t* u64 = malloc(sizeof(uint64_t) * n);
+  int64_t* i64 = malloc(sizeof(int64_t) * n);
+  double* f64 = malloc(sizeof(double) * n);
+  keyed* records = malloc(sizeof(keyed) * n);
+  for (int i = 0; i < n; i++) {
+    u32[i] = (uint32_t)rand() * 2654435761u;
+    u64[i] = (uint64_t)rand() << 40 ^ (uint64_t)rand();
+    i64[i] = ((int64_t)rand() - RAND_MAX / 2) * (i % 3 ? 1 : 1000000007LL);
+    f64[i] = (rand() - RAND_MAX / 2) / 1000.0;
+    records[i].key = rand() % 1000 - 500;
+    records[i].order = i;
+  }
+  f64[0] = -INFINITY;
+  f64[1] = INFINITY;
+  f64[2] = -0.0;
+  f64[3] = 0.0;
+  assert(yk__radixsort_u32(u32, n) == 0);
+  assert(yk__radixsort_u64(u64, n) == 0);
+  assert(yk__radixsort_i64(i64, n) == 0);
+  assert(yk__radixsort_f64(f64, n) == 0);
+  assert(yk__radixsort_key(records, sizeof(keyed), n, keyed_key) == 0);
+  for (int i = 1; i < n; i++) {
+    assert(u32[i - 1] <= u32[i] && u64[i - 1] <= u64[i]);
+    assert(i64[i - 1] <= i64[i] && f64[i - 1] <= f64[i]);
+    assert(records[i - 1].key <= records[i].key);
+    if (records[i - 1].key == records[i].key)
+      assert(records[i - 1].order < records[i].order);// stable
+  }
+  assert(f64[0] == -INFINITY && f64[n - 1] == INFINITY);
+  // one pass for the low byte, the others are the same for all keys
+  uint32_t small[] = {0x1234567f, 0x12345601, 0x12345680};
+  uint32_t scratch[3];
+  yk__radixsort_u32_ex(small, 3, scratch);
+  assert(small[0] == 0x12345601 && small[2] == 0x12345680);
+  free(u32);
+  free(u64);
+  free(i64);
+  free(f64);
+  free(records);
+}
+static void test_radix_sds(void) {
+  int n = 20000;
+  yk__sds* strings = malloc(sizeof(yk__sds) * n);
+  for (int i = 0; i < n; i++) {
+    switch (i % 4) {
+      case 0:
+        strings[i] = yk__sdscatprintf(yk__sdsempty(), "%d", rand());
+        break;
+      case 1: strings[i] = yk__sdsnewlen("a\0b", rand() % 4); break;
+      case 2:
+        // a long common prefix
+        strings[i] = yk__sdsgrowzero(yk__sdsempty(), 300);
+        strings[i] = yk__sdscatprintf(strings[i], "%d", rand() % 500);
+        break;
+      default: strings[i] = yk__sdsempty(); break;
+    }
+  }
+  assert(yk__radixsort_sds(strings, n) == 0);
+  for (int i = 1; i < n; i++)
+    assert(yk__sdscmp(strings[i - 1], strings[i]) <= 0);
+  for (int i = 0; i < n; i++) yk__sdsfree(strings[i]);
+  free(strings);
+}
+static void check_stable(keyed* records, int n) {
+  for (int i = 1; i < n; i++) {
+    assert(records[i - 1].key <= records[i].key);
+    if (records[i - 1].key == records[i].key)
+      assert(records[i - 1].order < records[i].order);
+  }
+}
+int compare_keyed(const void* a, const void* b) {
+  return compare_int(&((const keyed*)a)->key, &((const keyed*)b)->key);
+}
+static void test_stable(void) {
+  int sizes[] = {0, 1, 2, 63, 64, 65, 1000, 100000};
+  int n_max = 100000;
+  int* x = malloc(sizeof(int) * n_max);
+  int* copy = malloc(sizeof(int) * n_max);
+  keyed* records = malloc(sizeof(keyed) * n_max);
+  keyed scratch[100];
+  for (int s = 0; s < 8; s++) {
+    int n = sizes[s];
+    for (int p = 0; p < PATTERNS; p++) {
+      fill(x, n, p);
+      memcpy(copy, x, sizeof(int) * n);
+      comparisons = 0;
+      assert(yk__stablesort(x, sizeof(int), n, counting_compare_int) == 0);
+      check_sorted(x, copy, n);
+      if (n == 100000 && (p == SORTED || p == REVERSED))
+        assert(comparisons < n);// a single run
+      // keys with many duplicates, merged with 1, 7 and 100 scratch elements
+      for (int k = 0; k < 3; k++) {
+        for (int i = 0; i < n; i++) {
+          records[i].key = copy[i] % 50;
+          records[i].order = i;
+        }
+        yk__stablesort_ex(records, sizeof(keyed), n, compare_keyed, scratch,
+                          k == 0 ? 1 : (k == 1 ? 7 : 100));
+        check_stable(records, n);
+      }
+    }
+  }
+  // nearly sorted, a few swapped elements and a sorted tail appended
+  for (int i = 0; i < n_max; i++) x[i] = i < n_max - 500 ? i : rand();
+  for (int i = 0; i < 100; i++) {
+    int a = rand() % n_max, b = rand() % n_max, t = x[a];
+    x[a] = x[b];
+    x[b] = t;
+  }
+  memcpy(copy, x, sizeof(int) * n_max);
+  comparisons = 0;
+  assert(yk__stablesort(x, sizeof(int), n_max, counting_compare_int) == 0);
+  check_sorted(x, copy, n_max);
+  printf("stable sort: %ld comparisons for %d nearly sorted elements\n",
+         comparisons, n_max);
+  free(x);
+  free(copy);
+  free(records);
+}
+static void check_nth(int* x, int* sorted, int n, int nth) {
+  assert(x[nth] == sorted[nth]);
+  for (int i = 0; i < nth; i++) assert(x[i] <= x[nth]);
+  for (int i = nth + 1; i < n; i++) assert(x[i] >= x[nth]);
+}
+// same pseudo random values every time
+static void refill(int* x, int n, int pattern) {
+  srand(7);
+  fill(x, n, pattern);
+}
+static void test_select(void) {
+  int sizes[] = {1, 2, 23, 24, 200, 100000};
+  int n_max = 100000;
+  int* x = malloc(sizeof(int) * n_max);
+  int* sorted = malloc(sizeof(int) * n_max);
+  int* heap = malloc(sizeof(int) * n_max);
+  for (int s = 0; s < 6; s++) {
+    int n = sizes[s];
+    int picks[] = {0, n / 10, n / 2, n - 1};
+    for (int p = 0; p < PATTERNS; p++) {
+      refill(sorted, n, p);
+      yk__sort_i32(sorted, n);
+      for (int k = 0; k < 4; k++) {
+        int nth = picks[k];
+        refill(x, n, p);
+        comparisons = 0;
+        assert(yk__nth_element(x, sizeof(int), n, nth, counting_compare_int) ==
+               0);
+        check_nth(x, sorted, n, nth);
+        if (n == 100000) assert(comparisons < 6L * n);// no full sort
+        refill(x, n, p);
+        yk__sort_i32_nth_element(x, n, nth);
+        check_nth(x, sorted, n, nth);
+        // nth + 1 smallest, sorted
+        refill(x, n, p);
+        assert(yk__partial_sort(x, sizeof(int), n, nth + 1, compare_int) == 0);
+        for (int i = 0; i <= nth; i++) assert(x[i] == sorted[i]);
+        refill(x, n, p);
+        yk__sort_i32_partial_sort(x, n, nth + 1);
+        for (int i = 0; i <= nth; i++) assert(x[i] == sorted[i]);
+        for (int i = nth + 1; i < n; i++) assert(x[i] >= x[nth]);
+      }
+    }
+    fill(x, n, RANDOM);
+    memcpy(sorted, x, sizeof(int) * n);
+    yk__sort_i32(sorted, n);
+    // streaming, the k smallest of n items with k from 0 to above n
+    for (int k = 0; k <= n + 1; k += n / 3 + 1) {
+      yk__topk topk;
+      size_t count = 0;
+      int typed[200];
+      yk__topk_init(&topk, heap, sizeof(int), k, compare_int);
+      for (int i = 0; i < n; i++) {
+        yk__topk_push(&topk, &x[i]);
+        if (k <= 200) count = yk__sort_i32_topk_push(typed, count, k, x[i]);
+      }
+      assert(yk__topk_sort(&topk) == (size_t)(k < n ? k : n));
+      for (int i = 0; i < k && i < n; i++) assert(heap[i] == sorted[i]);
+      if (k <= 200) {
+        yk__sort_i32_topk_sort(typed, count);
+        for (int i = 0; i < k && i < n; i++) assert(typed[i] == sorted[i]);
+      }
+    }
+  }
+  // nothing to do past the end
+  int one[] = {2, 1};
+  yk__nth_element(one, sizeof(int), 2, 2, compare_int);
+  yk__partial_sort(one, sizeof(int), 2, 0, compare_int);
+  assert(one[0] == 2 && one[1] == 1);
+  free(x);
+  free(sorted);
+  free(heap);
+}
+typedef struct {
+  char name[24];
+  int order;
+  char payload[228];
+} wide_record;
+static long extracted = 0;
+// the key is the number spelled in name, parsed once per record
+void wide_record_key(const void* item, void* key) {
+  extracted++;
+  *(int*)key = atoi(((const wide_record*)item)->name);
+}
+void keyed_int_key(const void* item, void* key) {
+  *(int*)key = ((const keyed*)item)->key;
+}
+static void test_argsort(void) {
+  int n = 20000;
+  keyed* records = malloc(sizeof(keyed) * n);
+  keyed* copy = malloc(sizeof(keyed) * n);
+  size_t* perm = malloc(sizeof(size_t) * n);
+  size_t* expected = malloc(sizeof(size_t) * n);
+  size_t scratch[3];
+  keyed tmp;
+  for (int i = 0; i < n; i++) {
+    records[i].key = rand() % 100;
+    records[i].order = i;
+  }
+  memcpy(copy, records, sizeof(keyed) * n);
+  assert(yk__argsort(records, sizeof(keyed), n, compare_keyed, perm) == 0);
+  assert(memcmp(copy, records, sizeof(keyed) * n) == 0);// not modified
+  for (int i = 0; i < n; i++) {
+    assert(i == 0 || perm[i - 1] != perm[i]);
+    assert(records[perm[i]].order == (int)perm[i]);
+  }
+  yk__apply_permutation(records, sizeof(keyed), n, perm, &tmp);
+  check_stable(records, n);
+  for (int i = 0; i < n; i++) assert(perm[i] == (size_t)i);
+  // a tiny scratch buffer gives the same order
+  yk__argsort_ex(copy, sizeof(keyed), n, compare_keyed, perm, scratch, 3);
+  yk__apply_permutation(copy, sizeof(keyed), n, perm, &tmp);
+  assert(memcmp(copy, records, sizeof(keyed) * n) == 0);
+  yk__argsort(records, sizeof(keyed), 0, compare_keyed, perm);
+  // cached keys give the same stable order
+  for (int i = 0; i < n; i++) records[i].key = rand() % 100;
+  yk__argsort(records, sizeof(keyed), n, compare_keyed, expected);
+  assert(yk__argsort_by_key(records, sizeof(keyed), n, keyed_int_key,
+                            sizeof(int), compare_int, perm) == 0);
+  assert(memcmp(expected, perm, sizeof(size_t) * n) == 0);
+  free(records);
+  free(expected);
+  free(copy);
+  free(perm);
+  wide_record* wide = malloc(sizeof(wide_record) * n);
+  for (int i = 0; i < n; i++) {
+    sprintf(wide[i].name, "%d", rand() % 1000 - 500);
+    wide[i].order = i;
+    memset(wide[i].payload, i % 128, sizeof(wide[i].payload));
+  }
+  extracted = 0;
+  assert(yk__sort_by_key(wide, sizeof(wide_record), n, wide_record_key,
+                         sizeof(int), compare_int) == 0);
+  assert(extracted == n);
+  for (int i = 0; i < n; i++) {
+    wide_record* w = &wide[i];
+    assert(w->payload[0] == w->order % 128 && w->payload[227] == w->payload[0]);
+    if (i == 0) continue;
+    assert(atoi(w[-1].name) <= atoi(w->name));
+    if (atoi(w[-1].name) == atoi(w->name)) assert(w[-1].order < w->order);
+  }
+  free(wide);
+}
+// not strict weak orderings, the order is unspecified but the sorts must
+// stay inside the array, keep every element and finish
+int compare_less_equal(const void* a, const void* b) {
+  return *((const int*)a) <= *((const int*)b) ? -1 : 1;
+}
+int compare_always_less(const void* a, const void* b) {
+  (void)a;
+  (void)b;
+  return -1;
+}
+#define less_equal(a, b) ((a) <= (b))
+YK__DEFINE_SORT(sort_less_equal, int, less_equal)
+static void check_same_items(int* x, int* copy, int n) {
+  yk__sort_i32(x, n);
+  for (int i = 0; i < n; i++) assert(x[i] == copy[i]);
+}
+static void test_broken_compare(void) {
+  yk__compare_function compares[] = {compare_less_equal, compare_always_less};
+  int sizes[] = {24, 30, 1000}, tmp;
+  for (int c = 0; c < 2; c++) {
+    for (int s = 0; s < 3; s++) {
+      int n = sizes[s];
+      // exact sizes so the sanitizers see any access past the end
+      int* x = malloc(sizeof(int) * n);
+      int* copy = malloc(sizeof(int) * n);
+      size_t* perm = malloc(sizeof(size_t) * n);
+      for (int i = 0; i < n; i++) copy[i] = i % 3;
+      yk__sort_i32(copy, n);
+      memcpy(x, copy, sizeof(int) * n);
+      yk__quicksort(x, sizeof(int), n, compares[c]);
+      check_same_items(x, copy, n);
+      yk__nth_element(x, sizeof(int), n, n / 2, compares[c]);
+      check_same_items(x, copy, n);
+      yk__partial_sort(x, sizeof(int), n, n / 2, compares[c]);
+      check_same_items(x, copy, n);
+      yk__stablesort(x, sizeof(int), n, compares[c]);
+      check_same_items(x, copy, n);
+      yk__argsort(x, sizeof(int), n, compares[c], perm);
+      yk__apply_permutation(x, sizeof(int), n, perm, &tmp);
+      check_same_items(x, copy, n);
+      sort_less_equal(x, n);
+      check_same_items(x, copy, n);
+      sort_less_equal_nth_element(x, n, n / 2);
+      check_same_items(x, copy, n);
+      free(x);
+      free(copy);
+      free(perm);
+    }
+  }
 }
 int main() {
   int x[] = {4, 3, 2, 6, 1, 5, 10, 20, 60, 30, 40, 50};
@@ -16,4 +522,16 @@ int main() {
   for (int i = 0; i < elements; i++) {
     printf("%d\n", x[i]);
   }
-}
\ No newline at end of file
+  test_patterns();
+  test_item_sizes();
+  test_adversary();
+  test_typed();
+  test_typed_adversary();
+  test_radix();
+  test_radix_sds();
+  test_stable();
+  test_select();
+  test_argsort();
+  test_broken_compare();
+  printf("yksort done\n");
+}
@@ -0,0 +1,405 @@
+// Sort benchmark, yk__quicksort against the explicit stack quick sort it
+// replaced and the C library qsort, on random, sorted, reversed, sawtooth
+// and many duplicates inputs, and the YK__DEFINE_SORT based yk__sort_i32,
+// record sizes from 4 to 256 bytes for the size dispatched swaps, radix sorts
+// against the comparison sorts, the stable sort on nearly sorted input,
+// median and smallest 100 by selection against a full sort, 256 byte
+// records sorted in place against argsort and sorting by cached keys
+#define YK__SDS_IMPLEMENTATION
+#define YK__BHALIB_IMPLEMENTATION
+#define YK__STB_DS_IMPLEMENTATION
+#define YK__SORT_IMPLEMENTATION
+#include "yk__lib.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#define ELEMENTS ((size_t) 1 << 20)
+static double now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+static int compare_int(const void *a, const void *b) {
+  int x = *((const int *) a), y = *((const int *) b);
+  return (x > y) - (x < y);
+}
+// yk__quicksort_ex before it became a pattern defeating quick sort, gives up
+// with -1 once its 48 level stack is full
+static int old_quicksort_ex(void *arr, size_t item_size, size_t elements,
+                            yk__compare_function cmp_func, void *piv) {
+  size_t beg[48], end[48], L, R;
+  int i = 0;
+  beg[0] = 0;
+  end[0] = elements;
+  while (i >= 0) {
+    L = beg[i];
+    R = end[i];
+    if (R - L > 1) {
+      size_t M = L + ((R - L) >> 1);
+      memcpy(piv, yk__generic_get(arr, M, item_size), item_size);
+      memcpy(yk__generic_get(arr, M, item_size),
+             yk__generic_get(arr, L, item_size), item_size);
+      if (i == 48 - 1) { return -1; }
+      R--;
+      while (L < R) {
+        while (cmp_func(yk__generic_get(arr, R, item_size), piv) >= 0 &&
+               L < R) {
+          R--;
+        }
+        if (L < R) { yk__generic_swap(arr, L++, R, item_size); }
+        while (cmp_func(yk__generic_get(arr, L, item_size), piv) <= 0 &&
+               L < R) {
+          L++;
+        }
+        if (L < R) { yk__generic_swap(arr, R--, L, item_size); }
+      }
+      memcpy(yk__generic_get(arr, L, item_size), piv, item_size);
+      M = L + 1;
+      while (L > beg[i] &&
+             cmp_func(yk__generic_get(arr, L - 1, item_size), piv) == 0) {
+        L--;
+      }
+      while (M < end[i] &&
+             cmp_func(yk__generic_get(arr, M, item_size), piv) == 0) {
+        M++;
+      }
+      if (L - beg[i] > end[i] - M) {
+        beg[i + 1] = M;
+        end[i + 1] = end[i];
+        end[i++] = L;
+      } else {
+        beg[i + 1] = beg[i];
+        end[i + 1] = L;
+        beg[i++] = M;
+      }
+    } else {
+      i--;
+    }
+  }
+  return 0;
+}
+static const char *patterns[] = {"random", "sorted", "reversed", "sawtooth",
+                                 "duplicates"};
+static void fill(int *x, size_t n, int pattern) {
+  srand(1);
+  for (size_t i = 0; i < n; i++) {
+    switch (pattern) {
+      case 0: x[i] = rand(); break;
+      case 1: x[i] = (int) i; break;
+      case 2: x[i] = (int) (n - i); break;
+      case 3: x[i] = (int) (i % 1000); break;
+      default: x[i] = rand() % 16; break;
+    }
+  }
+}
+// yk__memswap before it swapped words and vectors
+static void byte_swap(void *a, void *b, size_t item_size) {
+  char *a_swap = (char *) a;
+  char *b_swap = (char *) b;
+  char *a_end = a_swap + item_size;
+  while (a_swap < a_end) {
+    char temp = *a_swap;
+    *a_swap = *b_swap;
+    *b_swap = temp;
+    a_swap++;
+    b_swap++;
+  }
+}
+static void bench_record_sizes(void) {
+  size_t sizes[] = {4, 8, 16, 32, 64, 256};
+  printf("record size  sort ms  byte swap ns  yk__memswap ns\n");
+  for (int s = 0; s < 6; s++) {
+    size_t size = sizes[s], n = ((size_t) 64 << 20) / size;
+    char *records = calloc(n, size);
+    char *tmp = malloc(size);
+    double t[3];
+    if (n > ELEMENTS) n = ELEMENTS;
+    srand(1);
+    for (size_t i = 0; i < n; i++) *(int *) (records + i * size) = rand();
+    t[0] = now();
+    yk__quicksort_ex(records, size, n, compare_int, tmp);
+    t[0] = now() - t[0];
+    for (size_t i = 1; i < n; i++)
+      assert(compare_int(records + (i - 1) * size, records + i * size) <= 0);
+    for (int k = 1; k < 3; k++) {
+      size_t j = 0;
+      t[k] = now();
+      for (size_t i = 0; i < n; i++) {
+        j += 7919;
+        if (j >= n) j -= n;
+        if (k == 1) byte_swap(records + i * size, records + j * size, size);
+        else
+          yk__memswap(records + i * size, records + j * size, size);
+      }
+      t[k] = (now() - t[k]) * 1e9 / n;
+    }
+    printf("%11zu %8.1f %13.2f %15.2f\n", size, t[0] * 1e3, t[1], t[2]);
+    free(records);
+    free(tmp);
+  }
+}
+static int compare_sds(const void *a, const void *b) {
+  return yk__sdscmp(*(const yk__sds *) a, *(const yk__sds *) b);
+}
+static void fill_keys(uint32_t *u32, uint64_t *u64, double *f64,
+                      yk__sds *strings) {
+  srand(1);
+  for (size_t i = 0; i < ELEMENTS; i++) {
+    u32[i] = (uint32_t) rand() * 2654435761u;
+    u64[i] = (uint64_t) rand() << 33 ^ (uint64_t) rand();
+    f64[i] = (rand() - RAND_MAX / 2) / 7.0;
+    yk__sdsclear(strings[i]);
+    strings[i] = yk__sdscatprintf(strings[i], "%x", rand());
+  }
+}
+static void bench_radix(void) {
+  uint32_t *u32 = malloc(sizeof(uint32_t) * ELEMENTS);
+  uint64_t *u64 = malloc(sizeof(uint64_t) * ELEMENTS);
+  double *f64 = malloc(sizeof(double) * ELEMENTS);
+  yk__sds *strings = malloc(sizeof(yk__sds) * ELEMENTS);
+  double t[2][4];
+  for (size_t i = 0; i < ELEMENTS; i++) strings[i] = yk__sdsempty();
+  fill_keys(u32, u64, f64, strings);
+  t[0][0] = now();
+  yk__sort_u32(u32, ELEMENTS);
+  t[0][0] = now() - t[0][0];
+  t[0][1] = now();
+  yk__sort_u64(u64, ELEMENTS);
+  t[0][1] = now() - t[0][1];
+  t[0][2] = now();
+  yk__sort_f64(f64, ELEMENTS);
+  t[0][2] = now() - t[0][2];
+  t[0][3] = now();
+  yk__quicksort(strings, sizeof(yk__sds), ELEMENTS, compare_sds);
+  t[0][3] = now() - t[0][3];
+  fill_keys(u32, u64, f64, strings);
+  t[1][0] = now();
+  yk__radixsort_u32(u32, ELEMENTS);
+  t[1][0] = now() - t[1][0];
+  t[1][1] = now();
+  yk__radixsort_u64(u64, ELEMENTS);
+  t[1][1] = now() - t[1][1];
+  t[1][2] = now();
+  yk__radixsort_f64(f64, ELEMENTS);
+  t[1][2] = now() - t[1][2];
+  t[1][3] = now();
+  yk__radixsort_sds(strings, ELEMENTS);
+  t[1][3] = now() - t[1][3];
+  for (size_t i = 1; i < ELEMENTS; i++) {
+    assert(u32[i - 1] <= u32[i] && u64[i - 1] <= u64[i]);
+    assert(f64[i - 1] <= f64[i]);
+    assert(yk__sdscmp(strings[i - 1], strings[i]) <= 0);
+  }
+  printf("%zu keys, ms    comparison sort    radix sort\n", ELEMENTS);
+  const char *names[] = {"u32", "u64", "f64", "sds"};
+  for (int k = 0; k < 4; k++)
+    printf("%-15s %18.1f %13.1f\n", names[k], t[0][k] * 1e3, t[1][k] * 1e3);
+  for (size_t i = 0; i < ELEMENTS; i++) yk__sdsfree(strings[i]);
+  free(u32);
+  free(u64);
+  free(f64);
+  free(strings);
+}
+// sorted with a few random elements swapped in, or with a random tail
+static void fill_nearly_sorted(int *x, size_t n, int pattern) {
+  srand(1);
+  for (size_t i = 0; i < n; i++) x[i] = (int) i;
+  if (pattern == 0) {
+    for (size_t i = 0; i < n / 1000; i++) {
+      size_t a = (size_t) rand() % n, b = (size_t) rand() % n;
+      int t = x[a];
+      x[a] = x[b];
+      x[b] = t;
+    }
+  } else {
+    for (size_t i = n - n / 100; i < n; i++) x[i] = rand();
+  }
+}
+static void bench_stable(int *x) {
+  const char *names[] = {"random", "swapped 0.1%", "random tail 1%"};
+  int *scratch = malloc(sizeof(int) * (ELEMENTS / 2 + 1));
+  int tmp;
+  printf("%zu ints, ms      yk__stablesort  yk__quicksort          qsort\n",
+         ELEMENTS);
+  for (int p = 0; p < 3; p++) {
+    double t[3];
+    for (int k = 0; k < 3; k++) {
+      if (p == 0) fill(x, ELEMENTS, 0);
+      else
+        fill_nearly_sorted(x, ELEMENTS, p - 1);
+      t[k] = now();
+      if (k == 0)
+        yk__stablesort_ex(x, sizeof(int), ELEMENTS, compare_int, scratch,
+                          ELEMENTS / 2 + 1);
+      else if (k == 1)
+        yk__quicksort_ex(x, sizeof(int), ELEMENTS, compare_int, &tmp);
+      else
+        qsort(x, ELEMENTS, sizeof(int), compare_int);
+      t[k] = now() - t[k];
+      for (size_t i = 1; i < ELEMENTS; i++) assert(x[i - 1] <= x[i]);
+    }
+    printf("%-16s %15.1f %14.1f %14.1f\n", names[p], t[0] * 1e3, t[1] * 1e3,
+           t[2] * 1e3);
+  }
+  free(scratch);
+}
+static void bench_select(int *x) {
+  const char *names[] = {"median", "median i32", "smallest 100",
+                         "smallest 100 i32", "top 100 heap"};
+  int tmp, heap[100];
+  printf("%zu ints, ms      selection     full sort\n", ELEMENTS);
+  for (int k = 0; k < 5; k++) {
+    double t[2];
+    int result;
+    fill(x, ELEMENTS, 0);
+    t[0] = now();
+    switch (k) {
+      case 0:
+        yk__nth_element_ex(x, sizeof(int), ELEMENTS, ELEMENTS / 2,
+                           compare_int, &tmp);
+        result = x[ELEMENTS / 2];
+        break;
+      case 1:
+        yk__sort_i32_nth_element(x, ELEMENTS, ELEMENTS / 2);
+        result = x[ELEMENTS / 2];
+        break;
+      case 2:
+        yk__partial_sort_ex(x, sizeof(int), ELEMENTS, 100, compare_int, &tmp);
+        result = x[99];
+        break;
+      case 3:
+        yk__sort_i32_partial_sort(x, ELEMENTS, 100);
+        result = x[99];
+        break;
+      default: {
+        yk__topk topk;
+        yk__topk_init(&topk, heap, sizeof(int), 100, compare_int);
+        for (size_t i = 0; i < ELEMENTS; i++) yk__topk_push(&topk, &x[i]);
+        yk__topk_sort(&topk);
+        result = heap[99];
+        break;
+      }
+    }
+    t[0] = now() - t[0];
+    fill(x, ELEMENTS, 0);
+    t[1] = now();
+    if (k == 1 || k == 3) yk__sort_i32(x, ELEMENTS);
+    else
+      yk__quicksort_ex(x, sizeof(int), ELEMENTS, compare_int, &tmp);
+    t[1] = now() - t[1];
+    assert(result == x[k < 2 ? ELEMENTS / 2 : 99]);
+    printf("%-16s %13.1f %13.1f\n", names[k], t[0] * 1e3, t[1] * 1e3);
+  }
+}
+typedef struct {
+  int key;
+  char name[12];// key as a decimal number
+  char payload[240];
+} big_record;
+static int compare_big(const void *a, const void *b) {
+  int x = ((const big_record *) a)->key, y = ((const big_record *) b)->key;
+  return (x > y) - (x < y);
+}
+static int compare_big_name(const void *a, const void *b) {
+  int x = atoi(((const big_record *) a)->name);
+  int y = atoi(((const big_record *) b)->name);
+  return (x > y) - (x < y);
+}
+static void big_record_key(const void *item, void *key) {
+  *(int *) key = atoi(((const big_record *) item)->name);
+}
+static void big_record_int_key(const void *item, void *key) {
+  *(int *) key = ((const big_record *) item)->key;
+}
+static void bench_records(void) {
+  const char *names[] = {"yk__quicksort", "yk__stablesort", "argsort + apply",
+                         "argsort_by_key + apply", "yk__sort_by_key"};
+  size_t n = ((size_t) 64 << 20) / sizeof(big_record);
+  big_record *records = malloc(sizeof(big_record) * n), tmp;
+  size_t *perm = malloc(sizeof(size_t) * n);
+  printf("%zu records of %zu bytes, ms   int key   key in a string\n", n,
+         sizeof(big_record));
+  for (int k = 0; k < 5; k++) {
+    double t[2];
+    for (int parsed = 0; parsed < 2; parsed++) {
+      yk__compare_function cmp = parsed ? compare_big_name : compare_big;
+      srand(1);
+      for (size_t i = 0; i < n; i++) {
+        records[i].key = rand() % 100000000;
+        sprintf(records[i].name, "%d", records[i].key);
+        memset(records[i].payload, (int) i, sizeof(records[i].payload));
+      }
+      t[parsed] = now();
+      switch (k) {
+        case 0: yk__quicksort(records, sizeof(big_record), n, cmp); break;
+        case 1: yk__stablesort(records, sizeof(big_record), n, cmp); break;
+        case 2:
+          yk__argsort(records, sizeof(big_record), n, cmp, perm);
+          yk__apply_permutation(records, sizeof(big_record), n, perm, &tmp);
+          break;
+        case 3:
+          yk__argsort_by_key(records, sizeof(big_record), n,
+                             parsed ? big_record_key : big_record_int_key,
+                             sizeof(int), compare_int, perm);
+          yk__apply_permutation(records, sizeof(big_record), n, perm, &tmp);
+          break;
+        default:
+          yk__sort_by_key(records, sizeof(big_record), n,
+                          parsed ? big_record_key : big_record_int_key,
+                          sizeof(int), compare_int);
+          break;
+      }
+      t[parsed] = now() - t[parsed];
+      for (size_t i = 1; i < n; i++)
+        assert(compare_big(&records[i - 1], &records[i]) <= 0);
+    }
+    printf("%-27s %9.1f %17.1f\n", names[k], t[0] * 1e3, t[1] * 1e3);
+  }
+  free(records);
+  free(perm);
+}
+static int is_sorted(int *x, size_t n) {
+  for (size_t i = 1; i < n; i++)
+    if (x[i - 1] > x[i]) return 0;
+  return 1;
+}
+int main(void) {
+  int *x = malloc(sizeof(int) * ELEMENTS);
+  int tmp;
+  printf("%zu ints, ms      yk__quicksort  old quicksort          qsort"
+         "   yk__sort_i32\n",
+         ELEMENTS);
+  for (int p = 0; p < 5; p++) {
+    double t[4];
+    int old_result;
+    fill(x, ELEMENTS, p);
+    t[0] = now();
+    yk__quicksort_ex(x, sizeof(int), ELEMENTS, compare_int, &tmp);
+    t[0] = now() - t[0];
+    assert(is_sorted(x, ELEMENTS));
+    fill(x, ELEMENTS, p);
+    t[1] = now();
+    old_result = old_quicksort_ex(x, sizeof(int), ELEMENTS, compare_int, &tmp);
+    t[1] = now() - t[1];
+    fill(x, ELEMENTS, p);
+    t[2] = now();
+    qsort(x, ELEMENTS, sizeof(int), compare_int);
+    t[2] = now() - t[2];
+    fill(x, ELEMENTS, p);
+    t[3] = now();
+    yk__sort_i32(x, ELEMENTS);
+    t[3] = now() - t[3];
+    assert(is_sorted(x, ELEMENTS));
+    printf("%-12s %16.1f %14.1f%s %14.1f %14.1f\n", patterns[p], t[0] * 1e3,
+           t[1] * 1e3, old_result == 0 ? " " : "*", t[2] * 1e3, t[3] * 1e3);
+  }
+  printf("* old quicksort gave up, partially sorted\n");
+  bench_stable(x);
+  bench_select(x);
+  free(x);
+  bench_record_sizes();
+  bench_radix();
+  bench_records();
+  return 0;
+}